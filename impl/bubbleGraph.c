@@ -306,107 +306,243 @@ bool maxCandidateDeleteLength(PoaNode *node, double candidateWeight) {
 	return maxDeleteLength;
 }
 
-static bool containsString(stList *strings, char *s) {
-	for(int64_t i=0; i<stList_length(strings); i++) {
-		if(stString_eq(stList_get(strings, i), s)) {
-			return 1;
-		}
-	}
-	return 0;
+/*
+ * K-best enumeration of candidate consensus substrings
+ */
+
+// Search effort allowed per requested string before giving up, which only matters if many paths spell the same string
+#define CANDIDATE_PATH_MAX_EXPANSIONS_PER_STRING_AND_POSITION 16
+
+typedef struct _candidateEdge {
+	int64_t to; // The position following the edge
+	double score; // Log-weight of the edge
+	char *string; // The expanded string the edge adds to the consensus substring
+} CandidateEdge;
+
+typedef struct _candidatePath CandidatePath;
+
+struct _candidatePath {
+	CandidatePath *prefix; // The path preceding the last edge, or NULL for the empty path
+	CandidateEdge *edge; // The last edge of the path, or NULL for the empty path
+	int64_t position; // The position the path ends at
+	double score; // Sum of the edge scores of the path
+	double bound; // Score of the best completion of the path
+};
+
+static void candidateEdge_destruct(CandidateEdge *edge) {
+	free(edge->string);
+	free(edge);
 }
 
-stList *getCandidateConsensusSubstrings(Poa *poa, int64_t from, int64_t to,
-										double *candidateWeights, double weightAdjustment, int64_t maximumStringNumber) {
+static void addCandidateEdge(stList *edges, int64_t to, double score, char *string) {
+	CandidateEdge *edge = st_malloc(sizeof(CandidateEdge));
+	edge->to = to;
+	edge->score = score;
+	edge->string = string;
+	stList_append(edges, edge);
+}
+
+static double getCandidateLogWeight(double weight, double totalWeight) {
+	// Pseudo-count of one read's worth of weight, so that the always included reference choices have a finite score
+	return log((weight + PAIR_ALIGNMENT_PROB_1) / (totalWeight + PAIR_ALIGNMENT_PROB_1));
+}
+
+static stList *getCandidateEdges(Poa *poa, int64_t position, int64_t to, double candidateWeight) {
 	/*
-	 *  A candidate variant is an edit (either insert, delete or substitution) to the poa reference
-	 *  string with "high" weight. This function returns all possible combinations of candidate variants,
-	 *  each as a new consensus substring, for the interval of the reference string from "from" (inclusive)
-	 *  to "to" (exclusive). Returned list of strings always contains the reference string without edits (the no
-	 *  candidate variants string).
+	 * Gets the edges leaving the given position of the candidate variant lattice: each combination of candidate base and
+	 * repeat count at the node, followed by either nothing, a candidate insert or a candidate delete.
 	 */
+	stList *edges = stList_construct3(0, (void (*)(void *))candidateEdge_destruct);
+	PoaNode *node = stList_get(poa->nodes, position);
+	double totalWeight = getTotalWeight(poa, node);
 
-	// Function is recursive
-
-	// First get suffix substrings
-	stList *suffixes;
-	if(from+1 < to) {
-		suffixes = getCandidateConsensusSubstrings(poa, from+1, to, candidateWeights, weightAdjustment, maximumStringNumber);
+	double totalRepeatCountWeight = 0.0;
+	for(int64_t i=0; i<poa->maxRepeatCount; i++) {
+		totalRepeatCountWeight += node->repeatCountWeights[i];
+	}
 
-		if(suffixes == NULL) { // If too many combinations, return null.
-			return NULL;
-		}
+	// The weight of having no indel is the weight not given to the candidate indels
+	double noIndelWeight = totalWeight;
+	for(int64_t k=0; k<stList_length(node->inserts); k++) {
+		double w = poaInsert_getWeight(stList_get(node->inserts, k));
+		noIndelWeight -= w > candidateWeight ? w : 0.0;
 	}
-	else {
-		suffixes = stList_construct3(0, free);
-		stList_append(suffixes, stString_copy("")); // Start with the empty string
+	for(int64_t k=0; k<stList_length(node->deletes); k++) {
+		double w = poaDelete_getWeight(stList_get(node->deletes, k));
+		noIndelWeight -= w > candidateWeight ? w : 0.0;
 	}
-
-	// Now extend by adding on prefix variants
-	stList *consensusSubstrings = stList_construct3(0, free);
-
-	PoaNode *node = stList_get(poa->nodes, from);
-
-	double candidateWeight = candidateWeights[from] * weightAdjustment;
+	double noIndelScore = getCandidateLogWeight(noIndelWeight > 0.0 ? noIndelWeight : 0.0, totalWeight);
 
 	int64_t i=0;
 	char base;
-	while((base = getNextCandidateBase(poa, node, &i, candidateWeight)) != '-') { // Enumerate the possible bases at the reference node.
+	while((base = getNextCandidateBase(poa, node, &i, candidateWeight)) != '-') {
+		double baseScore = getCandidateLogWeight(node->baseWeights[i-1], totalWeight);
 
 		int64_t repeatCount, l=1;
-		while((repeatCount = getNextCandidateRepeatCount(poa, node, &l, candidateWeight)) != -1) { // Enumerate the possible repeat counts at the reference node.
-			assert(repeatCount != 0);
+		while((repeatCount = getNextCandidateRepeatCount(poa, node, &l, candidateWeight)) != -1) {
+			double score = baseScore + getCandidateLogWeight(node->repeatCountWeights[repeatCount], totalRepeatCountWeight);
 			char *bases = expandChar(base, repeatCount);
 
-			// Create the consensus substrings with no inserts or deletes starting at this node
-			for(int64_t j=0; j<stList_length(suffixes); j++) {
-				stList_append(consensusSubstrings, stString_print("%s%s", bases, stList_get(suffixes, j)));
+			// No indel
+			addCandidateEdge(edges, position+1, score + noIndelScore, stString_copy(bases));
+
+			// Inserts
+			for(int64_t k=0; k<stList_length(node->inserts); k++) {
+				PoaInsert *insert = stList_get(node->inserts, k);
+				if(poaInsert_getWeight(insert) > candidateWeight) {
+					char *expandedInsert = rleString_expand(insert->insert);
+					addCandidateEdge(edges, position+1, score + getCandidateLogWeight(poaInsert_getWeight(insert), totalWeight),
+							stString_print("%s%s", bases, expandedInsert));
+					free(expandedInsert);
+				}
 			}
 
-			// Now add insert cases
-			int64_t k=0;
-			RleString *insert;
-			while((insert = getNextCandidateInsert(node, &k, candidateWeight)) != NULL) {
-				char *expandedInsert = rleString_expand(insert);
-				assert(strlen(expandedInsert) > 0);
-				for(int64_t j=0; j<stList_length(suffixes); j++) {
-					stList_append(consensusSubstrings, stString_print("%s%s%s", bases, expandedInsert, stList_get(suffixes, j)));
+			// Deletes, which skip the following reference positions
+			for(int64_t k=0; k<stList_length(node->deletes); k++) {
+				PoaDelete *delete = stList_get(node->deletes, k);
+				if(poaDelete_getWeight(delete) > candidateWeight) {
+					addCandidateEdge(edges, position+1+delete->length < to ? position+1+delete->length : to,
+							score + getCandidateLogWeight(poaDelete_getWeight(delete), totalWeight), stString_copy(bases));
 				}
-				free(expandedInsert);
 			}
 
-			// Add then deletes
-			k = 0;
-			int64_t deleteLength;
-			while((deleteLength = getNextCandidateDelete(node, &k, candidateWeight)) > 0) {
-				for(int64_t j=0; j<stList_length(suffixes); j++) {
-					char *suffixHaplotype = stList_get(suffixes, j);
+			free(bases);
+		}
+	}
 
-					// Build new deletion
-					char *s = stString_print("%s%s", bases,
-							((int64_t)strlen(suffixHaplotype) - deleteLength >= 0) ? &(suffixHaplotype[deleteLength]) : "");
+	return edges;
+}
 
-					// Add deletion if not already in the set of consensus strings
-					if(!containsString(consensusSubstrings, s)) {
-						stList_append(consensusSubstrings, s);
-					}
-					else {
-						free(s);
-					}
-				}
+static void candidatePathHeap_push(stList *heap, CandidatePath *path) {
+	// Binary max-heap ordered by path bound
+	stList_append(heap, path);
+	int64_t i = stList_length(heap)-1;
+	while(i > 0) {
+		int64_t parent = (i-1)/2;
+		if(((CandidatePath *)stList_get(heap, parent))->bound >= path->bound) {
+			break;
+		}
+		stList_set(heap, i, stList_get(heap, parent));
+		i = parent;
+	}
+	stList_set(heap, i, path);
+}
+
+static CandidatePath *candidatePathHeap_pop(stList *heap) {
+	CandidatePath *top = stList_get(heap, 0);
+	CandidatePath *last = stList_pop(heap);
+	int64_t n = stList_length(heap);
+	if(n > 0) {
+		int64_t i = 0;
+		while(1) {
+			int64_t child = 2*i+1;
+			if(child >= n) {
+				break;
+			}
+			if(child+1 < n && ((CandidatePath *)stList_get(heap, child+1))->bound > ((CandidatePath *)stList_get(heap, child))->bound) {
+				child++;
+			}
+			if(((CandidatePath *)stList_get(heap, child))->bound <= last->bound) {
+				break;
 			}
+			stList_set(heap, i, stList_get(heap, child));
+			i = child;
+		}
+		stList_set(heap, i, last);
+	}
+	return top;
+}
 
-			// Cleanup bases
-			free(bases);
+static char *candidatePath_getString(CandidatePath *path) {
+	stList *strings = stList_construct();
+	while(path->edge != NULL) {
+		stList_append(strings, path->edge->string);
+		path = path->prefix;
+	}
+	stList_reverse(strings);
+	char *string = stString_join2("", strings);
+	stList_destruct(strings);
+	return string;
+}
+
+stList *getKBestCandidateConsensusSubstrings(Poa *poa, int64_t from, int64_t to,
+											 double *candidateWeights, int64_t maximumStringNumber) {
+	/*
+	 * A candidate variant is an edit (either insert, delete or substitution) to the poa reference string with "high"
+	 * weight. Returns the (up to) maximumStringNumber distinct consensus substrings for the interval of the reference
+	 * string from "from" (inclusive) to "to" (exclusive) with the highest scoring combinations of candidate variants,
+	 * in descending order of score. Each combination is scored by the sum over positions of the log fraction of
+	 * the poa weight given to the chosen base, repeat count and indel. Combinations are enumerated lazily using
+	 * a best-first search over the lattice of candidate variants, with the exact best score of completing each
+	 * partial combination as the bound, so complete combinations are found in score order.
+	 */
+	int64_t length = to - from;
+	assert(length > 0);
+
+	// Build the lattice edges and the best score from each position to the end of the interval
+	stList *edges[length];
+	double bestSuffixScores[length+1];
+	bestSuffixScores[length] = 0.0;
+	for(int64_t i=length-1; i>=0; i--) {
+		edges[i] = getCandidateEdges(poa, from+i, to, candidateWeights[from+i]);
+		bestSuffixScores[i] = -INFINITY;
+		for(int64_t j=0; j<stList_length(edges[i]); j++) {
+			CandidateEdge *edge = stList_get(edges[i], j);
+			double score = edge->score + bestSuffixScores[edge->to-from];
+			if(score > bestSuffixScores[i]) {
+				bestSuffixScores[i] = score;
+			}
 		}
 	}
 
-	// Clean up
-	stList_destruct(suffixes);
+	// Best-first search
+	stList *paths = stList_construct3(0, free); // Owns all the paths
+	stList *heap = stList_construct();
+	CandidatePath *emptyPath = st_calloc(1, sizeof(CandidatePath));
+	emptyPath->position = from;
+	emptyPath->bound = bestSuffixScores[0];
+	stList_append(paths, emptyPath);
+	candidatePathHeap_push(heap, emptyPath);
 
-	if(stList_length(consensusSubstrings) > maximumStringNumber) {
-		// Clean up and return null (too many combinations)
-		stList_destruct(consensusSubstrings);
-		return NULL;
+	stList *consensusSubstrings = stList_construct3(0, free);
+	stSet *seenSubstrings = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, NULL);
+	int64_t expansions = 0, maxExpansions = maximumStringNumber * (length+1) * CANDIDATE_PATH_MAX_EXPANSIONS_PER_STRING_AND_POSITION;
+	while(stList_length(heap) > 0 && stList_length(consensusSubstrings) < maximumStringNumber && expansions++ < maxExpansions) {
+		CandidatePath *path = candidatePathHeap_pop(heap);
+
+		if(path->position == to) { // Is complete
+			char *substring = candidatePath_getString(path);
+			if(stSet_search(seenSubstrings, substring) == NULL) {
+				stList_append(consensusSubstrings, substring);
+				stSet_insert(seenSubstrings, substring);
+			}
+			else {
+				free(substring);
+			}
+			continue;
+		}
+
+		// Extend by each edge
+		stList *positionEdges = edges[path->position-from];
+		for(int64_t j=0; j<stList_length(positionEdges); j++) {
+			CandidateEdge *edge = stList_get(positionEdges, j);
+			CandidatePath *extension = st_malloc(sizeof(CandidatePath));
+			extension->prefix = path;
+			extension->edge = edge;
+			extension->position = edge->to;
+			extension->score = path->score + edge->score;
+			extension->bound = extension->score + bestSuffixScores[edge->to-from];
+			stList_append(paths, extension);
+			candidatePathHeap_push(heap, extension);
+		}
+	}
+
+	// Cleanup
+	stSet_destruct(seenSubstrings);
+	stList_destruct(heap);
+	stList_destruct(paths);
+	for(int64_t i=0; i<length; i++) {
+		stList_destruct(edges[i]);
 	}
 
 	return consensusSubstrings;
@@ -441,6 +577,52 @@ RleString *bamChunkReadSubstring_getRleString(BamChunkReadSubstring *readSubstri
 	return rleString_copySubstring(readSubstring->read->rleRead, readSubstring->start, readSubstring->length);
 }
 
+char *bamChunkReadSubstring_expand(BamChunkReadSubstring *readSubstring) {
+	RleString *r = readSubstring->read->rleRead;
+	uint64_t nonRleLength = 0;
+	for(uint64_t i=readSubstring->start; i<readSubstring->start+readSubstring->length; i++) {
+		nonRleLength += r->repeatCounts[i];
+	}
+	char *s = st_malloc((nonRleLength+1) * sizeof(char));
+	int64_t j=0;
+	for(uint64_t i=readSubstring->start; i<readSubstring->start+readSubstring->length; i++) {
+		for(int64_t k=0; k<r->repeatCounts[i]; k++) {
+			s[j++] = r->rleString[i];
+		}
+	}
+	s[nonRleLength] = '\0';
+	return s;
+}
+
+uint64_t bamChunkReadSubstring_hashKey(const void *k) {
+	BamChunkReadSubstring *readSubstring = (BamChunkReadSubstring *)k;
+	RleString *r = readSubstring->read->rleRead;
+	uint64_t h = 0;
+	for(uint64_t i=readSubstring->start; i<readSubstring->start+readSubstring->length; i++) {
+		h = h * 31 + (uint64_t)r->rleString[i];
+		h = h * 31 + r->repeatCounts[i];
+	}
+	return h;
+}
+
+int bamChunkReadSubstring_equalKey(const void *key1, const void *key2) {
+	BamChunkReadSubstring *rs1 = (BamChunkReadSubstring *)key1;
+	BamChunkReadSubstring *rs2 = (BamChunkReadSubstring *)key2;
+	if(rs1->length != rs2->length) {
+		return 0;
+	}
+	RleString *r1 = rs1->read->rleRead, *r2 = rs2->read->rleRead;
+	if(memcmp(&(r1->rleString[rs1->start]), &(r2->rleString[rs2->start]), rs1->length) != 0) {
+		return 0;
+	}
+	for(uint64_t i=0; i<rs1->length; i++) {
+		if(r1->repeatCounts[rs1->start+i] != r2->repeatCounts[rs2->start+i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
 void bamChunkReadSubstring_destruct(BamChunkReadSubstring *rs) {
 	free(rs);
 }
@@ -797,7 +979,311 @@ stList *getCandidateAllelesFromReadSubstrings(stList *readSubstrings, PolishPara
 	return alleles;
 }
 
+/*
+ * Forward score cache
+ */
+
+#define FORWARD_SCORE_CACHE_ENTRY_OVERHEAD 64 // Approximate bytes used by the hash table for each entry
+
+typedef struct _forwardScoreCacheEntry ForwardScoreCacheEntry;
+
+struct _forwardScoreCacheEntry {
+	char *key; // Strand, expanded allele and expanded read substring
+	float score;
+	ForwardScoreCacheEntry *previous; // More recently used entry
+	ForwardScoreCacheEntry *next; // Less recently used entry
+};
+
+struct _forwardScoreCache {
+	stHash *entries; // Map of keys to entries
+	ForwardScoreCacheEntry *head; // Most recently used entry
+	ForwardScoreCacheEntry *tail; // Least recently used entry
+	uint64_t memory; // Approximate bytes used by the entries
+	uint64_t maxMemory;
+	uint64_t hits;
+	uint64_t misses;
+#if defined(_OPENMP)
+	omp_lock_t lock; // Guards the entries, the recently used list and the counts, per chunk's cache
+#endif
+};
+
+ForwardScoreCache *forwardScoreCache_construct(uint64_t maxMemory) {
+	ForwardScoreCache *cache = st_calloc(1, sizeof(ForwardScoreCache));
+	cache->entries = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+	cache->maxMemory = maxMemory;
+#if defined(_OPENMP)
+	omp_init_lock(&cache->lock);
+#endif
+	return cache;
+}
+
+static void forwardScoreCacheEntry_destruct(ForwardScoreCacheEntry *entry) {
+	free(entry->key);
+	free(entry);
+}
+
+void forwardScoreCache_destruct(ForwardScoreCache *cache) {
+	ForwardScoreCacheEntry *entry = cache->head;
+	while(entry != NULL) {
+		ForwardScoreCacheEntry *next = entry->next;
+		forwardScoreCacheEntry_destruct(entry);
+		entry = next;
+	}
+	stHash_destruct(cache->entries);
+#if defined(_OPENMP)
+	omp_destroy_lock(&cache->lock);
+#endif
+	free(cache);
+}
+
+static char *forwardScoreCache_getKey(char *allele, char *readSubstring, bool forwardStrand) {
+	return stString_print("%c%s %s", forwardStrand ? '+' : '-', allele, readSubstring);
+}
+
+static uint64_t forwardScoreCacheEntry_getMemory(ForwardScoreCacheEntry *entry) {
+	return sizeof(ForwardScoreCacheEntry) + strlen(entry->key) + 1 + FORWARD_SCORE_CACHE_ENTRY_OVERHEAD;
+}
+
+static void forwardScoreCache_unlink(ForwardScoreCache *cache, ForwardScoreCacheEntry *entry) {
+	if(entry->previous != NULL) {
+		entry->previous->next = entry->next;
+	}
+	else {
+		cache->head = entry->next;
+	}
+	if(entry->next != NULL) {
+		entry->next->previous = entry->previous;
+	}
+	else {
+		cache->tail = entry->previous;
+	}
+	entry->previous = NULL;
+	entry->next = NULL;
+}
+
+static void forwardScoreCache_pushFront(ForwardScoreCache *cache, ForwardScoreCacheEntry *entry) {
+	entry->previous = NULL;
+	entry->next = cache->head;
+	if(cache->head != NULL) {
+		cache->head->previous = entry;
+	}
+	cache->head = entry;
+	if(cache->tail == NULL) {
+		cache->tail = entry;
+	}
+}
+
+bool forwardScoreCache_get(ForwardScoreCache *cache, char *allele, char *readSubstring, bool forwardStrand, float *score) {
+	char *key = forwardScoreCache_getKey(allele, readSubstring, forwardStrand);
+	bool found = 0;
+#if defined(_OPENMP)
+	omp_set_lock(&cache->lock);
+#endif
+	ForwardScoreCacheEntry *entry = stHash_search(cache->entries, key);
+	if(entry != NULL) {
+		// Move to the front of the recently used list
+		forwardScoreCache_unlink(cache, entry);
+		forwardScoreCache_pushFront(cache, entry);
+		*score = entry->score;
+		found = 1;
+		cache->hits++;
+	}
+	else {
+		cache->misses++;
+	}
+#if defined(_OPENMP)
+	omp_unset_lock(&cache->lock);
+#endif
+	free(key);
+	return found;
+}
+
+void forwardScoreCache_add(ForwardScoreCache *cache, char *allele, char *readSubstring, bool forwardStrand, float score) {
+	ForwardScoreCacheEntry *entry = st_calloc(1, sizeof(ForwardScoreCacheEntry));
+	entry->key = forwardScoreCache_getKey(allele, readSubstring, forwardStrand);
+	entry->score = score;
+	uint64_t entryMemory = forwardScoreCacheEntry_getMemory(entry);
+	if(entryMemory > cache->maxMemory) { // Would never fit
+		forwardScoreCacheEntry_destruct(entry);
+		return;
+	}
+#if defined(_OPENMP)
+	omp_set_lock(&cache->lock);
+#endif
+	if(stHash_search(cache->entries, entry->key) != NULL) { // Already added, e.g. by another thread
+		forwardScoreCacheEntry_destruct(entry);
+	}
+	else {
+		stHash_insert(cache->entries, entry->key, entry);
+		forwardScoreCache_pushFront(cache, entry);
+		cache->memory += entryMemory;
+
+		// Evict least recently used entries until within budget
+		while(cache->memory > cache->maxMemory) {
+			ForwardScoreCacheEntry *lruEntry = cache->tail;
+			forwardScoreCache_unlink(cache, lruEntry);
+			stHash_remove(cache->entries, lruEntry->key);
+			cache->memory -= forwardScoreCacheEntry_getMemory(lruEntry);
+			forwardScoreCacheEntry_destruct(lruEntry);
+		}
+	}
+#if defined(_OPENMP)
+	omp_unset_lock(&cache->lock);
+#endif
+}
+
+uint64_t forwardScoreCache_getHits(ForwardScoreCache *cache) {
+	return cache->hits;
+}
+
+uint64_t forwardScoreCache_getMisses(ForwardScoreCache *cache) {
+	return cache->misses;
+}
+
+static void readSymbolString_destruct(SymbolString *readSymbolString) {
+	symbolString_destruct(*readSymbolString);
+	free(readSymbolString);
+}
+
+static Bubble *getBubble(Poa *poa, stList *bamChunkReads, stHash *readSymbolStrings, double *candidateWeights,
+		int64_t pAnchor, int64_t i, PolishParams *params, ForwardScoreCache *forwardScoreCache) {
+	/*
+	 * Builds the bubble for the interval of the poa between the anchors pAnchor and i (both exclusive), scoring
+	 * each read substring against each allele, using forwardScoreCache if it is not NULL. Read substrings are scored
+	 * using views into readSymbolStrings, a map of each read to its pre-encoded symbol string. Returns NULL if the
+	 * interval has no reads or only the reference allele. Only reads the poa, so may be called concurrently
+	 * for different intervals.
+	 */
+	Bubble *b = NULL;
+
+	// Get read substrings
+	stList *readSubstrings = getReadSubstrings(bamChunkReads, poa, pAnchor+1, i, params);
+
+	if(stList_length(readSubstrings) > 0) {
+		stList *alleles = NULL;
+		if(params->useReadAlleles) {
+			alleles = getCandidateAllelesFromReadSubstrings(readSubstrings, params);
+		}
+		else {
+			// Calculate the list of the highest weight alleles
+			alleles = getKBestCandidateConsensusSubstrings(poa, pAnchor+1, i, candidateWeights, params->maxConsensusStrings);
+		}
+
+		// Get existing reference string
+		assert(i-1-pAnchor > 0);
+		RleString *existingRefSubstring = rleString_copySubstring(poa->refString, pAnchor, i-1-pAnchor);
+		assert(existingRefSubstring->length == i-pAnchor-1);
+		char *expandedExistingRefSubstring = rleString_expand(existingRefSubstring);
+
+		// Check if the reference allele is in the set of alleles and add it if not
+		bool seenRefAllele = 0;
+		for(int64_t j=0; j<stList_length(alleles); j++) {
+			if(stString_eq(expandedExistingRefSubstring, stList_get(alleles, j))) {
+				seenRefAllele = 1;
+				break;
+			}
+		}
+		if(!seenRefAllele) {
+			stList_append(alleles, stString_copy(expandedExistingRefSubstring));
+		}
+
+		// If it is not trivial because it contains more than one allele
+		if(stList_length(alleles) > 1) {
+
+			b = st_malloc(sizeof(Bubble)); // Make a bubble
+
+			// Set the coordinates
+			b->refStart = pAnchor;
+
+			// The reference allele
+			b->refAllele = existingRefSubstring;
+
+			// Add read substrings
+			b->readNo = stList_length(readSubstrings);
+			b->reads = st_malloc(sizeof(BamChunkReadSubstring *) * b->readNo);
+			for(int64_t j=0; j<b->readNo; j++) {
+				b->reads[j] = stList_pop(readSubstrings);
+			}
+
+			// Now copy the alleles list to the bubble's array of alleles
+			b->alleleNo = stList_length(alleles);
+			b->alleles = st_malloc(sizeof(RleString *) * b->alleleNo);
+			for(int64_t j=0; j<b->alleleNo; j++) {
+				b->alleles[j] = params->useRunLengthEncoding ? rleString_construct(stList_get(alleles, j)) : rleString_construct_no_rle(stList_get(alleles, j));
+			}
+
+			// Get allele supports
+			b->alleleReadSupports = st_calloc(b->readNo*b->alleleNo, sizeof(float));
+
+			stList *anchorPairs = stList_construct(); // Currently empty
+
+			SymbolString alleleSymbolStrings[b->alleleNo];
+			for(int64_t j=0; j<b->alleleNo; j++) {
+				alleleSymbolStrings[j] = rleString_constructSymbolString(b->alleles[j], 0, b->alleles[j]->length,
+						params->alphabet, params->useRepeatCountsInAlignment, poa->maxRepeatCount);
+			}
+
+			stHash *cachedScores = stHash_construct3(bamChunkReadSubstring_hashKey, bamChunkReadSubstring_equalKey,
+																		NULL, free);
+
+			for(int64_t k=0; k<b->readNo; k++) {
+				BamChunkReadSubstring *readSubstring = b->reads[k];
+				StateMachine *sM = readSubstring->read->forwardStrand ? params->stateMachineForForwardStrandRead : params->stateMachineForReverseStrandRead;
+
+				uint64_t *index = stHash_search(cachedScores, readSubstring);
+				if(index != NULL) {
+					for(int64_t j=0; j<b->alleleNo; j++) {
+						b->alleleReadSupports[j*b->readNo + k] = b->alleleReadSupports[j*b->readNo + *index];
+					}
+				}
+				else {
+					index = st_malloc(sizeof(uint64_t));
+					*index = k;
+					stHash_insert(cachedScores, readSubstring, index);
+					SymbolString *readSymbolString = stHash_search(readSymbolStrings, readSubstring->read);
+					assert(readSymbolString != NULL);
+					SymbolString rS = symbolString_getView(*readSymbolString, readSubstring->start, readSubstring->length);
+					char *expandedReadSubstring = forwardScoreCache != NULL ? bamChunkReadSubstring_expand(readSubstring) : NULL;
+					for(int64_t j=0; j<b->alleleNo; j++) {
+						float *score = &(b->alleleReadSupports[j*b->readNo + k]);
+						if(forwardScoreCache == NULL || !forwardScoreCache_get(forwardScoreCache, stList_get(alleles, j),
+								expandedReadSubstring, b->reads[k]->read->forwardStrand, score)) {
+							*score = computeForwardProbability(alleleSymbolStrings[j], rS, anchorPairs, params->p, sM, 0, 0);
+							if(forwardScoreCache != NULL) {
+								forwardScoreCache_add(forwardScoreCache, stList_get(alleles, j),
+										expandedReadSubstring, b->reads[k]->read->forwardStrand, *score);
+							}
+						}
+					}
+					free(expandedReadSubstring);
+				}
+			}
+
+			stHash_destruct(cachedScores);
+			for(int64_t j=0; j<b->alleleNo; j++) {
+				symbolString_destruct(alleleSymbolStrings[j]);
+			}
+			stList_destruct(anchorPairs);
+		}
+		// Cleanup
+		else {
+			rleString_destruct(existingRefSubstring);
+		}
+
+		free(expandedExistingRefSubstring);
+		stList_destruct(alleles);
+	}
+	stList_destruct(readSubstrings);
+
+	return b;
+}
+
 BubbleGraph *bubbleGraph_constructFromPoa(Poa *poa, stList *bamChunkReads, PolishParams *params) {
+	return bubbleGraph_constructFromPoa2(poa, bamChunkReads, params, NULL);
+}
+
+BubbleGraph *bubbleGraph_constructFromPoa2(Poa *poa, stList *bamChunkReads, PolishParams *params,
+		ForwardScoreCache *forwardScoreCache) {
 	// Setup
 	double *candidateWeights = getCandidateWeights(poa, params);
 
@@ -818,137 +1304,56 @@ BubbleGraph *bubbleGraph_constructFromPoa(Poa *poa, stList *bamChunkReads, Polis
 	// Identify anchor points, represented as a binary array, one bit for each POA node
 	bool *anchors = getFilteredAnchorPositions(poa, candidateWeights, params);
 
-	// Make a list of bubbles
-	stList *bubbles = stList_construct3(0, free);
+	// Make a list of the intervals between non-adjacent anchors, each of which is a potential bubble
+	int64_t *intervalStarts = st_malloc(sizeof(int64_t) * stList_length(poa->nodes));
+	int64_t *intervalEnds = st_malloc(sizeof(int64_t) * stList_length(poa->nodes));
+	int64_t intervalNo = 0;
 	int64_t pAnchor = 0; // Previous anchor, starting from first position of POA, which is the prefix "N"
 	for(int64_t i=1; i<stList_length(poa->nodes); i++) {
 		if(anchors[i]) { // If position i is an anchor
 			assert(i > pAnchor);
 			if(i-pAnchor != 1)  { // In case anchors are not trivially adjacent there exists a potential bubble
 				// with start coordinate on the reference sequence of pAnchor and length pAnchor-i
-
-				// Get read substrings
-				stList *readSubstrings = getReadSubstrings(bamChunkReads, poa, pAnchor+1, i, params);
-
-				if(stList_length(readSubstrings) > 0) {
-					stList *alleles = NULL;
-					if(params->useReadAlleles) {
-						alleles = getCandidateAllelesFromReadSubstrings(readSubstrings, params);
-					}
-					else {
-						// Calculate the list of alleles
-						double weightAdjustment = 1.0;
-						do {
-							alleles = getCandidateConsensusSubstrings(poa, pAnchor+1, i,
-									candidateWeights, weightAdjustment, params->maxConsensusStrings);
-							weightAdjustment *= 1.5; // Increase the candidate weight by 50%
-						} while(alleles == NULL);
-					}
-
-					// Get existing reference string
-					assert(i-1-pAnchor > 0);
-					RleString *existingRefSubstring = rleString_copySubstring(poa->refString, pAnchor, i-1-pAnchor);
-					assert(existingRefSubstring->length == i-pAnchor-1);
-					char *expandedExistingRefSubstring = rleString_expand(existingRefSubstring);
-
-					// Check if the reference allele is in the set of alleles and add it if not
-					bool seenRefAllele = 0;
-					for(int64_t j=0; j<stList_length(alleles); j++) {
-						if(stString_eq(expandedExistingRefSubstring, stList_get(alleles, j))) {
-							seenRefAllele = 1;
-							break;
-						}
-					}
-					if(!seenRefAllele) {
-						stList_append(alleles, stString_copy(expandedExistingRefSubstring));
-					}
-
-					// If it is not trivial because it contains more than one allele
-					if(stList_length(alleles) > 1) {
-
-						Bubble *b = st_malloc(sizeof(Bubble)); // Make a bubble and add to list of bubbles
-						stList_append(bubbles, b);
-
-						// Set the coordinates
-						b->refStart = pAnchor;
-
-						// The reference allele
-						b->refAllele = existingRefSubstring;
-
-						// Add read substrings
-						b->readNo = stList_length(readSubstrings);
-						b->reads = st_malloc(sizeof(BamChunkReadSubstring *) * b->readNo);
-						for(int64_t j=0; j<b->readNo; j++) {
-							b->reads[j] = stList_pop(readSubstrings);
-						}
-
-						// Now copy the alleles list to the bubble's array of alleles
-						b->alleleNo = stList_length(alleles);
-						b->alleles = st_malloc(sizeof(RleString *) * b->alleleNo);
-						for(int64_t j=0; j<b->alleleNo; j++) {
-							b->alleles[j] = params->useRunLengthEncoding ? rleString_construct(stList_get(alleles, j)) : rleString_construct_no_rle(stList_get(alleles, j));
-						}
-
-						// Get allele supports
-						b->alleleReadSupports = st_calloc(b->readNo*b->alleleNo, sizeof(float));
-
-						stList *anchorPairs = stList_construct(); // Currently empty
-
-						SymbolString alleleSymbolStrings[b->alleleNo];
-						for(int64_t j=0; j<b->alleleNo; j++) {
-							alleleSymbolStrings[j] = rleString_constructSymbolString(b->alleles[j], 0, b->alleles[j]->length,
-									params->alphabet, params->useRepeatCountsInAlignment, poa->maxRepeatCount);
-						}
-
-						stHash *cachedScores = stHash_construct3(rleString_stringKey, rleString_expandedStringEqualKey,
-																					(void (*)(void *))rleString_destruct, free);
-
-						for(int64_t k=0; k<b->readNo; k++) {
-							RleString *readSubstring = bamChunkReadSubstring_getRleString(b->reads[k]);
-							SymbolString rS = rleString_constructSymbolString(readSubstring, 0, readSubstring->length,
-									params->alphabet, params->useRepeatCountsInAlignment, poa->maxRepeatCount);
-							StateMachine *sM = b->reads[k]->read->forwardStrand ? params->stateMachineForForwardStrandRead : params->stateMachineForReverseStrandRead;
-
-							uint64_t *index = stHash_search(cachedScores, readSubstring);
-							if(index != NULL) {
-								for(int64_t j=0; j<b->alleleNo; j++) {
-									b->alleleReadSupports[j*b->readNo + k] = b->alleleReadSupports[j*b->readNo + *index];
-								}
-								rleString_destruct(readSubstring);
-							}
-							else {
-								index = st_malloc(sizeof(uint64_t));
-								*index = k;
-								stHash_insert(cachedScores, readSubstring, index);
-								for(int64_t j=0; j<b->alleleNo; j++) {
-									b->alleleReadSupports[j*b->readNo + k] = computeForwardProbability(alleleSymbolStrings[j], rS, anchorPairs, params->p, sM, 0, 0);
-								}
-							}
-
-							symbolString_destruct(rS);
-						}
-
-						stHash_destruct(cachedScores);
-						for(int64_t j=0; j<b->alleleNo; j++) {
-							symbolString_destruct(alleleSymbolStrings[j]);
-						}
-						stList_destruct(anchorPairs);
-					}
-					// Cleanup
-					else {
-						rleString_destruct(existingRefSubstring);
-					}
-
-					free(expandedExistingRefSubstring);
-					stList_destruct(alleles);
-					stList_destruct(readSubstrings);
-				}
+				intervalStarts[intervalNo] = pAnchor;
+				intervalEnds[intervalNo++] = i;
 			}
 			// Update previous anchor
 			pAnchor = i;
 		}
 	}
 
+	// Encode each read once, so that bubbles can score views of the read substrings
+	stHash *readSymbolStrings = stHash_construct2(NULL, (void (*)(void *))readSymbolString_destruct);
+	for(int64_t j=0; j<stList_length(bamChunkReads); j++) {
+		BamChunkRead *read = stList_get(bamChunkReads, j);
+		SymbolString *readSymbolString = st_malloc(sizeof(SymbolString));
+		*readSymbolString = rleString_constructSymbolString(read->rleRead, 0, read->rleRead->length,
+				params->alphabet, params->useRepeatCountsInAlignment, poa->maxRepeatCount);
+		stHash_insert(readSymbolStrings, read, readSymbolString);
+	}
+
+	// Build the bubbles, which are independent of one another
+	Bubble **intervalBubbles = st_calloc(intervalNo > 0 ? intervalNo : 1, sizeof(Bubble *));
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for(int64_t j=0; j<intervalNo; j++) {
+		intervalBubbles[j] = getBubble(poa, bamChunkReads, readSymbolStrings, candidateWeights, intervalStarts[j], intervalEnds[j],
+				params, forwardScoreCache);
+	}
+
+	// Make a list of the non-trivial bubbles, in reference order
+	stList *bubbles = stList_construct3(0, free);
+	for(int64_t j=0; j<intervalNo; j++) {
+		if(intervalBubbles[j] != NULL) {
+			stList_append(bubbles, intervalBubbles[j]);
+		}
+	}
+	free(intervalBubbles);
+	free(intervalStarts);
+	free(intervalEnds);
+	stHash_destruct(readSymbolStrings);
+
 	// Build the the graph
 
 	BubbleGraph *bg = st_malloc(sizeof(BubbleGraph));
@@ -968,6 +1373,8 @@ BubbleGraph *bubbleGraph_constructFromPoa(Poa *poa, stList *bamChunkReads, Polis
 		alleleOffset += bg->bubbles[i].alleleNo;
 	}
 	bg->totalAlleles = alleleOffset;
+	HOT_PATH_COUNT(HOT_PATH_COUNTER_BUBBLES, bg->bubbleNo);
+	HOT_PATH_COUNT(HOT_PATH_COUNTER_BUBBLE_ALLELES, bg->totalAlleles);
 
 	// Cleanup
 	free(anchors);
@@ -1302,12 +1709,27 @@ stGenomeFragment *bubbleGraph_phaseBubbleGraph(BubbleGraph *bg, char *refSeqName
 	// Run phasing for each strand partition
 	params->phaseParams->includeAncestorSubProb = 0; // Switch off using ancestor substitution probabilities in calculating the hmm probs
 
-	st_logInfo("> Phasing forward strand reads\n");
-	stList *tilingPathForward = getRPHmms(forwardStrandProfileSeqs, params->phaseParams);
-	stList_setDestructor(tilingPathForward, NULL);
+	// The strand partitions are independent until they are joined, so phase them concurrently
+	st_logInfo("> Phasing forward and reverse strand reads\n");
+	stList *tilingPathForward, *tilingPathReverse;
+#if defined(_OPENMP)
+#pragma omp parallel
+{
+#pragma omp sections nowait
+{
+#pragma omp section
+	tilingPathForward = getRPHmms(forwardStrandProfileSeqs, params->phaseParams);
+
+#pragma omp section
+	tilingPathReverse = getRPHmms(reverseStrandProfileSeqs, params->phaseParams);
 
-	st_logInfo("> Phasing reverse strand reads\n");
-	stList *tilingPathReverse = getRPHmms(reverseStrandProfileSeqs, params->phaseParams);
+}
+}
+#else
+	tilingPathForward = getRPHmms(forwardStrandProfileSeqs, params->phaseParams);
+	tilingPathReverse = getRPHmms(reverseStrandProfileSeqs, params->phaseParams);
+#endif
+	stList_setDestructor(tilingPathForward, NULL);
 	stList_setDestructor(tilingPathReverse, NULL);
 
 	// Join the hmms
@@ -1319,6 +1741,10 @@ stGenomeFragment *bubbleGraph_phaseBubbleGraph(BubbleGraph *bg, char *refSeqName
 	stRPHmm_forwardBackward(hmm);
 
 	st_logInfo("Forward probability of the hmm: %f, backward prob: %f\n", (float)hmm->forwardLogProb, (float)hmm->backwardLogProb);
+	if(params->phaseParams->beamWidth > 0) {
+		st_logInfo("Beam of width %" PRIi64 " discarded %" PRIi64 " states with forward log probability: %f\n",
+				params->phaseParams->beamWidth, hmm->beamDiscardedCells, (float)hmm->beamDiscardedLogProb);
+	}
 
 	// Now compute a high probability path through the hmm
 	stList *path = stRPHmm_forwardTraceBack(hmm);
@@ -4,6 +4,8 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <time.h>
+#include <sys/resource.h>
 #include "margin.h"
 #include "bedidx.h"
 
@@ -48,11 +50,62 @@ void bamChunkRead_destruct(BamChunkRead *r) {
     free(r);
 }
 
+stHash *parseReferenceSequences(char *referenceFastaFile) {
+    /*
+     * Get hash of reference sequence names in fasta to their sequences, doing some munging on the sequence names.
+     */
+    st_logInfo("> Parsing reference sequences from file: %s\n", referenceFastaFile);
+    FILE *fh = fopen(referenceFastaFile, "r");
+    stHash *referenceSequences = fastaReadToMap(fh);  //valgrind says blocks from this allocation are "still reachable"
+    fclose(fh);
+    // log names and transform (if necessary)
+    stList *refSeqNames = stHash_getKeys(referenceSequences);
+    int64_t origRefSeqLen = stList_length(refSeqNames);
+    st_logDebug("\tReference contigs: \n");
+    for (int64_t i = 0; i < origRefSeqLen; ++i) {
+        char *fullRefSeqName = (char *) stList_get(refSeqNames, i);
+        st_logDebug("\t\t%s\n", fullRefSeqName);
+        char refSeqName[128] = "";
+        if (sscanf(fullRefSeqName, "%s", refSeqName) == 1 && !stString_eq(fullRefSeqName, refSeqName)) {
+            // this transformation is necessary for cases where the reference has metadata after the contig name:
+            // >contig001 length=1000 date=1999-12-31
+            char *newKey = stString_copy(refSeqName);
+            char *refSeq = stHash_search(referenceSequences, fullRefSeqName);
+            stHash_insert(referenceSequences, newKey, refSeq);
+            stHash_removeAndFreeKey(referenceSequences, fullRefSeqName);
+            st_logDebug("\t\t\t-> %s\n", newKey);
+        }
+    }
+    stList_destruct(refSeqNames);
+
+    return referenceSequences;
+}
+
+RleString *bamChunk_getReferenceSubstring(BamChunk *bamChunk, stHash *referenceSequences, Params *params) {
+    /*
+     * Get corresponding substring of the reference for a given bamChunk.
+     */
+    char *fullReferenceString = stHash_search(referenceSequences, bamChunk->refSeqName);
+    if (fullReferenceString == NULL) {
+        st_logCritical("> ERROR: Reference sequence missing from reference map: %s \n", bamChunk->refSeqName);
+        return NULL;
+    }
+    int64_t refLen = strlen(fullReferenceString);
+    char *referenceString = stString_getSubString(fullReferenceString, bamChunk->chunkBoundaryStart,
+                                                  (refLen < bamChunk->chunkBoundaryEnd ? refLen : bamChunk->chunkBoundaryEnd) - bamChunk->chunkBoundaryStart);
+
+    RleString *rleRef = params->polishParams->useRunLengthEncoding ?
+            rleString_construct(referenceString) : rleString_construct_no_rle(referenceString);
+    free(referenceString);
+
+    return rleRef;
+}
+
 
 
 
 char *mergeContigChunks(char **chunks, int64_t startIdx, int64_t endIdxExclusive, int64_t overlap, Params *params,
-                        char *missingChunkSpacer) {
+                        char *missingChunkSpacer, ChunkProfile **chunkProfiles) {
 
     // merge chunks
     stList *polishedReferenceStrings = stList_construct3(0, free); // The polished reference strings, one for each chunk
@@ -70,9 +123,13 @@ char *mergeContigChunks(char **chunks, int64_t startIdx, int64_t endIdxExclusive
 
             // Trim the currrent and previous polished reference strings to remove overlap
             int64_t prefixStringCropEnd, suffixStringCropStart;
+            double startTime = chunkProfile_getTime();
             int64_t overlapMatchWeight = removeOverlap(previousChunk, currentChunk,
                                                        overlap, params->polishParams,
                                                        &prefixStringCropEnd, &suffixStringCropStart);
+            if (chunkProfiles != NULL) {
+                chunkProfile_addStageTime(chunkProfiles[chunkIdx], CHUNK_STAGE_MERGE, chunkProfile_getTime() - startTime);
+            }
 
             // we have an overlap
             if (overlapMatchWeight > 0) {
@@ -121,10 +178,12 @@ char *mergeContigChunks(char **chunks, int64_t startIdx, int64_t endIdxExclusive
 
 
 char *mergeContigChunksThreaded(char **chunks, int64_t startIdx, int64_t endIdxExclusive, int64_t numThreads,
-                                int64_t overlap, Params *params, char *missingChunkSpacer, char *referenceSequenceName) {
+                                int64_t overlap, Params *params, char *missingChunkSpacer, char *referenceSequenceName,
+                                ChunkProfile **chunkProfiles) {
 
     // special unthreaded case
-    if (numThreads == 1) return mergeContigChunks(chunks, startIdx, endIdxExclusive, overlap, params, missingChunkSpacer);
+    if (numThreads == 1) return mergeContigChunks(chunks, startIdx, endIdxExclusive, overlap, params, missingChunkSpacer,
+                                                  chunkProfiles);
 
     // divide into chunks
     int64_t totalChunks = endIdxExclusive - startIdx;
@@ -142,14 +201,227 @@ char *mergeContigChunksThreaded(char **chunks, int64_t startIdx, int64_t endIdxE
         if (endIdxExclusive < threadedEndIdxExclusive) threadedEndIdxExclusive = endIdxExclusive;
 
         outputChunks[thread] = mergeContigChunks(chunks, threadedStartIdx, threadedEndIdxExclusive, overlap,
-                                                 params, missingChunkSpacer);
+                                                 params, missingChunkSpacer, chunkProfiles);
     }
 
-    // finish
-    char *contig = mergeContigChunks(outputChunks, 0, numThreads, overlap, params, missingChunkSpacer);
+    // finish, charging each stitch between threads' outputs to the first chunk of the later thread
+    ChunkProfile **threadProfiles = NULL;
+    if (chunkProfiles != NULL) {
+        threadProfiles = st_calloc(numThreads, sizeof(ChunkProfile *));
+        for (int64_t thread = 0; thread < numThreads; thread++) {
+            threadProfiles[thread] = chunkProfiles[startIdx + chunksPerThread * thread];
+        }
+    }
+    char *contig = mergeContigChunks(outputChunks, 0, numThreads, overlap, params, missingChunkSpacer, threadProfiles);
+    if (threadProfiles != NULL) {
+        free(threadProfiles);
+    }
     for (int64_t i = 0; i < numThreads; i++) {
         free(outputChunks[i]);
     }
     free(outputChunks);
     return contig;
 }
+
+/*
+ * Hot-path counters
+ */
+
+#ifdef _HOT_PATH_COUNTERS
+__thread int64_t hotPathCounters[HOT_PATH_COUNTER_NUMBER];
+#endif
+
+static char *hotPathCounter_getName(HotPathCounter counter) {
+    switch (counter) {
+        case HOT_PATH_COUNTER_DP_CELLS:
+            return "dpCells";
+        case HOT_PATH_COUNTER_POSTERIOR_PAIRS:
+            return "posteriorPairs";
+        case HOT_PATH_COUNTER_FORWARD_PROBABILITY_CALLS:
+            return "forwardProbabilityCalls";
+        case HOT_PATH_COUNTER_FORWARD_PROBABILITY_CELLS:
+            return "forwardProbabilityCells";
+        case HOT_PATH_COUNTER_BUBBLES:
+            return "bubbles";
+        case HOT_PATH_COUNTER_BUBBLE_ALLELES:
+            return "bubbleAlleles";
+        case HOT_PATH_COUNTER_HMM_COLUMNS:
+            return "hmmColumns";
+        case HOT_PATH_COUNTER_HMM_CELLS:
+            return "hmmCells";
+        case HOT_PATH_COUNTER_POA_INSERTS:
+            return "poaInserts";
+        case HOT_PATH_COUNTER_POA_DELETES:
+            return "poaDeletes";
+        default:
+            st_errAbort("Unrecognised hot-path counter: %i\n", (int) counter);
+            return NULL;
+    }
+}
+
+bool hotPathCounters_enabled() {
+#ifdef _HOT_PATH_COUNTERS
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+void hotPathCounters_add(int64_t *counters) {
+#ifdef _HOT_PATH_COUNTERS
+    for (int64_t i = 0; i < HOT_PATH_COUNTER_NUMBER; i++) {
+        counters[i] += hotPathCounters[i];
+    }
+#endif
+}
+
+void hotPathCounters_subtract(int64_t *counters) {
+#ifdef _HOT_PATH_COUNTERS
+    for (int64_t i = 0; i < HOT_PATH_COUNTER_NUMBER; i++) {
+        counters[i] -= hotPathCounters[i];
+    }
+#endif
+}
+
+void hotPathCounters_logSummary(int64_t *counters) {
+    if (!hotPathCounters_enabled()) {
+        return;
+    }
+    st_logCritical("> Hot-path counters:\n");
+    for (int64_t i = 0; i < HOT_PATH_COUNTER_NUMBER; i++) {
+        st_logCritical(">   %s: %" PRIi64 "\n", hotPathCounter_getName(i), counters[i]);
+    }
+    st_logCritical(">   alleles per bubble: %.3f, cells per hmm column: %.3f, cells per forward probability call: %.1f\n",
+               counters[HOT_PATH_COUNTER_BUBBLES] == 0 ? 0.0 :
+               (double) counters[HOT_PATH_COUNTER_BUBBLE_ALLELES] / counters[HOT_PATH_COUNTER_BUBBLES],
+               counters[HOT_PATH_COUNTER_HMM_COLUMNS] == 0 ? 0.0 :
+               (double) counters[HOT_PATH_COUNTER_HMM_CELLS] / counters[HOT_PATH_COUNTER_HMM_COLUMNS],
+               counters[HOT_PATH_COUNTER_FORWARD_PROBABILITY_CALLS] == 0 ? 0.0 :
+               (double) counters[HOT_PATH_COUNTER_FORWARD_PROBABILITY_CELLS] /
+               counters[HOT_PATH_COUNTER_FORWARD_PROBABILITY_CALLS]);
+}
+
+/*
+ * Chunk profiles
+ */
+
+static char *chunkStage_getName(ChunkStage stage) {
+    switch (stage) {
+        case CHUNK_STAGE_BAM_FETCH:
+            return "bamFetch";
+        case CHUNK_STAGE_DOWNSAMPLE:
+            return "downsample";
+        case CHUNK_STAGE_INITIAL_REALIGN:
+            return "initialRealign";
+        case CHUNK_STAGE_CONSENSUS:
+            return "consensus";
+        case CHUNK_STAGE_POLISH:
+            return "polish";
+        case CHUNK_STAGE_BUBBLE_GRAPH:
+            return "bubbleGraph";
+        case CHUNK_STAGE_REPEAT_COUNTS:
+            return "repeatCounts";
+        case CHUNK_STAGE_FEATURES:
+            return "features";
+        case CHUNK_STAGE_MERGE:
+            return "merge";
+        default:
+            st_errAbort("Unrecognised chunk stage: %i\n", (int) stage);
+            return NULL;
+    }
+}
+
+ChunkProfile *chunkProfile_construct(int64_t chunkIdx, char *refSeqName, int64_t chunkBoundaryStart,
+        int64_t chunkBoundaryEnd) {
+    ChunkProfile *profile = st_calloc(1, sizeof(ChunkProfile));
+    profile->chunkIdx = chunkIdx;
+    profile->refSeqName = stString_copy(refSeqName);
+    profile->chunkBoundaryStart = chunkBoundaryStart;
+    profile->chunkBoundaryEnd = chunkBoundaryEnd;
+    profile->iterations = stList_construct3(0, free);
+    return profile;
+}
+
+void chunkProfile_destruct(ChunkProfile *profile) {
+    free(profile->refSeqName);
+    stList_destruct(profile->iterations);
+    free(profile);
+}
+
+double chunkProfile_getTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+void chunkProfile_addStageTime(ChunkProfile *profile, ChunkStage stage, double seconds) {
+    if (profile != NULL) {
+        profile->stageSeconds[stage] += seconds;
+    }
+}
+
+void chunkProfile_addIteration(ChunkProfile *profile, bool consensus, double consensusSeconds, double realignSeconds) {
+    if (profile != NULL) {
+        ChunkProfileIteration *iteration = st_calloc(1, sizeof(ChunkProfileIteration));
+        iteration->consensus = consensus;
+        iteration->consensusSeconds = consensusSeconds;
+        iteration->realignSeconds = realignSeconds;
+        stList_append(profile->iterations, iteration);
+    }
+}
+
+void chunkProfile_startCounters(ChunkProfile *profile) {
+    if (profile != NULL) {
+        hotPathCounters_subtract(profile->counters);
+    }
+}
+
+void chunkProfile_stopCounters(ChunkProfile *profile) {
+    if (profile != NULL) {
+        hotPathCounters_add(profile->counters);
+    }
+}
+
+void chunkProfile_setChunkStats(ChunkProfile *profile, stList *bamChunkReads, Poa *poa) {
+    if (profile == NULL) {
+        return;
+    }
+    profile->readCount = stList_length(bamChunkReads);
+    profile->rleNucleotides = 0;
+    for (int64_t i = 0; i < stList_length(bamChunkReads); i++) {
+        profile->rleNucleotides += ((BamChunkRead *) stList_get(bamChunkReads, i))->rleRead->length;
+    }
+    profile->nodeCount = poa == NULL ? 0 : stList_length(poa->nodes);
+    // The high water mark of the whole process, so with concurrent chunks it bounds rather than measures the chunk
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    profile->peakRssKb = usage.ru_maxrss;
+}
+
+void chunkProfile_writeJson(ChunkProfile *profile, FILE *fh) {
+    fprintf(fh, "{\"chunk\": %" PRIi64 ", \"contig\": \"%s\", \"start\": %" PRIi64 ", \"end\": %" PRIi64
+            ", \"reads\": %" PRIi64 ", \"rleNucleotides\": %" PRIi64 ", \"nodes\": %" PRIi64 ", \"bubbles\": %" PRIi64
+            ", \"peakRssKb\": %" PRIi64 ", \"seconds\": {\"total\": %.6f",
+            profile->chunkIdx, profile->refSeqName, profile->chunkBoundaryStart, profile->chunkBoundaryEnd,
+            profile->readCount, profile->rleNucleotides, profile->nodeCount, profile->bubbleCount, profile->peakRssKb,
+            profile->totalSeconds);
+    for (int64_t stage = 0; stage < CHUNK_STAGE_NUMBER; stage++) {
+        fprintf(fh, ", \"%s\": %.6f", chunkStage_getName(stage), profile->stageSeconds[stage]);
+    }
+    fprintf(fh, "}, \"iterations\": [");
+    for (int64_t i = 0; i < stList_length(profile->iterations); i++) {
+        ChunkProfileIteration *iteration = stList_get(profile->iterations, i);
+        fprintf(fh, "%s{\"algorithm\": \"%s\", \"consensusSeconds\": %.6f, \"realignSeconds\": %.6f}",
+                i == 0 ? "" : ", ", iteration->consensus ? "consensus" : "polish", iteration->consensusSeconds,
+                iteration->realignSeconds);
+    }
+    fprintf(fh, "]");
+    if (hotPathCounters_enabled()) {
+        fprintf(fh, ", \"counters\": {");
+        for (int64_t i = 0; i < HOT_PATH_COUNTER_NUMBER; i++) {
+            fprintf(fh, "%s\"%s\": %" PRIi64, i == 0 ? "" : ", ", hotPathCounter_getName(i), profile->counters[i]);
+        }
+        fprintf(fh, "}");
+    }
+    fprintf(fh, "}\n");
+}
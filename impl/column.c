@@ -24,7 +24,9 @@ stRPColumn *stRPColumn_construct(int64_t refStart, int64_t length, int64_t depth
     column->seqs = seqs;
 
     // Initially contains not states
-    column->head = NULL;
+    column->cells = NULL;
+    column->cellNo = 0;
+    column->cellCapacity = 0;
 
     return column;
 }
@@ -32,12 +34,8 @@ stRPColumn *stRPColumn_construct(int64_t refStart, int64_t length, int64_t depth
 void stRPColumn_destruct(stRPColumn *column) {
 
     // Clean up the contained cells
-    stRPCell *cell = column->head;
-    while(cell != NULL) {
-        stRPCell *pCell = cell;
-        cell = cell->nCell;
-        stRPCell_destruct(pCell);
-    }
+    free(column->cells);
+    free(column->bitCountVectors);
 
     free(column->seqHeaders);
     free(column->seqs);
@@ -59,11 +57,10 @@ void stRPColumn_print(stRPColumn *column, FILE *fileHandle, bool includeCells) {
         stProfileSeq_print(column->seqHeaders[i], fileHandle);
     }
     if(includeCells) {
-        stRPCell *cell = column->head;
-        do {
+        for(int64_t i=0; i<column->cellNo; i++) {
             fprintf(fileHandle, "\t\t");
-            stRPCell_print(cell, fileHandle);
-        } while((cell = cell->nCell) != NULL);
+            stRPCell_print(&column->cells[i], fileHandle);
+        }
     }
 }
 
@@ -92,13 +89,11 @@ void stRPColumn_split(stRPColumn *column, int64_t firstHalfLength, stRPHmm *hmm)
     stRPMergeColumn *mColumn = stRPMergeColumn_construct(acceptMask, acceptMask);
 
     // Copy cells
-    stRPCell *cell = column->head;
-    stRPCell **pCell = &(rColumn->head);
-    do {
-        *pCell = stRPCell_construct(cell->partition);
-        stRPMergeCell_construct(cell->partition, cell->partition, mColumn);
-        pCell = &((*pCell)->nCell);
-    } while((cell = cell->nCell) != NULL);
+    stRPColumn_reserveCells(rColumn, column->cellNo);
+    for(int64_t i=0; i<column->cellNo; i++) {
+        stRPColumn_addCell(rColumn, column->cells[i].partition);
+        stRPMergeCell_construct(column->cells[i].partition, column->cells[i].partition, mColumn);
+    }
 
     // Create links
     rColumn->pColumn = mColumn;
@@ -120,8 +115,10 @@ void stRPColumn_split(stRPColumn *column, int64_t firstHalfLength, stRPHmm *hmm)
     // Increase column number
     hmm->columnNumber++;
 
-    // Adjust length of previous column
+    // Adjust length of previous column, discarding its now out of date bit count vectors
     column->length = firstHalfLength;
+    free(column->bitCountVectors);
+    column->bitCountVectors = NULL;
 }
 
 stSet *stRPColumn_getColumnSequencesAsSet(stRPColumn *column) {
@@ -151,20 +148,71 @@ stSet *stRPColumn_getSequencesInCommon(stRPColumn *column1, stRPColumn *column2)
     return seqsShared;
 }
 
-/*
- * Read partitioning hmm state (stRPCell) functions
- */
+void stRPColumn_reserveCells(stRPColumn *column, int64_t cellNo) {
+    /*
+     * Ensures the column can hold cellNo cells without reallocating, so pointers to its
+     * cells remain valid while up to that many cells are added.
+     */
+    if(cellNo > column->cellCapacity) {
+        column->cells = realloc(column->cells, sizeof(stRPCell) * cellNo);
+        if(column->cells == NULL) {
+            st_errAbort("Failed to allocate %" PRIi64 " cells for a column", cellNo);
+        }
+        column->cellCapacity = cellNo;
+    }
+}
 
-stRPCell *stRPCell_construct(int64_t partition) {
-    stRPCell *cell = st_calloc(1, sizeof(stRPCell));
+stRPCell *stRPColumn_addCell(stRPColumn *column, uint64_t partition) {
+    /*
+     * Appends a cell with the given partition to the column. The returned pointer (and pointers
+     * to the other cells of the column) are only valid until the column's cells are next reallocated.
+     */
+    if(column->cellNo == column->cellCapacity) {
+        stRPColumn_reserveCells(column, column->cellCapacity > 0 ? 2 * column->cellCapacity : 2);
+    }
+    stRPCell *cell = &column->cells[column->cellNo++];
     cell->partition = partition;
+    cell->forwardLogProb = 0.0;
+    cell->backwardLogProb = 0.0;
     return cell;
 }
 
-void stRPCell_destruct(stRPCell *cell) {
-    free(cell);
+void stRPColumn_setCells(stRPColumn *column, stList *cells) {
+    /*
+     * Replaces the cells of the column with the cells in the list 'cells', which must point
+     * into the column, in the order given. The list is updated to point at the new locations of the cells.
+     */
+    assert(stList_length(cells) > 0);
+    stRPCell *newCells = st_malloc(sizeof(stRPCell) * stList_length(cells));
+    for(int64_t i=0; i<stList_length(cells); i++) {
+        stRPCell *cell = stList_get(cells, i);
+        assert(cell >= column->cells && cell < column->cells + column->cellNo);
+        newCells[i] = *cell;
+        stList_set(cells, i, &newCells[i]);
+    }
+    free(column->cells);
+    column->cells = newCells;
+    column->cellNo = stList_length(cells);
+    column->cellCapacity = column->cellNo;
+}
+
+uint64_t *stRPColumn_getBitCountVectors(stRPColumn *column, stReference *ref) {
+    /*
+     * Returns the bit count vectors of the column (see calculateCountBitVectors), calculating them
+     * on first use. They are owned by the column, so are shared by the forward pass and by
+     * any subsequent genotype calculation.
+     */
+    if(column->bitCountVectors == NULL) {
+        column->bitCountVectors = calculateCountBitVectors(column->seqs, ref,
+                column->refStart, column->length, column->depth);
+    }
+    return column->bitCountVectors;
 }
 
+/*
+ * Read partitioning hmm state (stRPCell) functions
+ */
+
 void stRPCell_print(stRPCell *cell, FILE *fileHandle) {
     /*
      * Prints a debug representation of the cell.
@@ -276,16 +276,22 @@ stList *mergeTwoTilingPaths(stList *tilingPath1, stList *tilingPath2) {
     stList_destruct(tilingPath1);
     stList_destruct(tilingPath2);
 
-    // The output tiling path, which starts out empty
-    stList *newTilingPath = stList_construct();
+    // Take ownership of the components, which are destroyed as they are fused
+    stList *componentsList = stSet_getList(components);
+    for(int64_t i=0; i<stList_length(componentsList); i++) {
+        stSet_remove(components, stList_get(componentsList, i));
+    }
 
     // Fuse the hmms
 
-    // For each component of overlapping hmms
-    stList *componentsList = stSet_getList(components);
-    for(int64_t i=0; i<stList_length(componentsList); i++) {
+    // For each component of overlapping hmms, which are independent of one another
+    int64_t componentNo = stList_length(componentsList);
+    stRPHmm **componentHmms = st_calloc(componentNo > 0 ? componentNo : 1, sizeof(stRPHmm *));
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1) if(componentNo > 1)
+#endif
+    for(int64_t i=0; i<componentNo; i++) {
         stSortedSet *component = stList_get(componentsList, i);
-        stSet_remove(components, component);
 
         // Make two sub-tiling paths (there can only be two maximal paths, by definition)
         stList *tilingPaths = getTilingPaths(component);
@@ -322,12 +328,18 @@ stList *mergeTwoTilingPaths(stList *tilingPath1, stList *tilingPath2) {
             stList_destruct(subTilingPath1);
         }
 
-        // Add to output tiling path
-        stList_append(newTilingPath, hmm);
+        componentHmms[i] = hmm;
 
         stList_destruct(tilingPaths);
     }
 
+    // The output tiling path
+    stList *newTilingPath = stList_construct();
+    for(int64_t i=0; i<componentNo; i++) {
+        stList_append(newTilingPath, componentHmms[i]);
+    }
+    free(componentHmms);
+
     //Cleanup
 
     stList_destruct(componentsList);
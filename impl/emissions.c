@@ -4,8 +4,16 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <pthread.h>
 #include "margin.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define EMISSION_KERNELS_X86
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*
  * Allele alphabet and substitutions
  */
@@ -79,6 +87,45 @@ uint64_t calculateBitCountVector(uint8_t **seqs, uint64_t depth,
     return bitCountVector;
 }
 
+static inline void calculateBitCountVectorsOfAllele(uint8_t **seqs, uint64_t depth, uint64_t alleleOffset,
+		uint64_t *bitCountVectors) {
+    /*
+     * Calculates the bit count vectors for all the bits of a given allele, equivalent to
+     * calculateBitCountVector for each bit. The allele's probabilities for the reads form a 64x8 bit matrix,
+     * which is transposed using the SSE2 byte movemask: shifting bit k of each byte into the byte's
+     * top bit and taking the movemask gives bit k of 16 reads at a time.
+     */
+	assert(depth <= MAX_READ_PARTITIONING_DEPTH);
+	uint8_t probs[64];
+	for(uint64_t i=0; i<depth; i++) {
+		probs[i] = seqs[i][alleleOffset];
+	}
+	memset(&probs[depth], 0, 64 - depth);
+
+#if defined(__SSE2__)
+	__m128i v[4];
+	for(int64_t q=0; q<4; q++) {
+		v[q] = _mm_loadu_si128((__m128i *)&probs[16*q]);
+	}
+	for(uint64_t k=0; k<ALLELE_LOG_PROB_BITS; k++) {
+		__m128i shift = _mm_cvtsi32_si128(7 - k);
+		uint64_t bitCountVector = 0;
+		for(int64_t q=0; q<4; q++) {
+			bitCountVector |= ((uint64_t)(uint16_t)_mm_movemask_epi8(_mm_sll_epi64(v[q], shift))) << (16*q);
+		}
+		bitCountVectors[k] = bitCountVector;
+	}
+#else
+	for(uint64_t k=0; k<ALLELE_LOG_PROB_BITS; k++) {
+		uint64_t bitCountVector = 0;
+		for(uint64_t i=0; i<depth; i++) {
+			bitCountVector |= ((((uint64_t)probs[i] >> k) & 1) << i);
+		}
+		bitCountVectors[k] = bitCountVector;
+	}
+#endif
+}
+
 uint64_t *calculateCountBitVectors(uint8_t **seqs, stReference *ref,
 								   uint64_t firstSite, uint64_t length, uint64_t depth) {
     /*
@@ -101,11 +148,9 @@ uint64_t *calculateCountBitVectors(uint8_t **seqs, stReference *ref,
         // For each allele
     	uint64_t siteOffset = ref->sites[i].alleleOffset - firstAllele;
         for(uint64_t j=0; j<ref->sites[i].alleleNumber; j++) {
-            // For each bit
-            for(uint64_t k=0; k<ALLELE_LOG_PROB_BITS; k++) {
-                *retrieveBitCountVector(bitCountVectors, siteOffset, j, k) =
-                        calculateBitCountVector(seqs, depth, siteOffset, j, k);
-            }
+            // All the bits at once
+            calculateBitCountVectorsOfAllele(seqs, depth, siteOffset + j,
+                    retrieveBitCountVector(bitCountVectors, siteOffset, j, 0));
         }
     }
 
@@ -127,6 +172,115 @@ uint64_t getLogProbOfAllele(uint64_t *bitCountVectors, uint64_t depth, uint64_t
     return negLogProb;
 }
 
+/*
+ * Batched computation of getLogProbOfAllele for many partitions against the same bit count vectors.
+ * The kernel is picked at runtime from the instructions the CPU supports.
+ */
+
+static void getLogProbsOfAlleleScalar(uint64_t *j, uint64_t *partitions, int64_t partitionNo,
+		uint64_t *negLogProbs, int64_t stride) {
+	for(int64_t p=0; p<partitionNo; p++) {
+		uint64_t negLogProb = popcount64(j[0] & partitions[p]);
+		for(uint64_t i=1; i<ALLELE_LOG_PROB_BITS; i++) {
+			negLogProb += (popcount64(j[i] & partitions[p]) << i);
+		}
+		negLogProbs[p * stride] = negLogProb;
+	}
+}
+
+#ifdef EMISSION_KERNELS_X86
+
+__attribute__((target("avx2")))
+static void getLogProbsOfAlleleAVX2(uint64_t *j, uint64_t *partitions, int64_t partitionNo,
+		uint64_t *negLogProbs, int64_t stride) {
+	/*
+	 * Four partitions at a time, counting bits with a nibble lookup table (vpshufb) and summing
+	 * the byte counts of each 64 bit lane with vpsadbw.
+	 */
+	const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+											0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i lowMask = _mm256_set1_epi8(0x0f);
+	const __m256i zero = _mm256_setzero_si256();
+	int64_t p = 0;
+	for(; p+4 <= partitionNo; p += 4) {
+		__m256i partition = _mm256_loadu_si256((__m256i *)&partitions[p]);
+		__m256i negLogProb = zero;
+		for(uint64_t i=0; i<ALLELE_LOG_PROB_BITS; i++) {
+			__m256i x = _mm256_and_si256(_mm256_set1_epi64x(j[i]), partition);
+			__m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(x, lowMask)),
+					_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), lowMask)));
+			negLogProb = _mm256_add_epi64(negLogProb,
+					_mm256_sll_epi64(_mm256_sad_epu8(counts, zero), _mm_cvtsi64_si128(i)));
+		}
+		uint64_t out[4];
+		_mm256_storeu_si256((__m256i *)out, negLogProb);
+		for(int64_t k=0; k<4; k++) {
+			negLogProbs[(p + k) * stride] = out[k];
+		}
+	}
+	getLogProbsOfAlleleScalar(j, &partitions[p], partitionNo - p, &negLogProbs[p * stride], stride);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static void getLogProbsOfAlleleAVX512(uint64_t *j, uint64_t *partitions, int64_t partitionNo,
+		uint64_t *negLogProbs, int64_t stride) {
+	/*
+	 * Eight partitions at a time using the native 64 bit lane popcount (vpopcntq).
+	 */
+	int64_t p = 0;
+	for(; p+8 <= partitionNo; p += 8) {
+		__m512i partition = _mm512_loadu_si512((void *)&partitions[p]);
+		__m512i negLogProb = _mm512_setzero_si512();
+		for(uint64_t i=0; i<ALLELE_LOG_PROB_BITS; i++) {
+			__m512i counts = _mm512_popcnt_epi64(_mm512_and_si512(_mm512_set1_epi64(j[i]), partition));
+			negLogProb = _mm512_add_epi64(negLogProb, _mm512_sll_epi64(counts, _mm_cvtsi64_si128(i)));
+		}
+		uint64_t out[8];
+		_mm512_storeu_si512((void *)out, negLogProb);
+		for(int64_t k=0; k<8; k++) {
+			negLogProbs[(p + k) * stride] = out[k];
+		}
+	}
+	getLogProbsOfAlleleScalar(j, &partitions[p], partitionNo - p, &negLogProbs[p * stride], stride);
+}
+
+#endif
+
+typedef void (*LogProbsOfAlleleKernel)(uint64_t *, uint64_t *, int64_t, uint64_t *, int64_t);
+
+static LogProbsOfAlleleKernel logProbsOfAlleleKernel = getLogProbsOfAlleleScalar;
+static pthread_once_t logProbsOfAlleleKernelOnce = PTHREAD_ONCE_INIT;
+
+static void chooseLogProbsOfAlleleKernel(void) {
+	/*
+	 * Picks the fastest kernel supported by the CPU, run once before the first use.
+	 */
+#ifdef EMISSION_KERNELS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512vpopcntdq")) {
+		logProbsOfAlleleKernel = getLogProbsOfAlleleAVX512;
+	}
+	else if(__builtin_cpu_supports("avx2")) {
+		logProbsOfAlleleKernel = getLogProbsOfAlleleAVX2;
+	}
+#endif
+}
+
+static LogProbsOfAlleleKernel getLogProbsOfAlleleKernel(void) {
+	pthread_once(&logProbsOfAlleleKernelOnce, chooseLogProbsOfAlleleKernel);
+	return logProbsOfAlleleKernel;
+}
+
+void getLogProbsOfAllele(uint64_t *bitCountVectors, uint64_t *partitions, int64_t partitionNo,
+						 uint64_t siteOffset, uint64_t allele, uint64_t *negLogProbs, int64_t stride) {
+    /*
+     * For each of the partitions, sets negLogProbs[i * stride] to the -log prob of the reads in partition i
+     * being generated by the given allele, as given by getLogProbOfAllele.
+     */
+	getLogProbsOfAlleleKernel()(retrieveBitCountVector(bitCountVectors, siteOffset, allele, 0),
+			partitions, partitionNo, negLogProbs, stride);
+}
+
 static inline uint64_t minP(uint64_t a, uint64_t b) {
     return a < b ? a : b;
 }
@@ -174,20 +328,14 @@ static inline uint64_t getMaxAlleleLogProb(stSite *site, uint64_t *alleleLogProb
 	return p;
 }
 
-static inline uint64_t genotypeLogProbability(stRPColumn *column, stSite *site, uint64_t siteOffset,
-                                                 uint64_t partition, uint64_t *bitCountVectors, bool includeAncestorSubProb) {
+static inline uint64_t genotypeLogProbability(stSite *site, uint64_t *alleleLogProbsHap1,
+		uint64_t *alleleLogProbsHap2, bool includeAncestorSubProb) {
     /*
-     * Get the -log probability of the alleles in a given position within a column for a given partition.
+     * Get the -log probability of the alleles in a given position within a column for a given partition,
+     * given the -log probabilities of each allele for the reads in the partition and in its complement.
      */
     // Get the sum of log probabilities of the derived alleles over the possible source alleles
 
-	// For each allele calculate the log probability of the
-	// partition and store counts in an array
-	uint64_t alleleLogProbsHap1[site->alleleNumber];
-	alleleLogHapProbabilities(column, site, siteOffset, partition, bitCountVectors, alleleLogProbsHap1);
-	uint64_t alleleLogProbsHap2[site->alleleNumber];
-	alleleLogHapProbabilities(column, site, siteOffset, ~partition, bitCountVectors, alleleLogProbsHap2);
-
 	if(!includeAncestorSubProb) {
 		return getMaxAlleleLogProb(site, alleleLogProbsHap1) + getMaxAlleleLogProb(site, alleleLogProbsHap2);
 	}
@@ -207,25 +355,63 @@ static inline uint64_t genotypeLogProbability(stRPColumn *column, stSite *site,
     return logGenotypeProb;
 }
 
-double emissionLogProbability(stRPColumn *column,
-                              stRPCell *cell, uint64_t *bitCountVectors, stReference *ref,
-                              stRPHmmParameters *params) {
+void emissionLogProbabilities(stRPColumn *column, stRPCell *cells, int64_t cellNo,
+                              uint64_t *bitCountVectors, stReference *ref,
+                              stRPHmmParameters *params, double *emissionLogProbs) {
     /*
-     * Get the log probability of a set of reads for a given column.
+     * Get the log probability of a set of reads for a given column for each of the cells, setting
+     * emissionLogProbs[i] for cells[i]. The allele probabilities of a block of partitions
+     * are calculated together at each site, so the bit count vectors are loaded once per block.
      */
     assert(column->length > 0);
-    uint64_t logPartitionProb = 0;
 	uint64_t firstAllele = ref->sites[column->refStart].alleleOffset;
-    for(uint64_t i=column->refStart; i<column->refStart+column->length; i++) {
-    	stSite *site = &(ref->sites[i]);
-    	uint64_t siteOffset = site->alleleOffset - firstAllele;
+	for(int64_t b=0; b<cellNo; b+=EMISSION_PARTITION_BLOCK_SIZE) {
+		int64_t partitionNo = cellNo - b < EMISSION_PARTITION_BLOCK_SIZE ? cellNo - b : EMISSION_PARTITION_BLOCK_SIZE;
+		uint64_t partitions[EMISSION_PARTITION_BLOCK_SIZE], invertedPartitions[EMISSION_PARTITION_BLOCK_SIZE];
+		uint64_t logPartitionProbs[EMISSION_PARTITION_BLOCK_SIZE];
+		for(int64_t k=0; k<partitionNo; k++) {
+			partitions[k] = cells[b+k].partition;
+			invertedPartitions[k] = ~cells[b+k].partition;
+			logPartitionProbs[k] = 0;
+		}
 
-        // Get the reference prior probabilities
-        logPartitionProb += genotypeLogProbability(column, site, siteOffset, cell->partition, bitCountVectors,
-        		params->includeAncestorSubProb);
-    }
+		for(uint64_t i=column->refStart; i<column->refStart+column->length; i++) {
+			stSite *site = &(ref->sites[i]);
+			uint64_t siteOffset = site->alleleOffset - firstAllele;
+
+			// For each allele calculate the log probability of each partition (and its complement),
+			// stored by partition then allele
+			uint64_t alleleLogProbsHap1[partitionNo * site->alleleNumber];
+			uint64_t alleleLogProbsHap2[partitionNo * site->alleleNumber];
+			for(uint64_t j=0; j<site->alleleNumber; j++) {
+				getLogProbsOfAllele(bitCountVectors, partitions, partitionNo, siteOffset, j,
+						&alleleLogProbsHap1[j], site->alleleNumber);
+				getLogProbsOfAllele(bitCountVectors, invertedPartitions, partitionNo, siteOffset, j,
+						&alleleLogProbsHap2[j], site->alleleNumber);
+			}
+
+			// Get the reference prior probabilities
+			for(int64_t k=0; k<partitionNo; k++) {
+				logPartitionProbs[k] += genotypeLogProbability(site, &alleleLogProbsHap1[k * site->alleleNumber],
+						&alleleLogProbsHap2[k * site->alleleNumber], params->includeAncestorSubProb);
+			}
+		}
+
+		for(int64_t k=0; k<partitionNo; k++) {
+			emissionLogProbs[b+k] = -((double)logPartitionProbs[k]);
+		}
+	}
+}
 
-    return -((double)logPartitionProb);
+double emissionLogProbability(stRPColumn *column,
+                              stRPCell *cell, uint64_t *bitCountVectors, stReference *ref,
+                              stRPHmmParameters *params) {
+    /*
+     * Get the log probability of a set of reads for a given column.
+     */
+    double emissionLogProb;
+    emissionLogProbabilities(column, cell, 1, bitCountVectors, ref, params, &emissionLogProb);
+    return emissionLogProb;
 }
 
 /*
@@ -317,16 +503,12 @@ void fillInPredictedGenome(stGenomeFragment *gF, uint64_t partition,
      * genome fragment argument.
      */
     
-    // Calculate the bit vectors
-    uint64_t *bitCountVectors = calculateCountBitVectors(column->seqs, gF->reference, column->refStart,
-    				column->length, column->depth);
+    // Get the bit vectors, cached by the column
+    uint64_t *bitCountVectors = stRPColumn_getBitCountVectors(column, gF->reference);
 
     assert(column->length > 0);
     for(uint64_t i=0; i<column->length; i++) {
         fillInPredictedGenomePosition(gF, i+column->refStart, partition, column,
                                       bitCountVectors);
     }
-
-    // Cleanup
-    free(bitCountVectors);
 }
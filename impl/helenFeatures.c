@@ -115,15 +115,305 @@ int PoaFeature_ChannelRleWeight_charRLIndex(int64_t maxRunLength, Symbol charact
     return pos;
 }
 
+/*
+ * Truth labels
+ */
+
+typedef struct _HelenTruthAlignment {
+    int64_t refStart;
+    int64_t refEnd;
+    uint8_t *sequence; // packed four bits per base, as in the BAM record
+    int64_t cigarLength;
+    uint32_t *cigar;
+    int64_t *cigarRefStarts; // reference and sequence position at the start of each cigar op, one extra at the end
+    int64_t *cigarSeqStarts;
+} HelenTruthAlignment;
+
+typedef struct _HelenTruthContig {
+    char *refSeqName;
+    stList *alignments; // NULL until loaded
+    bool loaded;
+    int64_t users; // chunks reading the alignments, an evicted contig is freed by the last of them
+    bool evicted;
+} HelenTruthContig;
+
+static HelenTruthAlignment *helenTruthAlignment_construct(bam1_t *aln) {
+    HelenTruthAlignment *alignment = st_calloc(1, sizeof(HelenTruthAlignment));
+    uint32_t *cigar = bam_get_cigar(aln);
+    alignment->refStart = aln->core.pos;
+    alignment->sequence = st_calloc((aln->core.l_qseq + 1) / 2, sizeof(uint8_t));
+    memcpy(alignment->sequence, bam_get_seq(aln), (aln->core.l_qseq + 1) / 2);
+    alignment->cigarLength = aln->core.n_cigar;
+    alignment->cigar = st_calloc(aln->core.n_cigar, sizeof(uint32_t));
+    memcpy(alignment->cigar, cigar, aln->core.n_cigar * sizeof(uint32_t));
+    alignment->cigarRefStarts = st_calloc(aln->core.n_cigar + 1, sizeof(int64_t));
+    alignment->cigarSeqStarts = st_calloc(aln->core.n_cigar + 1, sizeof(int64_t));
+
+    alignment->cigarRefStarts[0] = alignment->refStart;
+    alignment->cigarSeqStarts[0] = 0;
+    for (int64_t i = 0; i < alignment->cigarLength; i++) {
+        int cigarOp = cigar[i] & BAM_CIGAR_MASK;
+        int64_t cigarNum = cigar[i] >> BAM_CIGAR_SHIFT;
+        alignment->cigarRefStarts[i + 1] = alignment->cigarRefStarts[i] + (bam_cigar_type(cigarOp) & 2 ? cigarNum : 0);
+        alignment->cigarSeqStarts[i + 1] = alignment->cigarSeqStarts[i] + (bam_cigar_type(cigarOp) & 1 ? cigarNum : 0);
+    }
+    alignment->refEnd = alignment->cigarRefStarts[alignment->cigarLength];
+    return alignment;
+}
+
+static void helenTruthAlignment_destruct(HelenTruthAlignment *alignment) {
+    free(alignment->sequence);
+    free(alignment->cigar);
+    free(alignment->cigarRefStarts);
+    free(alignment->cigarSeqStarts);
+    free(alignment);
+}
+
+static HelenTruthContig *helenTruthContig_construct(char *refSeqName) {
+    HelenTruthContig *contig = st_calloc(1, sizeof(HelenTruthContig));
+    contig->refSeqName = stString_copy(refSeqName);
+    return contig;
+}
+
+static void helenTruthContig_destruct(HelenTruthContig *contig) {
+    free(contig->refSeqName);
+    if (contig->alignments != NULL) {
+        stList_destruct(contig->alignments);
+    }
+    free(contig);
+}
+
+static stList *helenTruthLabeler_loadAlignments(HelenTruthLabeler *labeler, char *refSeqName) {
+    /*
+     * Reads every truth alignment to the contig which passes the same filters as the polishing reads, keeping only
+     * the sequence and cigar needed to cut out any chunk later. Only reads the labeler's settings, so is called
+     * without holding its mutex.
+     */
+    stList *alignments = stList_construct3(0, (void (*)(void *)) helenTruthAlignment_destruct);
+
+    samFile *in = NULL;
+    hts_idx_t *idx = NULL;
+    if ((in = hts_open(labeler->bamFile, "r")) == 0) {
+        st_errAbort("ERROR: Cannot open bam file %s\n", labeler->bamFile);
+    }
+    if ((idx = sam_index_load(in, labeler->bamFile)) == 0) {
+        st_errAbort("ERROR: Cannot open index for bam file %s\n", labeler->bamFile);
+    }
+    bam_hdr_t *bamHdr = sam_hdr_read(in);
+    int tid = bam_name2id(bamHdr, refSeqName);
+    if (tid >= 0) {
+        bam1_t *aln = bam_init1();
+        hts_itr_t *iter = sam_itr_queryi(idx, tid, 0, bamHdr->target_len[tid]);
+        if (iter == NULL) {
+            st_errAbort("ERROR: Cannot open iterator for contig %s for bam file %s\n", refSeqName, labeler->bamFile);
+        }
+        while (sam_itr_next(in, iter, aln) >= 0) {
+            if (aln->core.l_qseq <= 0) continue;
+            if (aln->core.n_cigar == 0) continue;
+            if ((aln->core.flag & (uint16_t) 0x4) != 0)
+                continue; //unaligned
+            if (!labeler->params->includeSecondaryAlignments && (aln->core.flag & (uint16_t) 0x100) != 0)
+                continue; //secondary
+            if (!labeler->params->includeSupplementaryAlignments && (aln->core.flag & (uint16_t) 0x800) != 0)
+                continue; //supplementary
+            if (aln->core.qual < labeler->params->filterAlignmentsWithMapQBelowThisThreshold)
+                continue; //low mapping quality
+
+            HelenTruthAlignment *alignment = helenTruthAlignment_construct(aln);
+            if (alignment->refEnd <= alignment->refStart) {
+                helenTruthAlignment_destruct(alignment);
+                continue;
+            }
+            stList_append(alignments, alignment);
+        }
+        hts_itr_destroy(iter);
+        bam_destroy1(aln);
+    }
+    bam_hdr_destroy(bamHdr);
+    hts_idx_destroy(idx);
+    hts_close(in);
+
+    st_logInfo(" Loaded %"PRId64" truth alignments for contig %s\n", stList_length(alignments), refSeqName);
+    return alignments;
+}
+
+static char *helenTruthAlignment_getTruth(HelenTruthAlignment *alignment, int64_t windowStart, int64_t windowEnd,
+                                          int64_t *referenceToTruth) {
+    /*
+     * Returns the truth bases aligned to the window, including inserts before window positions but no soft clips.
+     * For each window position, referenceToTruth is set to the index in the returned sequence of the base aligned
+     * to it, or of the next aligned base for deleted positions.
+     */
+    int64_t windowLength = windowEnd - windowStart;
+    for (int64_t i = 0; i < windowLength; i++) {
+        referenceToTruth[i] = -1;
+    }
+
+    // first op which reaches the window
+    int64_t lo = 0, hi = alignment->cigarLength;
+    while (lo < hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (alignment->cigarRefStarts[mid + 1] < windowStart) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int64_t truthStart = -1;
+    int64_t truthEnd = -1;
+    for (int64_t i = lo; i < alignment->cigarLength && alignment->cigarRefStarts[i] < windowEnd; i++) {
+        int cigarOp = alignment->cigar[i] & BAM_CIGAR_MASK;
+        int64_t cigarNum = alignment->cigar[i] >> BAM_CIGAR_SHIFT;
+        int64_t refPos = alignment->cigarRefStarts[i];
+        int64_t seqPos = alignment->cigarSeqStarts[i];
+        if (cigarOp == BAM_CMATCH || cigarOp == BAM_CEQUAL || cigarOp == BAM_CDIFF) {
+            int64_t first = refPos < windowStart ? windowStart : refPos;
+            int64_t last = refPos + cigarNum > windowEnd ? windowEnd : refPos + cigarNum;
+            for (int64_t r = first; r < last; r++) {
+                if (truthStart < 0) truthStart = seqPos + r - refPos;
+                truthEnd = seqPos + r - refPos + 1;
+                referenceToTruth[r - windowStart] = truthEnd - 1;
+            }
+        } else if (cigarOp == BAM_CINS && refPos >= windowStart) {
+            if (truthStart < 0) truthStart = seqPos;
+            truthEnd = seqPos + cigarNum;
+        }
+    }
+    if (truthStart < 0) {
+        truthStart = 0;
+        truthEnd = 0;
+    }
+
+    // positions are relative to the returned sequence, deletions take the next aligned base
+    int64_t nextTruthPos = truthEnd - truthStart;
+    for (int64_t i = windowLength - 1; i >= 0; i--) {
+        if (referenceToTruth[i] >= 0) {
+            referenceToTruth[i] -= truthStart;
+            nextTruthPos = referenceToTruth[i];
+        } else {
+            referenceToTruth[i] = nextTruthPos;
+        }
+    }
+
+    char *truth = st_calloc(truthEnd - truthStart + 1, sizeof(char));
+    for (int64_t i = truthStart; i < truthEnd; i++) {
+        truth[i - truthStart] = seq_nt16_str[bam_seqi(alignment->sequence, i)];
+    }
+    return truth;
+}
+
+HelenTruthLabeler *helenTruthLabeler_construct(char *bamFile, PolishParams *params) {
+    /*
+     * The truth BAM is read one contig at a time as chunks first ask for it. Alignment filters are taken from the
+     * polishing parameters, as for the reads.
+     */
+    HelenTruthLabeler *labeler = st_calloc(1, sizeof(HelenTruthLabeler));
+    labeler->bamFile = stString_copy(bamFile);
+    labeler->params = params;
+    labeler->contigs = stList_construct3(0, (void (*)(void *)) helenTruthContig_destruct);
+    labeler->contigLoads = 0;
+    pthread_mutex_init(&labeler->mutex, NULL);
+    pthread_cond_init(&labeler->contigLoaded, NULL);
+    return labeler;
+}
+
+void helenTruthLabeler_destruct(HelenTruthLabeler *labeler) {
+    st_logInfo("> Loaded truth alignments %"PRId64" times from %s\n", labeler->contigLoads, labeler->bamFile);
+    pthread_mutex_destroy(&labeler->mutex);
+    pthread_cond_destroy(&labeler->contigLoaded);
+    stList_destruct(labeler->contigs);
+    free(labeler->bamFile);
+    free(labeler);
+}
+
+char *helenTruthLabeler_getTruth(HelenTruthLabeler *labeler, BamChunk *bamChunk, int64_t **referenceToTruth) {
+    /*
+     * Returns the true reference sequence aligned to the chunk if exactly one truth alignment overlaps it, otherwise
+     * NULL. On success referenceToTruth is set to an array over the chunk's reference positions giving the truth
+     * position aligned to each (see helenTruthAlignment_getTruth), which the caller frees. The contig is loaded on
+     * first use; the least recently used contig is dropped once more than HELEN_TRUTH_CACHED_CONTIGS are cached.
+     * The mutex is only held to look up and update the cache. The first chunk to ask for a contig loads it without
+     * the mutex, and other chunks asking for it meanwhile wait for that load rather than repeating it.
+     */
+    int64_t windowStart = bamChunk->chunkBoundaryStart;
+    int64_t windowEnd = bamChunk->chunkBoundaryEnd;
+    char *truth = NULL;
+    *referenceToTruth = NULL;
+
+    pthread_mutex_lock(&labeler->mutex);
+    HelenTruthContig *contig = NULL;
+    for (int64_t i = 0; i < stList_length(labeler->contigs); i++) {
+        HelenTruthContig *cached = stList_get(labeler->contigs, i);
+        if (stString_eq(cached->refSeqName, bamChunk->refSeqName)) {
+            contig = stList_remove(labeler->contigs, i);
+            break;
+        }
+    }
+    bool loadContig = contig == NULL;
+    if (loadContig) {
+        contig = helenTruthContig_construct(bamChunk->refSeqName);
+    }
+    contig->users++;
+    stList_append(labeler->contigs, contig);
+    while (stList_length(labeler->contigs) > HELEN_TRUTH_CACHED_CONTIGS) {
+        HelenTruthContig *evicted = stList_remove(labeler->contigs, 0);
+        if (evicted->users == 0) {
+            helenTruthContig_destruct(evicted);
+        } else {
+            evicted->evicted = TRUE;
+        }
+    }
+    while (!loadContig && !contig->loaded) {
+        pthread_cond_wait(&labeler->contigLoaded, &labeler->mutex);
+    }
+    pthread_mutex_unlock(&labeler->mutex);
+
+    if (loadContig) {
+        stList *alignments = helenTruthLabeler_loadAlignments(labeler, bamChunk->refSeqName);
+        pthread_mutex_lock(&labeler->mutex);
+        contig->alignments = alignments;
+        contig->loaded = TRUE;
+        labeler->contigLoads++;
+        pthread_cond_broadcast(&labeler->contigLoaded);
+        pthread_mutex_unlock(&labeler->mutex);
+    }
+
+    // poor man's "do we have a unique alignment"
+    HelenTruthAlignment *overlapping = NULL;
+    int64_t overlappingCount = 0;
+    for (int64_t i = 0; i < stList_length(contig->alignments); i++) {
+        HelenTruthAlignment *alignment = stList_get(contig->alignments, i);
+        if (alignment->refStart < windowEnd && alignment->refEnd > windowStart) {
+            overlapping = alignment;
+            overlappingCount++;
+        }
+    }
+    if (overlappingCount == 1 && windowEnd > windowStart) {
+        *referenceToTruth = st_calloc(windowEnd - windowStart, sizeof(int64_t));
+        truth = helenTruthAlignment_getTruth(overlapping, windowStart, windowEnd, *referenceToTruth);
+    }
+
+    pthread_mutex_lock(&labeler->mutex);
+    contig->users--;
+    if (contig->evicted && contig->users == 0) {
+        helenTruthContig_destruct(contig);
+    }
+    pthread_mutex_unlock(&labeler->mutex);
+
+    return truth;
+}
+
+
 void handleHelenFeatures(
         // global params
-        HelenFeatureType helenFeatureType, BamChunker *trueReferenceBamChunker,
-        int64_t splitWeightMaxRunLength, void **helenHDF5Files, bool fullFeatureOutput,
-        char *trueReferenceBam, Params *params,
+        HelenFeatureType helenFeatureType, HelenTruthLabeler *helenTruthLabeler,
+        int64_t splitWeightMaxRunLength, HelenFeatureWriter *helenFeatureWriter, bool fullFeatureOutput,
+        Params *params,
 
         // chunk params
         char *logIdentifier, int64_t chunkIdx, BamChunk *bamChunk, Poa *poa, stList *bamChunkReads,
-        char *polishedConsensusString, RleString *polishedRleConsensus) {
+        char *polishedConsensusString, RleString *polishedRleConsensus, RleString *rleReference) {
 
     st_logInfo(">%s Performing feature generation for chunk.\n", logIdentifier);
 
@@ -157,22 +447,20 @@ void handleHelenFeatures(
     bool validReferenceAlignment = FALSE;
 
     // get reference chunk
-    if (trueReferenceBam != NULL) {
-        // get alignment of true ref to assembly
-        stList *trueRefReads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
-        stList *unused = stList_construct3(0, (void (*)(void *)) stList_destruct);
-        // construct new chunk
-        BamChunk *trueRefBamChunk = bamChunk_copyConstruct(bamChunk);
-        trueRefBamChunk->parent = trueReferenceBamChunker;
-        // get true ref as "read"
-        uint32_t trueAlignmentCount = convertToReadsAndAlignments(trueRefBamChunk, NULL, trueRefReads, unused);
+    if (helenTruthLabeler != NULL) {
+        // get true ref sequence aligned to the chunk, and where the assembly positions fall in it
+        int64_t *referenceToTruth = NULL;
+        char *trueRefExpanded = helenTruthLabeler_getTruth(helenTruthLabeler, bamChunk, &referenceToTruth);
 
         // poor man's "do we have a unique alignment"
-        if (trueAlignmentCount == 1) {
-            BamChunkRead *trueRefRead = stList_get(trueRefReads, 0);
-            char *trueRefExpanded = rleString_expand(trueRefRead->rleRead);
-
-            stList *trueRefAlignmentRawSpace = alignConsensusAndTruth(polishedConsensusString, trueRefExpanded);
+        if (trueRefExpanded != NULL) {
+            stList *trueRefAlignmentRawSpace = alignConsensusAndTruthBanded(polishedConsensusString, trueRefExpanded,
+                    referenceToTruth, bamChunk->chunkBoundaryEnd - bamChunk->chunkBoundaryStart,
+                    HELEN_TRUTH_BAND_WIDTH);
+            if (trueRefAlignmentRawSpace == NULL) {
+                st_logInfo(" %s Truth alignment reached the edge of the band, realigning without it\n", logIdentifier);
+                trueRefAlignmentRawSpace = alignConsensusAndTruth(polishedConsensusString, trueRefExpanded);
+            }
             if (st_getLogLevel() == debug) {
                 printMEAAlignment(polishedConsensusString, trueRefExpanded,
                                   strlen(polishedConsensusString), strlen(trueRefExpanded),
@@ -221,15 +509,33 @@ void handleHelenFeatures(
 
             //cleanup
             free(trueRefExpanded);
+            free(referenceToTruth);
         }
+    }
 
-        stList_destruct(trueRefReads);
-        stList_destruct(unused);
-        bamChunk_destruct(trueRefBamChunk);
+    // the chunk core is in reference coordinates, features are indexed by consensus position
+    int64_t consensusCoreStart = 0;
+    int64_t consensusCoreEnd = polishedRleConsensus->length;
+    if (helenFeatureWriter->windowMode == HFEAT_WINDOW_CORE) {
+        uint64_t *rleReference_nonRleToRleCoordinateMap = rleString_getNonRleToRleCoordinateMap(rleReference);
+        int64_t referenceCoreStart = bamChunk->chunkStart - bamChunk->chunkBoundaryStart;
+        int64_t referenceCoreEnd = bamChunk->chunkEnd - bamChunk->chunkBoundaryStart;
+        referenceCoreStart = referenceCoreStart >= rleReference->nonRleLength ? rleReference->length :
+                rleReference_nonRleToRleCoordinateMap[referenceCoreStart];
+        referenceCoreEnd = referenceCoreEnd >= rleReference->nonRleLength ? rleReference->length :
+                rleReference_nonRleToRleCoordinateMap[referenceCoreEnd];
+        free(rleReference_nonRleToRleCoordinateMap);
+
+        consensusCoreStart = getConsensusPositionOfReferencePosition(polishedRleConsensus, rleReference,
+                referenceCoreStart);
+        consensusCoreEnd = getConsensusPositionOfReferencePosition(polishedRleConsensus, rleReference,
+                referenceCoreEnd);
+        st_logInfo(" %s Chunk core %"PRId64"-%"PRId64" is at consensus positions %"PRId64"-%"PRId64"\n",
+                logIdentifier, bamChunk->chunkStart, bamChunk->chunkEnd, consensusCoreStart, consensusCoreEnd);
     }
 
     // either write it, or note that we failed to find a valid reference alignment
-    if (trueReferenceBam != NULL && !validReferenceAlignment) {
+    if (helenTruthLabeler != NULL && !validReferenceAlignment) {
         st_logInfo(" %s No valid reference alignment was found, skipping HELEN feature output.\n", logIdentifier);
     } else {
         st_logInfo(" %s Writing HELEN features with filename base: %s\n", logIdentifier, helenFeatureOutfileBase);
@@ -237,7 +543,7 @@ void handleHelenFeatures(
         // write the actual features (type dependent)
         poa_writeHelenFeatures(helenFeatureType, poa, bamChunkReads, helenFeatureOutfileBase,
                                bamChunk, trueRefAlignment, polishedRleConsensus, trueRefRleString, fullFeatureOutput,
-                               splitWeightMaxRunLength, (HelenFeatureHDF5FileInfo**) helenHDF5Files);
+                               splitWeightMaxRunLength, consensusCoreStart, consensusCoreEnd, helenFeatureWriter);
 
         // write the polished chunk in fasta format
         if (fullFeatureOutput) {
@@ -409,6 +715,10 @@ void poa_addSplitRunLengthFeaturesForObservations(Poa *poa, PoaFeatureSplitRleWe
 
 
 stList *poa_getSplitRleWeightFeatures(Poa *poa, stList *bamChunkReads, const int64_t maxRunLength) {
+    /*
+     * Linked split run length features. poa_writeHelenFeatures builds the dense tensor directly instead, this is
+     * kept for the synchronous writers and as the reference that featureTest checks the dense tensor against.
+     */
     // initialize feature list
     stList *featureList = stList_construct3(0, (void (*)(void *)) PoaFeature_SplitRleWeight_destruct);
     for(int64_t i=1; i<stList_length(poa->nodes); i++) {
@@ -979,19 +1289,14 @@ void poa_annotateHelenFeaturesWithTruth(stList *features, HelenFeatureType featu
 void poa_writeHelenFeatures(HelenFeatureType type, Poa *poa, stList *bamChunkReads,
         char *outputFileBase, BamChunk *bamChunk, stList *trueRefAlignment, RleString *consensusRleString,
         RleString *trueRefRleString, bool fullFeatureOutput, int64_t maxRunLength,
-        HelenFeatureHDF5FileInfo** helenHDF5Files) {
+        int64_t consensusCoreStart, int64_t consensusCoreEnd, HelenFeatureWriter *helenFeatureWriter) {
     // prep
     int64_t firstMatchedFeature = -1;
     int64_t lastMatchedFeature = -1;
     stList *features = NULL;
+    HelenFeatureTensor *tensor = NULL;
     bool outputLabels = trueRefAlignment != NULL && trueRefRleString != NULL;
 
-    # ifdef _OPENMP
-    int64_t threadIdx = omp_get_thread_num();
-    # else
-    int64_t threadIdx = 0;
-    # endif
-
     // handle differently based on type
     switch (type) {
         case HFEAT_SIMPLE_WEIGHT :
@@ -1006,51 +1311,40 @@ void poa_writeHelenFeatures(HelenFeatureType type, Poa *poa, stList *bamChunkRea
                                                    &firstMatchedFeature, &lastMatchedFeature);
             }
 
-            writeSimpleWeightHelenFeaturesHDF5(poa->alphabet, helenHDF5Files[threadIdx], outputFileBase, bamChunk,
-                    outputLabels, features, firstMatchedFeature, lastMatchedFeature);
+            tensor = getSimpleWeightHelenFeatureTensor(poa->alphabet, helenFeatureWriter->imageEncoding,
+                    outputFileBase, bamChunk, outputLabels, features, firstMatchedFeature, lastMatchedFeature);
 
             break;
 
         case HFEAT_SPLIT_RLE_WEIGHT:
-            // get features
-            features = poa_getSplitRleWeightFeatures(poa, bamChunkReads, maxRunLength);
-            firstMatchedFeature = 0;
-            lastMatchedFeature = stList_length(features) - 1;
-
-            // get truth (if we have it)
-            if (outputLabels) {
-                poa_annotateHelenFeaturesWithTruth(features, type, trueRefAlignment, trueRefRleString,
-                                                   &firstMatchedFeature, &lastMatchedFeature);
-            }
-
-            writeSplitRleWeightHelenFeaturesHDF5(poa->alphabet, helenHDF5Files[threadIdx],
-                    outputFileBase, bamChunk, outputLabels, features, firstMatchedFeature, lastMatchedFeature,
-                    maxRunLength);
-            break;
-
         case HFEAT_CHANNEL_RLE_WEIGHT:
-            // get features
-            features = poa_getChannelRleWeightFeatures(poa, bamChunkReads, maxRunLength);
-            firstMatchedFeature = 0;
-            lastMatchedFeature = stList_length(features) - 1;
-
-            // get truth (if we have it)
-            if (outputLabels) {
-                poa_annotateHelenFeaturesWithTruth(features, type, trueRefAlignment, trueRefRleString,
-                                                   &firstMatchedFeature, &lastMatchedFeature);
-            }
-
-            writeChannelRleWeightHelenFeaturesHDF5(poa->alphabet, helenHDF5Files[threadIdx],
-                                                 outputFileBase, bamChunk, outputLabels, features, firstMatchedFeature,
-                                                 lastMatchedFeature, maxRunLength);
+            // written straight into the tensor, without the linked features
+            tensor = poa_getRleWeightFeatureTensor(type, helenFeatureWriter->imageEncoding, poa,
+                    bamChunkReads, maxRunLength, outputFileBase, bamChunk, trueRefAlignment, trueRefRleString);
             break;
 
         default:
             st_errAbort("Unhandled HELEN feature type!\n");
     }
 
+    // with core windows, positions in the chunk overlaps are left to the neighbouring chunks
+    if (tensor != NULL && helenFeatureWriter->windowMode == HFEAT_WINDOW_CORE) {
+        helenFeatureTensor_keepReferencePositions(tensor, consensusCoreStart, consensusCoreEnd - 1);
+        if (tensor->featureCount == 0) {
+            helenFeatureTensor_destruct(tensor);
+            tensor = NULL;
+        }
+    }
+
+    // hand off to the sink thread, which owns the tensor from here
+    if (tensor != NULL) {
+        helenFeatureWriter_add(helenFeatureWriter, tensor);
+    }
+
     //cleanup
-    stList_destruct(features);
+    if (features != NULL) {
+        stList_destruct(features);
+    }
 }
 
 // this function taken from https://github.com/mengyao/Complete-Striped-Smith-Waterman-Library/blob/master/src/example.c
@@ -1098,8 +1392,9 @@ stList *alignConsensusAndTruth(char *consensusStr, char *truthStr) {
     profile = ssw_init(num, (int32_t) consensusLen, mat, 5, 2);
     for (m = 0; m < truthLen; ++m) ref_num[m] = nt_table[(int) truthStr[m]];
 
-    // Only the 8 bit of the flag is setted. ssw_align will always return the best alignment beginning position and cigar.
-    result = ssw_align (profile, ref_num, (int32_t) truthLen, gap_open, gap_extension, 1, 0, 0, 15);
+    // Only the 7 bit of the flag is setted, with a score filter of 1. ssw_align will return the best alignment
+    // beginning position and cigar unless nothing aligns, when generating the cigar would read before the sequences.
+    result = ssw_align (profile, ref_num, (int32_t) truthLen, gap_open, gap_extension, 2, 1, 0, 15);
 
     // Convert from cigar to aligned pairs
     int32_t consensusPos = result->read_begin1;
@@ -1134,6 +1429,222 @@ stList *alignConsensusAndTruth(char *consensusStr, char *truthStr) {
     return alignedPairs;
 }
 
+static inline int8_t getTruthAlignmentNucleotide(char c) {
+    switch (c) {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return 4;
+    }
+}
+
+#define BANDED_TRACEBACK_FROM_MATCH 0
+#define BANDED_TRACEBACK_FROM_CONSENSUS_GAP 1
+#define BANDED_TRACEBACK_FROM_TRUTH_GAP 2
+#define BANDED_TRACEBACK_START 3
+#define BANDED_TRACEBACK_CONSENSUS_GAP_EXTEND 4
+#define BANDED_TRACEBACK_TRUTH_GAP_EXTEND 8
+
+stList *alignConsensusAndTruthBanded(char *consensusStr, char *truthStr, int64_t *referenceToTruth,
+        int64_t referenceLength, int64_t bandWidth) {
+    /*
+     * Affine gap alignment of the consensus and truth with free end gaps, scored as in alignConsensusAndTruth but
+     * restricted to a band around the known alignment of the truth to the reference. Consensus position i is
+     * expected at reference position i * referenceLength / consensusLength, and its band is centred on the truth
+     * position referenceToTruth gives for that, so only the drift of the consensus from the reference has to fit in
+     * bandWidth. Rows are widened where the truth jumps ahead (a truth insert) so the band stays connected. Returns
+     * NULL if the best alignment runs along the edge of the band, where it may have been cut off.
+     */
+    int32_t match = 2, mismatch = 2, gapOpen = 3, gapExtension = 1;
+    const int32_t negativeInfinity = INT32_MIN / 2;
+
+    int64_t consensusLen = strlen(consensusStr);
+    int64_t truthLen = strlen(truthStr);
+    stList *alignedPairs = stList_construct3(0, (void(*)(void*)) stIntTuple_destruct);
+    if (consensusLen == 0 || truthLen == 0 || referenceLength == 0) {
+        return alignedPairs;
+    }
+
+    // band for each row, row i having aligned the first i consensus bases
+    int64_t *bandStart = st_calloc(consensusLen + 1, sizeof(int64_t));
+    int64_t *bandEnd = st_calloc(consensusLen + 1, sizeof(int64_t));
+    int64_t *rowOffset = st_calloc(consensusLen + 2, sizeof(int64_t));
+    int64_t maxRowWidth = 0;
+    for (int64_t i = 0; i <= consensusLen; i++) {
+        int64_t referencePos = i * referenceLength / consensusLen;
+        int64_t centre = referencePos >= referenceLength ? truthLen : referenceToTruth[referencePos];
+        bandStart[i] = centre - bandWidth < 0 ? 0 : centre - bandWidth;
+        bandEnd[i] = centre + bandWidth > truthLen ? truthLen : centre + bandWidth;
+        if (i > 0 && bandStart[i] > bandEnd[i - 1]) {
+            bandStart[i] = bandStart[i - 1];
+        }
+        rowOffset[i + 1] = rowOffset[i] + bandEnd[i] - bandStart[i] + 1;
+        if (bandEnd[i] - bandStart[i] + 1 > maxRowWidth) {
+            maxRowWidth = bandEnd[i] - bandStart[i] + 1;
+        }
+    }
+
+    int8_t *consensusNum = st_calloc(consensusLen, sizeof(int8_t));
+    int8_t *truthNum = st_calloc(truthLen, sizeof(int8_t));
+    for (int64_t i = 0; i < consensusLen; i++) consensusNum[i] = getTruthAlignmentNucleotide(consensusStr[i]);
+    for (int64_t j = 0; j < truthLen; j++) truthNum[j] = getTruthAlignmentNucleotide(truthStr[j]);
+
+    // scores of the previous and current row, ending in a match, a gap in the truth, or a gap in the consensus
+    int32_t *scores = st_calloc(6 * maxRowWidth, sizeof(int32_t));
+    int32_t *prevMatch = scores, *prevConsensusGap = scores + maxRowWidth, *prevTruthGap = scores + 2 * maxRowWidth;
+    int32_t *currMatch = scores + 3 * maxRowWidth, *currConsensusGap = scores + 4 * maxRowWidth,
+            *currTruthGap = scores + 5 * maxRowWidth;
+    uint8_t *traceback = st_calloc(rowOffset[consensusLen + 1], sizeof(uint8_t));
+    int32_t bestScore = negativeInfinity;
+    int64_t bestI = 0, bestJ = 0;
+
+    for (int64_t i = 0; i <= consensusLen; i++) {
+        for (int64_t j = bandStart[i]; j <= bandEnd[i]; j++) {
+            int64_t c = j - bandStart[i];
+            int32_t matchScore = negativeInfinity, consensusGapScore = negativeInfinity, truthGapScore = negativeInfinity;
+            uint8_t tb = 0;
+            if (i == 0 || j == 0) {
+                // free leading gaps
+                matchScore = 0;
+                tb = BANDED_TRACEBACK_START;
+            } else {
+                // consensus base i-1 against truth base j-1
+                if (j - 1 >= bandStart[i - 1] && j - 1 <= bandEnd[i - 1]) {
+                    int64_t p = j - 1 - bandStart[i - 1];
+                    matchScore = prevMatch[p];
+                    tb = BANDED_TRACEBACK_FROM_MATCH;
+                    if (prevConsensusGap[p] > matchScore) {
+                        matchScore = prevConsensusGap[p];
+                        tb = BANDED_TRACEBACK_FROM_CONSENSUS_GAP;
+                    }
+                    if (prevTruthGap[p] > matchScore) {
+                        matchScore = prevTruthGap[p];
+                        tb = BANDED_TRACEBACK_FROM_TRUTH_GAP;
+                    }
+                    int8_t x = consensusNum[i - 1], y = truthNum[j - 1];
+                    matchScore += (x == 4 || y == 4) ? 0 : (x == y ? match : -mismatch);
+                }
+                // consensus base i-1 against a gap
+                if (j >= bandStart[i - 1] && j <= bandEnd[i - 1]) {
+                    int64_t p = j - bandStart[i - 1];
+                    consensusGapScore = prevMatch[p] - gapOpen;
+                    if (prevConsensusGap[p] - gapExtension > consensusGapScore) {
+                        consensusGapScore = prevConsensusGap[p] - gapExtension;
+                        tb |= BANDED_TRACEBACK_CONSENSUS_GAP_EXTEND;
+                    }
+                }
+                // truth base j-1 against a gap
+                if (c > 0) {
+                    truthGapScore = currMatch[c - 1] - gapOpen;
+                    if (currTruthGap[c - 1] - gapExtension > truthGapScore) {
+                        truthGapScore = currTruthGap[c - 1] - gapExtension;
+                        tb |= BANDED_TRACEBACK_TRUTH_GAP_EXTEND;
+                    }
+                }
+            }
+            currMatch[c] = matchScore < negativeInfinity ? negativeInfinity : matchScore;
+            currConsensusGap[c] = consensusGapScore < negativeInfinity ? negativeInfinity : consensusGapScore;
+            currTruthGap[c] = truthGapScore < negativeInfinity ? negativeInfinity : truthGapScore;
+            traceback[rowOffset[i] + c] = tb;
+
+            // free trailing gaps
+            if ((i == consensusLen || j == truthLen) && i > 0 && j > 0 && matchScore > bestScore) {
+                bestScore = matchScore;
+                bestI = i;
+                bestJ = j;
+            }
+        }
+        int32_t *swap;
+        swap = prevMatch; prevMatch = currMatch; currMatch = swap;
+        swap = prevConsensusGap; prevConsensusGap = currConsensusGap; currConsensusGap = swap;
+        swap = prevTruthGap; prevTruthGap = currTruthGap; currTruthGap = swap;
+    }
+
+    // trace back from the best end, which is always in a match
+    bool touchedBandEdge = FALSE;
+    if (bestScore > 0) {
+        int64_t i = bestI, j = bestJ;
+        int state = BANDED_TRACEBACK_FROM_MATCH;
+        while (i > 0 && j > 0) {
+            if ((j == bandStart[i] && j > 0) || (j == bandEnd[i] && j < truthLen)) {
+                touchedBandEdge = TRUE;
+            }
+            uint8_t tb = traceback[rowOffset[i] + j - bandStart[i]];
+            if (state == BANDED_TRACEBACK_FROM_MATCH) {
+                stList_append(alignedPairs, stIntTuple_construct3(i - 1, j - 1, 0));
+                state = tb & 3;
+                i--;
+                j--;
+            } else if (state == BANDED_TRACEBACK_FROM_CONSENSUS_GAP) {
+                state = (tb & BANDED_TRACEBACK_CONSENSUS_GAP_EXTEND) ? BANDED_TRACEBACK_FROM_CONSENSUS_GAP :
+                        BANDED_TRACEBACK_FROM_MATCH;
+                i--;
+            } else {
+                state = (tb & BANDED_TRACEBACK_TRUTH_GAP_EXTEND) ? BANDED_TRACEBACK_FROM_TRUTH_GAP :
+                        BANDED_TRACEBACK_FROM_MATCH;
+                j--;
+            }
+        }
+        stList_reverse(alignedPairs);
+    }
+
+    // cleanup
+    free(traceback);
+    free(scores);
+    free(truthNum);
+    free(consensusNum);
+    free(rowOffset);
+    free(bandEnd);
+    free(bandStart);
+
+    if (touchedBandEdge) {
+        stList_destruct(alignedPairs);
+        return NULL;
+    }
+    return alignedPairs;
+}
+
+int64_t getConsensusPositionOfReferencePosition(RleString *consensus, RleString *reference, int64_t referencePos) {
+    /*
+     * Returns the consensus position aligned to the reference position, or to the first aligned one after it. A
+     * window of the reference around the position is aligned to a window twice as wide around the consensus position
+     * expected from the length ratio, so only the drift of the consensus from that needs to fit in the window. Falls
+     * back to the expected position if nothing aligns at or after the reference position.
+     */
+    if (referencePos <= 0 || consensus->length == 0) {
+        return 0;
+    }
+    if (referencePos >= reference->length) {
+        return consensus->length;
+    }
+    int64_t expectedPos = (int64_t) (1.0 * referencePos * consensus->length / reference->length);
+    int64_t referenceStart = referencePos < HELEN_CORE_ANCHOR_WINDOW ? 0 : referencePos - HELEN_CORE_ANCHOR_WINDOW;
+    int64_t referenceEnd = referencePos + HELEN_CORE_ANCHOR_WINDOW > reference->length ? reference->length :
+            referencePos + HELEN_CORE_ANCHOR_WINDOW;
+    int64_t consensusStart = expectedPos < 2 * HELEN_CORE_ANCHOR_WINDOW ? 0 : expectedPos - 2 * HELEN_CORE_ANCHOR_WINDOW;
+    int64_t consensusEnd = expectedPos + 2 * HELEN_CORE_ANCHOR_WINDOW > consensus->length ? consensus->length :
+            expectedPos + 2 * HELEN_CORE_ANCHOR_WINDOW;
+
+    char *referenceWindow = stString_getSubString(reference->rleString, referenceStart, referenceEnd - referenceStart);
+    char *consensusWindow = stString_getSubString(consensus->rleString, consensusStart, consensusEnd - consensusStart);
+    stList *alignedPairs = alignConsensusAndTruth(consensusWindow, referenceWindow);
+
+    int64_t consensusPos = expectedPos;
+    for (int64_t i = 0; i < stList_length(alignedPairs); i++) {
+        stIntTuple *alignedPair = stList_get(alignedPairs, i);
+        if (referenceStart + stIntTuple_get(alignedPair, 1) >= referencePos) {
+            consensusPos = consensusStart + stIntTuple_get(alignedPair, 0);
+            break;
+        }
+    }
+
+    stList_destruct(alignedPairs);
+    free(referenceWindow);
+    free(consensusWindow);
+    return consensusPos;
+}
+
 #define HDF5_FEATURE_SIZE 1000
 
 double **getTwoDArrayDouble(int64_t rowCount, int64_t columnCount, bool zeroValues) {
@@ -1190,6 +1701,32 @@ uint8_t ***getThreeDArrayUInt8(int64_t depthCount, int64_t rowCount, int64_t col
     return array;
 }
 
+float ***getThreeDArrayFloat(int64_t depthCount, int64_t rowCount, int64_t columnCount) {
+    float ***array  = st_calloc(depthCount, sizeof(float**));
+    array[0] = (float**) st_calloc(depthCount * rowCount, sizeof(float*) );
+    array[0][0] = (float*) st_calloc(depthCount * rowCount * columnCount, sizeof(float) );
+    for (int64_t i=0; i < depthCount; i++) {
+        array[i] = array[0] + i*rowCount;
+        for (int64_t j=0; j < rowCount; j++) {
+            array[i][j] = (array[0][0] + i*rowCount*columnCount + j*columnCount);
+        }
+    }
+    return array;
+}
+
+double ***getThreeDArrayDouble(int64_t depthCount, int64_t rowCount, int64_t columnCount) {
+    double ***array  = st_calloc(depthCount, sizeof(double**));
+    array[0] = (double**) st_calloc(depthCount * rowCount, sizeof(double*) );
+    array[0][0] = (double*) st_calloc(depthCount * rowCount * columnCount, sizeof(double) );
+    for (int64_t i=0; i < depthCount; i++) {
+        array[i] = array[0] + i*rowCount;
+        for (int64_t j=0; j < rowCount; j++) {
+            array[i][j] = (array[0][0] + i*rowCount*columnCount + j*columnCount);
+        }
+    }
+    return array;
+}
+
 char **getTwoDArrayChar(int64_t rowCount, int64_t columnCount) {
     char **array  = st_calloc(rowCount, sizeof(char*));
     array[0] = (char*) st_calloc(columnCount * rowCount, sizeof(char) );
@@ -1215,8 +1752,108 @@ uint8_t normalizeWeightToUInt8(double totalWeight, double weight) {
 }
 
 
-void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
-        BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+HelenFeatureTensor *helenFeatureTensor_construct(HelenFeatureType type, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, int64_t featureCount, int64_t positionColumnCount,
+        int64_t imageColumnCount, int64_t runLengthColumnCount) {
+    HelenFeatureTensor *tensor = st_calloc(1, sizeof(HelenFeatureTensor));
+    tensor->type = type;
+    tensor->imageEncoding = imageEncoding;
+    tensor->outputFileBase = stString_copy(outputFileBase);
+    tensor->refSeqName = stString_copy(bamChunk->refSeqName);
+    tensor->chunkBoundaryStart = bamChunk->chunkBoundaryStart;
+    tensor->chunkBoundaryEnd = bamChunk->chunkBoundaryEnd;
+    tensor->chunkStart = bamChunk->chunkStart;
+    tensor->chunkEnd = bamChunk->chunkEnd;
+    tensor->outputLabels = outputLabels;
+    tensor->featureCount = featureCount;
+    tensor->positionColumnCount = positionColumnCount;
+    tensor->imageColumnCount = imageColumnCount;
+    tensor->runLengthColumnCount = runLengthColumnCount;
+
+    tensor->positionData = getTwoDArrayUInt32(featureCount, positionColumnCount);
+    tensor->normalizationData = getTwoDArrayUInt8(featureCount, 1);
+    // the default encoding is quantized as the features are built, the others keep the weight fractions
+    // until they are written
+    if (imageEncoding == HFEAT_IMAGE_NORMALIZED_UINT8) {
+        tensor->imageData = getTwoDArrayUInt8(featureCount, imageColumnCount);
+        if (runLengthColumnCount > 0) {
+            tensor->runLengthData = getThreeDArrayUInt8(featureCount, runLengthColumnCount, (SYMBOL_NUMBER - 1));
+        }
+    } else {
+        tensor->imageWeights = getTwoDArrayFloat(featureCount, imageColumnCount);
+        if (runLengthColumnCount > 0) {
+            tensor->runLengthWeights = getThreeDArrayFloat(featureCount, runLengthColumnCount, (SYMBOL_NUMBER - 1));
+        }
+    }
+    if (outputLabels) {
+        tensor->labelCharacterData = getTwoDArrayUInt8(featureCount, 1);
+        if (type != HFEAT_SIMPLE_WEIGHT) {
+            tensor->labelRunLengthData = getTwoDArrayUInt8(featureCount, 1);
+        }
+    }
+    return tensor;
+}
+
+void helenFeatureTensor_destruct(HelenFeatureTensor *tensor) {
+    free(tensor->positionData[0]);
+    free(tensor->positionData);
+    free(tensor->normalizationData[0]);
+    free(tensor->normalizationData);
+    if (tensor->imageData != NULL) {
+        free(tensor->imageData[0]);
+        free(tensor->imageData);
+    }
+    if (tensor->runLengthData != NULL) {
+        free(tensor->runLengthData[0][0]);
+        free(tensor->runLengthData[0]);
+        free(tensor->runLengthData);
+    }
+    if (tensor->imageWeights != NULL) {
+        free(tensor->imageWeights[0]);
+        free(tensor->imageWeights);
+    }
+    if (tensor->runLengthWeights != NULL) {
+        free(tensor->runLengthWeights[0][0]);
+        free(tensor->runLengthWeights[0]);
+        free(tensor->runLengthWeights);
+    }
+    if (tensor->labelCharacterData != NULL) {
+        free(tensor->labelCharacterData[0]);
+        free(tensor->labelCharacterData);
+    }
+    if (tensor->labelRunLengthData != NULL) {
+        free(tensor->labelRunLengthData[0]);
+        free(tensor->labelRunLengthData);
+    }
+    free(tensor->outputFileBase);
+    free(tensor->refSeqName);
+    free(tensor);
+}
+
+static inline float normalizeWeightToFloat(double totalWeight, double weight) {
+    return totalWeight > 0 ? (float) (weight / totalWeight) : 0.0f;
+}
+
+static inline void helenFeatureTensor_setImageWeight(HelenFeatureTensor *tensor, int64_t featureIdx, int64_t column,
+        double totalWeight, double weight) {
+    if (tensor->imageData != NULL) {
+        tensor->imageData[featureIdx][column] = normalizeWeightToUInt8(totalWeight, weight);
+    } else {
+        tensor->imageWeights[featureIdx][column] = normalizeWeightToFloat(totalWeight, weight);
+    }
+}
+
+static inline void helenFeatureTensor_setRunLengthWeight(HelenFeatureTensor *tensor, int64_t featureIdx,
+        int64_t runLengthColumn, int64_t symbol, double totalWeight, double weight) {
+    if (tensor->runLengthData != NULL) {
+        tensor->runLengthData[featureIdx][runLengthColumn][symbol] = normalizeWeightToUInt8(totalWeight, weight);
+    } else {
+        tensor->runLengthWeights[featureIdx][runLengthColumn][symbol] = normalizeWeightToFloat(totalWeight, weight);
+    }
+}
+
+HelenFeatureTensor *getSimpleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
         int64_t featureEndIdxInclusive) {
 
     // count features, create feature array
@@ -1232,18 +1869,19 @@ void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5File
         char *logIdentifier = getLogIdentifier();
         st_logInfo(" %s Feature count %"PRId64" less than minimum of %d\n", logIdentifier, featureCount, HDF5_FEATURE_SIZE);
         free(logIdentifier);
-        return;
+        return NULL;
+    }
+    if (featureCount == 0) {
+        return NULL;
     }
 
     // get all feature data into an array
-    uint32_t **positionData = getTwoDArrayUInt32(featureCount, 2);
     int64_t columnCount = POAFEATURE_SIMPLE_WEIGHT_TOTAL_SIZE;
-    uint8_t **normalizationData = getTwoDArrayUInt8(featureCount, 1);
-    uint8_t **imageData = getTwoDArrayUInt8(featureCount, columnCount);
-    char **labelCharacterData = NULL;
-    if (outputLabels) {
-        labelCharacterData = getTwoDArrayChar(featureCount, 1);
-    }
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_SIMPLE_WEIGHT, imageEncoding, outputFileBase,
+            bamChunk, outputLabels, featureCount, 2, columnCount, 0);
+    uint32_t **positionData = tensor->positionData;
+    uint8_t **normalizationData = tensor->normalizationData;
+    uint8_t **labelCharacterData = tensor->labelCharacterData;
 
     // add all data to features
     featureCount = 0;
@@ -1264,22 +1902,22 @@ void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5File
             // normalization and image data
             normalizationData[featureCount][0] = convertTotalWeightToUInt8(totalWeight);
             for (int64_t j = 0; j < columnCount; j++) {
-                imageData[featureCount][j] = normalizeWeightToUInt8(totalWeight, feature->weights[j]);
+                helenFeatureTensor_setImageWeight(tensor, featureCount, j, totalWeight, feature->weights[j]);
             }
 
             // nucleotide weights
             int64_t pos;
             for (int64_t symbol = 0; symbol < SYMBOL_NUMBER_NO_N; symbol++) {
                 pos = PoaFeature_SimpleWeight_charIndex((Symbol) symbol, TRUE);
-                imageData[featureCount][pos] = normalizeWeightToUInt8(totalWeight, feature->weights[pos]);
+                helenFeatureTensor_setImageWeight(tensor, featureCount, pos, totalWeight, feature->weights[pos]);
                 pos = PoaFeature_SimpleWeight_charIndex((Symbol) symbol, FALSE);
-                imageData[featureCount][pos] = normalizeWeightToUInt8(totalWeight, feature->weights[pos]);
+                helenFeatureTensor_setImageWeight(tensor, featureCount, pos, totalWeight, feature->weights[pos]);
             }
             // gap weights
             pos = PoaFeature_SimpleWeight_gapIndex(TRUE);
-            imageData[featureCount][pos] = normalizeWeightToUInt8(totalWeight, feature->weights[pos]);
+            helenFeatureTensor_setImageWeight(tensor, featureCount, pos, totalWeight, feature->weights[pos]);
             pos = PoaFeature_SimpleWeight_gapIndex(FALSE);
-            imageData[featureCount][pos] = normalizeWeightToUInt8(totalWeight, feature->weights[pos]);
+            helenFeatureTensor_setImageWeight(tensor, featureCount, pos, totalWeight, feature->weights[pos]);
 
             // potentially labels
             if (outputLabels) {
@@ -1294,182 +1932,54 @@ void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5File
         }
     }
 
-    /*
-     * Get hdf5 data set up
-     */
-
-    hid_t status;
-    hid_t stringType = H5Tcopy (H5T_C_S1);
-    status = H5Tset_size (stringType, strlen(bamChunk->refSeqName) + 1);
-
-    // so that we can produce chunks smaller than HDF5_FEATURE_SIZE (not used during training)
-    hsize_t featureSize = (hsize_t) (featureCount < HDF5_FEATURE_SIZE ? featureCount : HDF5_FEATURE_SIZE);
-
-    hsize_t metadataDimension[1] = {1};
-    hsize_t postionDimension[2] = {featureSize, 2};
-    hsize_t labelCharacterDimension[2] = {featureSize, 1};
-    hsize_t normalizationDimension[2] = {featureSize, 1};
-    hsize_t imageDimension[2] = {featureSize, (hsize_t) columnCount};
-
-    hid_t metadataSpace = H5Screate_simple(1, metadataDimension, NULL);
-    hid_t positionSpace = H5Screate_simple(2, postionDimension, NULL);
-    hid_t labelCharacterSpace = H5Screate_simple(2, labelCharacterDimension, NULL);
-    hid_t normalizationSpace = H5Screate_simple(2, normalizationDimension, NULL);
-    hid_t imageSpace = H5Screate_simple(2, imageDimension, NULL);
-
-    /*
-     * Write features to files
-     */
+    return tensor;
+}
 
-    // each file must have exactly 1000 features
-    int64_t totalFeatureFiles = (int64_t) (featureCount / HDF5_FEATURE_SIZE) + (featureCount % HDF5_FEATURE_SIZE == 0 ? 0 : 1);
-    int64_t featureOffset = 0;
-    if (featureCount >= HDF5_FEATURE_SIZE) {
-        featureOffset = (int64_t) ((HDF5_FEATURE_SIZE * totalFeatureFiles - featureCount) / (int64_t) (featureCount / HDF5_FEATURE_SIZE));
-    }
+HelenFeatureTensor *getSplitRleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive, const int64_t maxRunLength) {
 
-    for (int64_t featureIndex = 0; featureIndex < totalFeatureFiles; featureIndex++) {
-        // get start pos
-        int64_t chunkFeatureStartIdx = (HDF5_FEATURE_SIZE * featureIndex) - (featureOffset * featureIndex);
-        if (featureIndex + 1 == totalFeatureFiles && featureCount >= HDF5_FEATURE_SIZE) {
-            chunkFeatureStartIdx = featureCount - HDF5_FEATURE_SIZE;
+    // count features, create feature array
+    uint64_t featureCount = 0;
+    for (int64_t i = featureStartIdx; i <= featureEndIdxInclusive; i++) {
+        PoaFeatureSplitRleWeight *feature = stList_get(features, i);
+        while (feature != NULL) {
+            PoaFeatureSplitRleWeight *rlFeature = feature;
+            while (rlFeature != NULL) {
+                featureCount++;
+                rlFeature = rlFeature->nextRunLength;
+            }
+            feature = feature->nextInsert;
         }
+    }
+    if (featureCount < HDF5_FEATURE_SIZE && outputLabels) {
+        char *logIdentifier = getLogIdentifier();
+        st_logInfo(" %s Feature count %"PRId64" less than minimum of %d\n", logIdentifier, featureCount, HDF5_FEATURE_SIZE);
+        free(logIdentifier);
+        return NULL;
+    }
+    if (featureCount == 0) {
+        return NULL;
+    }
 
-        // create group
-        char *outputGroup = stString_print("images/%s.%"PRId64, outputFileBase, featureIndex);
-        hid_t group = H5Gcreate (hdf5FileInfo->file, outputGroup, hdf5FileInfo->groupPropertyList, H5P_DEFAULT, H5P_DEFAULT);
+    // get all feature data into an array
+    int64_t rleNucleotideColumnCount = ((SYMBOL_NUMBER - 1) * (maxRunLength + 1) + 1) * 2;
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_SPLIT_RLE_WEIGHT, imageEncoding, outputFileBase,
+            bamChunk, outputLabels, featureCount, 3, rleNucleotideColumnCount, 0);
+    uint32_t **positionData = tensor->positionData;
+    uint8_t **normalizationData = tensor->normalizationData;
+    uint8_t **labelCharacterData = tensor->labelCharacterData;
+    uint8_t **labelRunLengthData = tensor->labelRunLengthData;
 
-        // write metadata
-        hid_t contigDataset = H5Dcreate (group, "contig", stringType, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigDataset, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, bamChunk->refSeqName);
-        hid_t contigStartDataset = H5Dcreate (group, "contig_start", hdf5FileInfo->int64Type, metadataSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigStartDataset, hdf5FileInfo->int64Type,
-                H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryStart);
-        hid_t contigEndDataset = H5Dcreate (group, "contig_end", hdf5FileInfo->int64Type, metadataSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigEndDataset, hdf5FileInfo->int64Type,
-                H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryEnd);
-        hid_t chunkIndexDataset = H5Dcreate (group, "feature_chunk_idx", hdf5FileInfo->int64Type, metadataSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (chunkIndexDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &featureIndex);
-
-        // write position info
-        hid_t positionDataset = H5Dcreate (group, "position", hdf5FileInfo->uint32Type, positionSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (positionDataset, hdf5FileInfo->uint32Type,
-                H5S_ALL, H5S_ALL, H5P_DEFAULT, positionData[chunkFeatureStartIdx]);
-
-        // write normalization data
-        hid_t normalizationDataset = H5Dcreate (group, "normalization", hdf5FileInfo->uint8Type, normalizationSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (normalizationDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                normalizationData[chunkFeatureStartIdx]);
-
-        // write rle data
-        hid_t imageDataset = H5Dcreate (group, "image", hdf5FileInfo->uint8Type, imageSpace,
-                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (imageDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                imageData[chunkFeatureStartIdx]);
+    // add all data to features
+    featureCount = 0;
+    for (int64_t i = featureStartIdx; i <= featureEndIdxInclusive; i++) {
+        PoaFeatureSplitRleWeight *refFeature = stList_get(features, i);
 
-        // if labels, add all these too
-        if (outputLabels) {
-            hid_t labelCharacterDataset = H5Dcreate (group, "label_base", hdf5FileInfo->uint8Type, labelCharacterSpace,
-                    H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-            status |= H5Dwrite (labelCharacterDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                                labelCharacterData[chunkFeatureStartIdx]);
-            status |= H5Dclose (labelCharacterDataset);
-        }
-
-        // cleanup
-        status |= H5Dclose (contigDataset);
-        status |= H5Dclose (contigStartDataset);
-        status |= H5Dclose (contigEndDataset);
-        status |= H5Dclose (chunkIndexDataset);
-        status |= H5Dclose (positionDataset);
-        status |= H5Dclose (normalizationDataset);
-        status |= H5Dclose (imageDataset);
-        status |= H5Gclose (group);
-        free(outputGroup);
-    }
-
-
-    // cleanup
-    free(normalizationData[0]);
-    free(normalizationData);
-    free(imageData[0]);
-    free(imageData);
-    free(positionData[0]);
-    free(positionData);
-    status |= H5Tclose (stringType);
-    status |= H5Sclose (metadataSpace);
-    status |= H5Sclose (normalizationSpace);
-    status |= H5Sclose (imageSpace);
-    status |= H5Sclose (positionSpace);
-    status |= H5Sclose (labelCharacterSpace);
-    if (outputLabels) {
-        free(labelCharacterData[0]);
-        free(labelCharacterData);
-    }
-
-    if (status) {
-        char *logIdentifier = getLogIdentifier();
-        st_logInfo(" %s Error writing HELEN features to HDF5 files: %s\n", logIdentifier, outputFileBase);
-        free(logIdentifier);
-    }
-}
-
-void writeSplitRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase, BamChunk *bamChunk,
-                                          bool outputLabels, stList *features, int64_t featureStartIdx,
-                                          int64_t featureEndIdxInclusive, const int64_t maxRunLength) {
-
-    herr_t      status = 0;
-
-    /*
-     * Get feature data set up
-     */
-
-    // count features, create feature array
-    uint64_t featureCount = 0;
-    for (int64_t i = featureStartIdx; i <= featureEndIdxInclusive; i++) {
-        PoaFeatureSplitRleWeight *feature = stList_get(features, i);
-        while (feature != NULL) {
-            PoaFeatureSplitRleWeight *rlFeature = feature;
-            while (rlFeature != NULL) {
-                featureCount++;
-                rlFeature = rlFeature->nextRunLength;
-            }
-            feature = feature->nextInsert;
-        }
-    }
-    if (featureCount < HDF5_FEATURE_SIZE && outputLabels) {
-        char *logIdentifier = getLogIdentifier();
-        st_logInfo(" %s Feature count %"PRId64" less than minimum of %d\n", logIdentifier, featureCount, HDF5_FEATURE_SIZE);
-        free(logIdentifier);
-        return;
-    }
-
-    // get all feature data into an array
-    uint32_t **positionData = getTwoDArrayUInt32(featureCount, 3);
-    int64_t rleNucleotideColumnCount = ((SYMBOL_NUMBER - 1) * (maxRunLength + 1) + 1) * 2;
-    uint8_t **normalizationData = getTwoDArrayUInt8(featureCount, 1);
-    uint8_t **imageData = getTwoDArrayUInt8(featureCount, rleNucleotideColumnCount);
-    uint8_t **labelCharacterData = NULL;
-    uint8_t **labelRunLengthData = NULL;
-    if (outputLabels) {
-        labelCharacterData = getTwoDArrayUInt8(featureCount, 1);
-        labelRunLengthData = getTwoDArrayUInt8(featureCount, 1);
-    }
-
-    // add all data to features
-    featureCount = 0;
-    for (int64_t i = featureStartIdx; i <= featureEndIdxInclusive; i++) {
-        PoaFeatureSplitRleWeight *refFeature = stList_get(features, i);
-
-        // total weight is calculated for the very first refPos feature, used for all inserts and run lengths
-        double totalWeight = 0;
-        for (int64_t j = 0; j < rleNucleotideColumnCount; j++) {
-            totalWeight += refFeature->weights[j];
+        // total weight is calculated for the very first refPos feature, used for all inserts and run lengths
+        double totalWeight = 0;
+        for (int64_t j = 0; j < rleNucleotideColumnCount; j++) {
+            totalWeight += refFeature->weights[j];
         }
 
         // iterate over all insert features
@@ -1489,8 +1999,7 @@ void writeSplitRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5Fi
 
                 // copy weights over (into normalized uint8 space)
                 for (int64_t j = 0; j < rleNucleotideColumnCount; j++) {
-                    imageData[featureCount][j] =
-                            normalizeWeightToUInt8(totalWeight, rlFeature->weights[j]);
+                    helenFeatureTensor_setImageWeight(tensor, featureCount, j, totalWeight, rlFeature->weights[j]);
                 }
 
                 // labels
@@ -1515,142 +2024,13 @@ void writeSplitRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5Fi
         }
     }
 
-    /*
-     * Get hdf5 data set up
-     */
-
-
-    // so that we can produce chunks smaller than HDF5_FEATURE_SIZE (not used during training)
-    hsize_t featureSize = (hsize_t) (featureCount < HDF5_FEATURE_SIZE ? featureCount : HDF5_FEATURE_SIZE);
-
-    hsize_t metadataDimension[1] = {1};
-    hsize_t postionDimension[2] = {featureSize, 3};
-    hsize_t labelCharacterDimension[2] = {featureSize, 1};
-    hsize_t labelRunLengthDimension[2] = {featureSize, 1};
-    hsize_t normalizationDimension[2] = {featureSize, 1};
-    hsize_t imageDimension[2] = {featureSize, (hsize_t) rleNucleotideColumnCount};
-
-    hid_t metadataSpace = H5Screate_simple(1, metadataDimension, NULL);
-    hid_t positionSpace = H5Screate_simple(2, postionDimension, NULL);
-    hid_t labelCharacterSpace = H5Screate_simple(2, labelCharacterDimension, NULL);
-    hid_t labelRunLengthSpace = H5Screate_simple(2, labelRunLengthDimension, NULL);
-    hid_t normalizationSpace = H5Screate_simple(2, normalizationDimension, NULL);
-    hid_t imageSpace = H5Screate_simple(2, imageDimension, NULL);
-
-    hid_t stringType = H5Tcopy (H5T_C_S1);
-    H5Tset_size (stringType, strlen(bamChunk->refSeqName) + 1);
-
-
-    /*
-     * Write features to files
-     */
-
-    // each file must have exactly 1000 features
-    int64_t totalFeatureFiles = (int64_t) (featureCount / HDF5_FEATURE_SIZE) + (featureCount % HDF5_FEATURE_SIZE == 0 ? 0 : 1);
-    int64_t featureOffset = 0;
-    if (featureCount >= HDF5_FEATURE_SIZE) {
-        featureOffset = (int64_t) ((HDF5_FEATURE_SIZE * totalFeatureFiles - featureCount) / (int64_t) (featureCount / HDF5_FEATURE_SIZE));
-    }
-    for (int64_t featureIndex = 0; featureIndex < totalFeatureFiles; featureIndex++) {
-        // get start pos
-        int64_t chunkFeatureStartIdx = (HDF5_FEATURE_SIZE * featureIndex) - (featureOffset * featureIndex);
-        if (featureIndex + 1 == totalFeatureFiles && featureCount >= HDF5_FEATURE_SIZE) {
-            chunkFeatureStartIdx = featureCount - HDF5_FEATURE_SIZE;
-        }
-
-        // create group
-        char *outputGroup = stString_print("images/%s.%"PRId64, outputFileBase, featureIndex);
-        hid_t group = H5Gcreate (hdf5FileInfo->file, outputGroup, hdf5FileInfo->groupPropertyList, H5P_DEFAULT, H5P_DEFAULT);
-
-        // write metadata
-        hid_t contigDataset = H5Dcreate (group, "contig", stringType, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigDataset, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, bamChunk->refSeqName);
-        hid_t contigStartDataset = H5Dcreate (group, "contig_start", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigStartDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryStart);
-        hid_t contigEndDataset = H5Dcreate (group, "contig_end", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigEndDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryEnd);
-        hid_t chunkIndexDataset = H5Dcreate (group, "feature_chunk_idx", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (chunkIndexDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &featureIndex);
-
-        // write position info
-        hid_t positionDataset = H5Dcreate (group, "position", hdf5FileInfo->uint32Type, positionSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (positionDataset, hdf5FileInfo->uint32Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, positionData[chunkFeatureStartIdx]);
-
-        // write rle data
-        hid_t imageDataset = H5Dcreate (group, "image", hdf5FileInfo->uint8Type, imageSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (imageDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                            imageData[chunkFeatureStartIdx]);
-        hid_t normalizationDataset = H5Dcreate (group, "normalization", hdf5FileInfo->uint8Type, normalizationSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (normalizationDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                            normalizationData[chunkFeatureStartIdx]);
-
-        // if labels, add all these too
-        if (outputLabels) {
-            hid_t labelCharacterDataset = H5Dcreate (group, "label_base", hdf5FileInfo->uint8Type, labelCharacterSpace, H5P_DEFAULT,
-                                                     H5P_DEFAULT, H5P_DEFAULT);
-            status |= H5Dwrite (labelCharacterDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                                labelCharacterData[chunkFeatureStartIdx]);
-            hid_t labelRunLengthDataset = H5Dcreate (group, "label_run_length", hdf5FileInfo->uint8Type, labelRunLengthSpace,
-                                                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-            status |= H5Dwrite (labelRunLengthDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                                labelRunLengthData[chunkFeatureStartIdx]);
-
-            status |= H5Dclose (labelCharacterDataset);
-            status |= H5Dclose (labelRunLengthDataset);
-        }
-
-        // cleanup
-        status |= H5Dclose (contigDataset);
-        status |= H5Dclose (contigStartDataset);
-        status |= H5Dclose (contigEndDataset);
-        status |= H5Dclose (chunkIndexDataset);
-        status |= H5Dclose (positionDataset);
-        status |= H5Dclose (imageDataset);
-        status |= H5Dclose (normalizationDataset);
-        status |= H5Gclose (group);
-        free(outputGroup);
-    }
-
-    // cleanup
-    free(imageData[0]);
-    free(imageData);
-    free(normalizationData[0]);
-    free(normalizationData);
-    free(positionData[0]);
-    free(positionData);
-    status |= H5Sclose (metadataSpace);
-    status |= H5Sclose (positionSpace);
-    status |= H5Sclose (imageSpace);
-    status |= H5Sclose (normalizationSpace);
-    status |= H5Sclose (labelRunLengthSpace);
-    status |= H5Sclose (labelCharacterSpace);
-    status |= H5Tclose (stringType);
-    if (outputLabels) {
-        free(labelCharacterData[0]);
-        free(labelCharacterData);
-        free(labelRunLengthData[0]);
-        free(labelRunLengthData);
-    }
-
-    if (status) {
-        char *logIdentifier = getLogIdentifier();
-        st_logInfo(" %s Error writing HELEN features to HDF5 files: %s\n", logIdentifier, outputFileBase);
-        free(logIdentifier);
-    }
+    return tensor;
 }
 
-
-
-void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
-        BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+HelenFeatureTensor *getChannelRleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
         int64_t featureEndIdxInclusive, const int64_t maxRunLength) {
 
-    herr_t      status = 0;
-
-    /*
-     * Get feature data set up
-     */
-
     // count features, create feature array
     uint64_t featureCount = 0;
     for (int64_t i = featureStartIdx; i <= featureEndIdxInclusive; i++) {
@@ -1668,7 +2048,10 @@ void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5
         char *logIdentifier = getLogIdentifier();
         st_logInfo(" %s Feature count %"PRId64" less than minimum of %d\n", logIdentifier, featureCount, HDF5_FEATURE_SIZE);
         free(logIdentifier);
-        return;
+        return NULL;
+    }
+    if (featureCount == 0) {
+        return NULL;
     }
 
     // sizes
@@ -1676,17 +2059,12 @@ void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5
     int64_t runLengthColumnCount = (maxRunLength + 1) * 2; //(runLenght + 0) x {fwd,bwd}
 
     // get all feature data into an array
-    uint32_t **positionData = getTwoDArrayUInt32(featureCount, 3);
-    uint8_t **normalizationData = getTwoDArrayUInt8(featureCount, 1);
-    uint8_t **nucleotideData = getTwoDArrayUInt8(featureCount, nucleotideColumnCount);
-    uint8_t ***runLengthData = getThreeDArrayUInt8(featureCount, runLengthColumnCount, (SYMBOL_NUMBER - 1));
-    //uint8_t ***runLengthData = getThreeDArrayUInt8(featureCount, (SYMBOL_NUMBER - 1), runLengthColumnCount);
-    uint8_t **labelCharacterData = NULL;
-    uint8_t **labelRunLengthData = NULL;
-    if (outputLabels) {
-        labelCharacterData = getTwoDArrayUInt8(featureCount, 1);
-        labelRunLengthData = getTwoDArrayUInt8(featureCount, 1);
-    }
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_CHANNEL_RLE_WEIGHT, imageEncoding, outputFileBase,
+            bamChunk, outputLabels, featureCount, 3, nucleotideColumnCount, runLengthColumnCount);
+    uint32_t **positionData = tensor->positionData;
+    uint8_t **normalizationData = tensor->normalizationData;
+    uint8_t **labelCharacterData = tensor->labelCharacterData;
+    uint8_t **labelRunLengthData = tensor->labelRunLengthData;
 
     // add all data to features
     featureCount = 0;
@@ -1717,32 +2095,25 @@ void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5
                 // copy weights over (into normalized uint8 space)
                 for (int64_t c = 0; c < SYMBOL_NUMBER - 1; c++) {
                     // overall nucl count
-                    nucleotideData[featureCount][c * 2 + POS_STRAND_IDX] = normalizeWeightToUInt8(totalWeight,
+                    helenFeatureTensor_setImageWeight(tensor, featureCount, c * 2 + POS_STRAND_IDX, totalWeight,
                             rlFeature->nucleotideWeights[PoaFeature_ChannelRleWeight_charNuclIndex(c, TRUE)]);
-                    nucleotideData[featureCount][c * 2 + NEG_STRAND_IDX] = normalizeWeightToUInt8(totalWeight,
+                    helenFeatureTensor_setImageWeight(tensor, featureCount, c * 2 + NEG_STRAND_IDX, totalWeight,
                             rlFeature->nucleotideWeights[PoaFeature_ChannelRleWeight_charNuclIndex(c, FALSE)]);
 
                     // run length counts
                     for (int64_t r = 0; r <= maxRunLength; r++) {
-                        runLengthData[featureCount][r * 2 + POS_STRAND_IDX][c] =
-                                normalizeWeightToUInt8(totalWeight, rlFeature->runLengthWeights[
+                        helenFeatureTensor_setRunLengthWeight(tensor, featureCount, r * 2 + POS_STRAND_IDX, c,
+                                totalWeight, rlFeature->runLengthWeights[
                                         PoaFeature_ChannelRleWeight_charRLIndex(maxRunLength, c, r, TRUE)]);
-                        runLengthData[featureCount][r * 2 + NEG_STRAND_IDX][c] =
-                                normalizeWeightToUInt8(totalWeight, rlFeature->runLengthWeights[
+                        helenFeatureTensor_setRunLengthWeight(tensor, featureCount, r * 2 + NEG_STRAND_IDX, c,
+                                totalWeight, rlFeature->runLengthWeights[
                                         PoaFeature_ChannelRleWeight_charRLIndex(maxRunLength, c, r, FALSE)]);
-
-                        //runLengthData[featureCount][c][r * 2 + POS_STRAND_IDX] =
-                        //        normalizeWeightToUInt8(totalWeight, rlFeature->runLengthWeights[
-                        //                PoaFeature_ChannelRleWeight_charRLIndex(maxRunLength, c, r, TRUE)]);
-                        //runLengthData[featureCount][c][r * 2 + NEG_STRAND_IDX] =
-                        //        normalizeWeightToUInt8(totalWeight, rlFeature->runLengthWeights[
-                        //                PoaFeature_ChannelRleWeight_charRLIndex(maxRunLength, c, r, FALSE)]);
                     }
                 }
                 // gap counts
-                nucleotideData[featureCount][SYMBOL_NUMBER_NO_N * 2 + 0 + POS_STRAND_IDX] = normalizeWeightToUInt8(
+                helenFeatureTensor_setImageWeight(tensor, featureCount, SYMBOL_NUMBER_NO_N * 2 + 0 + POS_STRAND_IDX,
                         totalWeight, rlFeature->nucleotideWeights[PoaFeature_ChannelRleWeight_gapNuclIndex(TRUE)]);
-                nucleotideData[featureCount][SYMBOL_NUMBER_NO_N * 2 + NEG_STRAND_IDX] = normalizeWeightToUInt8(
+                helenFeatureTensor_setImageWeight(tensor, featureCount, SYMBOL_NUMBER_NO_N * 2 + NEG_STRAND_IDX,
                         totalWeight, rlFeature->nucleotideWeights[PoaFeature_ChannelRleWeight_gapNuclIndex(FALSE)]);
 
                 // labels
@@ -1767,146 +2138,738 @@ void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5
         }
     }
 
+    return tensor;
+}
+
+/*
+ * Dense run length weight features, written straight into the tensor
+ */
+
+static int64_t getRunLengthRowCount(stList *observations, stList *bamChunkReads, const int64_t maxRunLength,
+        int64_t observationOffset) {
     /*
-     * Get hdf5 data set up
+     * Rows a set of observations expands to. Each row holds run lengths up to maxRunLength and the next row the
+     * remainder, so this is the longest observed run length divided by maxRunLength, rounded up, and at least one.
      */
+    int64_t maxObservedRunLength = 0;
+    for (int64_t i = 0; i < stList_length(observations); i++) {
+        PoaBaseObservation *observation = stList_get(observations, i);
+        BamChunkRead *bamChunkRead = stList_get(bamChunkReads, observation->readNo);
+        int64_t runLength = bamChunkRead->rleRead->repeatCounts[observation->offset + observationOffset];
+        if (runLength > maxObservedRunLength) {
+            maxObservedRunLength = runLength;
+        }
+    }
+    return maxObservedRunLength <= maxRunLength ? 1 : (maxObservedRunLength + maxRunLength - 1) / maxRunLength;
+}
 
+static void addRleWeightTensorObservations(Poa *poa, HelenFeatureType type, double **weights, double ***runLengthWeights,
+        int64_t firstRow, stList *observations, stList *bamChunkReads, const int64_t maxRunLength,
+        int64_t observationOffset) {
+    /*
+     * Adds the weights of the observations to the run length rows starting at firstRow. As in
+     * poa_addSplitRunLengthFeaturesForObservations, observations with shorter run lengths than the longest one
+     * count as run length zero in the later rows. Ns have no run length columns, their weight goes to the gap
+     * (the linked features index past the end of their weights for an N with a run length).
+     */
+    int64_t rowCount = getRunLengthRowCount(observations, bamChunkReads, maxRunLength, observationOffset);
+    for (int64_t i = 0; i < stList_length(observations); i++) {
+        PoaBaseObservation *observation = stList_get(observations, i);
+        BamChunkRead *bamChunkRead = stList_get(bamChunkReads, observation->readNo);
+        RleString *rleString = bamChunkRead->rleRead;
+        Symbol symbol = poa->alphabet->convertCharToSymbol(rleString->rleString[observation->offset + observationOffset]);
+        int64_t observedRunLength = rleString->repeatCounts[observation->offset + observationOffset];
+        bool forward = bamChunkRead->forwardStrand;
+        double weight = observation->weight;
+
+        for (int64_t r = 0; r < rowCount; r++) {
+            int64_t runLength = observedRunLength - r * maxRunLength;
+            if (runLength < 0) {
+                runLength = 0;
+            } else if (runLength > maxRunLength) {
+                runLength = maxRunLength;
+            }
+
+            double *row = weights[firstRow + r];
+            if (symbol >= SYMBOL_NUMBER_NO_N) {
+                row[type == HFEAT_SPLIT_RLE_WEIGHT ? PoaFeature_SplitRleWeight_gapIndex(maxRunLength, forward) :
+                        PoaFeature_ChannelRleWeight_gapNuclIndex(forward)] += weight;
+            } else if (type == HFEAT_SPLIT_RLE_WEIGHT) {
+                row[PoaFeature_SplitRleWeight_charIndex(maxRunLength, symbol, runLength, forward)] += weight;
+            } else {
+                row[PoaFeature_ChannelRleWeight_charNuclIndex(symbol, forward)] += weight;
+                runLengthWeights[firstRow + r][runLength * 2 + (forward ? POS_STRAND_IDX : NEG_STRAND_IDX)][symbol] +=
+                        weight;
+            }
+        }
+    }
+}
+
+static void helenFeatureTensor_setLabels(HelenFeatureTensor *tensor, Alphabet *alphabet, int64_t startRow,
+        int64_t endRow, char labelChar, int64_t trueRunLength, const int64_t maxRunLength) {
+    /*
+     * Labels the run length rows [startRow, endRow) of one reference or insert position, splitting the true run
+     * length over them the way the features split observed run lengths.
+     */
+    Symbol label = alphabet->convertCharToSymbol(labelChar);
+    bool unlabeled = alphabet->convertSymbolToChar(label) == 'N';
+    for (int64_t row = startRow; row < endRow; row++) {
+        int64_t labelRunLength = trueRunLength <= 0 ? 0 : (trueRunLength > maxRunLength ? maxRunLength : trueRunLength);
+        tensor->labelCharacterData[row][0] = (uint8_t) (unlabeled ? 0 : label + 1);
+        tensor->labelRunLengthData[row][0] = (uint8_t) (unlabeled ? 0 : labelRunLength);
+        trueRunLength -= maxRunLength;
+    }
+}
+
+static void helenFeatureTensor_annotateWithTruth(HelenFeatureTensor *tensor, Alphabet *alphabet,
+        stList *trueRefAlignment, RleString *trueRefRleString, const int64_t maxRunLength,
+        int64_t *firstMatchedFeature, int64_t *lastMatchedFeature) {
+    /*
+     * poa_annotateHelenFeaturesWithTruth for a dense run length tensor. Rows of one reference or insert position
+     * are contiguous, so they are found from the position columns instead of the nextInsert and nextRunLength
+     * chains.
+     */
+    static int FEATURE_POS = 0;
+    static int REFERENCE_POS = 1;
+    *firstMatchedFeature = -1;
+    *lastMatchedFeature = -1;
+    char *logIdentifier = getLogIdentifier();
+    uint32_t **positionData = tensor->positionData;
+
+    // iterate over true ref alignment
+    stListIterator *trueRefAlignItor = stList_getIterator(trueRefAlignment);
+    stIntTuple *currTrueRefAlign = stList_getNext(trueRefAlignItor);
+
+    // iterate over features
+    int64_t trueRefPos = currTrueRefAlign == NULL ? 0 : stIntTuple_get(currTrueRefAlign, REFERENCE_POS);
+    int64_t row = 0;
+    while (row < tensor->featureCount) {
+        int64_t featureRefPos = positionData[row][0];
+
+        while (row < tensor->featureCount && positionData[row][0] == featureRefPos) {
+            int64_t featureInsPos = positionData[row][1];
+            int64_t endRow = row + 1;
+            while (endRow < tensor->featureCount && positionData[endRow][0] == featureRefPos &&
+                    positionData[endRow][1] == featureInsPos) {
+                endRow++;
+            }
+
+            // no more ref bases, everything is gaps
+            if (currTrueRefAlign == NULL) {
+                helenFeatureTensor_setLabels(tensor, alphabet, row, endRow, '_', 0, maxRunLength);
+            }
+
+            // match
+            else if (stIntTuple_get(currTrueRefAlign, FEATURE_POS) == featureRefPos &&
+                    stIntTuple_get(currTrueRefAlign, REFERENCE_POS) == trueRefPos) {
+                st_logDebug(" %s LABEL MATCH  %c trueRefPos:%"PRId64" featureRefPos:%"PRId64" featureInsPos:%"PRId64"\n",
+                           logIdentifier, featureInsPos == 0 ? ' ' : 'I', trueRefPos, featureRefPos, featureInsPos);
+                helenFeatureTensor_setLabels(tensor, alphabet, row, endRow, trueRefRleString->rleString[trueRefPos],
+                        trueRefRleString->repeatCounts[trueRefPos], maxRunLength);
+
+                // iterate
+                trueRefPos++;
+                currTrueRefAlign = stList_getNext(trueRefAlignItor);
+                // handle first and last match
+                if (featureInsPos == 0) {
+                    if (*firstMatchedFeature == -1) {
+                        *firstMatchedFeature = featureRefPos;
+                    }
+                    *lastMatchedFeature = featureRefPos;
+                }
+            }
+
+            // insert
+            else if (trueRefPos < stIntTuple_get(currTrueRefAlign, REFERENCE_POS)) {
+                st_logDebug(" %s LABEL INSERT %c trueRefPos:%"PRId64" featureRefPos:%"PRId64" featureInsPos:%"PRId64"\n",
+                           logIdentifier, featureInsPos == 0 ? ' ' : 'I', trueRefPos, featureRefPos, featureInsPos);
+                helenFeatureTensor_setLabels(tensor, alphabet, row, endRow, trueRefRleString->rleString[trueRefPos],
+                        trueRefRleString->repeatCounts[trueRefPos], maxRunLength);
+                trueRefPos++;
+            }
+
+            // delete
+            else if (featureRefPos < stIntTuple_get(currTrueRefAlign, FEATURE_POS)) {
+                st_logDebug(" %s LABEL DELETE %c trueRefPos:%"PRId64" featureRefPos:%"PRId64" featureInsPos:%"PRId64"\n",
+                           logIdentifier, featureInsPos == 0 ? ' ' : 'I', trueRefPos, featureRefPos, featureInsPos);
+                helenFeatureTensor_setLabels(tensor, alphabet, row, endRow, '_', 0, maxRunLength);
+            }
+
+            // programmer error
+            else {
+                st_errAbort("Unhandled case annotating features with true reference characters!\n");
+            }
+
+            row = endRow;
+        }
+
+        // this catches any true inserts which are not present in the poa / feature list
+        while (currTrueRefAlign != NULL &&
+                featureRefPos < stIntTuple_get(currTrueRefAlign, FEATURE_POS) &&
+                trueRefPos < stIntTuple_get(currTrueRefAlign, REFERENCE_POS)) {
+            trueRefPos++;
+        }
+    }
+
+    stList_destructIterator(trueRefAlignItor);
+    free(logIdentifier);
+}
+
+void helenFeatureTensor_keepReferencePositions(HelenFeatureTensor *tensor, int64_t firstRefPos,
+        int64_t lastRefPosInclusive) {
+    /*
+     * Drops the rows outside the given reference positions by moving the kept rows to the front of each array.
+     * The row pointers stay valid as every array is a single contiguous allocation.
+     */
+    int64_t startRow = 0;
+    while (startRow < tensor->featureCount && (int64_t) tensor->positionData[startRow][0] < firstRefPos) {
+        startRow++;
+    }
+    int64_t endRow = startRow;
+    while (endRow < tensor->featureCount && (int64_t) tensor->positionData[endRow][0] <= lastRefPosInclusive) {
+        endRow++;
+    }
+    int64_t rowCount = endRow - startRow;
+
+    if (startRow > 0 && rowCount > 0) {
+        memmove(tensor->positionData[0], tensor->positionData[startRow],
+                rowCount * tensor->positionColumnCount * sizeof(uint32_t));
+        memmove(tensor->normalizationData[0], tensor->normalizationData[startRow], rowCount * sizeof(uint8_t));
+        int64_t runLengthRowSize = tensor->runLengthColumnCount * (SYMBOL_NUMBER - 1);
+        if (tensor->imageData != NULL) {
+            memmove(tensor->imageData[0], tensor->imageData[startRow],
+                    rowCount * tensor->imageColumnCount * sizeof(uint8_t));
+        } else {
+            memmove(tensor->imageWeights[0], tensor->imageWeights[startRow],
+                    rowCount * tensor->imageColumnCount * sizeof(float));
+        }
+        if (tensor->runLengthData != NULL) {
+            memmove(tensor->runLengthData[0][0], tensor->runLengthData[startRow][0],
+                    rowCount * runLengthRowSize * sizeof(uint8_t));
+        }
+        if (tensor->runLengthWeights != NULL) {
+            memmove(tensor->runLengthWeights[0][0], tensor->runLengthWeights[startRow][0],
+                    rowCount * runLengthRowSize * sizeof(float));
+        }
+        if (tensor->labelCharacterData != NULL) {
+            memmove(tensor->labelCharacterData[0], tensor->labelCharacterData[startRow], rowCount * sizeof(uint8_t));
+        }
+        if (tensor->labelRunLengthData != NULL) {
+            memmove(tensor->labelRunLengthData[0], tensor->labelRunLengthData[startRow], rowCount * sizeof(uint8_t));
+        }
+    }
+    tensor->featureCount = rowCount;
+}
+
+HelenFeatureTensor *poa_getRleWeightFeatureTensor(HelenFeatureType type, HelenFeatureImageEncoding imageEncoding,
+        Poa *poa, stList *bamChunkReads, const int64_t maxRunLength, char *outputFileBase, BamChunk *bamChunk,
+        stList *trueRefAlignment, RleString *trueRefRleString) {
+    /*
+     * Builds the split or channel run length tensor for the chunk without the linked PoaFeature lists. A sizing
+     * pass over the POA counts the insert positions after each reference position and the run length rows of each
+     * position, then the weights are accumulated in a row-major double scratch tensor and normalized into the
+     * output tensor. Rows are ordered as the linked features are walked: a reference position, its run length
+     * rows, then each insert position and its run length rows. Weights are summed in double and in the same order
+     * as the linked features, so the output matches theirs exactly. As in the linked features, every base of every
+     * insert after a position goes to a single insert position, so a reference position has at most two position
+     * groups.
+     *
+     * If the truth alignment is given the rows are labeled and trimmed to the first and last matched reference
+     * positions. Returns NULL if no rows remain, or if fewer than HDF5_FEATURE_SIZE remain with labels.
+     */
+    assert(type == HFEAT_SPLIT_RLE_WEIGHT || type == HFEAT_CHANNEL_RLE_WEIGHT);
+    int64_t refPositionCount = stList_length(poa->nodes) - 1; //skip the first poa node, as it's always an 'N'
+    if (refPositionCount <= 0) {
+        return NULL;
+    }
+    bool outputLabels = trueRefAlignment != NULL && trueRefRleString != NULL;
+    char *logIdentifier = getLogIdentifier();
+
+    // position groups: each reference position is followed by an insert group if it has inserts
+    int64_t *refPositionGroupStart = st_calloc(refPositionCount + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < refPositionCount; i++) {
+        PoaNode *node = stList_get(poa->nodes, i + 1);
+        bool hasInsert = FALSE;
+        for (int64_t n = 0; n < stList_length(node->inserts); n++) {
+            PoaInsert *insert = stList_get(node->inserts, n);
+            hasInsert |= strlen(insert->insert->rleString) > 0;
+        }
+        refPositionGroupStart[i + 1] = refPositionGroupStart[i] + (hasInsert ? 2 : 1);
+    }
+
+    // rows per group (the longest run length over any observation of it), then the first row of each group
+    int64_t groupCount = refPositionGroupStart[refPositionCount];
+    int64_t *groupRowStart = st_calloc(groupCount + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < refPositionCount; i++) {
+        PoaNode *node = stList_get(poa->nodes, i + 1);
+        int64_t refGroup = refPositionGroupStart[i];
+        groupRowStart[refGroup + 1] = getRunLengthRowCount(node->observations, bamChunkReads, maxRunLength, 0);
+        for (int64_t n = 0; n < stList_length(node->inserts); n++) {
+            PoaInsert *insert = stList_get(node->inserts, n);
+            int64_t length = strlen(insert->insert->rleString);
+            for (int64_t o = 0; o < length; o++) {
+                int64_t rowCount = getRunLengthRowCount(insert->observations, bamChunkReads, maxRunLength, o);
+                if (rowCount > groupRowStart[refGroup + 2]) {
+                    groupRowStart[refGroup + 2] = rowCount;
+                }
+            }
+        }
+    }
+    for (int64_t g = 0; g < groupCount; g++) {
+        groupRowStart[g + 1] += groupRowStart[g];
+    }
+    int64_t featureCount = groupRowStart[groupCount];
+
+    // allocate once for the whole chunk
+    int64_t imageColumnCount;
+    int64_t runLengthColumnCount;
+    if (type == HFEAT_SPLIT_RLE_WEIGHT) {
+        imageColumnCount = ((SYMBOL_NUMBER - 1) * (maxRunLength + 1) + 1) * 2;
+        runLengthColumnCount = 0;
+    } else {
+        imageColumnCount = SYMBOL_NUMBER * 2; //ACGTGap x {fwd,bwd}
+        runLengthColumnCount = (maxRunLength + 1) * 2; //(runLenght + 0) x {fwd,bwd}
+    }
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(type, imageEncoding, outputFileBase, bamChunk,
+            outputLabels, featureCount, 3, imageColumnCount, runLengthColumnCount);
+    double **weights = getTwoDArrayDouble(featureCount, imageColumnCount, FALSE);
+    double ***runLengthWeights = runLengthColumnCount > 0 ?
+            getThreeDArrayDouble(featureCount, runLengthColumnCount, (SYMBOL_NUMBER - 1)) : NULL;
+
+    // positions
+    for (int64_t i = 0; i < refPositionCount; i++) {
+        for (int64_t g = refPositionGroupStart[i]; g < refPositionGroupStart[i + 1]; g++) {
+            for (int64_t row = groupRowStart[g]; row < groupRowStart[g + 1]; row++) {
+                tensor->positionData[row][0] = (uint32_t) i;
+                tensor->positionData[row][1] = (uint32_t) (g - refPositionGroupStart[i]);
+                tensor->positionData[row][2] = (uint32_t) (row - groupRowStart[g]);
+            }
+        }
+    }
+
+    // weights
+    double *gapWeights = st_calloc(refPositionCount * 2, sizeof(double));
+    for (int64_t i = 0; i < refPositionCount; i++) {
+        PoaNode *node = stList_get(poa->nodes, i + 1);
+        int64_t refGroup = refPositionGroupStart[i];
+
+        addRleWeightTensorObservations(poa, type, weights, runLengthWeights, groupRowStart[refGroup],
+                node->observations, bamChunkReads, maxRunLength, 0);
+
+        // Deletes start AFTER the current position, their weight is a gap at the following positions
+        for (int64_t d = 0; d < stList_length(node->deletes); d++) {
+            PoaDelete *delete = stList_get(node->deletes, d);
+            for (int64_t k = 1; k < delete->length; k++) {
+                if (i + k >= refPositionCount) {
+                    st_logInfo(" %s Encountered DELETE that occurs after end of POA!\n", logIdentifier);
+                    break;
+                }
+                gapWeights[(i + k) * 2] += delete->weightForwardStrand;
+                gapWeights[(i + k) * 2 + 1] += delete->weightReverseStrand;
+            }
+        }
+
+        // Inserts
+        for (int64_t n = 0; n < stList_length(node->inserts); n++) {
+            PoaInsert *insert = stList_get(node->inserts, n);
+            for (int64_t o = 0; o < strlen(insert->insert->rleString); o++) {
+                addRleWeightTensorObservations(poa, type, weights, runLengthWeights, groupRowStart[refGroup + 1],
+                        insert->observations, bamChunkReads, maxRunLength, o);
+            }
+        }
+    }
+
+    // gaps and normalization, per reference position
+    int64_t gapForwardColumn = type == HFEAT_SPLIT_RLE_WEIGHT ?
+            PoaFeature_SplitRleWeight_gapIndex(maxRunLength, TRUE) : PoaFeature_ChannelRleWeight_gapNuclIndex(TRUE);
+    int64_t gapReverseColumn = type == HFEAT_SPLIT_RLE_WEIGHT ?
+            PoaFeature_SplitRleWeight_gapIndex(maxRunLength, FALSE) : PoaFeature_ChannelRleWeight_gapNuclIndex(FALSE);
+    for (int64_t i = 0; i < refPositionCount; i++) {
+        int64_t refGroup = refPositionGroupStart[i];
+        int64_t refRow = groupRowStart[refGroup];
+
+        // deletes are gaps in every run length row of the reference position, but not its inserts
+        for (int64_t row = refRow; row < groupRowStart[refGroup + 1]; row++) {
+            weights[row][gapForwardColumn] += gapWeights[i * 2];
+            weights[row][gapReverseColumn] += gapWeights[i * 2 + 1];
+        }
+
+        // total weight is calculated for the very first refPos row, used for all inserts and run lengths
+        double totalWeight = 0;
+        for (int64_t j = 0; j < imageColumnCount; j++) {
+            totalWeight += weights[refRow][j];
+        }
+        uint8_t normalization = convertTotalWeightToUInt8(totalWeight);
+
+        for (int64_t row = refRow; row < groupRowStart[refPositionGroupStart[i + 1]]; row++) {
+            tensor->normalizationData[row][0] = normalization;
+            for (int64_t j = 0; j < imageColumnCount; j++) {
+                helenFeatureTensor_setImageWeight(tensor, row, j, totalWeight, weights[row][j]);
+            }
+            for (int64_t r = 0; r < runLengthColumnCount; r++) {
+                for (int64_t c = 0; c < SYMBOL_NUMBER - 1; c++) {
+                    helenFeatureTensor_setRunLengthWeight(tensor, row, r, c, totalWeight, runLengthWeights[row][r][c]);
+                }
+            }
+        }
+    }
+
+    // cleanup
+    free(weights[0]);
+    free(weights);
+    if (runLengthWeights != NULL) {
+        free(runLengthWeights[0][0]);
+        free(runLengthWeights[0]);
+        free(runLengthWeights);
+    }
+    free(gapWeights);
+    free(groupRowStart);
+    free(refPositionGroupStart);
+
+    // labels
+    if (outputLabels) {
+        int64_t firstMatchedFeature = -1;
+        int64_t lastMatchedFeature = -1;
+        helenFeatureTensor_annotateWithTruth(tensor, poa->alphabet, trueRefAlignment, trueRefRleString, maxRunLength,
+                &firstMatchedFeature, &lastMatchedFeature);
+        helenFeatureTensor_keepReferencePositions(tensor, firstMatchedFeature, lastMatchedFeature);
+        if (tensor->featureCount < HDF5_FEATURE_SIZE) {
+            st_logInfo(" %s Feature count %"PRId64" less than minimum of %d\n", logIdentifier, tensor->featureCount,
+                    HDF5_FEATURE_SIZE);
+            helenFeatureTensor_destruct(tensor);
+            tensor = NULL;
+        }
+    }
+    if (tensor != NULL && tensor->featureCount == 0) {
+        helenFeatureTensor_destruct(tensor);
+        tensor = NULL;
+    }
+
+    free(logIdentifier);
+    return tensor;
+}
+
+static int64_t getHelenFeatureWindowCount(int64_t featureCount) {
+    return featureCount / HDF5_FEATURE_SIZE + (featureCount % HDF5_FEATURE_SIZE == 0 ? 0 : 1);
+}
+
+static int64_t getHelenFeatureWindowStart(int64_t featureCount, bool coreWindows, int64_t windowIndex) {
+    /*
+     * Index of the first feature in the window. Core windows are consecutive. Overlapping windows are spread evenly
+     * so the last ends at the last feature, unless there are too few features to fill a single window.
+     */
+    if (featureCount < HDF5_FEATURE_SIZE || coreWindows) {
+        return HDF5_FEATURE_SIZE * windowIndex;
+    }
+    int64_t windowCount = getHelenFeatureWindowCount(featureCount);
+    if (windowIndex + 1 == windowCount) {
+        return featureCount - HDF5_FEATURE_SIZE;
+    }
+    int64_t featureOffset = (HDF5_FEATURE_SIZE * windowCount - featureCount) / (featureCount / HDF5_FEATURE_SIZE);
+    return HDF5_FEATURE_SIZE * windowIndex - featureOffset * windowIndex;
+}
+
+static uint8_t *getScaledHelenFeatureWeights(const float *weights, int64_t weightCount, float *scale) {
+    /*
+     * Quantizes the weights against the largest of them, such that weight = value * scale.
+     */
+    float maxWeight = 0.0f;
+    for (int64_t i = 0; i < weightCount; i++) {
+        if (weights[i] > maxWeight) maxWeight = weights[i];
+    }
+    *scale = maxWeight / UINT8_MAX;
+    uint8_t *scaledWeights = st_calloc(weightCount, sizeof(uint8_t));
+    if (maxWeight > 0) {
+        for (int64_t i = 0; i < weightCount; i++) {
+            scaledWeights[i] = (uint8_t) (weights[i] / maxWeight * UINT8_MAX + 0.5f);
+        }
+    }
+    return scaledWeights;
+}
+
+static hid_t getHelenFeatureDatasetProperties(HelenFeatureHDF5FileInfo *hdf5FileInfo, int rank, hsize_t *dimensions) {
+    /*
+     * Dataset creation properties for a feature dataset. Without compression datasets are contiguous. With it,
+     * each dataset is a single chunk covering the whole window, as HELEN always reads a window's datasets whole.
+     * Core windows may be written partially, so their padding must be filled (with zeros) on allocation.
+     */
+    if (hdf5FileInfo->compressionLevel == 0 && hdf5FileInfo->windowMode != HFEAT_WINDOW_CORE) {
+        return H5P_DEFAULT;
+    }
+    hid_t properties = H5Pcreate (H5P_DATASET_CREATE);
+    if (hdf5FileInfo->compressionLevel > 0) {
+        H5Pset_chunk (properties, rank, dimensions);
+        H5Pset_shuffle (properties);
+        H5Pset_deflate (properties, (unsigned) hdf5FileInfo->compressionLevel);
+    }
+    if (hdf5FileInfo->windowMode == HFEAT_WINDOW_CORE) {
+        H5Pset_fill_time (properties, H5D_FILL_TIME_ALLOC);
+    }
+    return properties;
+}
+
+static herr_t closeHelenFeatureDatasetProperties(hid_t properties) {
+    return properties == H5P_DEFAULT ? 0 : H5Pclose (properties);
+}
+
+static herr_t writeHelenFeatureDataset(hid_t group, char *name, hid_t fileType, hid_t memoryType, hid_t space,
+        hid_t properties, const void *data) {
+    hid_t dataset = H5Dcreate (group, name, fileType, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    herr_t status = H5Dwrite (dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    status |= H5Dclose (dataset);
+    return status;
+}
+
+static herr_t writeHelenFeatureRows(hid_t group, char *name, hid_t fileType, hid_t memoryType, hid_t space,
+        hid_t properties, hsize_t rowCount, const void *data) {
+    /*
+     * As writeHelenFeatureDataset, but only data for the first rowCount rows of the dataset is given. Any rows after
+     * those keep the fill value.
+     */
+    hsize_t dimensions[3];
+    int rank = H5Sget_simple_extent_dims (space, dimensions, NULL);
+    if (rowCount == dimensions[0]) {
+        return writeHelenFeatureDataset(group, name, fileType, memoryType, space, properties, data);
+    }
+    hsize_t start[3] = {0, 0, 0};
+    dimensions[0] = rowCount;
+    hid_t memorySpace = H5Screate_simple (rank, dimensions, NULL);
+    hid_t fileSpace = H5Scopy (space);
+    herr_t status = H5Sselect_hyperslab (fileSpace, H5S_SELECT_SET, start, NULL, dimensions, NULL);
+
+    hid_t dataset = H5Dcreate (group, name, fileType, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    status |= H5Dwrite (dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, data);
+    status |= H5Dclose (dataset);
+    status |= H5Sclose (fileSpace);
+    status |= H5Sclose (memorySpace);
+    return status;
+}
+
+static herr_t writeHelenFeatureWeights(hid_t group, char *name, HelenFeatureHDF5FileInfo *hdf5FileInfo,
+        HelenFeatureImageEncoding imageEncoding, hid_t space, hid_t properties, hid_t scaleSpace, hsize_t rowCount,
+        const uint8_t *quantizedWeights, const float *weights, int64_t weightCount) {
+    /*
+     * Writes one window of image weights in the requested encoding, of which weightCount weights in the first
+     * rowCount rows are given. For the scaled encoding the weights are quantized against the largest weight in the
+     * window, and the scale is written alongside as "<name>_scale" such that weight = value * scale.
+     */
+    herr_t status = 0;
+    switch (imageEncoding) {
+        case HFEAT_IMAGE_NORMALIZED_UINT8:
+            status |= writeHelenFeatureRows(group, name, hdf5FileInfo->uint8Type, hdf5FileInfo->uint8Type, space,
+                    properties, rowCount, quantizedWeights);
+            break;
+        case HFEAT_IMAGE_FLOAT16:
+            status |= writeHelenFeatureRows(group, name, hdf5FileInfo->float16Type, H5T_NATIVE_FLOAT, space,
+                    properties, rowCount, weights);
+            break;
+        case HFEAT_IMAGE_SCALED_UINT8: {
+            float scale;
+            uint8_t *scaledWeights = getScaledHelenFeatureWeights(weights, weightCount, &scale);
+            char *scaleName = stString_print("%s_scale", name);
+            status |= writeHelenFeatureRows(group, name, hdf5FileInfo->uint8Type, hdf5FileInfo->uint8Type, space,
+                    properties, rowCount, scaledWeights);
+            status |= writeHelenFeatureDataset(group, scaleName, hdf5FileInfo->floatType, H5T_NATIVE_FLOAT,
+                    scaleSpace, H5P_DEFAULT, &scale);
+            free(scaleName);
+            free(scaledWeights);
+            break;
+        }
+        default:
+            st_errAbort("Unhandled HELEN image encoding!\n");
+    }
+    return status;
+}
+
+void helenFeatureTensor_writeHDF5(HelenFeatureTensor *tensor, HelenFeatureHDF5FileInfo *hdf5FileInfo) {
+    /*
+     * Writes the tensor to the file as a series of groups of exactly HDF5_FEATURE_SIZE features (or a single smaller
+     * group if there are fewer features than that). For overlapping windows the last group is shifted back to end at
+     * the last feature. For core windows the groups do not overlap, and the last is zero padded; its "feature_mask"
+     * marks which rows are features.
+     */
+    herr_t status = 0;
+    int64_t featureCount = tensor->featureCount;
+    bool hasRunLengths = tensor->runLengthColumnCount > 0;
+    bool coreWindows = hdf5FileInfo->windowMode == HFEAT_WINDOW_CORE;
+
+    if (tensor->imageEncoding != hdf5FileInfo->imageEncoding) {
+        st_errAbort("HELEN feature tensor image encoding does not match the encoding of %s\n", hdf5FileInfo->filename);
+    }
 
     // so that we can produce chunks smaller than HDF5_FEATURE_SIZE (not used during training)
-    hsize_t featureSize = (hsize_t) (featureCount < HDF5_FEATURE_SIZE ? featureCount : HDF5_FEATURE_SIZE);
+    hsize_t featureSize = (hsize_t) (featureCount < HDF5_FEATURE_SIZE && !coreWindows ?
+            featureCount : HDF5_FEATURE_SIZE);
 
     hsize_t metadataDimension[1] = {1};
-    hsize_t postionDimension[2] = {featureSize, 3};
-    hsize_t labelCharacterDimension[2] = {featureSize, 1};
-    hsize_t labelRunLengthDimension[2] = {featureSize, 1};
+    hsize_t postionDimension[2] = {featureSize, (hsize_t) tensor->positionColumnCount};
+    hsize_t labelDimension[2] = {featureSize, 1};
     hsize_t normalizationDimension[2] = {featureSize, 1};
-    hsize_t nucleotideDimension[2] = {featureSize, (hsize_t) nucleotideColumnCount};
-    hsize_t runLengthDimension[3] = {featureSize, (hsize_t) runLengthColumnCount, (hsize_t) SYMBOL_NUMBER - 1};
-//    hsize_t runLengthDimension[3] = {featureSize, (hsize_t) SYMBOL_NUMBER - 1, (hsize_t) runLengthColumnCount};
+    hsize_t imageDimension[2] = {featureSize, (hsize_t) tensor->imageColumnCount};
+    hsize_t runLengthDimension[3] = {featureSize, (hsize_t) tensor->runLengthColumnCount, (hsize_t) SYMBOL_NUMBER - 1};
 
     hid_t metadataSpace = H5Screate_simple(1, metadataDimension, NULL);
     hid_t positionSpace = H5Screate_simple(2, postionDimension, NULL);
-    hid_t labelCharacterSpace = H5Screate_simple(2, labelCharacterDimension, NULL);
-    hid_t labelRunLengthSpace = H5Screate_simple(2, labelRunLengthDimension, NULL);
+    hid_t labelSpace = H5Screate_simple(2, labelDimension, NULL);
     hid_t normalizationSpace = H5Screate_simple(2, normalizationDimension, NULL);
-    hid_t nucleotideSpace = H5Screate_simple(2, nucleotideDimension, NULL);
-    hid_t runLengthSpace = H5Screate_simple(3, runLengthDimension, NULL);
+    hid_t imageSpace = H5Screate_simple(2, imageDimension, NULL);
+    hid_t runLengthSpace = hasRunLengths ? H5Screate_simple(3, runLengthDimension, NULL) : -1;
 
-    hid_t stringType = H5Tcopy (H5T_C_S1);
-    H5Tset_size (stringType, strlen(bamChunk->refSeqName) + 1);
+    hid_t positionProperties = getHelenFeatureDatasetProperties(hdf5FileInfo, 2, postionDimension);
+    hid_t labelProperties = getHelenFeatureDatasetProperties(hdf5FileInfo, 2, labelDimension);
+    hid_t normalizationProperties = getHelenFeatureDatasetProperties(hdf5FileInfo, 2, normalizationDimension);
+    hid_t imageProperties = getHelenFeatureDatasetProperties(hdf5FileInfo, 2, imageDimension);
+    hid_t runLengthProperties = hasRunLengths ?
+            getHelenFeatureDatasetProperties(hdf5FileInfo, 3, runLengthDimension) : H5P_DEFAULT;
 
+    hid_t stringType = H5Tcopy (H5T_C_S1);
+    status |= H5Tset_size (stringType, strlen(tensor->refSeqName) + 1);
 
-    /*
-     * Write features to files
-     */
+    // the channel feature type stores its nucleotide weights separately from the run length weights
+    char *imageName = tensor->type == HFEAT_CHANNEL_RLE_WEIGHT ? "nucleotide" : "image";
 
     // each file must have exactly 1000 features
-    int64_t totalFeatureFiles = (int64_t) (featureCount / HDF5_FEATURE_SIZE) + (featureCount % HDF5_FEATURE_SIZE == 0 ? 0 : 1);
-    int64_t featureOffset = 0;
-    if (featureCount >= HDF5_FEATURE_SIZE) {
-        featureOffset = (int64_t) ((HDF5_FEATURE_SIZE * totalFeatureFiles - featureCount) / (int64_t) (featureCount / HDF5_FEATURE_SIZE));
+    int64_t totalFeatureFiles = getHelenFeatureWindowCount(featureCount);
+
+    // rows of the padded last core window are masked out
+    uint8_t *featureMask = NULL;
+    if (coreWindows) {
+        featureMask = st_calloc(featureSize, sizeof(uint8_t));
+        memset(featureMask, 1, featureSize);
     }
+
     for (int64_t featureIndex = 0; featureIndex < totalFeatureFiles; featureIndex++) {
         // get start pos
-        int64_t chunkFeatureStartIdx = (HDF5_FEATURE_SIZE * featureIndex) - (featureOffset * featureIndex);
-        if (featureIndex + 1 == totalFeatureFiles && featureCount >= HDF5_FEATURE_SIZE) {
-            chunkFeatureStartIdx = featureCount - HDF5_FEATURE_SIZE;
-        }
+        int64_t chunkFeatureStartIdx = getHelenFeatureWindowStart(featureCount, coreWindows, featureIndex);
+        hsize_t rowCount = (hsize_t) (featureCount - chunkFeatureStartIdx) < featureSize ?
+                (hsize_t) (featureCount - chunkFeatureStartIdx) : featureSize;
+        int64_t imageWeightCount = (int64_t) rowCount * tensor->imageColumnCount;
+        int64_t runLengthWeightCount = (int64_t) rowCount * tensor->runLengthColumnCount * (SYMBOL_NUMBER - 1);
 
         // create group
-        char *outputGroup = stString_print("images/%s.%"PRId64, outputFileBase, featureIndex);
+        char *outputGroup = stString_print("images/%s.%"PRId64, tensor->outputFileBase, featureIndex);
         hid_t group = H5Gcreate (hdf5FileInfo->file, outputGroup, hdf5FileInfo->groupPropertyList, H5P_DEFAULT, H5P_DEFAULT);
 
         // write metadata
-        hid_t contigDataset = H5Dcreate (group, "contig", stringType, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigDataset, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, bamChunk->refSeqName);
-        hid_t contigStartDataset = H5Dcreate (group, "contig_start", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigStartDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryStart);
-        hid_t contigEndDataset = H5Dcreate (group, "contig_end", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (contigEndDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &bamChunk->chunkBoundaryEnd);
-        hid_t chunkIndexDataset = H5Dcreate (group, "feature_chunk_idx", hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (chunkIndexDataset, hdf5FileInfo->int64Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &featureIndex);
-
-        // write position info
-        hid_t positionDataset = H5Dcreate (group, "position", hdf5FileInfo->uint32Type, positionSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (positionDataset, hdf5FileInfo->uint32Type, H5S_ALL, H5S_ALL, H5P_DEFAULT, positionData[chunkFeatureStartIdx]);
-
-        // write nucl, rl, and norm data
-        hid_t nucleotideDataset = H5Dcreate (group, "nucleotide", hdf5FileInfo->uint8Type, nucleotideSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (nucleotideDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                            nucleotideData[chunkFeatureStartIdx]);
-        hid_t runLengthDataset = H5Dcreate (group, "runLengths", hdf5FileInfo->uint8Type, runLengthSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (runLengthDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                            runLengthData[chunkFeatureStartIdx][0]);
-        hid_t normalizationDataset = H5Dcreate (group, "normalization", hdf5FileInfo->uint8Type, normalizationSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        status |= H5Dwrite (normalizationDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                            normalizationData[chunkFeatureStartIdx]);
+        status |= writeHelenFeatureDataset(group, "contig", stringType, stringType, metadataSpace, H5P_DEFAULT,
+                tensor->refSeqName);
+        status |= writeHelenFeatureDataset(group, "contig_start", hdf5FileInfo->int64Type, hdf5FileInfo->int64Type,
+                metadataSpace, H5P_DEFAULT, &tensor->chunkBoundaryStart);
+        status |= writeHelenFeatureDataset(group, "contig_end", hdf5FileInfo->int64Type, hdf5FileInfo->int64Type,
+                metadataSpace, H5P_DEFAULT, &tensor->chunkBoundaryEnd);
+        status |= writeHelenFeatureDataset(group, "feature_chunk_idx", hdf5FileInfo->int64Type,
+                hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, &featureIndex);
+        if (coreWindows) {
+            status |= writeHelenFeatureDataset(group, "contig_core_start", hdf5FileInfo->int64Type,
+                    hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, &tensor->chunkStart);
+            status |= writeHelenFeatureDataset(group, "contig_core_end", hdf5FileInfo->int64Type,
+                    hdf5FileInfo->int64Type, metadataSpace, H5P_DEFAULT, &tensor->chunkEnd);
+            status |= writeHelenFeatureRows(group, "feature_mask", hdf5FileInfo->uint8Type, hdf5FileInfo->uint8Type,
+                    labelSpace, labelProperties, rowCount, featureMask);
+        }
 
-        // if labels, add all these too
-        if (outputLabels) {
-            hid_t labelCharacterDataset = H5Dcreate (group, "label_base", hdf5FileInfo->uint8Type, labelCharacterSpace, H5P_DEFAULT,
-                                                     H5P_DEFAULT, H5P_DEFAULT);
-            status |= H5Dwrite (labelCharacterDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                                labelCharacterData[chunkFeatureStartIdx]);
-            hid_t labelRunLengthDataset = H5Dcreate (group, "label_run_length", hdf5FileInfo->uint8Type, labelRunLengthSpace,
-                                                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-            status |= H5Dwrite (labelRunLengthDataset, hdf5FileInfo->uint8Type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                                labelRunLengthData[chunkFeatureStartIdx]);
+        // write position, weight and normalization data
+        status |= writeHelenFeatureRows(group, "position", hdf5FileInfo->uint32Type, hdf5FileInfo->uint32Type,
+                positionSpace, positionProperties, rowCount, tensor->positionData[chunkFeatureStartIdx]);
+        status |= writeHelenFeatureWeights(group, imageName, hdf5FileInfo, tensor->imageEncoding, imageSpace,
+                imageProperties, metadataSpace, rowCount,
+                tensor->imageData == NULL ? NULL : tensor->imageData[chunkFeatureStartIdx],
+                tensor->imageWeights == NULL ? NULL : tensor->imageWeights[chunkFeatureStartIdx],
+                imageWeightCount);
+        if (hasRunLengths) {
+            status |= writeHelenFeatureWeights(group, "runLengths", hdf5FileInfo, tensor->imageEncoding,
+                    runLengthSpace, runLengthProperties, metadataSpace, rowCount,
+                    tensor->runLengthData == NULL ? NULL : tensor->runLengthData[chunkFeatureStartIdx][0],
+                    tensor->runLengthWeights == NULL ? NULL : tensor->runLengthWeights[chunkFeatureStartIdx][0],
+                    runLengthWeightCount);
+        }
+        status |= writeHelenFeatureRows(group, "normalization", hdf5FileInfo->uint8Type, hdf5FileInfo->uint8Type,
+                normalizationSpace, normalizationProperties, rowCount, tensor->normalizationData[chunkFeatureStartIdx]);
 
-            status |= H5Dclose (labelCharacterDataset);
-            status |= H5Dclose (labelRunLengthDataset);
+        // if labels, add all these too
+        if (tensor->labelCharacterData != NULL) {
+            status |= writeHelenFeatureRows(group, "label_base", hdf5FileInfo->uint8Type, hdf5FileInfo->uint8Type,
+                    labelSpace, labelProperties, rowCount, tensor->labelCharacterData[chunkFeatureStartIdx]);
+        }
+        if (tensor->labelRunLengthData != NULL) {
+            status |= writeHelenFeatureRows(group, "label_run_length", hdf5FileInfo->uint8Type,
+                    hdf5FileInfo->uint8Type, labelSpace, labelProperties, rowCount,
+                    tensor->labelRunLengthData[chunkFeatureStartIdx]);
         }
 
         // cleanup
-        status |= H5Dclose (contigDataset);
-        status |= H5Dclose (contigStartDataset);
-        status |= H5Dclose (contigEndDataset);
-        status |= H5Dclose (chunkIndexDataset);
-        status |= H5Dclose (positionDataset);
-        status |= H5Dclose (nucleotideDataset);
-        status |= H5Dclose (runLengthDataset);
-        status |= H5Dclose (normalizationDataset);
         status |= H5Gclose (group);
         free(outputGroup);
     }
 
     // cleanup
-    free(nucleotideData[0]);
-    free(nucleotideData);
-    free(runLengthData[0][0]);
-    free(runLengthData[0]);
-    free(runLengthData);
-    free(normalizationData[0]);
-    free(normalizationData);
-    free(positionData[0]);
-    free(positionData);
+    free(featureMask);
+    status |= closeHelenFeatureDatasetProperties(positionProperties);
+    status |= closeHelenFeatureDatasetProperties(labelProperties);
+    status |= closeHelenFeatureDatasetProperties(normalizationProperties);
+    status |= closeHelenFeatureDatasetProperties(imageProperties);
+    status |= closeHelenFeatureDatasetProperties(runLengthProperties);
     status |= H5Sclose (metadataSpace);
     status |= H5Sclose (positionSpace);
-    status |= H5Sclose (nucleotideSpace);
-    status |= H5Sclose (runLengthSpace);
+    status |= H5Sclose (labelSpace);
     status |= H5Sclose (normalizationSpace);
-    status |= H5Sclose (labelRunLengthSpace);
-    status |= H5Sclose (labelCharacterSpace);
-    status |= H5Tclose (stringType);
-    if (outputLabels) {
-        free(labelCharacterData[0]);
-        free(labelCharacterData);
-        free(labelRunLengthData[0]);
-        free(labelRunLengthData);
+    status |= H5Sclose (imageSpace);
+    if (hasRunLengths) {
+        status |= H5Sclose (runLengthSpace);
     }
+    status |= H5Tclose (stringType);
 
     if (status) {
         char *logIdentifier = getLogIdentifier();
-        st_logInfo(" %s Error writing HELEN features to HDF5 files: %s\n", logIdentifier, outputFileBase);
+        st_logInfo(" %s Error writing HELEN features to HDF5 files: %s\n", logIdentifier, tensor->outputFileBase);
         free(logIdentifier);
     }
 }
 
+void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
+        BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive) {
+    HelenFeatureTensor *tensor = getSimpleWeightHelenFeatureTensor(alphabet, hdf5FileInfo->imageEncoding, outputFileBase,
+            bamChunk, outputLabels, features, featureStartIdx, featureEndIdxInclusive);
+    if (tensor != NULL) {
+        helenFeatureTensor_writeHDF5(tensor, hdf5FileInfo);
+        helenFeatureTensor_destruct(tensor);
+    }
+}
 
+void writeSplitRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
+        BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive, const int64_t maxRunLength) {
+    HelenFeatureTensor *tensor = getSplitRleWeightHelenFeatureTensor(alphabet, hdf5FileInfo->imageEncoding, outputFileBase,
+            bamChunk, outputLabels, features, featureStartIdx, featureEndIdxInclusive, maxRunLength);
+    if (tensor != NULL) {
+        helenFeatureTensor_writeHDF5(tensor, hdf5FileInfo);
+        helenFeatureTensor_destruct(tensor);
+    }
+}
 
-HelenFeatureHDF5FileInfo* HelenFeatureHDF5FileInfo_construct(char *filename) {
+void writeChannelRleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
+        BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive, const int64_t maxRunLength) {
+    HelenFeatureTensor *tensor = getChannelRleWeightHelenFeatureTensor(alphabet, hdf5FileInfo->imageEncoding, outputFileBase,
+            bamChunk, outputLabels, features, featureStartIdx, featureEndIdxInclusive, maxRunLength);
+    if (tensor != NULL) {
+        helenFeatureTensor_writeHDF5(tensor, hdf5FileInfo);
+        helenFeatureTensor_destruct(tensor);
+    }
+}
+
+
+HelenFeatureHDF5FileInfo* HelenFeatureHDF5FileInfo_construct(char *filename, int64_t compressionLevel,
+        HelenFeatureImageEncoding imageEncoding, HelenFeatureWindowMode windowMode) {
+    if (compressionLevel < 0 || compressionLevel > 9) {
+        st_errAbort("HELEN feature compression level must be between 0 and 9, got %"PRId64"\n", compressionLevel);
+    }
     HelenFeatureHDF5FileInfo *fileInfo = st_calloc(1, sizeof(HelenFeatureHDF5FileInfo));
     fileInfo->filename = stString_copy(filename);
+    fileInfo->compressionLevel = compressionLevel;
+    fileInfo->imageEncoding = imageEncoding;
+    fileInfo->windowMode = windowMode;
     fileInfo->file = H5Fcreate (filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
     fileInfo->int64Type = H5Tcopy(H5T_NATIVE_UINT32);
     H5Tset_order(fileInfo->int64Type, H5T_ORDER_LE);
@@ -1916,6 +2879,11 @@ HelenFeatureHDF5FileInfo* HelenFeatureHDF5FileInfo_construct(char *filename) {
     H5Tset_order(fileInfo->uint8Type, H5T_ORDER_LE);
     fileInfo->floatType = H5Tcopy(H5T_NATIVE_FLOAT);
     H5Tset_order(fileInfo->floatType, H5T_ORDER_LE);
+    // IEEE half precision: sign bit 15, 5 exponent bits from 10, 10 mantissa bits from 0
+    fileInfo->float16Type = H5Tcopy(H5T_IEEE_F32LE);
+    H5Tset_fields(fileInfo->float16Type, 15, 10, 5, 0, 10);
+    H5Tset_size(fileInfo->float16Type, 2);
+    H5Tset_ebias(fileInfo->float16Type, 15);
     fileInfo->groupPropertyList = H5Pcreate (H5P_LINK_CREATE);
     H5Pset_create_intermediate_group (fileInfo->groupPropertyList, 1);
     return fileInfo;
@@ -1927,19 +2895,385 @@ void HelenFeatureHDF5FileInfo_destruct(HelenFeatureHDF5FileInfo *fileInfo) {
     H5Tclose(fileInfo->uint32Type);
     H5Tclose(fileInfo->uint8Type);
     H5Tclose(fileInfo->floatType);
+    H5Tclose(fileInfo->float16Type);
     H5Pclose(fileInfo->groupPropertyList);
     H5Fclose(fileInfo->file);
     free(fileInfo);
 }
 
-HelenFeatureHDF5FileInfo** openHelenFeatureHDF5FilesByThreadCount(char *filenameBase, int64_t threadCount) {
-    HelenFeatureHDF5FileInfo** infoArray = st_calloc(threadCount, sizeof(HelenFeatureHDF5FileInfo*));
-    for (int64_t i = 0; i < threadCount; i++) {
-        char *filename = stString_print("%s.T%02"PRId64".h5", filenameBase, i);
-        infoArray[i] = HelenFeatureHDF5FileInfo_construct(filename);
-        free(filename);
+/*
+ * Memory mappable feature output
+ */
+
+static uint16_t floatToHalf(float value) {
+    /*
+     * IEEE half precision bits for the value, rounded to nearest even. Values too large become infinity.
+     */
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(uint32_t));
+    uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+    int32_t exponent = (int32_t) ((bits >> 23) & 0xff);
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) {
+        return (uint16_t) (sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
     }
-    return infoArray;
+    int32_t halfExponent = exponent - 127 + 15;
+    if (halfExponent >= 0x1f) {
+        return (uint16_t) (sign | 0x7c00);
+    }
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+    if (halfExponent <= 0) {
+        // subnormal
+        if (halfExponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int32_t shift = 14 - halfExponent;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        half = ((uint32_t) halfExponent << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1fff;
+        halfway = 0x1000;
+    }
+    // a carry out of the mantissa correctly moves to the next exponent
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        half++;
+    }
+    return (uint16_t) (sign | half);
+}
+
+static void writeNpyHeader(FILE *file, char *description, int64_t windowCount, int64_t columnCount,
+        int64_t depthCount) {
+    /*
+     * Writes a version 1.0 .npy header of exactly HELEN_NPY_HEADER_SIZE bytes at the start of the file, for an array
+     * of windowCount windows of HDF5_FEATURE_SIZE rows by columnCount (by depthCount if positive) values.
+     */
+    uint16_t byteOrderTest = 1;
+    char byteOrder = *((uint8_t *) &byteOrderTest) == 1 ? '<' : '>';
+    char *shape = depthCount > 0 ?
+            stString_print("(%"PRId64", %d, %"PRId64", %"PRId64")", windowCount, HDF5_FEATURE_SIZE, columnCount,
+                    depthCount) :
+            stString_print("(%"PRId64", %d, %"PRId64")", windowCount, HDF5_FEATURE_SIZE, columnCount);
+    char *dictionary = stString_print("{'descr': '%c%s', 'fortran_order': False, 'shape': %s, }",
+            description[0] == 'u' && description[1] == '1' ? '|' : byteOrder, description, shape);
+
+    int64_t headerLength = HELEN_NPY_HEADER_SIZE - 10;
+    if (strlen(dictionary) + 1 > headerLength) {
+        st_errAbort("HELEN feature .npy header is too long: %s\n", dictionary);
+    }
+    char header[HELEN_NPY_HEADER_SIZE];
+    memset(header, ' ', HELEN_NPY_HEADER_SIZE);
+    memcpy(header, "\x93NUMPY\x01\x00", 8);
+    header[8] = (char) (headerLength & 0xff);
+    header[9] = (char) (headerLength >> 8);
+    memcpy(header + 10, dictionary, strlen(dictionary));
+    header[HELEN_NPY_HEADER_SIZE - 1] = '\n';
+
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, HELEN_NPY_HEADER_SIZE, file) != HELEN_NPY_HEADER_SIZE) {
+        st_errAbort("Could not write HELEN feature .npy header\n");
+    }
+    free(dictionary);
+    free(shape);
+}
+
+static FILE *openNpyFile(char *outputBase, char *name) {
+    /*
+     * Creates "<outputBase>.<name>.npy", leaving room for the header which is written when the file is closed.
+     */
+    char *filename = stString_print("%s.%s.npy", outputBase, name);
+    FILE *file = fopen(filename, "w+b");
+    if (file == NULL) {
+        st_errAbort("Could not open HELEN feature file %s\n", filename);
+    }
+    char header[HELEN_NPY_HEADER_SIZE];
+    memset(header, 0, HELEN_NPY_HEADER_SIZE);
+    if (fwrite(header, 1, HELEN_NPY_HEADER_SIZE, file) != HELEN_NPY_HEADER_SIZE) {
+        st_errAbort("Could not write to HELEN feature file %s\n", filename);
+    }
+    free(filename);
+    return file;
+}
+
+static void closeNpyFile(FILE *file, char *description, int64_t windowCount, int64_t columnCount,
+        int64_t depthCount) {
+    if (file == NULL) return;
+    writeNpyHeader(file, description, windowCount, columnCount, depthCount);
+    fclose(file);
+}
+
+static void writeNpyRows(FILE *file, const void *data, int64_t rowBytes, int64_t rowCount) {
+    /*
+     * Appends rowCount rows of data, then zero rows up to HDF5_FEATURE_SIZE.
+     */
+    static const uint8_t zeros[4096] = {0};
+    if (rowCount > 0 && fwrite(data, (size_t) rowBytes, (size_t) rowCount, file) != (size_t) rowCount) {
+        st_errAbort("Could not write HELEN features\n");
+    }
+    int64_t paddingBytes = (HDF5_FEATURE_SIZE - rowCount) * rowBytes;
+    while (paddingBytes > 0) {
+        size_t bytes = paddingBytes < (int64_t) sizeof(zeros) ? (size_t) paddingBytes : sizeof(zeros);
+        if (fwrite(zeros, 1, bytes, file) != bytes) {
+            st_errAbort("Could not write HELEN features\n");
+        }
+        paddingBytes -= bytes;
+    }
+}
+
+static void writeNpyWeights(FILE *file, HelenFeatureImageEncoding imageEncoding, int64_t rowCount,
+        int64_t weightsPerRow, const uint8_t *quantizedWeights, const float *weights, float *scale) {
+    /*
+     * As writeHelenFeatureWeights, for one window of a .npy file. The scale of the scaled encoding is returned
+     * instead of written.
+     */
+    int64_t weightCount = rowCount * weightsPerRow;
+    *scale = 0.0f;
+    switch (imageEncoding) {
+        case HFEAT_IMAGE_NORMALIZED_UINT8:
+            writeNpyRows(file, quantizedWeights, weightsPerRow, rowCount);
+            break;
+        case HFEAT_IMAGE_FLOAT16: {
+            uint16_t *halfWeights = st_calloc(weightCount, sizeof(uint16_t));
+            for (int64_t i = 0; i < weightCount; i++) {
+                halfWeights[i] = floatToHalf(weights[i]);
+            }
+            writeNpyRows(file, halfWeights, weightsPerRow * sizeof(uint16_t), rowCount);
+            free(halfWeights);
+            break;
+        }
+        case HFEAT_IMAGE_SCALED_UINT8: {
+            uint8_t *scaledWeights = getScaledHelenFeatureWeights(weights, weightCount, scale);
+            writeNpyRows(file, scaledWeights, weightsPerRow, rowCount);
+            free(scaledWeights);
+            break;
+        }
+        default:
+            st_errAbort("Unhandled HELEN image encoding!\n");
+    }
+}
+
+HelenFeatureNpyFileInfo *HelenFeatureNpyFileInfo_construct(char *outputBase, HelenFeatureImageEncoding imageEncoding,
+        HelenFeatureWindowMode windowMode) {
+    /*
+     * Windows are written to <outputBase>.images.npy, .positions.npy, .normalization.npy, and for the channel type
+     * .runLengths.npy, and with labels .labels.npy (base and run length per row). Every window has
+     * HDF5_FEATURE_SIZE rows, zero padded past its features. Row i of <outputBase>.index.tsv describes window i
+     * of each file: the chunk it came from, how many of its rows are features, and the image scales of the scaled
+     * encoding.
+     */
+    HelenFeatureNpyFileInfo *fileInfo = st_calloc(1, sizeof(HelenFeatureNpyFileInfo));
+    fileInfo->outputBase = stString_copy(outputBase);
+    fileInfo->imageEncoding = imageEncoding;
+    fileInfo->windowMode = windowMode;
+    fileInfo->windowCount = 0;
+    fileInfo->layoutFixed = FALSE;
+    fileInfo->imageFile = openNpyFile(outputBase, "images");
+    fileInfo->positionFile = openNpyFile(outputBase, "positions");
+    fileInfo->normalizationFile = openNpyFile(outputBase, "normalization");
+
+    char *indexFilename = stString_print("%s.index.tsv", outputBase);
+    fileInfo->indexFile = fopen(indexFilename, "w");
+    if (fileInfo->indexFile == NULL) {
+        st_errAbort("Could not open HELEN feature file %s\n", indexFilename);
+    }
+    fprintf(fileInfo->indexFile, "#window\tname\tfeature_chunk_idx\tcontig\tcontig_start\tcontig_end\t"
+            "contig_core_start\tcontig_core_end\tfeatures\timage_scale\trun_length_scale\n");
+    free(indexFilename);
+    return fileInfo;
+}
+
+void HelenFeatureNpyFileInfo_destruct(HelenFeatureNpyFileInfo *fileInfo) {
+    char *imageDescription = fileInfo->imageEncoding == HFEAT_IMAGE_FLOAT16 ? "f2" : "u1";
+    closeNpyFile(fileInfo->imageFile, imageDescription, fileInfo->windowCount, fileInfo->imageColumnCount, 0);
+    closeNpyFile(fileInfo->runLengthFile, imageDescription, fileInfo->windowCount, fileInfo->runLengthColumnCount,
+            SYMBOL_NUMBER - 1);
+    closeNpyFile(fileInfo->positionFile, "u4", fileInfo->windowCount, fileInfo->positionColumnCount, 0);
+    closeNpyFile(fileInfo->normalizationFile, "u1", fileInfo->windowCount, 1, 0);
+    closeNpyFile(fileInfo->labelFile, "u1", fileInfo->windowCount, 2, 0);
+    fclose(fileInfo->indexFile);
+    free(fileInfo->outputBase);
+    free(fileInfo);
+}
+
+void helenFeatureTensor_writeNpy(HelenFeatureTensor *tensor, HelenFeatureNpyFileInfo *npyFileInfo) {
+    /*
+     * Appends the tensor's windows, chosen as for helenFeatureTensor_writeHDF5, to the .npy files. The first tensor
+     * fixes the record layout; all later ones must match it.
+     */
+    int64_t featureCount = tensor->featureCount;
+    bool coreWindows = npyFileInfo->windowMode == HFEAT_WINDOW_CORE;
+    bool hasLabels = tensor->labelCharacterData != NULL;
+
+    if (tensor->imageEncoding != npyFileInfo->imageEncoding) {
+        st_errAbort("HELEN feature tensor image encoding does not match the encoding of %s\n", npyFileInfo->outputBase);
+    }
+    if (!npyFileInfo->layoutFixed) {
+        npyFileInfo->layoutFixed = TRUE;
+        npyFileInfo->type = tensor->type;
+        npyFileInfo->positionColumnCount = tensor->positionColumnCount;
+        npyFileInfo->imageColumnCount = tensor->imageColumnCount;
+        npyFileInfo->runLengthColumnCount = tensor->runLengthColumnCount;
+        npyFileInfo->hasLabels = hasLabels;
+        if (tensor->runLengthColumnCount > 0) {
+            npyFileInfo->runLengthFile = openNpyFile(npyFileInfo->outputBase, "runLengths");
+        }
+        if (hasLabels) {
+            npyFileInfo->labelFile = openNpyFile(npyFileInfo->outputBase, "labels");
+        }
+    } else if (tensor->type != npyFileInfo->type || tensor->positionColumnCount != npyFileInfo->positionColumnCount ||
+            tensor->imageColumnCount != npyFileInfo->imageColumnCount ||
+            tensor->runLengthColumnCount != npyFileInfo->runLengthColumnCount || hasLabels != npyFileInfo->hasLabels) {
+        st_errAbort("HELEN feature tensor %s does not match the layout of %s\n", tensor->outputFileBase,
+                npyFileInfo->outputBase);
+    }
+
+    int64_t runLengthWeightsPerRow = tensor->runLengthColumnCount * (SYMBOL_NUMBER - 1);
+    uint8_t *labels = hasLabels ? st_calloc(2 * HDF5_FEATURE_SIZE, sizeof(uint8_t)) : NULL;
+    int64_t windowCount = getHelenFeatureWindowCount(featureCount);
+    for (int64_t windowIndex = 0; windowIndex < windowCount; windowIndex++) {
+        int64_t start = getHelenFeatureWindowStart(featureCount, coreWindows, windowIndex);
+        int64_t rowCount = featureCount - start < HDF5_FEATURE_SIZE ? featureCount - start : HDF5_FEATURE_SIZE;
+
+        float imageScale;
+        float runLengthScale = 0.0f;
+        writeNpyWeights(npyFileInfo->imageFile, tensor->imageEncoding, rowCount, tensor->imageColumnCount,
+                tensor->imageData == NULL ? NULL : tensor->imageData[start],
+                tensor->imageWeights == NULL ? NULL : tensor->imageWeights[start], &imageScale);
+        if (npyFileInfo->runLengthFile != NULL) {
+            writeNpyWeights(npyFileInfo->runLengthFile, tensor->imageEncoding, rowCount, runLengthWeightsPerRow,
+                    tensor->runLengthData == NULL ? NULL : tensor->runLengthData[start][0],
+                    tensor->runLengthWeights == NULL ? NULL : tensor->runLengthWeights[start][0], &runLengthScale);
+        }
+        writeNpyRows(npyFileInfo->positionFile, tensor->positionData[start],
+                tensor->positionColumnCount * sizeof(uint32_t), rowCount);
+        writeNpyRows(npyFileInfo->normalizationFile, tensor->normalizationData[start], 1, rowCount);
+        if (hasLabels) {
+            for (int64_t i = 0; i < rowCount; i++) {
+                labels[2 * i] = tensor->labelCharacterData[start + i][0];
+                labels[2 * i + 1] = tensor->labelRunLengthData == NULL ? 0 : tensor->labelRunLengthData[start + i][0];
+            }
+            writeNpyRows(npyFileInfo->labelFile, labels, 2, rowCount);
+        }
+
+        // index
+        fprintf(npyFileInfo->indexFile, "%"PRId64"\t%s\t%"PRId64"\t%s\t%"PRId64"\t%"PRId64"\t%"PRId64"\t%"PRId64"\t%"PRId64,
+                npyFileInfo->windowCount, tensor->outputFileBase, windowIndex, tensor->refSeqName,
+                tensor->chunkBoundaryStart, tensor->chunkBoundaryEnd, tensor->chunkStart, tensor->chunkEnd, rowCount);
+        if (tensor->imageEncoding == HFEAT_IMAGE_SCALED_UINT8) {
+            fprintf(npyFileInfo->indexFile, "\t%.9g\t%.9g\n", imageScale, runLengthScale);
+        } else {
+            fprintf(npyFileInfo->indexFile, "\tNA\tNA\n");
+        }
+        npyFileInfo->windowCount++;
+    }
+    free(labels);
+}
+
+
+/*
+ * Asynchronous feature writer
+ */
+
+static void *helenFeatureWriter_sink(void *arg) {
+    /*
+     * Body of the sink thread: pops tensors off the queue in arrival order and writes them to the file until the
+     * writer is finished and the queue is drained. All HDF5 calls and .npy writes happen on this thread.
+     */
+    HelenFeatureWriter *writer = arg;
+    while (1) {
+        pthread_mutex_lock(&writer->mutex);
+        while (stList_length(writer->queue) == 0 && !writer->finished) {
+            pthread_cond_wait(&writer->notEmpty, &writer->mutex);
+        }
+        if (stList_length(writer->queue) == 0) {
+            pthread_mutex_unlock(&writer->mutex);
+            break;
+        }
+        HelenFeatureTensor *tensor = stList_remove(writer->queue, 0);
+        pthread_cond_signal(&writer->notFull);
+        pthread_mutex_unlock(&writer->mutex);
+
+        if (writer->outputFormat == HFEAT_OUTPUT_NPY) {
+            helenFeatureTensor_writeNpy(tensor, writer->npyFileInfo);
+        } else {
+            helenFeatureTensor_writeHDF5(tensor, writer->fileInfo);
+        }
+        helenFeatureTensor_destruct(tensor);
+        writer->tensorsWritten++;
+    }
+    return NULL;
+}
+
+HelenFeatureWriter *helenFeatureWriter_construct(char *outputName, HelenFeatureOutputFormat outputFormat,
+        int64_t compressionLevel, HelenFeatureImageEncoding imageEncoding, HelenFeatureWindowMode windowMode,
+        int64_t queueCapacity) {
+    /*
+     * Opens the output and starts the sink thread. The output name is the HDF5 file, or the prefix of the .npy files
+     * (compression does not apply to those). At most queueCapacity tensors wait to be written at once, bounding the
+     * memory held by finished chunks when the file system is slower than the polishing threads.
+     */
+    if (queueCapacity < 1) {
+        st_errAbort("HELEN feature writer queue capacity must be positive, got %"PRId64"\n", queueCapacity);
+    }
+    HelenFeatureWriter *writer = st_calloc(1, sizeof(HelenFeatureWriter));
+    writer->outputFormat = outputFormat;
+    writer->imageEncoding = imageEncoding;
+    writer->windowMode = windowMode;
+    writer->outputName = stString_copy(outputName);
+    if (outputFormat == HFEAT_OUTPUT_NPY) {
+        writer->npyFileInfo = HelenFeatureNpyFileInfo_construct(outputName, imageEncoding, windowMode);
+    } else {
+        writer->fileInfo = HelenFeatureHDF5FileInfo_construct(outputName, compressionLevel, imageEncoding, windowMode);
+    }
+    writer->queue = stList_construct();
+    writer->queueCapacity = queueCapacity;
+    writer->finished = FALSE;
+    writer->tensorsWritten = 0;
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->notEmpty, NULL);
+    pthread_cond_init(&writer->notFull, NULL);
+    if (pthread_create(&writer->sinkThread, NULL, helenFeatureWriter_sink, writer) != 0) {
+        st_errAbort("Could not start HELEN feature writer thread for %s\n", outputName);
+    }
+    return writer;
+}
+
+void helenFeatureWriter_add(HelenFeatureWriter *writer, HelenFeatureTensor *tensor) {
+    /*
+     * Hands the tensor to the sink thread, which takes ownership of it. Blocks only while the queue is full.
+     */
+    pthread_mutex_lock(&writer->mutex);
+    while (stList_length(writer->queue) >= writer->queueCapacity) {
+        pthread_cond_wait(&writer->notFull, &writer->mutex);
+    }
+    stList_append(writer->queue, tensor);
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+void helenFeatureWriter_destruct(HelenFeatureWriter *writer) {
+    /*
+     * Waits for all queued tensors to be written, then stops the sink thread and closes the file.
+     */
+    pthread_mutex_lock(&writer->mutex);
+    writer->finished = TRUE;
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->sinkThread, NULL);
+
+    st_logInfo("> Wrote %"PRId64" HELEN feature chunks to %s\n", writer->tensorsWritten, writer->outputName);
+
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->notEmpty);
+    pthread_cond_destroy(&writer->notFull);
+    stList_destruct(writer->queue);
+    if (writer->fileInfo != NULL) HelenFeatureHDF5FileInfo_destruct(writer->fileInfo);
+    if (writer->npyFileInfo != NULL) HelenFeatureNpyFileInfo_destruct(writer->npyFileInfo);
+    free(writer->outputName);
+    free(writer);
 }
 
 #endif
\ No newline at end of file
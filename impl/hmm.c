@@ -9,7 +9,6 @@
 // OpenMP
 #if defined(_OPENMP)
 #include <omp.h>
-#define CELL_BUFFER_SIZE 1000
 #endif
 
 inline double logAddP(double a, double b, bool maxNotSum) {
@@ -56,6 +55,7 @@ void stRPHmmParameters_printParameters(stRPHmmParameters *params, FILE *fH) {
             (int)params->maxNotSumTransitions, params->maxPartitionsInAColumn,
             params->minReadCoverageToSupportPhasingBetweenHeterozygousSites);
 
+    fprintf(fH, "\t\tBeam width of the forward pass (0 is unbounded): %" PRIi64 "\n", params->beamWidth);
     fprintf(fH, "\t\tInclude inverted partitions?: %i\n", (int) params->includeInvertedPartitions);
     fprintf(fH, "\t\tRounds of iterative refinement: %" PRIi64 "\n", params->roundsOfIterativeRefinement);
 }
@@ -125,9 +125,8 @@ stRPHmm *stRPHmm_construct(stProfileSeq *profileSeq, stRPHmmParameters *params)
     hmm->lastColumn = column;
 
     // Add two cells to the column to represent the two possible partitions of the single profile sequence
-    stRPCell *cell = stRPCell_construct(1);
-    column->head = cell;
-    cell->nCell = stRPCell_construct(0);
+    stRPColumn_addCell(column, 1);
+    stRPColumn_addCell(column, 0);
 
     return hmm;
 }
@@ -173,10 +172,10 @@ stList *stRPHmm_forwardTraceBack(stRPHmm *hmm) {
     stRPColumn *column = hmm->lastColumn;
 
     // Pick cell in the last column with highest probability
-    stRPCell *cell = column->head;
-    double maxProb = cell->forwardLogProb;
-    stRPCell *maxCell = cell;
-    while((cell = cell->nCell) != NULL) {
+    stRPCell *maxCell = &column->cells[0];
+    double maxProb = maxCell->forwardLogProb;
+    for(int64_t i=1; i<column->cellNo; i++) {
+        stRPCell *cell = &column->cells[i];
         if(cell->forwardLogProb > maxProb) {
             maxProb = cell->forwardLogProb;
             maxCell = cell;
@@ -198,16 +197,16 @@ stList *stRPHmm_forwardTraceBack(stRPHmm *hmm) {
 
         // Walk through cells in the previous column to find the one with the
         // highest forward probability that transitions to maxCell
-        cell = column->head;
         maxCell = NULL;
         maxProb = ST_MATH_LOG_ZERO;
-        do {
+        for(int64_t i=0; i<column->cellNo; i++) {
+            stRPCell *cell = &column->cells[i];
             // If compatible and has greater probability
             if(stRPMergeColumn_getNextMergeCell(cell, column->nColumn) == mCell && cell->forwardLogProb > maxProb) {
                 maxProb = cell->forwardLogProb;
                 maxCell = cell;
             }
-        } while((cell = cell->nCell) != NULL);
+        }
 
         assert(maxCell != NULL);
         stList_append(path, maxCell);
@@ -342,7 +341,7 @@ stRPHmm *stRPHmm_fuse(stRPHmm *leftHmm, stRPHmm *rightHmm) {
         column->pColumn = mColumn;
 
         // Make cell for empty column
-        column->head = stRPCell_construct(0);
+        stRPColumn_addCell(column, 0);
 
         // Add right merge column
         mColumn = stRPMergeColumn_construct(0, 0);
@@ -399,7 +398,7 @@ void stRPHmm_alignColumns(stRPHmm *hmm1, stRPHmm *hmm2) {
                 hmm2->refStart - hmm1->refStart, 0, NULL, NULL);
 
         // Add cell
-        column->head = stRPCell_construct(0);
+        stRPColumn_addCell(column, 0);
 
         // Create merge column
         stRPMergeColumn *mColumn = stRPMergeColumn_construct(0,0);
@@ -438,7 +437,7 @@ void stRPHmm_alignColumns(stRPHmm *hmm1, stRPHmm *hmm2) {
                 hmm1->refLength - hmm2->refLength, 0, NULL, NULL);
 
         // Add cell
-        column->head = stRPCell_construct(0);
+        stRPColumn_addCell(column, 0);
 
         // Create merge column
         stRPMergeColumn *mColumn = stRPMergeColumn_construct(0, 0);
@@ -515,21 +514,19 @@ static int intEqualsFn(const void *key1, const void *key2) {
     return *(uint64_t *)key1 == *(uint64_t *)key2;
 }
 
-stRPCell **makeCell(uint64_t partition, stRPCell **pCell, stHash *seen) {
+void makeCell(uint64_t partition, stRPColumn *column, stHash *seen) {
     /*
-     * Make a cell for a column.
+     * Make a cell for a column. The column's cells must have been reserved, as the seen hash is keyed
+     * by the partitions of the cells.
      */
+    assert(column->cellNo < column->cellCapacity);
 
     // Make the cell
-    stRPCell *cell = stRPCell_construct(partition);
+    stRPCell *cell = stRPColumn_addCell(column, partition);
 
     // Add the partition to those already seen
     assert(stHash_search(seen, &cell->partition) == NULL);
     stHash_insert(seen, &cell->partition, cell);
-
-    // Link cells
-    *pCell = cell;
-    return &cell->nCell;
 }
 
 stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2) {
@@ -621,23 +618,21 @@ stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2)
         }
 
         // Create cross product of columns
-        stRPCell **pCell = &column->head;
-        stRPCell *cell1 = column1->head;
 
         // includeInvertedPartitions forces that the partition and its inverse are included
         // in the resulting combine hmm.
         if(hmm->parameters->includeInvertedPartitions) {
+            stRPColumn_reserveCells(column, 2 * column1->cellNo * column2->cellNo);
             stHash *seen = stHash_construct3(intHashFn, intEqualsFn, NULL, NULL);
-            do {
-                stRPCell *cell2 = column2->head;
-                do {
-                    uint64_t partition = mergePartitionsOrMasks(cell1->partition, cell2->partition,
+            for(int64_t i=0; i<column1->cellNo; i++) {
+                for(int64_t j=0; j<column2->cellNo; j++) {
+                    uint64_t partition = mergePartitionsOrMasks(column1->cells[i].partition, column2->cells[j].partition,
                             column1->depth, column2->depth);
 
                     // We have not seen the combined partition before
                     if(stHash_search(seen, &partition) == NULL) {
                         // Add the partition to the column
-                        pCell = makeCell(partition, pCell, seen);
+                        makeCell(partition, column, seen);
 
                         // Check if the column has non-zero depth and only add the inverse partition if it does
                         // because if zero length the inverse partition is the same as for the forward, and therefore
@@ -646,27 +641,24 @@ stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2)
                             uint64_t invertedPartition = invertPartition(partition, newColumnDepth);
                             assert(stHash_search(seen, &invertedPartition) == NULL);
 
-                            pCell = makeCell(invertedPartition, pCell, seen);
+                            makeCell(invertedPartition, column, seen);
                         }
                     }
-                } while((cell2 = cell2->nCell) != NULL);
-            } while((cell1 = cell1->nCell) != NULL);
+                }
+            }
 
             // Cleanup
             stHash_destruct(seen);
         }
         // If not forcing symmetry
         else {
-            do {
-                stRPCell *cell2 = column2->head;
-                do {
-                    stRPCell *cell = stRPCell_construct(mergePartitionsOrMasks(cell1->partition, cell2->partition,
+            stRPColumn_reserveCells(column, column1->cellNo * column2->cellNo);
+            for(int64_t i=0; i<column1->cellNo; i++) {
+                for(int64_t j=0; j<column2->cellNo; j++) {
+                    stRPColumn_addCell(column, mergePartitionsOrMasks(column1->cells[i].partition, column2->cells[j].partition,
                             column1->depth, column2->depth));
-                    // Link cells
-                    *pCell = cell;
-                    pCell = &cell->nCell;
-                } while((cell2 = cell2->nCell) != NULL);
-            } while((cell1 = cell1->nCell) != NULL);
+                }
+            }
         }
 
         // Get the next merged column
@@ -698,12 +690,10 @@ stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2)
         column->nColumn = mColumn;
 
         // Create cross product of merged columns
-        stHashIterator *cellIt1 = stHash_getIterator(mColumn1->mergeCellsFrom);
-        stRPMergeCell *mCell1;
-        while((mCell1 = stHash_getNext(cellIt1)) != NULL) {
-            stHashIterator *cellIt2 = stHash_getIterator(mColumn2->mergeCellsFrom);
-            stRPMergeCell *mCell2;
-            while((mCell2 = stHash_getNext(cellIt2)) != NULL) {
+        for(int64_t i=0; i<mColumn1->mergeCellNo; i++) {
+            stRPMergeCell *mCell1 = &mColumn1->mergeCells[i];
+            for(int64_t j=0; j<mColumn2->mergeCellNo; j++) {
+                stRPMergeCell *mCell2 = &mColumn2->mergeCells[j];
                 uint64_t fromPartition = mergePartitionsOrMasks(mCell1->fromPartition,
                         mCell2->fromPartition,
                         mColumn1->pColumn->depth, mColumn2->pColumn->depth);
@@ -717,7 +707,8 @@ stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2)
                 // includeInvertedPartitions forces that the partition and its inverse are included
                 // in the resulting combined hmm.
                 if(hmm->parameters->includeInvertedPartitions) {
-                    if(stHash_search(mColumn->mergeCellsFrom, &fromPartition) == NULL) {
+                    stRPCell fromCell = { fromPartition, 0.0, 0.0 };
+                    if(stRPMergeColumn_getNextMergeCell(&fromCell, mColumn) == NULL) {
                         stRPMergeCell_construct(fromPartition, toPartition, mColumn);
 
                         // If the mask includes no sequences then the the inverted will be identical, so we check
@@ -735,9 +726,7 @@ stRPHmm *stRPHmm_createCrossProductOfTwoAlignedHmm(stRPHmm *hmm1, stRPHmm *hmm2)
                     stRPMergeCell_construct(fromPartition, toPartition, mColumn);
                 }
             }
-            stHash_destructIterator(cellIt2);
         }
-        stHash_destructIterator(cellIt1);
 
         // Get next column
         column1 = mColumn1->nColumn;
@@ -757,6 +746,8 @@ static void stRPHmm_initialiseProbs(stRPHmm *hmm) {
     // Initialize total forward and backward probabilities
     hmm->forwardLogProb = ST_MATH_LOG_ZERO;
     hmm->backwardLogProb = ST_MATH_LOG_ZERO;
+    hmm->beamDiscardedLogProb = ST_MATH_LOG_ZERO;
+    hmm->beamDiscardedCells = 0;
 
     // Iterate through columns from first to last
     stRPColumn *column = hmm->firstColumn;
@@ -765,30 +756,27 @@ static void stRPHmm_initialiseProbs(stRPHmm *hmm) {
         column->totalLogProb = ST_MATH_LOG_ZERO;
 
         // Initialise cells in the column
-        stRPCell *cell = column->head;
-        do {
-            cell->forwardLogProb = ST_MATH_LOG_ZERO;
-            cell->backwardLogProb = ST_MATH_LOG_ZERO;
-        } while((cell = cell->nCell) != NULL);
+        for(int64_t i=0; i<column->cellNo; i++) {
+            column->cells[i].forwardLogProb = ST_MATH_LOG_ZERO;
+            column->cells[i].backwardLogProb = ST_MATH_LOG_ZERO;
+        }
 
         if(column->nColumn == NULL) {
             break;
         }
 
         // Initialise cells in the next merge column
-        stList *mergeCells = stHash_getValues(column->nColumn->mergeCellsFrom);
-        for(int64_t i=0; i<stList_length(mergeCells); i++) {
-            stRPMergeCell *mergeCell = stList_get(mergeCells, i);
-            mergeCell->forwardLogProb = ST_MATH_LOG_ZERO;
-            mergeCell->backwardLogProb = ST_MATH_LOG_ZERO;
+        stRPMergeColumn *mColumn = column->nColumn;
+        for(int64_t i=0; i<mColumn->mergeCellNo; i++) {
+            mColumn->mergeCells[i].forwardLogProb = ST_MATH_LOG_ZERO;
+            mColumn->mergeCells[i].backwardLogProb = ST_MATH_LOG_ZERO;
         }
-        stList_destruct(mergeCells);
 
         column = column->nColumn->nColumn;
     }
 }
 
-static inline void forwardCellCalc1(stRPHmm *hmm, stRPColumn *column, stRPCell *cell, uint64_t *bitCountVectors) {
+static inline void forwardCellCalc1(stRPHmm *hmm, stRPColumn *column, stRPCell *cell, double emissionProb) {
     // If the previous merge column exists then propagate forward probability from merge state
     if(column->pColumn != NULL) {
         stRPMergeCell *mCell = stRPMergeColumn_getPreviousMergeCell(cell, column->pColumn);
@@ -799,10 +787,6 @@ static inline void forwardCellCalc1(stRPHmm *hmm, stRPColumn *column, stRPCell *
         cell->forwardLogProb = ST_MATH_LOG_ONE;
     }
 
-    // Calculate the emission prob
-    double emissionProb = emissionLogProbability(column, cell, bitCountVectors,
-            hmm->ref, (stRPHmmParameters *)hmm->parameters);
-
     // Add emission prob to forward log prob
     cell->forwardLogProb += emissionProb;
 
@@ -824,6 +808,40 @@ static inline void forwardCellCalc2(stRPHmm *hmm, stRPColumn *column, stRPCell *
     }
 }
 
+static int cellForwardCmpFn(const void *a, const void *b) {
+    /*
+     * Sort cells by forward probability in descending order.
+     */
+    stRPCell *cell1 = (stRPCell *)a, *cell2 = (stRPCell *)b;
+    return cell1->forwardLogProb > cell2->forwardLogProb ? -1 : cell1->forwardLogProb < cell2->forwardLogProb ? 1 : 0;
+}
+
+static int cellAddressCmpFn(const void *a, const void *b) {
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static void applyForwardBeam(stRPHmm *hmm, stRPColumn *column) {
+    /*
+     * Removes all but the hmm->parameters->beamWidth cells of the column with highest forward probability,
+     * adding the forward probability of the removed cells to the hmm's discarded mass. The retained
+     * cells keep their order.
+     */
+    stList *cells = stList_construct();
+    for(int64_t i=0; i<column->cellNo; i++) {
+        stList_append(cells, &column->cells[i]);
+    }
+    stList_sort(cells, cellForwardCmpFn);
+    while(stList_length(cells) > hmm->parameters->beamWidth) {
+        stRPCell *cell = stList_pop(cells);
+        hmm->beamDiscardedLogProb = logAddP(hmm->beamDiscardedLogProb, cell->forwardLogProb,
+                hmm->parameters->maxNotSumTransitions);
+        hmm->beamDiscardedCells++;
+    }
+    stList_sort(cells, cellAddressCmpFn);
+    stRPColumn_setCells(column, cells);
+    stList_destruct(cells);
+}
+
 static void stRPHmm_forward(stRPHmm *hmm) {
     /*
      * Forward algorithm for hmm.
@@ -832,45 +850,37 @@ static void stRPHmm_forward(stRPHmm *hmm) {
 
     // Iterate through columns from first to last
     while(1) {
-        // Get the bit count vectors for the column
-        uint64_t *bitCountVectors = calculateCountBitVectors(column->seqs, hmm->ref,
-                column->refStart, column->length, column->depth);
+        // Get the bit count vectors for the column, which are kept by the column for reuse
+        uint64_t *bitCountVectors = stRPColumn_getBitCountVectors(column, hmm->ref);
 
-        // Iterate through states in column
-        stRPCell *cell = column->head;
-
-        // If OpenMP is available then parallelize the calculation of the emission calcs
+        // Iterate through blocks of states in column, calculating the emissions of each block together
+        // and the blocks in parallel if OpenMP is available
+        int64_t blockNo = (column->cellNo + EMISSION_PARTITION_BLOCK_SIZE - 1) / EMISSION_PARTITION_BLOCK_SIZE;
 #if defined(_OPENMP)
-        stRPCell *cells[CELL_BUFFER_SIZE];
-        do {
-            // Get as many cells as the buffer will fit / there are cells
-            int64_t cellsInBuffer=0;
-            do {
-                cells[cellsInBuffer++] = cell;
-            } while((cell = cell->nCell) != NULL && cellsInBuffer < CELL_BUFFER_SIZE);
-
-#pragma omp parallel
-{
-#pragma omp for
-            for(int64_t i=0; i<cellsInBuffer; i++) {
-                forwardCellCalc1(hmm, column, cells[i], bitCountVectors);
+#pragma omp parallel for
+#endif
+        for(int64_t b=0; b<blockNo; b++) {
+            stRPCell *cells = &column->cells[b * EMISSION_PARTITION_BLOCK_SIZE];
+            int64_t cellNo = column->cellNo - b * EMISSION_PARTITION_BLOCK_SIZE;
+            if(cellNo > EMISSION_PARTITION_BLOCK_SIZE) {
+                cellNo = EMISSION_PARTITION_BLOCK_SIZE;
             }
-}
-            for(int64_t i=0; i<cellsInBuffer; i++) {
-                forwardCellCalc2(hmm, column, cells[i]);
+            double emissionProbs[EMISSION_PARTITION_BLOCK_SIZE];
+            emissionLogProbabilities(column, cells, cellNo, bitCountVectors,
+                    hmm->ref, (stRPHmmParameters *)hmm->parameters, emissionProbs);
+            for(int64_t i=0; i<cellNo; i++) {
+                forwardCellCalc1(hmm, column, &cells[i], emissionProbs[i]);
             }
-        } while(cell != NULL);
-#else
-        // Otherwise do it without the need for the cell buffer
-        do {
-            forwardCellCalc1(hmm, column, cell, bitCountVectors);
-            forwardCellCalc2(hmm, column, cell);
         }
-        while((cell = cell->nCell) != NULL);
-#endif
 
-        // Cleanup the bit count vectors
-        free(bitCountVectors);
+        // If running as a beam search, keep only the most probable cells so that the less probable do not
+        // propagate to the following columns
+        if(hmm->parameters->beamWidth > 0 && column->cellNo > hmm->parameters->beamWidth) {
+            applyForwardBeam(hmm, column);
+        }
+        for(int64_t i=0; i<column->cellNo; i++) {
+            forwardCellCalc2(hmm, column, &column->cells[i]);
+        }
 
         if(column->nColumn == NULL) {
             break;
@@ -919,11 +929,9 @@ static void stRPHmm_backward(stRPHmm *hmm) {
     // Iterate through columns from last to first
     while(1) {
         // Iterate through states in column
-        stRPCell *cell = column->head;
-        do {
-            backwardCellCalc(hmm, column, cell);
+        for(int64_t i=0; i<column->cellNo; i++) {
+            backwardCellCalc(hmm, column, &column->cells[i]);
         }
-        while((cell = cell->nCell) != NULL);
 
         if(column->pColumn == NULL) {
             break;
@@ -943,6 +951,11 @@ void stRPHmm_forwardBackward(stRPHmm *hmm) {
     // Run the forward and backward passes
     stRPHmm_forward(hmm);
     stRPHmm_backward(hmm);
+
+    if(hmm->beamDiscardedCells > 0) {
+        st_logDebug("Beam discarded %" PRIi64 " states with forward log probability %f (total forward log prob: %f)\n",
+                hmm->beamDiscardedCells, (float)hmm->beamDiscardedLogProb, (float)hmm->forwardLogProb);
+    }
 }
 
 static int cellCmpFn(const void *a, const void *b, const void *extraArg) {
@@ -970,24 +983,8 @@ void filterMergeCells(stRPMergeColumn *mColumn, stSet *chosenMergeCellsSet) {
      * Removes merge cells from the column that are not in chosenMergeCellsSet
      */
     assert(stSet_size(chosenMergeCellsSet) > 0);
-    stList *mergeCells = stHash_getValues(mColumn->mergeCellsFrom);
-    for(int64_t i=0; i<stList_length(mergeCells); i++) {
-        stRPMergeCell *mCell = stList_get(mergeCells, i);
-        assert(mCell != NULL);
-        if(stSet_search(chosenMergeCellsSet, mCell) == NULL) {
-            // Remove the state from the merge column
-            assert(stHash_search(mColumn->mergeCellsFrom, &(mCell->fromPartition)) == mCell);
-            assert(stHash_search(mColumn->mergeCellsTo, &(mCell->toPartition)) == mCell);
-            stHash_remove(mColumn->mergeCellsFrom, &(mCell->fromPartition));
-            stHash_remove(mColumn->mergeCellsTo, &(mCell->toPartition));
-
-            // Cleanup
-            stRPMergeCell_destruct(mCell);
-        }
-    }
-    stList_destruct(mergeCells);
-    assert(stSet_size(chosenMergeCellsSet) == stHash_size(mColumn->mergeCellsFrom));
-    assert(stSet_size(chosenMergeCellsSet) == stHash_size(mColumn->mergeCellsTo));
+    stRPMergeColumn_retainMergeCells(mColumn, chosenMergeCellsSet);
+    assert(stSet_size(chosenMergeCellsSet) == mColumn->mergeCellNo);
 }
 
 stSet *getLinkedMergeCells(stRPMergeColumn *mColumn,
@@ -1009,17 +1006,11 @@ stSet *getLinkedMergeCells(stRPMergeColumn *mColumn,
 
 void relinkCells(stRPColumn *column, stList *cells) {
     /*
-     * Re-links the cells in the list 'cells' to make up the list of cells in the column.
+     * Makes the cells in the list 'cells' the cells of the column, in order, discarding the rest.
+     * The list is updated to point at the cells' new locations.
      */
-    stRPCell **pCell = &column->head; // Pointer to previous cell, used to
-    // remove cells from the linked list
-    for(int64_t i=0; i<stList_length(cells); i++) {
-        stRPCell *cell = stList_get(cells, i);
-        *pCell = cell;
-        pCell = &cell->nCell;
-    }
-    *pCell = NULL;
-    assert(column->head != NULL);
+    stRPColumn_setCells(column, cells);
+    assert(column->cellNo > 0);
 }
 
 stList *getLinkedCells(stRPColumn *column,
@@ -1033,18 +1024,12 @@ stList *getLinkedCells(stRPColumn *column,
     // only keeping cells that still have a preceding merge cell
 
     stList *cells = stList_construct();
-    stRPCell *cell = column->head;
-    do {
+    for(int64_t i=0; i<column->cellNo; i++) {
+        stRPCell *cell = &column->cells[i];
         if(mColumn == NULL || getPCell(cell, mColumn) != NULL) {
             stList_append(cells, cell);
-            cell = cell->nCell;
         }
-        else {
-            stRPCell *nCell = cell->nCell;
-            stRPCell_destruct(cell);
-            cell = nCell;
-        }
-    } while(cell != NULL);
+    }
     stList_sort2(cells, cellCmpFn, column);
     assert(stList_length(cells) > 0);
 
@@ -1061,7 +1046,7 @@ void stRPHmm_pruneForwards(stRPHmm *hmm) {
     stRPMergeColumn *mColumn = NULL;
 
     while(1) {
-        assert(column->head != NULL);
+        assert(column->cellNo > 0);
 
         // Get cells that have a valid previous cell
         stList *cells = getLinkedCells(column, stRPMergeColumn_getPreviousMergeCell, mColumn);
@@ -1071,7 +1056,7 @@ void stRPHmm_pruneForwards(stRPHmm *hmm) {
               (stList_length(cells) > hmm->parameters->maxPartitionsInAColumn ||
                stRPCell_posteriorProb(stList_peek(cells), column) <
                        hmm->parameters->minPosteriorProbabilityForPartition)) {
-            stRPCell_destruct(stList_pop(cells));
+            stList_pop(cells);
         }
 
         // Relink the cells (from most probable to least probable)
@@ -1123,7 +1108,7 @@ void stRPHmm_pruneBackwards(stRPHmm *hmm) {
     stRPMergeColumn *mColumn = NULL;
 
     while(1) {
-        assert(column->head != NULL);
+        assert(column->cellNo > 0);
 
         // Get cells that have a valid previous cell
         stList *cells = getLinkedCells(column, stRPMergeColumn_getNextMergeCell, mColumn);
@@ -1165,6 +1150,19 @@ void stRPHmm_pruneBackwards(stRPHmm *hmm) {
 void stRPHmm_prune(stRPHmm *hmm) {
     stRPHmm_pruneForwards(hmm);
     stRPHmm_pruneBackwards(hmm);
+
+#ifdef _HOT_PATH_COUNTERS
+    // Count the surviving cells, which bound the work of the traceback and of everything downstream of phasing
+    stRPColumn *column = hmm->firstColumn;
+    while(1) {
+        HOT_PATH_COUNT(HOT_PATH_COUNTER_HMM_COLUMNS, 1);
+        HOT_PATH_COUNT(HOT_PATH_COUNTER_HMM_CELLS, column->cellNo);
+        if(column->nColumn == NULL) {
+            break;
+        }
+        column = column->nColumn->nColumn;
+    }
+#endif
 }
 
 bool stRPHmm_overlapOnReference(stRPHmm *hmm1, stRPHmm *hmm2) {
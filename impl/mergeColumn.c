@@ -10,12 +10,50 @@
  * Read partitioning hmm merge column (stRPMergeColumn) functions
  */
 
-static uint64_t intHashFn(const void *a) {
-    return *(uint64_t *)a;
+static inline uint64_t partitionHashFn(uint64_t partition, int64_t indexSize) {
+    /*
+     * Hash of a (masked) partition into an open addressing table of the given power of two size.
+     */
+    uint64_t h = partition * 0x9E3779B97F4A7C15ULL;
+    return (h ^ (h >> 32)) & (indexSize - 1);
 }
 
-static int intEqualsFn(const void *key1, const void *key2) {
-    return *(uint64_t *)key1 == *(uint64_t *)key2;
+static int64_t *getMergeCellSlot(int64_t *index, int64_t indexSize, stRPMergeCell *mergeCells,
+        uint64_t partition, bool from) {
+    /*
+     * Returns the slot of the open addressing table that holds the merge cell with the given from
+     * (or to) partition, or else the empty slot where it would be inserted.
+     */
+    int64_t i = partitionHashFn(partition, indexSize);
+    while(index[i] != -1 &&
+          (from ? mergeCells[index[i]].fromPartition : mergeCells[index[i]].toPartition) != partition) {
+        i = (i + 1) & (indexSize - 1);
+    }
+    return &index[i];
+}
+
+static void reindexMergeCells(stRPMergeColumn *mColumn) {
+    /*
+     * Rebuilds the open addressing tables, sized to keep the load factor at most one half of the capacity.
+     */
+    int64_t indexSize = 8;
+    while(indexSize < 2 * mColumn->mergeCellCapacity) {
+        indexSize *= 2;
+    }
+    if(indexSize != mColumn->mergeCellIndexSize) {
+        free(mColumn->mergeCellsFrom);
+        free(mColumn->mergeCellsTo);
+        mColumn->mergeCellsFrom = st_malloc(sizeof(int64_t) * indexSize);
+        mColumn->mergeCellsTo = st_malloc(sizeof(int64_t) * indexSize);
+        mColumn->mergeCellIndexSize = indexSize;
+    }
+    memset(mColumn->mergeCellsFrom, -1, sizeof(int64_t) * indexSize);
+    memset(mColumn->mergeCellsTo, -1, sizeof(int64_t) * indexSize);
+    for(int64_t i=0; i<mColumn->mergeCellNo; i++) {
+        stRPMergeCell *mCell = &mColumn->mergeCells[i];
+        *getMergeCellSlot(mColumn->mergeCellsFrom, indexSize, mColumn->mergeCells, mCell->fromPartition, 1) = i;
+        *getMergeCellSlot(mColumn->mergeCellsTo, indexSize, mColumn->mergeCells, mCell->toPartition, 0) = i;
+    }
 }
 
 stRPMergeColumn *stRPMergeColumn_construct(uint64_t maskFrom, uint64_t maskTo) {
@@ -24,15 +62,17 @@ stRPMergeColumn *stRPMergeColumn_construct(uint64_t maskFrom, uint64_t maskTo) {
     mColumn->maskTo = maskTo;
 
     // Maps between partitions and cells
-    mColumn->mergeCellsFrom = stHash_construct3(intHashFn, intEqualsFn, NULL, (void (*)(void *))stRPMergeCell_destruct);
-    mColumn->mergeCellsTo = stHash_construct3(intHashFn, intEqualsFn, NULL, NULL);
+    mColumn->mergeCellCapacity = 2;
+    mColumn->mergeCells = st_malloc(sizeof(stRPMergeCell) * mColumn->mergeCellCapacity);
+    reindexMergeCells(mColumn);
 
     return mColumn;
 }
 
 void stRPMergeColumn_destruct(stRPMergeColumn *mColumn) {
-    stHash_destruct(mColumn->mergeCellsFrom);
-    stHash_destruct(mColumn->mergeCellsTo);
+    free(mColumn->mergeCells);
+    free(mColumn->mergeCellsFrom);
+    free(mColumn->mergeCellsTo);
     free(mColumn);
 }
 
@@ -44,18 +84,14 @@ void stRPMergeColumn_print(stRPMergeColumn *mColumn, FILE *fileHandle, bool incl
     char *maskToString = intToBinaryString(mColumn->maskTo);
     fprintf(fileHandle, "\tMERGE_COLUMN MASK_FROM: %s MASK_TO: %s"
             " DEPTH: %" PRIi64 "\n", maskFromString, maskToString,
-            stHash_size(mColumn->mergeCellsFrom));
-    assert(stHash_size(mColumn->mergeCellsFrom) == stHash_size(mColumn->mergeCellsTo));
+            mColumn->mergeCellNo);
     free(maskFromString);
     free(maskToString);
     if(includeCells) {
-        stHashIterator *it = stHash_getIterator(mColumn->mergeCellsFrom);
-        stRPMergeCell *mCell;
-        while((mCell = stHash_getNext(it)) != NULL) {
+        for(int64_t i=0; i<mColumn->mergeCellNo; i++) {
             fprintf(fileHandle, "\t\t");
-            stRPMergeCell_print(mCell, fileHandle);
+            stRPMergeCell_print(&mColumn->mergeCells[i], fileHandle);
         }
-        stHash_destructIterator(it);
     }
 }
 
@@ -64,8 +100,9 @@ stRPMergeCell *stRPMergeColumn_getNextMergeCell(stRPCell *cell, stRPMergeColumn
      * Get the merge cell that this cell feeds into.
      */
     uint64_t i = maskPartition(cell->partition, mergeColumn->maskFrom);
-    stRPMergeCell *mCell = stHash_search(mergeColumn->mergeCellsFrom, &i);
-    return mCell;
+    int64_t j = *getMergeCellSlot(mergeColumn->mergeCellsFrom, mergeColumn->mergeCellIndexSize,
+            mergeColumn->mergeCells, i, 1);
+    return j == -1 ? NULL : &mergeColumn->mergeCells[j];
 }
 
 stRPMergeCell *stRPMergeColumn_getPreviousMergeCell(stRPCell *cell, stRPMergeColumn *mergeColumn) {
@@ -73,15 +110,31 @@ stRPMergeCell *stRPMergeColumn_getPreviousMergeCell(stRPCell *cell, stRPMergeCol
      * Get the merge cell that this cell feeds from.
      */
     uint64_t i = maskPartition(cell->partition,  mergeColumn->maskTo);
-    stRPMergeCell *mCell = stHash_search(mergeColumn->mergeCellsTo, &i);
-    return mCell;
+    int64_t j = *getMergeCellSlot(mergeColumn->mergeCellsTo, mergeColumn->mergeCellIndexSize,
+            mergeColumn->mergeCells, i, 0);
+    return j == -1 ? NULL : &mergeColumn->mergeCells[j];
 }
 
 int64_t stRPMergeColumn_numberOfPartitions(stRPMergeColumn *mColumn) {
     /*
      * Returns the number of cells in the column.
      */
-    return stHash_size(mColumn->mergeCellsFrom);
+    return mColumn->mergeCellNo;
+}
+
+void stRPMergeColumn_retainMergeCells(stRPMergeColumn *mColumn, stSet *mergeCellsToRetain) {
+    /*
+     * Removes the merge cells that are not in mergeCellsToRetain, compacting the remaining
+     * merge cells in place. Pointers to merge cells of the column are invalidated.
+     */
+    int64_t j = 0;
+    for(int64_t i=0; i<mColumn->mergeCellNo; i++) {
+        if(stSet_search(mergeCellsToRetain, &mColumn->mergeCells[i]) != NULL) {
+            mColumn->mergeCells[j++] = mColumn->mergeCells[i];
+        }
+    }
+    mColumn->mergeCellNo = j;
+    reindexMergeCells(mColumn);
 }
 
 /*
@@ -97,20 +150,33 @@ stRPMergeCell *stRPMergeCell_construct(uint64_t fromPartition, uint64_t toPartit
     assert(popcount64(mColumn->maskFrom) == popcount64(mColumn->maskTo));
     assert(popcount64(fromPartition) <= popcount64(mColumn->maskFrom));
 
-    stRPMergeCell *mCell = st_calloc(1, sizeof(stRPMergeCell));
+    // Grow the merge cells, which invalidates pointers to the existing merge cells
+    if(mColumn->mergeCellNo == mColumn->mergeCellCapacity) {
+        mColumn->mergeCellCapacity *= 2;
+        mColumn->mergeCells = realloc(mColumn->mergeCells, sizeof(stRPMergeCell) * mColumn->mergeCellCapacity);
+        if(mColumn->mergeCells == NULL) {
+            st_errAbort("Failed to allocate %" PRIi64 " merge cells for a merge column", mColumn->mergeCellCapacity);
+        }
+        reindexMergeCells(mColumn);
+    }
+
+    int64_t i = mColumn->mergeCellNo++;
+    stRPMergeCell *mCell = &mColumn->mergeCells[i];
     mCell->fromPartition = fromPartition;
     mCell->toPartition = toPartition;
-    assert(stHash_search(mColumn->mergeCellsFrom, &mCell->fromPartition) == NULL);
-    stHash_insert(mColumn->mergeCellsFrom, &mCell->fromPartition, mCell);
-    assert(stHash_search(mColumn->mergeCellsTo, &mCell->toPartition) == NULL);
-    stHash_insert(mColumn->mergeCellsTo, &mCell->toPartition, mCell);
+    mCell->forwardLogProb = 0.0;
+    mCell->backwardLogProb = 0.0;
+    int64_t *fromSlot = getMergeCellSlot(mColumn->mergeCellsFrom, mColumn->mergeCellIndexSize,
+            mColumn->mergeCells, fromPartition, 1);
+    assert(*fromSlot == -1);
+    *fromSlot = i;
+    int64_t *toSlot = getMergeCellSlot(mColumn->mergeCellsTo, mColumn->mergeCellIndexSize,
+            mColumn->mergeCells, toPartition, 0);
+    assert(*toSlot == -1);
+    *toSlot = i;
     return mCell;
 }
 
-void stRPMergeCell_destruct(stRPMergeCell *mCell) {
-    free(mCell);
-}
-
 void stRPMergeCell_print(stRPMergeCell *mCell, FILE *fileHandle) {
     /*
      * Prints a debug representation of the cell.
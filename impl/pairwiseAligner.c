@@ -541,6 +541,7 @@ static void diagonalCalculation(StateMachine *sM, DpDiagonal *dpDiagonal, DpDiag
         const SymbolString sX, const SymbolString sY,
         void (*cellCalculation)(StateMachine *, double *, double *, double *, double *, Symbol, Symbol, void *), void *extraArgs) {
     Diagonal diagonal = dpDiagonal->diagonal;
+    HOT_PATH_COUNT(HOT_PATH_COUNTER_DP_CELLS, (diagonal_getMaxXmy(diagonal) - diagonal_getMinXmy(diagonal)) / 2 + 1);
     int64_t xmy = diagonal_getMinXmy(diagonal);
     while (xmy <= diagonal_getMaxXmy(diagonal)) {
         Symbol x = getXCharacter(sX, diagonal_getXay(diagonal), xmy);
@@ -585,6 +586,7 @@ double diagonalCalculationTotalProbability(StateMachine *sM, int64_t xay, DpMatr
 
 void addPosteriorProb(int64_t x, int64_t y, double posteriorProbability, stList *posteriorProbs, PairwiseAlignmentParameters *p) {
 	if (posteriorProbability >= p->threshold) {
+		HOT_PATH_COUNT(HOT_PATH_COUNTER_POSTERIOR_PAIRS, 1);
 		if (posteriorProbability > 1.0) {
 			posteriorProbability = 1.0;
 		}
@@ -819,6 +821,7 @@ double computeForwardProbability(SymbolString sX, SymbolString sY, stList *ancho
     assert(p->minDiagsBetweenTraceBack >= 2);
     assert(p->traceBackDiagonals + 1 < p->minDiagsBetweenTraceBack);
 
+    HOT_PATH_COUNT(HOT_PATH_COUNTER_FORWARD_PROBABILITY_CALLS, 1);
     int64_t diagonalNumber = sX.length + sY.length;
     if (diagonalNumber == 0) { //Deal with trivial case
         return LOG_ONE;
@@ -839,6 +842,8 @@ double computeForwardProbability(SymbolString sX, SymbolString sY, stList *ancho
         //Forward calculation
         dpDiagonal_zeroValues(dpMatrix_createDiagonal(forwardDpMatrix, diagonal));
         diagonalCalculationForward(sM, diagonal_getXay(diagonal), forwardDpMatrix, sX, sY);
+        HOT_PATH_COUNT(HOT_PATH_COUNTER_FORWARD_PROBABILITY_CELLS,
+                       (diagonal_getMaxXmy(diagonal) - diagonal_getMinXmy(diagonal)) / 2 + 1);
 
         bool atEnd = diagonal_getXay(diagonal) == diagonalNumber; //Condition true at the end of the matrix
         if (atEnd) {
@@ -5,6 +5,9 @@
  */
 
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "margin.h"
 
 /*
@@ -22,6 +25,7 @@ stRPHmmParameters *stRPHmmParameters_construct() {
 	params->minPartitionsInAColumn = 50;
 	params->maxPartitionsInAColumn = 200;
 	params->minPosteriorProbabilityForPartition = 0.001;
+	params->beamWidth = 0;
 	params->minReadCoverageToSupportPhasingBetweenHeterozygousSites = 0;
 
 	// Other marginPhase program options
@@ -60,6 +64,12 @@ stRPHmmParameters *parseParameters_fromJson(char *buf, size_t r) {
         else if (strcmp(keyString, "minPosteriorProbabilityForPartition") == 0) {
         	params->minPosteriorProbabilityForPartition = stJson_parseFloat(js, tokens, ++i);
         }
+        else if (strcmp(keyString, "beamWidth") == 0) {
+        	params->beamWidth = stJson_parseInt(js, tokens, ++i);
+        	if (params->beamWidth < 0) {
+        		st_errAbort("ERROR: beamWidth must be non-negative, got: %" PRIi64 "\n", params->beamWidth);
+        	}
+        }
         else if (strcmp(keyString, "maxCoverageDepth") == 0) {
         	params->maxCoverageDepth = stJson_parseInt(js, tokens, ++i);
         }
@@ -179,6 +189,7 @@ PolishParams *polishParams_jsonParse(char *buf, size_t r) {
     params->candidateVariantWeight = 0.2;
     params->columnAnchorTrim = 5;
     params->maxConsensusStrings = 100;
+    params->forwardScoreCacheMaxMemory = 1 << 28;
     params->repeatSubMatrix = NULL;
     params->stateMachineForGenomeComparison = stateMachine3_constructNucleotide(threeStateAsymmetric);
     params->useReadAlleles = 1;
@@ -308,6 +319,11 @@ PolishParams *polishParams_jsonParse(char *buf, size_t r) {
 				st_errAbort("ERROR: maxConsensusStrings parameter must zero or greater\n");
 			}
 			params->maxConsensusStrings = (uint64_t) stJson_parseInt(js, tokens, tokenIndex);
+		} else if (strcmp(keyString, "forwardScoreCacheMaxMemory") == 0) {
+			if (stJson_parseInt(js, tokens, ++tokenIndex) < 0) {
+				st_errAbort("ERROR: forwardScoreCacheMaxMemory parameter must zero or greater\n");
+			}
+			params->forwardScoreCacheMaxMemory = (uint64_t) stJson_parseInt(js, tokens, tokenIndex);
 		} else if (strcmp(keyString, "maxPoaConsensusIterations") == 0) {
 			if (stJson_parseInt(js, tokens, ++tokenIndex) < 0) {
 				st_errAbort("ERROR: maxPoaConsensusIterations parameter must zero or greater\n");
@@ -500,6 +516,397 @@ Params *params_jsonParse(char *buf, size_t r, bool requirePolish, bool requirePh
 	return params;
 }
 
+/*
+ * Compiled params objects
+ */
+
+typedef struct _paramsCompiledBuffer {
+	char *bytes;
+	size_t length;
+	size_t capacity;
+} ParamsCompiledBuffer;
+
+typedef struct _paramsCompiledReader {
+	const char *bytes;
+	size_t length;
+	size_t offset;
+	char *paramsFile;
+} ParamsCompiledReader;
+
+static uint64_t params_compiledChecksum(const char *bytes, size_t length) {
+	// 64 bit FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++) {
+		h ^= (uint8_t) bytes[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static void paramsCompiledBuffer_write(ParamsCompiledBuffer *buffer, const void *data, size_t size) {
+	if (buffer->length + size > buffer->capacity) {
+		buffer->capacity = 2 * (buffer->length + size);
+		buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+	}
+	memcpy(buffer->bytes + buffer->length, data, size);
+	buffer->length += size;
+}
+
+static void paramsCompiledBuffer_writeInt(ParamsCompiledBuffer *buffer, int64_t i) {
+	paramsCompiledBuffer_write(buffer, &i, sizeof(int64_t));
+}
+
+static void paramsCompiledBuffer_writeFloat(ParamsCompiledBuffer *buffer, double f) {
+	paramsCompiledBuffer_write(buffer, &f, sizeof(double));
+}
+
+static void paramsCompiledBuffer_writeFloatArray(ParamsCompiledBuffer *buffer, double *f, int64_t length) {
+	paramsCompiledBuffer_writeInt(buffer, length);
+	paramsCompiledBuffer_write(buffer, f, length * sizeof(double));
+}
+
+static void paramsCompiledReader_read(ParamsCompiledReader *reader, void *data, size_t size) {
+	if (reader->offset + size > reader->length) {
+		st_errAbort("ERROR: Compiled parameters file %s is truncated\n", reader->paramsFile);
+	}
+	memcpy(data, reader->bytes + reader->offset, size);
+	reader->offset += size;
+}
+
+static int64_t paramsCompiledReader_readInt(ParamsCompiledReader *reader) {
+	int64_t i;
+	paramsCompiledReader_read(reader, &i, sizeof(int64_t));
+	return i;
+}
+
+static double paramsCompiledReader_readFloat(ParamsCompiledReader *reader) {
+	double f;
+	paramsCompiledReader_read(reader, &f, sizeof(double));
+	return f;
+}
+
+static void paramsCompiledReader_readFloatArray(ParamsCompiledReader *reader, double *f, int64_t expectedLength) {
+	int64_t length = paramsCompiledReader_readInt(reader);
+	if (length != expectedLength) {
+		st_errAbort("ERROR: Compiled parameters file %s has an array of length %" PRIi64 " where %" PRIi64
+				" was expected, recompile it with this version of the program\n", reader->paramsFile, length, expectedLength);
+	}
+	paramsCompiledReader_read(reader, f, length * sizeof(double));
+}
+
+static double *paramsCompiledReader_readNewFloatArray(ParamsCompiledReader *reader, int64_t *length) {
+	*length = paramsCompiledReader_readInt(reader);
+	if (*length < 0 || *length > (reader->length - reader->offset) / sizeof(double)) {
+		st_errAbort("ERROR: Compiled parameters file %s is corrupt\n", reader->paramsFile);
+	}
+	double *f = st_calloc(*length, sizeof(double));
+	paramsCompiledReader_read(reader, f, *length * sizeof(double));
+	return f;
+}
+
+static void stateMachine_writeCompiled(ParamsCompiledBuffer *buffer, StateMachine *sM) {
+	/*
+	 * Writes the transitions and the nucleotide emission tables of a read or haplotype state machine. The run
+	 * length emissions wrap the nucleotide emissions and the repeat sub matrix, so are rebuilt on loading.
+	 */
+	double transitions[STATE_MACHINE3_TRANSITION_NUMBER];
+	stateMachine3_getTransitions(sM, transitions);
+	NucleotideEmissions *ne = (NucleotideEmissions *) sM->emissions;
+	paramsCompiledBuffer_writeInt(buffer, sM->type);
+	paramsCompiledBuffer_writeFloatArray(buffer, transitions, STATE_MACHINE3_TRANSITION_NUMBER);
+	paramsCompiledBuffer_writeFloatArray(buffer, ne->EMISSION_MATCH_PROBS, 16);
+	paramsCompiledBuffer_writeFloatArray(buffer, ne->EMISSION_GAP_X_PROBS, 4);
+	paramsCompiledBuffer_writeFloatArray(buffer, ne->EMISSION_GAP_Y_PROBS, 4);
+}
+
+static StateMachine *stateMachine_readCompiled(ParamsCompiledReader *reader) {
+	StateMachineType type = paramsCompiledReader_readInt(reader);
+	if (type != threeState && type != threeStateAsymmetric) {
+		st_errAbort("ERROR: Unrecognised state machine type in compiled parameters file %s: %i\n", reader->paramsFile, (int) type);
+	}
+	StateMachine *sM = stateMachine3_constructNucleotide(type);
+	double transitions[STATE_MACHINE3_TRANSITION_NUMBER];
+	paramsCompiledReader_readFloatArray(reader, transitions, STATE_MACHINE3_TRANSITION_NUMBER);
+	stateMachine3_setTransitions(sM, transitions);
+	NucleotideEmissions *ne = (NucleotideEmissions *) sM->emissions;
+	paramsCompiledReader_readFloatArray(reader, ne->EMISSION_MATCH_PROBS, 16);
+	paramsCompiledReader_readFloatArray(reader, ne->EMISSION_GAP_X_PROBS, 4);
+	paramsCompiledReader_readFloatArray(reader, ne->EMISSION_GAP_Y_PROBS, 4);
+	return sM;
+}
+
+static void polishParams_writeCompiled(ParamsCompiledBuffer *buffer, PolishParams *params) {
+	paramsCompiledBuffer_writeInt(buffer, params->useRunLengthEncoding);
+	paramsCompiledBuffer_writeInt(buffer, params->alphabet->alphabetSize);
+	stateMachine_writeCompiled(buffer, params->stateMachineForGenomeComparison);
+	stateMachine_writeCompiled(buffer, params->stateMachineForForwardStrandRead);
+	stateMachine_writeCompiled(buffer, params->stateMachineForReverseStrandRead);
+
+	PairwiseAlignmentParameters *p = params->p;
+	paramsCompiledBuffer_writeFloat(buffer, p->threshold);
+	paramsCompiledBuffer_writeInt(buffer, p->minDiagsBetweenTraceBack);
+	paramsCompiledBuffer_writeInt(buffer, p->traceBackDiagonals);
+	paramsCompiledBuffer_writeInt(buffer, p->diagonalExpansion);
+	paramsCompiledBuffer_writeInt(buffer, p->constraintDiagonalTrim);
+	paramsCompiledBuffer_writeInt(buffer, p->splitMatrixBiggerThanThis);
+	paramsCompiledBuffer_writeInt(buffer, p->alignAmbiguityCharacters);
+	paramsCompiledBuffer_writeFloat(buffer, p->gapGamma);
+	paramsCompiledBuffer_writeInt(buffer, p->dynamicAnchorExpansion);
+
+	RepeatSubMatrix *repeatSubMatrix = params->repeatSubMatrix;
+	paramsCompiledBuffer_writeInt(buffer, repeatSubMatrix != NULL);
+	if (repeatSubMatrix != NULL) {
+		paramsCompiledBuffer_writeFloatArray(buffer, repeatSubMatrix->baseLogProbs_AT, repeatSubMatrix->maximumRepeatLength);
+		paramsCompiledBuffer_writeFloatArray(buffer, repeatSubMatrix->baseLogProbs_GC, repeatSubMatrix->maximumRepeatLength);
+		paramsCompiledBuffer_writeFloatArray(buffer, repeatSubMatrix->logProbabilities, repeatSubMatrix->maxEntry);
+	}
+
+	paramsCompiledBuffer_writeInt(buffer, params->useRepeatCountsInAlignment);
+	paramsCompiledBuffer_writeInt(buffer, params->useReadAlleles);
+	paramsCompiledBuffer_writeInt(buffer, params->useReadAllelesInPhasing);
+	paramsCompiledBuffer_writeInt(buffer, params->shuffleChunks);
+	paramsCompiledBuffer_writeInt(buffer, params->includeSoftClipping);
+	paramsCompiledBuffer_writeInt(buffer, params->chunkSize);
+	paramsCompiledBuffer_writeInt(buffer, params->chunkBoundary);
+	paramsCompiledBuffer_writeInt(buffer, params->maxDepth);
+	paramsCompiledBuffer_writeInt(buffer, params->includeSecondaryAlignments);
+	paramsCompiledBuffer_writeInt(buffer, params->includeSupplementaryAlignments);
+	paramsCompiledBuffer_writeInt(buffer, params->filterAlignmentsWithMapQBelowThisThreshold);
+	paramsCompiledBuffer_writeFloat(buffer, params->candidateVariantWeight);
+	paramsCompiledBuffer_writeInt(buffer, params->columnAnchorTrim);
+	paramsCompiledBuffer_writeInt(buffer, params->maxConsensusStrings);
+	paramsCompiledBuffer_writeInt(buffer, params->maxPoaConsensusIterations);
+	paramsCompiledBuffer_writeInt(buffer, params->minPoaConsensusIterations);
+	paramsCompiledBuffer_writeInt(buffer, params->maxRealignmentPolishIterations);
+	paramsCompiledBuffer_writeInt(buffer, params->minRealignmentPolishIterations);
+	paramsCompiledBuffer_writeInt(buffer, params->minReadsToCallConsensus);
+	paramsCompiledBuffer_writeInt(buffer, params->forwardScoreCacheMaxMemory);
+	paramsCompiledBuffer_writeInt(buffer, params->filterReadsWhileHaveAtLeastThisCoverage);
+	paramsCompiledBuffer_writeFloat(buffer, params->minAvgBaseQuality);
+	paramsCompiledBuffer_writeFloat(buffer, params->hetSubstitutionProbability);
+	paramsCompiledBuffer_writeFloat(buffer, params->hetRunLengthSubstitutionProbability);
+	paramsCompiledBuffer_writeInt(buffer, params->poaConstructCompareRepeatCounts);
+	paramsCompiledBuffer_writeFloat(buffer, params->referenceBasePenalty);
+	paramsCompiledBuffer_writeFloatArray(buffer, params->minPosteriorProbForAlignmentAnchors,
+			params->minPosteriorProbForAlignmentAnchorsLength);
+}
+
+static PolishParams *polishParams_readCompiled(ParamsCompiledReader *reader) {
+	PolishParams *params = st_calloc(1, sizeof(PolishParams));
+
+	params->useRunLengthEncoding = paramsCompiledReader_readInt(reader);
+	params->alphabet = alphabet_constructNucleotide();
+	int64_t alphabetSize = paramsCompiledReader_readInt(reader);
+	if (alphabetSize != params->alphabet->alphabetSize) {
+		st_errAbort("ERROR: Unrecognised alphabet of size %" PRIi64 " in compiled parameters file %s\n",
+				alphabetSize, reader->paramsFile);
+	}
+	params->stateMachineForGenomeComparison = stateMachine_readCompiled(reader);
+	params->stateMachineForForwardStrandRead = stateMachine_readCompiled(reader);
+	params->stateMachineForReverseStrandRead = stateMachine_readCompiled(reader);
+
+	PairwiseAlignmentParameters *p = pairwiseAlignmentBandingParameters_construct();
+	p->threshold = paramsCompiledReader_readFloat(reader);
+	p->minDiagsBetweenTraceBack = paramsCompiledReader_readInt(reader);
+	p->traceBackDiagonals = paramsCompiledReader_readInt(reader);
+	p->diagonalExpansion = paramsCompiledReader_readInt(reader);
+	p->constraintDiagonalTrim = paramsCompiledReader_readInt(reader);
+	p->splitMatrixBiggerThanThis = paramsCompiledReader_readInt(reader);
+	p->alignAmbiguityCharacters = paramsCompiledReader_readInt(reader);
+	p->gapGamma = paramsCompiledReader_readFloat(reader);
+	p->dynamicAnchorExpansion = paramsCompiledReader_readInt(reader);
+	params->p = p;
+
+	if (paramsCompiledReader_readInt(reader)) {
+		RepeatSubMatrix *repeatSubMatrix = repeatSubMatrix_constructEmpty(alphabet_constructNucleotide());
+		paramsCompiledReader_readFloatArray(reader, repeatSubMatrix->baseLogProbs_AT, repeatSubMatrix->maximumRepeatLength);
+		paramsCompiledReader_readFloatArray(reader, repeatSubMatrix->baseLogProbs_GC, repeatSubMatrix->maximumRepeatLength);
+		paramsCompiledReader_readFloatArray(reader, repeatSubMatrix->logProbabilities, repeatSubMatrix->maxEntry);
+		params->repeatSubMatrix = repeatSubMatrix;
+	}
+
+	params->useRepeatCountsInAlignment = paramsCompiledReader_readInt(reader);
+	params->useReadAlleles = paramsCompiledReader_readInt(reader);
+	params->useReadAllelesInPhasing = paramsCompiledReader_readInt(reader);
+	params->shuffleChunks = paramsCompiledReader_readInt(reader);
+	params->includeSoftClipping = paramsCompiledReader_readInt(reader);
+	params->chunkSize = paramsCompiledReader_readInt(reader);
+	params->chunkBoundary = paramsCompiledReader_readInt(reader);
+	params->maxDepth = paramsCompiledReader_readInt(reader);
+	params->includeSecondaryAlignments = paramsCompiledReader_readInt(reader);
+	params->includeSupplementaryAlignments = paramsCompiledReader_readInt(reader);
+	params->filterAlignmentsWithMapQBelowThisThreshold = paramsCompiledReader_readInt(reader);
+	params->candidateVariantWeight = paramsCompiledReader_readFloat(reader);
+	params->columnAnchorTrim = paramsCompiledReader_readInt(reader);
+	params->maxConsensusStrings = paramsCompiledReader_readInt(reader);
+	params->maxPoaConsensusIterations = paramsCompiledReader_readInt(reader);
+	params->minPoaConsensusIterations = paramsCompiledReader_readInt(reader);
+	params->maxRealignmentPolishIterations = paramsCompiledReader_readInt(reader);
+	params->minRealignmentPolishIterations = paramsCompiledReader_readInt(reader);
+	params->minReadsToCallConsensus = paramsCompiledReader_readInt(reader);
+	params->forwardScoreCacheMaxMemory = paramsCompiledReader_readInt(reader);
+	params->filterReadsWhileHaveAtLeastThisCoverage = paramsCompiledReader_readInt(reader);
+	params->minAvgBaseQuality = paramsCompiledReader_readFloat(reader);
+	params->hetSubstitutionProbability = paramsCompiledReader_readFloat(reader);
+	params->hetRunLengthSubstitutionProbability = paramsCompiledReader_readFloat(reader);
+	params->poaConstructCompareRepeatCounts = paramsCompiledReader_readInt(reader);
+	params->referenceBasePenalty = paramsCompiledReader_readFloat(reader);
+	params->minPosteriorProbForAlignmentAnchors = paramsCompiledReader_readNewFloatArray(reader,
+			&params->minPosteriorProbForAlignmentAnchorsLength);
+
+	// Replace the emission models of the read to reference state machines, as in polishParams_jsonParse
+	if (params->useRepeatCountsInAlignment) {
+		params->stateMachineForForwardStrandRead->emissions = rleNucleotideEmissions_construct(params->stateMachineForForwardStrandRead->emissions, params->repeatSubMatrix, 1);
+		params->stateMachineForReverseStrandRead->emissions = rleNucleotideEmissions_construct(params->stateMachineForReverseStrandRead->emissions, params->repeatSubMatrix, 0);
+	}
+
+	return params;
+}
+
+static void phaseParams_writeCompiled(ParamsCompiledBuffer *buffer, stRPHmmParameters *params) {
+	paramsCompiledBuffer_writeInt(buffer, params->maxNotSumTransitions);
+	paramsCompiledBuffer_writeInt(buffer, params->minPartitionsInAColumn);
+	paramsCompiledBuffer_writeInt(buffer, params->maxPartitionsInAColumn);
+	paramsCompiledBuffer_writeFloat(buffer, params->minPosteriorProbabilityForPartition);
+	paramsCompiledBuffer_writeInt(buffer, params->beamWidth);
+	paramsCompiledBuffer_writeInt(buffer, params->maxCoverageDepth);
+	paramsCompiledBuffer_writeInt(buffer, params->minReadCoverageToSupportPhasingBetweenHeterozygousSites);
+	paramsCompiledBuffer_writeInt(buffer, params->includeInvertedPartitions);
+	paramsCompiledBuffer_writeInt(buffer, params->roundsOfIterativeRefinement);
+	paramsCompiledBuffer_writeInt(buffer, params->includeAncestorSubProb);
+}
+
+static stRPHmmParameters *phaseParams_readCompiled(ParamsCompiledReader *reader) {
+	stRPHmmParameters *params = stRPHmmParameters_construct();
+	params->maxNotSumTransitions = paramsCompiledReader_readInt(reader);
+	params->minPartitionsInAColumn = paramsCompiledReader_readInt(reader);
+	params->maxPartitionsInAColumn = paramsCompiledReader_readInt(reader);
+	params->minPosteriorProbabilityForPartition = paramsCompiledReader_readFloat(reader);
+	params->beamWidth = paramsCompiledReader_readInt(reader);
+	params->maxCoverageDepth = paramsCompiledReader_readInt(reader);
+	params->minReadCoverageToSupportPhasingBetweenHeterozygousSites = paramsCompiledReader_readInt(reader);
+	params->includeInvertedPartitions = paramsCompiledReader_readInt(reader);
+	params->roundsOfIterativeRefinement = paramsCompiledReader_readInt(reader);
+	params->includeAncestorSubProb = paramsCompiledReader_readInt(reader);
+	return params;
+}
+
+void params_writeCompiled(Params *params, char *outputFile) {
+	/*
+	 * The file is a fixed header (magic, version, byte order mark, payload length and a checksum of the
+	 * payload) followed by the payload: the polish and phase sections, each prefixed by its length in bytes
+	 * (zero if absent), written as native int64 and double values in a fixed order.
+	 */
+	ParamsCompiledBuffer buffer = { NULL, 0, 0 };
+	for (int64_t section = 0; section < 2; section++) {
+		size_t lengthOffset = buffer.length;
+		paramsCompiledBuffer_writeInt(&buffer, 0);
+		if (section == 0 && params->polishParams != NULL) {
+			polishParams_writeCompiled(&buffer, params->polishParams);
+		} else if (section == 1 && params->phaseParams != NULL) {
+			phaseParams_writeCompiled(&buffer, params->phaseParams);
+		}
+		int64_t sectionLength = buffer.length - lengthOffset - sizeof(int64_t);
+		memcpy(buffer.bytes + lengthOffset, &sectionLength, sizeof(int64_t));
+	}
+
+	uint32_t version = PARAMS_COMPILED_VERSION;
+	uint32_t byteOrderMark = PARAMS_COMPILED_BYTE_ORDER_MARK;
+	uint64_t payloadLength = buffer.length;
+	uint64_t checksum = params_compiledChecksum(buffer.bytes, buffer.length);
+
+	FILE *fh = fopen(outputFile, "wb");
+	if (fh == NULL) {
+		st_errAbort("ERROR: Cannot open compiled parameters file %s for writing\n", outputFile);
+	}
+	if (fwrite(PARAMS_COMPILED_MAGIC, sizeof(char), PARAMS_COMPILED_MAGIC_LENGTH, fh) != PARAMS_COMPILED_MAGIC_LENGTH ||
+		fwrite(&version, sizeof(uint32_t), 1, fh) != 1 ||
+		fwrite(&byteOrderMark, sizeof(uint32_t), 1, fh) != 1 ||
+		fwrite(&payloadLength, sizeof(uint64_t), 1, fh) != 1 ||
+		fwrite(&checksum, sizeof(uint64_t), 1, fh) != 1 ||
+		fwrite(buffer.bytes, sizeof(char), buffer.length, fh) != buffer.length) {
+		st_errAbort("ERROR: Failed to write compiled parameters file %s\n", outputFile);
+	}
+	fclose(fh);
+	free(buffer.bytes);
+}
+
+Params *params_readCompiled(char *paramsFile, bool requirePolish, bool requirePhase) {
+	/*
+	 * Maps the file and checks the header and checksum before loading the sections that are required.
+	 */
+	int fd = open(paramsFile, O_RDONLY);
+	if (fd < 0) {
+		st_errAbort("ERROR: Cannot open parameters file %s\n", paramsFile);
+	}
+	struct stat st;
+	fstat(fd, &st);
+	size_t headerLength = PARAMS_COMPILED_MAGIC_LENGTH + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	if (st.st_size < (off_t) headerLength) {
+		st_errAbort("ERROR: Compiled parameters file %s is truncated\n", paramsFile);
+	}
+	char *bytes = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (bytes == MAP_FAILED) {
+		st_errAbort("ERROR: Cannot map compiled parameters file %s\n", paramsFile);
+	}
+	close(fd);
+
+	ParamsCompiledReader reader = { bytes, headerLength, 0, paramsFile };
+	char magic[PARAMS_COMPILED_MAGIC_LENGTH];
+	paramsCompiledReader_read(&reader, magic, PARAMS_COMPILED_MAGIC_LENGTH);
+	uint32_t version, byteOrderMark;
+	uint64_t payloadLength, checksum;
+	paramsCompiledReader_read(&reader, &version, sizeof(uint32_t));
+	paramsCompiledReader_read(&reader, &byteOrderMark, sizeof(uint32_t));
+	paramsCompiledReader_read(&reader, &payloadLength, sizeof(uint64_t));
+	paramsCompiledReader_read(&reader, &checksum, sizeof(uint64_t));
+	if (memcmp(magic, PARAMS_COMPILED_MAGIC, PARAMS_COMPILED_MAGIC_LENGTH) != 0) {
+		st_errAbort("ERROR: %s is not a compiled parameters file\n", paramsFile);
+	}
+	if (byteOrderMark != PARAMS_COMPILED_BYTE_ORDER_MARK) {
+		st_errAbort("ERROR: Compiled parameters file %s was written on a machine with a different byte order\n", paramsFile);
+	}
+	if (version != PARAMS_COMPILED_VERSION) {
+		st_errAbort("ERROR: Compiled parameters file %s has version %" PRIu32 " but version %d is required, "
+				"recompile it from the json parameters\n", paramsFile, version, PARAMS_COMPILED_VERSION);
+	}
+	if (payloadLength != (uint64_t) st.st_size - headerLength ||
+		params_compiledChecksum(bytes + headerLength, payloadLength) != checksum) {
+		st_errAbort("ERROR: Compiled parameters file %s is truncated or corrupt\n", paramsFile);
+	}
+
+	Params *params = st_calloc(1, sizeof(Params));
+	reader.length = st.st_size;
+	for (int64_t section = 0; section < 2; section++) {
+		int64_t sectionLength = paramsCompiledReader_readInt(&reader);
+		size_t sectionEnd = reader.offset + sectionLength;
+		bool required = section == 0 ? requirePolish : requirePhase;
+		if (sectionLength < 0 || sectionEnd > reader.length) {
+			st_errAbort("ERROR: Compiled parameters file %s is corrupt\n", paramsFile);
+		}
+		if (sectionLength == 0) {
+			if (required) {
+				st_errAbort("ERROR: Did not find %s parameters in compiled parameters file %s\n",
+						section == 0 ? "polish" : "phase", paramsFile);
+			}
+		} else if (required) {
+			if (section == 0) {
+				params->polishParams = polishParams_readCompiled(&reader);
+			} else {
+				params->phaseParams = phaseParams_readCompiled(&reader);
+			}
+		}
+		if (required && reader.offset != sectionEnd) {
+			st_errAbort("ERROR: Compiled parameters file %s is corrupt\n", paramsFile);
+		}
+		reader.offset = sectionEnd;
+	}
+
+	munmap(bytes, st.st_size);
+
+	return params;
+}
+
 Params *params_readParams(char *paramsFile) {
     return params_readParams2(paramsFile, TRUE, TRUE);
 }
@@ -514,6 +921,16 @@ Params *params_readParams2(char *paramsFile, bool requirePolish, bool requirePha
     struct stat st;
     fstat(fileno(fh), &st);
 
+    // compiled parameters are mapped rather than parsed
+    char magic[PARAMS_COMPILED_MAGIC_LENGTH];
+    if (st.st_size >= PARAMS_COMPILED_MAGIC_LENGTH &&
+        fread(magic, sizeof(char), PARAMS_COMPILED_MAGIC_LENGTH, fh) == PARAMS_COMPILED_MAGIC_LENGTH &&
+        memcmp(magic, PARAMS_COMPILED_MAGIC, PARAMS_COMPILED_MAGIC_LENGTH) == 0) {
+        fclose(fh);
+        return params_readCompiled(paramsFile, requirePolish, requirePhase);
+    }
+    rewind(fh);
+
     // read file and parse json
     char *buf = st_calloc(st.st_size + 1, sizeof(char));
     size_t readLen = fread(buf, sizeof(char), st.st_size , fh);
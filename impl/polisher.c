@@ -166,12 +166,67 @@ int cmpAlignedPairsByInvertedCoordinates(const void *a, const void *b) {
 	return i;
 }
 
-bool isMatch(stSortedSet *matchesSet, int64_t x, int64_t y) {
-	stIntTuple pair[4];
-	pair[0] = 3;
-	pair[2] = x;
-	pair[3] = y;
-	return stSortedSet_search(matchesSet, &pair) != NULL;
+/*
+ * Index of the matches of a single read to the reference, used to answer flank lookups while
+ * enumerating complete inserts and deletes. Matches are bucketed by read position in a compressed
+ * array: the reference positions matched to read position y are refPositions[offsets[y]..offsets[y+1]).
+ */
+typedef struct _matchIndex {
+	int64_t readLength; // Number of read positions indexed
+	int64_t *offsets; // Array of length readLength+1 of offsets into refPositions
+	int64_t *refPositions; // Reference coordinates of the matches, grouped by read position
+} MatchIndex;
+
+static MatchIndex *matchIndex_construct(stList *matches, int64_t readLength) {
+	MatchIndex *matchIndex = st_malloc(sizeof(MatchIndex));
+	matchIndex->readLength = readLength;
+	matchIndex->offsets = st_calloc(readLength+1, sizeof(int64_t));
+	matchIndex->refPositions = st_malloc((stList_length(matches) > 0 ? stList_length(matches) : 1) * sizeof(int64_t));
+
+	// Count the matches for each read position
+	for(int64_t i=0; i<stList_length(matches); i++) {
+		int64_t y = stIntTuple_get(stList_get(matches, i), 2);
+		assert(y >= 0 && y < readLength);
+		matchIndex->offsets[y+1]++;
+	}
+
+	// Prefix sum to get the start of each bucket
+	for(int64_t y=0; y<readLength; y++) {
+		matchIndex->offsets[y+1] += matchIndex->offsets[y];
+	}
+
+	// Fill the buckets, using a copy of the bucket starts as insertion points
+	int64_t *insertPoints = st_malloc((readLength+1) * sizeof(int64_t));
+	memcpy(insertPoints, matchIndex->offsets, (readLength+1) * sizeof(int64_t));
+	for(int64_t i=0; i<stList_length(matches); i++) {
+		stIntTuple *match = stList_get(matches, i);
+		matchIndex->refPositions[insertPoints[stIntTuple_get(match, 2)]++] = stIntTuple_get(match, 1);
+	}
+	free(insertPoints);
+
+	return matchIndex;
+}
+
+static void matchIndex_destruct(MatchIndex *matchIndex) {
+	free(matchIndex->offsets);
+	free(matchIndex->refPositions);
+	free(matchIndex);
+}
+
+static bool isMatch(MatchIndex *matchIndex, int64_t x, int64_t y) {
+	/*
+	 * Returns true if reference position x is matched to read position y. Coordinates outside of the
+	 * read, such as the (-1, -1) beginning and (N, M) end of the alignment, are never matches.
+	 */
+	if(y < 0 || y >= matchIndex->readLength) {
+		return 0;
+	}
+	for(int64_t i=matchIndex->offsets[y]; i<matchIndex->offsets[y+1]; i++) {
+		if(matchIndex->refPositions[i] == x) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
 static void addToInserts(PoaNode *node, RleString *insert, double weight, bool strand, PoaBaseObservation *observation) {
@@ -338,16 +393,10 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 		stList_append(node->observations, poaBaseObservation_construct(readNo, stIntTuple_get(match, 2), stIntTuple_get(match, 0)));
 	}
 
-	// Create a set of match coordinates
+	// Index the match coordinates by read position, so flanking matches can be looked up cheaply
 
-	stSortedSet *matchesSet = stSortedSet_construct3(cmpAlignedPairsByCoordinates, NULL);
-	for(int64_t i=0; i<stList_length(matches); i++) {
-		stIntTuple *match = stList_get(matches, i);
+	MatchIndex *matchIndex = matchIndex_construct(matches, read->length);
 
-		assert(stSortedSet_search(matchesSet, match) == NULL);
-		stSortedSet_insert(matchesSet, match); // Add to matches
-	}
-	
 	// Add inserts to the POA graph
 
 	// Sort the inserts first by the reference coordinate and then by read coordinate
@@ -385,7 +434,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 		for(int64_t k=i; k<j; k++) {
 
 			// If k position is not flanked by a preceding match or the beginning then can not be a complete insert
-			if(!isMatch(matchesSet, stIntTuple_get(insertStart, 1), stIntTuple_get(insertStart, 2) + k - i - 1) &&
+			if(!isMatch(matchIndex, stIntTuple_get(insertStart, 1), stIntTuple_get(insertStart, 2) + k - i - 1) &&
 				stIntTuple_get(insertStart, 2) + k - i - 1 > -1) {
 				continue;
 			}
@@ -393,7 +442,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 			for(int64_t l=k; l<j; l++) {
 
 				// If l position is not flanked by a proceeding match or the end then can not be a complete insert
-				if(!isMatch(matchesSet, stIntTuple_get(insertStart, 1) + 1, stIntTuple_get(insertStart, 2) + l - i + 1) &&
+				if(!isMatch(matchIndex, stIntTuple_get(insertStart, 1) + 1, stIntTuple_get(insertStart, 2) + l - i + 1) &&
 					stIntTuple_get(insertStart, 2) + l - i + 1 < read->length) {
 					continue;
 				}
@@ -432,6 +481,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 				// Add insert to graph at leftmost position
 				addToInserts(stList_get(poa->nodes, insertPosition), insert, insertWeight, readStrand,
 							 poaBaseObservation_construct(readNo, stIntTuple_get(stList_get(inserts, k), 2), insertWeight));
+				HOT_PATH_COUNT(HOT_PATH_COUNTER_POA_INSERTS, 1);
 
 				// Cleanup
 				rleString_destruct(insert);
@@ -478,7 +528,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 		for(int64_t k=i; k<j; k++) {
 
 			// If k position is not flanked by a preceding match or the alignment beginning then can not be a complete-delete
-			if(!isMatch(matchesSet, stIntTuple_get(deleteStart, 1) + k - i - 1, stIntTuple_get(deleteStart, 2)) &&
+			if(!isMatch(matchIndex, stIntTuple_get(deleteStart, 1) + k - i - 1, stIntTuple_get(deleteStart, 2)) &&
 					stIntTuple_get(deleteStart, 1) + k - i - 1 > -1) {
 				continue;
 			}
@@ -486,7 +536,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 			for(int64_t l=k; l<j; l++) {
 
 				// If l position is not flanked by a proceeding match or the alignment end then can not be a complete-delete
-				if(!isMatch(matchesSet, stIntTuple_get(deleteStart, 1) + l - i + 1, stIntTuple_get(deleteStart, 2) + 1) &&
+				if(!isMatch(matchIndex, stIntTuple_get(deleteStart, 1) + l - i + 1, stIntTuple_get(deleteStart, 2) + 1) &&
 					stIntTuple_get(deleteStart, 1) + l - i + 1 < poa->refString->length) {
 					continue;
 				}
@@ -522,6 +572,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 				// Add delete to graph at leftmost position
 				addToDeletes(stList_get(poa->nodes, deletePosition), deleteLength, deleteWeight, readStrand,
                              poaBaseObservation_construct(readNo, stIntTuple_get(deleteStart, 2), deleteWeight));
+				HOT_PATH_COUNT(HOT_PATH_COUNTER_POA_DELETES, 1);
 			}
 		}
 
@@ -530,7 +581,7 @@ void poa_augment(Poa *poa, RleString *read, bool readStrand, int64_t readNo, stL
 	}
 
 	// Cleanup
-	stSortedSet_destruct(matchesSet);
+	matchIndex_destruct(matchIndex);
 }
 
 stList *poa_getAnchorAlignments(Poa *poa, int64_t *poaToConsensusMap, int64_t noOfReads, PolishParams *pp) {
@@ -1553,21 +1604,42 @@ static int64_t expandRLEConsensus2(Poa *poa, PoaNode *node, stList *bamChunkRead
 			bamChunkReads, &logProbability);
 }
 
-void poa_estimateRepeatCountsUsingBayesianModel(Poa *poa, stList *bamChunkReads, RepeatSubMatrix *repeatSubMatrix) {
+/*
+ * The per-node estimation passes below are independent across nodes, so are run in parallel when OpenMP is available.
+ * Small POAs are done serially, as the cost of the parallel region would outweigh the work. Any global statistics
+ * are summed serially afterwards, so the results do not depend on the number of threads.
+ */
+#define MIN_NODES_FOR_PARALLEL_ESTIMATION 2000
+#define NODES_PER_PARALLEL_ESTIMATION_TASK 256
+
+static void poa_updateNonRleLength(Poa *poa) {
 	poa->refString->nonRleLength = 0;
-	for(uint64_t i=1; i<stList_length(poa->nodes); i++) {
+	for(uint64_t i=0; i<poa->refString->length; i++) {
+		poa->refString->nonRleLength += poa->refString->repeatCounts[i];
+	}
+}
+
+void poa_estimateRepeatCountsUsingBayesianModel(Poa *poa, stList *bamChunkReads, RepeatSubMatrix *repeatSubMatrix) {
+	int64_t nodeNo = stList_length(poa->nodes);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, NODES_PER_PARALLEL_ESTIMATION_TASK) if(nodeNo >= MIN_NODES_FOR_PARALLEL_ESTIMATION)
+#endif
+	for(int64_t i=1; i<nodeNo; i++) {
 		poa->refString->repeatCounts[i-1] = expandRLEConsensus2(poa, stList_get(poa->nodes, i), bamChunkReads, repeatSubMatrix);
 		if(poa->refString->repeatCounts[i-1] == 0) { // Prevent zero length estimates
 			poa->refString->repeatCounts[i-1] = 1;
 		}
-		poa->refString->nonRleLength += poa->refString->repeatCounts[i-1];
 	}
+	poa_updateNonRleLength(poa);
 }
 
 void poa_estimatePhasedRepeatCountsUsingBayesianModel(Poa *poa, stList *bamChunkReads,
 		RepeatSubMatrix *repeatSubMatrix, stSet *readsBelongingToHap1, stSet *readsBelongingToHap2, PolishParams *params) {
-	poa->refString->nonRleLength = 0;
-	for(uint64_t i=1; i<stList_length(poa->nodes); i++) {
+	int64_t nodeNo = stList_length(poa->nodes);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, NODES_PER_PARALLEL_ESTIMATION_TASK) if(nodeNo >= MIN_NODES_FOR_PARALLEL_ESTIMATION)
+#endif
+	for(int64_t i=1; i<nodeNo; i++) {
 		PoaNode *node = stList_get(poa->nodes, i);
 
 		// Repeat count
@@ -1579,9 +1651,8 @@ void poa_estimatePhasedRepeatCountsUsingBayesianModel(Poa *poa, stList *bamChunk
 		if(poa->refString->repeatCounts[i-1] == 0) { // Prevent zero length estimates
 			poa->refString->repeatCounts[i-1] = 1;
 		}
-
-		poa->refString->nonRleLength += poa->refString->repeatCounts[i-1];
 	}
+	poa_updateNonRleLength(poa);
 }
 
 
@@ -1680,8 +1751,11 @@ uint64_t poaNode_getPhasedMLBase(PoaNode *node, stList *bamChunkReads,
 
 void poa_estimatePhasedBasesUsingBayesianModel(Poa *poa, stList *bamChunkReads,
 		stSet *readsBelongingToHap1, stSet *readsBelongingToHap2, PolishParams *params) {
-	poa->refString->nonRleLength = 0;
-	for(uint64_t i=1; i<stList_length(poa->nodes); i++) {
+	int64_t nodeNo = stList_length(poa->nodes);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, NODES_PER_PARALLEL_ESTIMATION_TASK) if(nodeNo >= MIN_NODES_FOR_PARALLEL_ESTIMATION)
+#endif
+	for(int64_t i=1; i<nodeNo; i++) {
 		PoaNode *node = stList_get(poa->nodes, i);
 		node->base = poa->alphabet->convertSymbolToChar(poaNode_getPhasedMLBase(node, bamChunkReads,
 				poa, readsBelongingToHap1, readsBelongingToHap2));
@@ -1793,10 +1867,17 @@ RepeatSubMatrix *repeatSubMatrix_constructEmpty(Alphabet *alphabet) {
 	return repeatSubMatrix;
 }
 
-double repeatSubMatrix_getLogProbForGivenRepeatCount(RepeatSubMatrix *repeatSubMatrix, Symbol base, stList *observations,
-												     stList *bamChunkReads, int64_t underlyingRepeatCount) {
-	assert(underlyingRepeatCount < repeatSubMatrix->maximumRepeatLength);
-	double logProb = LOG_ONE;
+void repeatSubMatrix_getRepeatCountHistograms(RepeatSubMatrix *repeatSubMatrix, stList *observations, stList *bamChunkReads,
+		stSet *readsBelongingToHap1, double *histogramHap1, double *histogramHap2,
+		int64_t *observationNoHap1, int64_t *observationNoHap2) {
+	/*
+	 * Builds, in one pass over the observations, the weighted histograms of observed repeat counts for a node, split
+	 * by strand (see repeatSubMatrix_getLogProbForGivenRepeatCountHistogram for the layout). If readsBelongingToHap1
+	 * is non-NULL observations of reads in the set go in histogramHap1 and the rest in histogramHap2, otherwise
+	 * all go in histogramHap1 and histogramHap2 may be NULL. The histograms must be zeroed by the caller.
+	 */
+	*observationNoHap1 = 0;
+	*observationNoHap2 = 0;
 	for(int64_t i=0; i<stList_length(observations); i++) {
 		PoaBaseObservation *observation = stList_get(observations, i);
 		BamChunkRead *read = stList_get(bamChunkReads, observation->readNo);
@@ -1804,15 +1885,56 @@ double repeatSubMatrix_getLogProbForGivenRepeatCount(RepeatSubMatrix *repeatSubM
 
 		// Be robust to over-long repeat count observations
 		observedRepeatCount = observedRepeatCount >= repeatSubMatrix->maximumRepeatLength ?
-		        repeatSubMatrix->maximumRepeatLength-1 : observedRepeatCount;
+				repeatSubMatrix->maximumRepeatLength-1 : observedRepeatCount;
+
+		double *histogram = histogramHap1;
+		if(readsBelongingToHap1 != NULL && stSet_search(readsBelongingToHap1, read) == NULL) {
+			histogram = histogramHap2;
+			(*observationNoHap2)++;
+		}
+		else {
+			(*observationNoHap1)++;
+		}
+		histogram[(read->forwardStrand ? POS_STRAND_IDX : NEG_STRAND_IDX) * repeatSubMatrix->maximumRepeatLength +
+				  observedRepeatCount] += observation->weight;
+	}
+}
 
-		logProb += repeatSubMatrix_getLogProb(repeatSubMatrix, base, read->forwardStrand,
-		        observedRepeatCount, underlyingRepeatCount) * observation->weight;
+double repeatSubMatrix_getLogProbForGivenRepeatCountHistogram(RepeatSubMatrix *repeatSubMatrix, Symbol base,
+		double *histogram, int64_t minRepeatLength, int64_t maxRepeatLength, int64_t underlyingRepeatCount) {
+	/*
+	 * The histogram is an array of length 2 * maximumRepeatLength, giving the summed weight of the observations
+	 * of each repeat count, stored as [strand * maximumRepeatLength + observedRepeatCount], where strand
+	 * is POS_STRAND_IDX or NEG_STRAND_IDX. Only the observed repeat counts in [minRepeatLength, maxRepeatLength]
+	 * are considered, so the likelihood is a short dot product against a row of the repeat sub matrix.
+	 */
+	assert(underlyingRepeatCount < repeatSubMatrix->maximumRepeatLength);
+	assert(maxRepeatLength < repeatSubMatrix->maximumRepeatLength);
+	double logProb = LOG_ONE;
+	for(int64_t strand=0; strand<2; strand++) {
+		double *weights = &(histogram[strand * repeatSubMatrix->maximumRepeatLength]);
+		double *logProbs = repeatSubMatrix_setLogProb(repeatSubMatrix, base, strand == POS_STRAND_IDX, 0, underlyingRepeatCount);
+		for(int64_t j=minRepeatLength; j<=maxRepeatLength; j++) {
+			if(weights[j] != 0.0) { // Avoid 0 * log(0) for unobserved repeat counts
+				logProb += logProbs[j] * weights[j];
+			}
+		}
 	}
 
 	return logProb/PAIR_ALIGNMENT_PROB_1;
 }
 
+double repeatSubMatrix_getLogProbForGivenRepeatCount(RepeatSubMatrix *repeatSubMatrix, Symbol base, stList *observations,
+												     stList *bamChunkReads, int64_t underlyingRepeatCount) {
+	double histogram[2 * repeatSubMatrix->maximumRepeatLength];
+	memset(histogram, 0, sizeof(histogram));
+	int64_t observationNo, unused;
+	repeatSubMatrix_getRepeatCountHistograms(repeatSubMatrix, observations, bamChunkReads, NULL, histogram, NULL,
+			&observationNo, &unused);
+	return repeatSubMatrix_getLogProbForGivenRepeatCountHistogram(repeatSubMatrix, base, histogram,
+			0, repeatSubMatrix->maximumRepeatLength-1, underlyingRepeatCount);
+}
+
 void repeatSubMatrix_getMinAndMaxRepeatCountObservations(RepeatSubMatrix *repeatSubMatrix, stList *observations,
 		stList *bamChunkReads, int64_t *minRepeatLength, int64_t *maxRepeatLength) {
 	// Get the range or repeat observations, used to avoid calculating all repeat lengths, heuristically
@@ -1835,11 +1957,12 @@ void repeatSubMatrix_getMinAndMaxRepeatCountObservations(RepeatSubMatrix *repeat
 	}
 }
 
-void repeatSubMatrix_getRepeatCountProbs(RepeatSubMatrix *repeatSubMatrix, Symbol base, stList *observations,
-		stList *bamChunkReads, double *logProbabilities, int64_t minRepeatLength, int64_t maxRepeatLength) {
+void repeatSubMatrix_getRepeatCountProbs(RepeatSubMatrix *repeatSubMatrix, Symbol base, double *histogram,
+		double *logProbabilities, int64_t minRepeatLength, int64_t maxRepeatLength) {
+	// The histogram is only non-zero for observed repeat counts, so the dot products are restricted to that range
 	for(int64_t i=minRepeatLength; i<=maxRepeatLength; i++) {
-		logProbabilities[i-minRepeatLength] =
-				repeatSubMatrix_getLogProbForGivenRepeatCount(repeatSubMatrix, base, observations, bamChunkReads, i);
+		logProbabilities[i-minRepeatLength] = repeatSubMatrix_getLogProbForGivenRepeatCountHistogram(repeatSubMatrix,
+				base, histogram, minRepeatLength, maxRepeatLength, i);
 	}
 }
 
@@ -1857,9 +1980,15 @@ int64_t repeatSubMatrix_getMLRepeatCount(RepeatSubMatrix *repeatSubMatrix, Symbo
 		return 0; // Case we have no valid observations, so assume repeat length of 0
 	}
 
+	// Summarise the observations as a histogram of observed repeat counts
+	double histogram[2 * repeatSubMatrix->maximumRepeatLength];
+	memset(histogram, 0, sizeof(histogram));
+	int64_t observationNo, unused;
+	repeatSubMatrix_getRepeatCountHistograms(repeatSubMatrix, observations, bamChunkReads, NULL, histogram, NULL,
+			&observationNo, &unused);
+
 	// Get the prob for each repeat count
-	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, observations,
-			bamChunkReads, logProbabilities, minRepeatLength, maxRepeatLength);
+	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, histogram, logProbabilities, minRepeatLength, maxRepeatLength);
 
 	return getMax(logProbabilities, maxRepeatLength-minRepeatLength+1, logProbability)+minRepeatLength;
 }
@@ -1883,24 +2012,24 @@ int64_t repeatSubMatrix_getPhasedMLRepeatCount(RepeatSubMatrix *repeatSubMatrix,
 		return 0; // Case we have no valid observations, so assume repeat length of 0
 	}
 
-	// Split observations between haplotypes
-	stList *observationsHap1 = stList_construct();
-	stList *observationsHap2 = stList_construct();
-	for(int64_t i=0; i<stList_length(observations); i++) {
-		PoaBaseObservation *observation = stList_get(observations, i);
-		BamChunkRead *read = stList_get(bamChunkReads, observation->readNo);
-		stList_append(stSet_search(readsBelongingToHap1, read) != NULL ? observationsHap1 : observationsHap2, observation);
-	}
+	// Split observations between haplotypes, summarising each as a histogram of observed repeat counts
+	double histogramHap1[2 * repeatSubMatrix->maximumRepeatLength];
+	double histogramHap2[2 * repeatSubMatrix->maximumRepeatLength];
+	memset(histogramHap1, 0, sizeof(histogramHap1));
+	memset(histogramHap2, 0, sizeof(histogramHap2));
+	int64_t observationNoHap1, observationNoHap2;
+	repeatSubMatrix_getRepeatCountHistograms(repeatSubMatrix, observations, bamChunkReads, readsBelongingToHap1,
+			histogramHap1, histogramHap2, &observationNoHap1, &observationNoHap2);
 
 	// Get probs for hap 1
 	double logProbabilitiesHap1[repeatSubMatrix->maximumRepeatLength];
-	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, observationsHap1,
-				bamChunkReads, logProbabilitiesHap1, minRepeatLength, maxRepeatLength);
+	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, histogramHap1,
+				logProbabilitiesHap1, minRepeatLength, maxRepeatLength);
 
 	// Get probs for hap 2
 	double logProbabilitiesHap2[repeatSubMatrix->maximumRepeatLength];
-	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, observationsHap2,
-				bamChunkReads, logProbabilitiesHap2, minRepeatLength, maxRepeatLength);
+	repeatSubMatrix_getRepeatCountProbs(repeatSubMatrix, base, histogramHap2,
+				logProbabilitiesHap2, minRepeatLength, maxRepeatLength);
 
 	// Get ML prob for haplotype 2
 	double logProbMLHap2;
@@ -1924,26 +2053,19 @@ int64_t repeatSubMatrix_getPhasedMLRepeatCount(RepeatSubMatrix *repeatSubMatrix,
 		st_logDebug("Got %i repeat length, other hap repeat length %i, log prob:%f, log prob hap1: %f log prob hap2: %f (min rl: %i max: %i) (total obs: %i, hap1: %i, hap2 : %i)\n",
 			(int)mlRepeatLength, (int)mLRepeatLengthHap2, (float)*logProbability, (float)logProbabilitiesHap1[mlRepeatLength-minRepeatLength],
 			(float)logProbMLHap2, (int)minRepeatLength, (int)maxRepeatLength,
-			(int)stList_length(observations), (int)stList_length(observationsHap1), (int)stList_length(observationsHap2));
+			(int)stList_length(observations), (int)observationNoHap1, (int)observationNoHap2);
 	}
 
-	// Cleanup
-	stList_destruct(observationsHap1);
-	stList_destruct(observationsHap2);
-
 	return mlRepeatLength;
 }
 
-int64_t removeOverlap(char *prefixString, char *suffixString, int64_t approxOverlap, PolishParams *polishParams,
-				   int64_t *prefixStringCropEnd, int64_t *suffixStringCropStart) {
-
-	// Align the overlapping suffix of the prefixString and the prefix of the suffix string
-	int64_t prefixStringLength = strlen(prefixString);
-	int64_t suffixStringLength = strlen(suffixString);
-
-	// Get coordinates of substrings to be aligned
-	int64_t i = (prefixStringLength - approxOverlap) < 0 ? 0 : prefixStringLength - approxOverlap;
-	int64_t j = approxOverlap < suffixStringLength ? approxOverlap : suffixStringLength;
+static int64_t removeOverlapUsingPosteriorAlignment(char *prefixString, int64_t prefixStringLength, char *suffixString,
+		int64_t suffixStringLength, int64_t approxOverlap, int64_t i, int64_t j, PolishParams *polishParams,
+		int64_t *prefixStringCropEnd, int64_t *suffixStringCropStart) {
+	/*
+	 * Picks the split point as the highest posterior probability aligned pair between the suffix of the
+	 * prefixString starting at i and the prefix of the suffixString of length j.
+	 */
 
 	// Crop suffix
 	char c = suffixString[j];
@@ -2005,10 +2127,197 @@ int64_t removeOverlap(char *prefixString, char *suffixString, int64_t approxOver
 	return overlapWeight;
 }
 
+/*
+ * Exact k-mer seeding used to stitch together overlapping chunks without doing a full posterior alignment.
+ */
+
+#define OVERLAP_SEED_KMER_LENGTH 19 // Must be no more than 32, so k-mers can be packed into a uint64_t
+#define OVERLAP_SEED_MIN_MATCH_LENGTH (2 * OVERLAP_SEED_KMER_LENGTH) // Shortest exact match trusted as the split point
+// Largest distance of an exact match from the diagonal of the approximate overlap, as a fraction of the overlap,
+// allowing for the indels between the two polished chunks
+#define OVERLAP_SEED_MAX_DIAGONAL_DRIFT 0.1
+
+typedef struct _kmerPosition {
+	uint64_t kmer; // The 2-bit per base packed k-mer
+	int64_t position; // The position of the first base of the k-mer in the string
+} KmerPosition;
+
+static int kmerPosition_cmp(const void *a, const void *b) {
+	KmerPosition *k1 = (KmerPosition *)a, *k2 = (KmerPosition *)b;
+	return k1->kmer < k2->kmer ? -1 : k1->kmer > k2->kmer ? 1 :
+			(k1->position < k2->position ? -1 : k1->position > k2->position ? 1 : 0);
+}
+
+static int kmerPosition_cmpByDiagonal(const void *a, const void *b) {
+	/*
+	 * Compares seeds stored as pairs of KmerPositions (prefix string position, suffix string position),
+	 * first by diagonal and then by position in the prefix string.
+	 */
+	KmerPosition *s1 = (KmerPosition *)a, *s2 = (KmerPosition *)b;
+	int64_t d1 = s1[0].position - s1[1].position, d2 = s2[0].position - s2[1].position;
+	return d1 < d2 ? -1 : d1 > d2 ? 1 : (s1[0].position < s2[0].position ? -1 : s1[0].position > s2[0].position ? 1 : 0);
+}
+
+static int64_t nucleotideToBits(char c) {
+	switch(toupper(c)) {
+		case 'A': return 0;
+		case 'C': return 1;
+		case 'G': return 2;
+		case 'T': return 3;
+		default: return -1;
+	}
+}
+
+static int64_t getUniqueKmers(char *string, int64_t length, int64_t k, KmerPosition *kmers) {
+	/*
+	 * Fills kmers with the k-mers that occur exactly once in the string, sorted by k-mer.
+	 * K-mers containing non-ACGT characters are ignored. Returns the number of unique k-mers.
+	 */
+	uint64_t mask = k == 32 ? UINT64_MAX : (((uint64_t)1) << (2*k)) - 1;
+	uint64_t kmer = 0;
+	int64_t validBases = 0, kmerNo = 0;
+	for(int64_t i=0; i<length; i++) {
+		int64_t bits = nucleotideToBits(string[i]);
+		if(bits == -1) {
+			validBases = 0;
+			continue;
+		}
+		kmer = ((kmer << 2) | bits) & mask;
+		if(++validBases >= k) {
+			kmers[kmerNo].kmer = kmer;
+			kmers[kmerNo++].position = i - k + 1;
+		}
+	}
+
+	// Sort and remove any k-mers that occur more than once
+	qsort(kmers, kmerNo, sizeof(KmerPosition), kmerPosition_cmp);
+	int64_t uniqueKmerNo = 0;
+	for(int64_t i=0; i<kmerNo;) {
+		int64_t j=i+1;
+		while(j < kmerNo && kmers[j].kmer == kmers[i].kmer) {
+			j++;
+		}
+		if(j == i+1) {
+			kmers[uniqueKmerNo++] = kmers[i];
+		}
+		i = j;
+	}
+
+	return uniqueKmerNo;
+}
+
+static bool removeOverlapUsingKmerSeeds(char *prefixString, int64_t i, char *suffixString, int64_t j,
+		int64_t approxOverlap, int64_t *prefixStringCropEnd, int64_t *suffixStringCropStart) {
+	/*
+	 * Finds the k-mers that occur exactly once in both the suffix of the prefixString starting at i and the prefix of
+	 * the suffixString of length j. Each seed near the diagonal expected from the approximate overlap is extended to
+	 * a maximal exact match and the split point is placed in the middle of the longest. Returns false if there is no
+	 * such match of at least OVERLAP_SEED_MIN_MATCH_LENGTH, in which case the crop coordinates are not set.
+	 */
+	int64_t k = OVERLAP_SEED_KMER_LENGTH;
+	char *x = &(prefixString[i]);
+	int64_t xLength = strlen(x);
+	if(xLength < OVERLAP_SEED_MIN_MATCH_LENGTH || j < OVERLAP_SEED_MIN_MATCH_LENGTH) {
+		return 0;
+	}
+
+	// Both strings start at the start of the overlap, unless the prefixString is shorter than it
+	int64_t expectedDiagonal = xLength < approxOverlap ? xLength - approxOverlap : 0;
+	int64_t maxDiagonalDrift = k + (int64_t)(OVERLAP_SEED_MAX_DIAGONAL_DRIFT * approxOverlap);
+
+	// Get the unique k-mers of each string
+	KmerPosition *xKmers = st_malloc(sizeof(KmerPosition) * (xLength - k + 1));
+	KmerPosition *yKmers = st_malloc(sizeof(KmerPosition) * (j - k + 1));
+	int64_t xKmerNo = getUniqueKmers(x, xLength, k, xKmers);
+	int64_t yKmerNo = getUniqueKmers(suffixString, j, k, yKmers);
+
+	// Merge the sorted k-mer lists to get the shared seeds, stored as pairs of (x, y) k-mer positions
+	int64_t maxSeedNo = xKmerNo < yKmerNo ? xKmerNo : yKmerNo;
+	KmerPosition *seeds = st_malloc(sizeof(KmerPosition) * 2 * (maxSeedNo > 0 ? maxSeedNo : 1));
+	int64_t seedNo = 0;
+	for(int64_t xi=0, yi=0; xi<xKmerNo && yi<yKmerNo;) {
+		if(xKmers[xi].kmer < yKmers[yi].kmer) {
+			xi++;
+		}
+		else if(xKmers[xi].kmer > yKmers[yi].kmer) {
+			yi++;
+		}
+		else {
+			seeds[2*seedNo] = xKmers[xi++];
+			seeds[2*seedNo+1] = yKmers[yi++];
+			seedNo++;
+		}
+	}
+	free(xKmers);
+	free(yKmers);
+
+	// Extend the seeds to maximal exact matches, visiting them in diagonal order so that each
+	// exact match is only extended once
+	qsort(seeds, seedNo, sizeof(KmerPosition) * 2, kmerPosition_cmpByDiagonal);
+	int64_t bestXStart = -1, bestYStart = -1, bestLength = 0;
+	int64_t runDiagonal = INT64_MIN, runXEnd = -1;
+	for(int64_t s=0; s<seedNo; s++) {
+		int64_t xStart = seeds[2*s].position, yStart = seeds[2*s+1].position;
+		if(xStart - yStart == runDiagonal && xStart < runXEnd) {
+			continue; // Seed is contained in the previously extended exact match
+		}
+		if(llabs(xStart - yStart - expectedDiagonal) > maxDiagonalDrift) {
+			continue; // A chance match away from the overlap
+		}
+		while(xStart > 0 && yStart > 0 && x[xStart-1] == suffixString[yStart-1]) {
+			xStart--; yStart--;
+		}
+		int64_t xEnd = seeds[2*s].position + k, yEnd = seeds[2*s+1].position + k;
+		while(xEnd < xLength && yEnd < j && x[xEnd] == suffixString[yEnd]) {
+			xEnd++; yEnd++;
+		}
+		runDiagonal = xStart - yStart;
+		runXEnd = xEnd;
+		if(xEnd - xStart > bestLength) {
+			bestLength = xEnd - xStart;
+			bestXStart = xStart;
+			bestYStart = yStart;
+		}
+	}
+	free(seeds);
+
+	if(bestLength < OVERLAP_SEED_MIN_MATCH_LENGTH) {
+		return 0;
+	}
+
+	// Split in the middle of the longest exact match
+	*prefixStringCropEnd = i + bestXStart + bestLength/2; // Exclusive
+	*suffixStringCropStart = bestYStart + bestLength/2; // Inclusive
+
+	return 1;
+}
+
+int64_t removeOverlap(char *prefixString, char *suffixString, int64_t approxOverlap, PolishParams *polishParams,
+				   int64_t *prefixStringCropEnd, int64_t *suffixStringCropStart) {
+
+	// Align the overlapping suffix of the prefixString and the prefix of the suffix string
+	int64_t prefixStringLength = strlen(prefixString);
+	int64_t suffixStringLength = strlen(suffixString);
+
+	// Get coordinates of substrings to be aligned
+	int64_t i = (prefixStringLength - approxOverlap) < 0 ? 0 : prefixStringLength - approxOverlap;
+	int64_t j = approxOverlap < suffixStringLength ? approxOverlap : suffixStringLength;
+
+	// First try to find the split point using exact, unique k-mer matches, which are cheap to find
+	if(removeOverlapUsingKmerSeeds(prefixString, i, suffixString, j, approxOverlap, prefixStringCropEnd,
+			suffixStringCropStart)) {
+		return PAIR_ALIGNMENT_PROB_1; // The split point is in an exact match, so is certain
+	}
+
+	// Otherwise fall back to using the posterior alignment of the overlapping strings
+	return removeOverlapUsingPosteriorAlignment(prefixString, prefixStringLength, suffixString, suffixStringLength,
+			approxOverlap, i, j, polishParams, prefixStringCropEnd, suffixStringCropStart);
+}
+
 // Core polishing logic functions
 
-RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params,
-				  int64_t **poaToConsensusMap) {
+RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params, ForwardScoreCache *forwardScoreCache,
+				  ChunkProfile *chunkProfile, int64_t **poaToConsensusMap) {
 	/*
 	 * "Polishes" the given POA reference string to create a new consensus reference string.
 	 * Algorithm starts by dividing the reference into anchor points - points where the majority
@@ -2019,7 +2328,12 @@ RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params,
 	 * are aligned to it. The candidate string, including the current reference substring,
 	 * with the highest likelihood is then selected.
 	 */
-	BubbleGraph *bg = bubbleGraph_constructFromPoa(poa, bamChunkReads, params);
+	double startTime = chunkProfile_getTime();
+	BubbleGraph *bg = bubbleGraph_constructFromPoa2(poa, bamChunkReads, params, forwardScoreCache);
+	chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_BUBBLE_GRAPH, chunkProfile_getTime() - startTime);
+	if (chunkProfile != NULL) {
+		chunkProfile->bubbleCount += bg->bubbleNo;
+	}
 
 	uint64_t *consensusPath = bubbleGraph_getConsensusPath(bg, params);
 	RleString *newConsensusString = bubbleGraph_getConsensusString(bg, consensusPath, poaToConsensusMap, params);
@@ -2033,7 +2347,8 @@ RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params,
 // Functions to iteratively polish a sequence
 Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 						   PolishParams *polishParams, bool hmmMNotRealign,
-						   int64_t minIterations, int64_t maxIterations) {
+						   int64_t minIterations, int64_t maxIterations, ForwardScoreCache *forwardScoreCache,
+						   ChunkProfile *chunkProfile) {
 	assert(maxIterations >= 0);
 	assert(minIterations <= maxIterations);
 
@@ -2049,10 +2364,12 @@ Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 		i++;
 
 		time_t consensusFindingStartTime = time(NULL);
+		double iterationStartTime = chunkProfile_getTime();
 
 		int64_t *poaToConsensusMap;
 		RleString *reference = hmmMNotRealign ? poa_getConsensus(poa, &poaToConsensusMap, polishParams) :
-				poa_polish(poa, bamChunkReads, polishParams, &poaToConsensusMap);
+				poa_polish(poa, bamChunkReads, polishParams, forwardScoreCache, chunkProfile, &poaToConsensusMap);
+		double consensusSeconds = chunkProfile_getTime() - iterationStartTime;
 
 		st_logInfo(" %s Took %3d seconds to do round %" PRIi64 " of consensus finding using algorithm %s\n",
 				logIdentifier, (int)(time(NULL) - consensusFindingStartTime), i, hmmMNotRealign ? "consensus" : "polish");
@@ -2061,6 +2378,7 @@ Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 		if(rleString_eq(reference, poa->refString)) {
 			rleString_destruct(reference);
 			free(poaToConsensusMap);
+			chunkProfile_addIteration(chunkProfile, hmmMNotRealign, consensusSeconds, 0.0);
 			break;
 		}
 
@@ -2068,14 +2386,18 @@ Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 		stList *anchorAlignments = poa_getAnchorAlignments(poa, poaToConsensusMap, stList_length(bamChunkReads), polishParams);
 
 		time_t realignStartTime = time(NULL);
+		double realignProfileStartTime = chunkProfile_getTime();
 
 		// Generated updated poa
 		Poa *poa2 = poa_realign(bamChunkReads, anchorAlignments, reference, polishParams);
 
 		// Get updated repeat counts
 		if(polishParams->useRunLengthEncoding) {
+			double repeatCountStartTime = chunkProfile_getTime();
 			poa_estimateRepeatCountsUsingBayesianModel(poa2, bamChunkReads, polishParams->repeatSubMatrix);
+			chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_REPEAT_COUNTS, chunkProfile_getTime() - repeatCountStartTime);
 		}
+		chunkProfile_addIteration(chunkProfile, hmmMNotRealign, consensusSeconds, chunkProfile_getTime() - realignProfileStartTime);
 
 		// Cleanup
 		rleString_destruct(reference);
@@ -2108,22 +2430,80 @@ Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 
 Poa *poa_realignAll(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
 						  PolishParams *polishParams) {
+	ForwardScoreCache *forwardScoreCache = polishParams->forwardScoreCacheMaxMemory > 0 ?
+			forwardScoreCache_construct(polishParams->forwardScoreCacheMaxMemory) : NULL;
+	Poa *poa = poa_realignAll2(bamChunkReads, anchorAlignments, reference, polishParams, forwardScoreCache, NULL);
+	if(forwardScoreCache != NULL) {
+		forwardScoreCache_destruct(forwardScoreCache);
+	}
+	return poa;
+}
+
+Poa *poa_realignAll2(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
+						  PolishParams *polishParams, ForwardScoreCache *forwardScoreCache, ChunkProfile *chunkProfile) {
 	time_t startTime = time(NULL);
+	double stageStartTime = chunkProfile_getTime();
 	Poa *poa = poa_realign(bamChunkReads, anchorAlignments, reference, polishParams);
 	char *logIdentifier = getLogIdentifier();
+	chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_INITIAL_REALIGN, chunkProfile_getTime() - stageStartTime);
 
 	st_logInfo(" %s Took %3d seconds to generate initial POA\n", logIdentifier, (int)(time(NULL) - startTime));
-	free(logIdentifier);
 
 	if (polishParams->maxPoaConsensusIterations > 0) {
+		stageStartTime = chunkProfile_getTime();
 		poa = poa_realignIterative(poa, bamChunkReads, polishParams, 1, polishParams->minPoaConsensusIterations,
-				polishParams->maxPoaConsensusIterations);
+				polishParams->maxPoaConsensusIterations, forwardScoreCache, chunkProfile);
+		chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_CONSENSUS, chunkProfile_getTime() - stageStartTime);
 	}
 
 	if (polishParams->maxRealignmentPolishIterations > 0) {
+		stageStartTime = chunkProfile_getTime();
 		poa = poa_realignIterative(poa, bamChunkReads, polishParams, 0, polishParams->minRealignmentPolishIterations,
-				polishParams->maxRealignmentPolishIterations);
+				polishParams->maxRealignmentPolishIterations, forwardScoreCache, chunkProfile);
+		chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_POLISH, chunkProfile_getTime() - stageStartTime);
+
+		if (forwardScoreCache != NULL) {
+			st_logInfo(" %s Forward score cache got %" PRIu64 " hits and %" PRIu64 " misses\n", logIdentifier,
+					forwardScoreCache_getHits(forwardScoreCache), forwardScoreCache_getMisses(forwardScoreCache));
+		}
 	}
 
+	free(logIdentifier);
 	return poa;
 }
+
+/*
+ * Approximate number of bytes used per read nucleotide when building and realigning the poa. This covers the aligned pairs
+ * computed for each read, the base observations they are turned into and the run-length encoded read itself.
+ */
+#define POA_MEMORY_BYTES_PER_READ_NUCLEOTIDE 256
+
+int64_t poa_estimatePeakMemory(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
+		PolishParams *polishParams) {
+	int64_t totalReadNucleotides = 0, totalAnchorPairs = 0;
+	for(int64_t i=0; i<stList_length(bamChunkReads); i++) {
+		totalReadNucleotides += ((BamChunkRead *)stList_get(bamChunkReads, i))->rleRead->length;
+	}
+	for(int64_t i=0; i<stList_length(anchorAlignments); i++) {
+		totalAnchorPairs += stList_length(stList_get(anchorAlignments, i));
+	}
+
+	// Each node carries insert, delete and observation lists plus base and repeat count weight arrays, and during
+	// realignment the previous and new poa exist at the same time
+	int64_t bytesPerNode = sizeof(PoaNode) + 3 * 4 * sizeof(void *) +
+			sizeof(double) * (polishParams->alphabet->alphabetSize + polishParams->repeatSubMatrix->maximumRepeatLength);
+	int64_t nodeBytes = 2 * bytesPerNode * ((int64_t)reference->length + 1);
+
+	// Anchor pairs are held as stIntTuples for the life of the chunk
+	int64_t anchorBytes = totalAnchorPairs * (sizeof(void *) + 4 * sizeof(int64_t));
+
+	// Dynamic programming matrices for the largest (split) alignment problem, forward and backward
+	int64_t matrixBytes = 2 * polishParams->p->splitMatrixBiggerThanThis * sizeof(double) *
+			(polishParams->stateMachineForForwardStrandRead->stateNumber);
+
+	// The chunk's forward score cache can fill up to its cap across the polishing rounds
+	int64_t cacheBytes = (int64_t) polishParams->forwardScoreCacheMaxMemory;
+
+	return POA_MEMORY_BYTES_PER_READ_NUCLEOTIDE * totalReadNucleotides + nodeBytes + anchorBytes + matrixBytes +
+			cacheBytes;
+}
@@ -109,6 +109,14 @@ SymbolString symbolString_getSubString(SymbolString s, uint64_t start, uint64_t
 	return s2;
 }
 
+SymbolString symbolString_getView(SymbolString s, uint64_t start, uint64_t length) {
+	SymbolString s2 = s;
+	assert(start+length <= s.length); // Check bounds
+	s2.sequence = &(s.sequence[start]);
+	s2.length = length;
+	return s2;
+}
+
 void symbolString_destruct(SymbolString s) {
     free(s.sequence);
 }
@@ -629,6 +637,32 @@ StateMachine *stateMachine3_constructNucleotide(StateMachineType type) {
 	return stateMachine3_construct(type, nucleotideEmissions_construct());
 }
 
+void stateMachine3_getTransitions(StateMachine *sM, double *transitions) {
+	StateMachine3 *sM3 = (StateMachine3 *) sM;
+	transitions[0] = sM3->TRANSITION_MATCH_CONTINUE;
+	transitions[1] = sM3->TRANSITION_MATCH_FROM_GAP_X;
+	transitions[2] = sM3->TRANSITION_MATCH_FROM_GAP_Y;
+	transitions[3] = sM3->TRANSITION_GAP_OPEN_X;
+	transitions[4] = sM3->TRANSITION_GAP_OPEN_Y;
+	transitions[5] = sM3->TRANSITION_GAP_EXTEND_X;
+	transitions[6] = sM3->TRANSITION_GAP_EXTEND_Y;
+	transitions[7] = sM3->TRANSITION_GAP_SWITCH_TO_X;
+	transitions[8] = sM3->TRANSITION_GAP_SWITCH_TO_Y;
+}
+
+void stateMachine3_setTransitions(StateMachine *sM, double *transitions) {
+	StateMachine3 *sM3 = (StateMachine3 *) sM;
+	sM3->TRANSITION_MATCH_CONTINUE = transitions[0];
+	sM3->TRANSITION_MATCH_FROM_GAP_X = transitions[1];
+	sM3->TRANSITION_MATCH_FROM_GAP_Y = transitions[2];
+	sM3->TRANSITION_GAP_OPEN_X = transitions[3];
+	sM3->TRANSITION_GAP_OPEN_Y = transitions[4];
+	sM3->TRANSITION_GAP_EXTEND_X = transitions[5];
+	sM3->TRANSITION_GAP_EXTEND_Y = transitions[6];
+	sM3->TRANSITION_GAP_SWITCH_TO_X = transitions[7];
+	sM3->TRANSITION_GAP_SWITCH_TO_Y = transitions[8];
+}
+
 static void stateMachine3_loadAsymmetric(StateMachine3 *sM3, Hmm *hmm) {
     if (hmm->type != threeStateAsymmetric) {
         st_errAbort("Wrong hmm type");
@@ -8,6 +8,7 @@
 #ifdef _HDF5
 #include "margin.h"
 #include <hdf5.h>
+#include <pthread.h>
 
 #define SYMBOL_NUMBER 5
 #define SYMBOL_NUMBER_NO_N 4
@@ -60,12 +61,121 @@ struct _HelenFeatureHDF5FileInfo {
     hid_t uint32Type;
     hid_t uint8Type;
     hid_t floatType;
+    hid_t float16Type;
     hid_t groupPropertyList;
+    int64_t compressionLevel; // Deflate level for feature datasets, 0 for contiguous uncompressed datasets
+    HelenFeatureImageEncoding imageEncoding;
+    HelenFeatureWindowMode windowMode;
 };
 
-HelenFeatureHDF5FileInfo* HelenFeatureHDF5FileInfo_construct(char *filename);
+HelenFeatureHDF5FileInfo* HelenFeatureHDF5FileInfo_construct(char *filename, int64_t compressionLevel,
+        HelenFeatureImageEncoding imageEncoding, HelenFeatureWindowMode windowMode);
 void HelenFeatureHDF5FileInfo_destruct(HelenFeatureHDF5FileInfo *fileInfo);
-HelenFeatureHDF5FileInfo** openHelenFeatureHDF5FilesByThreadCount(char *filenameBase, int64_t threadCount);
+
+// Windows of HDF5_FEATURE_SIZE rows appended to .npy files, so readers can memory map all windows at once
+#define HELEN_NPY_HEADER_SIZE 128 // Fixed .npy header length, so the window count can be filled in on close
+typedef struct _HelenFeatureNpyFileInfo HelenFeatureNpyFileInfo;
+struct _HelenFeatureNpyFileInfo {
+    char *outputBase;
+    HelenFeatureImageEncoding imageEncoding;
+    HelenFeatureWindowMode windowMode;
+    int64_t windowCount;
+    // record layout, fixed by the first tensor written
+    bool layoutFixed;
+    HelenFeatureType type;
+    int64_t positionColumnCount;
+    int64_t imageColumnCount;
+    int64_t runLengthColumnCount;
+    bool hasLabels;
+    FILE *imageFile;
+    FILE *runLengthFile; // channel type only
+    FILE *positionFile;
+    FILE *normalizationFile;
+    FILE *labelFile; // with labels only
+    FILE *indexFile;
+};
+
+HelenFeatureNpyFileInfo *HelenFeatureNpyFileInfo_construct(char *outputBase, HelenFeatureImageEncoding imageEncoding,
+        HelenFeatureWindowMode windowMode);
+void HelenFeatureNpyFileInfo_destruct(HelenFeatureNpyFileInfo *fileInfo);
+
+// Features for one chunk, flattened into the arrays written to HDF5
+typedef struct _HelenFeatureTensor HelenFeatureTensor;
+struct _HelenFeatureTensor {
+    HelenFeatureType type;
+    HelenFeatureImageEncoding imageEncoding;
+    char *outputFileBase;
+    char *refSeqName;
+    int64_t chunkBoundaryStart;
+    int64_t chunkBoundaryEnd;
+    int64_t chunkStart;
+    int64_t chunkEnd;
+    bool outputLabels;
+    int64_t featureCount;
+    int64_t positionColumnCount;
+    int64_t imageColumnCount;
+    int64_t runLengthColumnCount;
+    uint32_t **positionData;
+    uint8_t **normalizationData;
+    uint8_t **imageData; // weights for the weight types, nucleotide weights for the channel type
+    uint8_t ***runLengthData; // channel type only, otherwise NULL
+    float **imageWeights; // replaces imageData for encodings other than HFEAT_IMAGE_NORMALIZED_UINT8
+    float ***runLengthWeights; // replaces runLengthData for encodings other than HFEAT_IMAGE_NORMALIZED_UINT8
+    uint8_t **labelCharacterData; // NULL without labels
+    uint8_t **labelRunLengthData; // run length types with labels only, otherwise NULL
+};
+
+HelenFeatureTensor *helenFeatureTensor_construct(HelenFeatureType type, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, int64_t featureCount, int64_t positionColumnCount,
+        int64_t imageColumnCount, int64_t runLengthColumnCount);
+void helenFeatureTensor_destruct(HelenFeatureTensor *tensor);
+void helenFeatureTensor_keepReferencePositions(HelenFeatureTensor *tensor, int64_t firstRefPos,
+        int64_t lastRefPosInclusive);
+void helenFeatureTensor_writeHDF5(HelenFeatureTensor *tensor, HelenFeatureHDF5FileInfo *hdf5FileInfo);
+void helenFeatureTensor_writeNpy(HelenFeatureTensor *tensor, HelenFeatureNpyFileInfo *npyFileInfo);
+
+// Writes feature tensors to a single HDF5 file (or set of .npy files) from a dedicated sink thread, fed by a bounded queue
+#define HELEN_FEATURE_WRITER_QUEUE_SIZE_PER_THREAD 2 // Finished chunks that may wait for the writer, per polishing thread
+typedef struct _HelenFeatureWriter HelenFeatureWriter;
+struct _HelenFeatureWriter {
+    HelenFeatureOutputFormat outputFormat;
+    HelenFeatureImageEncoding imageEncoding;
+    HelenFeatureWindowMode windowMode;
+    char *outputName;
+    HelenFeatureHDF5FileInfo *fileInfo; // HFEAT_OUTPUT_HDF5 only
+    HelenFeatureNpyFileInfo *npyFileInfo; // HFEAT_OUTPUT_NPY only
+    stList *queue;
+    int64_t queueCapacity;
+    bool finished;
+    int64_t tensorsWritten;
+    pthread_t sinkThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+};
+
+HelenFeatureWriter *helenFeatureWriter_construct(char *outputName, HelenFeatureOutputFormat outputFormat,
+        int64_t compressionLevel, HelenFeatureImageEncoding imageEncoding, HelenFeatureWindowMode windowMode,
+        int64_t queueCapacity);
+void helenFeatureWriter_add(HelenFeatureWriter *writer, HelenFeatureTensor *tensor);
+void helenFeatureWriter_destruct(HelenFeatureWriter *writer);
+
+// Alignments of the true reference to the assembly, loaded once per contig and served by chunk interval
+#define HELEN_TRUTH_CACHED_CONTIGS 2 // Contigs kept loaded at once, enough for the chunks in flight at a contig change
+#define HELEN_TRUTH_BAND_WIDTH 128 // Half-width of the band around the truth alignment when labelling a chunk
+typedef struct _HelenTruthLabeler HelenTruthLabeler;
+struct _HelenTruthLabeler {
+    char *bamFile;
+    PolishParams *params;
+    stList *contigs; // loaded contigs, most recently used last
+    int64_t contigLoads;
+    pthread_mutex_t mutex; // guards the contig cache, but is not held while a contig is read from the BAM
+    pthread_cond_t contigLoaded; // signalled when a contig finishes loading, for chunks waiting on the same contig
+};
+
+HelenTruthLabeler *helenTruthLabeler_construct(char *bamFile, PolishParams *params);
+void helenTruthLabeler_destruct(HelenTruthLabeler *labeler);
+char *helenTruthLabeler_getTruth(HelenTruthLabeler *labeler, BamChunk *bamChunk, int64_t **referenceToTruth);
 
 int PoaFeature_SimpleWeight_charIndex(Symbol character, bool forward);
 int PoaFeature_SimpleWeight_gapIndex(bool forward);
@@ -87,25 +197,46 @@ PoaFeatureChannelRleWeight *PoaFeature_ChannelRleWeight_construct(int64_t refPos
 void PoaFeature_ChannelRleWeight_destruct(PoaFeatureChannelRleWeight *feature);
 
 stList *poa_getSimpleWeightFeatures(Poa *poa, stList *bamChunkReads);
+// linked run length features, used by the synchronous writers and as the reference for poa_getRleWeightFeatureTensor
 stList *poa_getSplitRleWeightFeatures(Poa *poa, stList *bamChunkReads, int64_t maxRunLength);
 stList *poa_getChannelRleWeightFeatures(Poa *poa, stList *bamChunkReads, int64_t maxRunLength);
 
-void handleHelenFeatures(HelenFeatureType helenFeatureType, BamChunker *trueReferenceBamChunker,
-        int64_t splitWeightMaxRunLength, void **helenHDF5Files, bool fullFeatureOutput, char *trueReferenceBam,
-        Params *params, char *logIdentifier, int64_t chunkIdx, BamChunk *bamChunk, Poa *poa, stList *bamChunkReads,
-        char *polishedConsensusString, RleString *polishedRleConsensus);
+void handleHelenFeatures(HelenFeatureType helenFeatureType, HelenTruthLabeler *helenTruthLabeler,
+        int64_t splitWeightMaxRunLength, HelenFeatureWriter *helenFeatureWriter, bool fullFeatureOutput, Params *params, char *logIdentifier, int64_t chunkIdx, BamChunk *bamChunk, Poa *poa, stList *bamChunkReads,
+        char *polishedConsensusString, RleString *polishedRleConsensus, RleString *rleReference);
 
 void poa_writeHelenFeatures(HelenFeatureType type, Poa *poa, stList *bamChunkReads,
         char *outputFileBase, BamChunk *bamChunk, stList *trueRefAlignment, RleString *consensusRleString,
-        RleString *trueRefRleString, bool fullFeatureOutput, int64_t splitWeightMaxRunLength, HelenFeatureHDF5FileInfo** helenHDF5Files);
+        RleString *trueRefRleString, bool fullFeatureOutput, int64_t splitWeightMaxRunLength,
+        int64_t consensusCoreStart, int64_t consensusCoreEnd, HelenFeatureWriter *helenFeatureWriter);
 
 stList *alignConsensusAndTruth(char *consensusStr, char *truthStr);
+stList *alignConsensusAndTruthBanded(char *consensusStr, char *truthStr, int64_t *referenceToTruth,
+        int64_t referenceLength, int64_t bandWidth);
+#define HELEN_CORE_ANCHOR_WINDOW 100 // Half-width of the reference window aligned to find where a core boundary is
+int64_t getConsensusPositionOfReferencePosition(RleString *consensus, RleString *reference, int64_t referencePos);
 void poa_annotateHelenFeaturesWithTruth(stList *features, HelenFeatureType featureType, stList *trueRefAlignment,
                                         RleString *trueRefRleString, int64_t *firstMatchedFeaure,
                                         int64_t *lastMatchedFeature);
 
 void printMEAAlignment(char *X, char *Y, int64_t lX, int64_t lY, stList *alignedPairs, uint64_t *Xrl, uint64_t *Yrl);
 
+HelenFeatureTensor *getSimpleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive);
+
+HelenFeatureTensor *getSplitRleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive, const int64_t maxRunLength);
+
+HelenFeatureTensor *getChannelRleWeightHelenFeatureTensor(Alphabet *alphabet, HelenFeatureImageEncoding imageEncoding,
+        char *outputFileBase, BamChunk *bamChunk, bool outputLabels, stList *features, int64_t featureStartIdx,
+        int64_t featureEndIdxInclusive, const int64_t maxRunLength);
+
+HelenFeatureTensor *poa_getRleWeightFeatureTensor(HelenFeatureType type, HelenFeatureImageEncoding imageEncoding,
+        Poa *poa, stList *bamChunkReads, const int64_t maxRunLength, char *outputFileBase, BamChunk *bamChunk,
+        stList *trueRefAlignment, RleString *trueRefRleString);
+
 void writeSimpleWeightHelenFeaturesHDF5(Alphabet *alphabet, HelenFeatureHDF5FileInfo* hdf5FileInfo, char *outputFileBase,
         BamChunk *bamChunk, bool outputLabels, stList *features,
         int64_t featureStartIdx, int64_t featureEndIdxInclusive);
@@ -64,6 +64,8 @@ typedef struct _poaDelete PoaDelete;
 typedef struct _poaBaseObservation PoaBaseObservation;
 typedef struct _rleString RleString;
 typedef struct _refMsaView MsaView;
+typedef struct _forwardScoreCache ForwardScoreCache;
+typedef struct _chunkProfile ChunkProfile;
 /*
  * Combined params object
  */
@@ -83,6 +85,20 @@ Params *params_readParams2(char *paramsFile, bool requirePolish, bool requirePha
 
 void params_destruct(Params *params);
 
+/*
+ * Compiled params: a versioned, checksummed binary image of a parsed params object, written by
+ * "marginPolish --compileParams". params_readParams2 recognises such a file by its magic and maps it
+ * instead of parsing json. The version must be incremented whenever the layout changes.
+ */
+#define PARAMS_COMPILED_MAGIC "MARGINPB"
+#define PARAMS_COMPILED_MAGIC_LENGTH 8
+#define PARAMS_COMPILED_VERSION 1
+#define PARAMS_COMPILED_BYTE_ORDER_MARK 0x01020304
+
+void params_writeCompiled(Params *params, char *outputFile);
+
+Params *params_readCompiled(char *paramsFile, bool requirePolish, bool requirePhase);
+
 void params_printParameters(Params *params, FILE *fh);
 
 /*
@@ -216,10 +232,16 @@ int stRPProfileSeq_cmpFn(const void *a, const void *b);
 /*
  * Emission probabilities methods
  */
+#define EMISSION_PARTITION_BLOCK_SIZE 16 // Number of partitions whose emissions are calculated together
+
 double emissionLogProbability(stRPColumn *column, stRPCell *cell, uint64_t *bitCountVectors,
                                 stReference *reference,
                                 stRPHmmParameters *params);
 
+void emissionLogProbabilities(stRPColumn *column, stRPCell *cells, int64_t cellNo,
+                              uint64_t *bitCountVectors, stReference *reference,
+                              stRPHmmParameters *params, double *emissionLogProbs);
+
 void fillInPredictedGenome(stGenomeFragment *gF, uint64_t partition,
         stRPColumn *column, stRPHmmParameters *params);
 
@@ -231,6 +253,9 @@ int popcount64(uint64_t x);
 uint64_t getLogProbOfAllele(uint64_t *bitCountVectors, uint64_t depth, uint64_t partition,
 							uint64_t siteOffset, uint64_t allele);
 
+void getLogProbsOfAllele(uint64_t *bitCountVectors, uint64_t *partitions, int64_t partitionNo,
+						 uint64_t siteOffset, uint64_t allele, uint64_t *negLogProbs, int64_t stride);
+
 uint64_t *calculateCountBitVectors(uint8_t **seqs, stReference *ref,
 								   uint64_t firstSite, uint64_t length, uint64_t depth);
 
@@ -250,6 +275,11 @@ struct _stRPHmmParameters {
     int64_t maxPartitionsInAColumn;
     double minPosteriorProbabilityForPartition;
 
+    // If greater than zero, the forward pass keeps only this many of the states with highest forward
+    // probability in each column, discarding the rest before they propagate (a beam search). This bounds
+    // the work per column in deep regions, at the cost of the probability mass discarded.
+    int64_t beamWidth;
+
     // MaxCoverageDepth is the maximum depth of profileSeqs to allow at any base.
     // If the coverage depth is higher than this then some profile seqs are randomly discarded.
     int64_t maxCoverageDepth;
@@ -286,6 +316,9 @@ struct _stRPHmm {
     //Forward/backward probability calculation things
     double forwardLogProb;
     double backwardLogProb;
+    // Forward probability mass (and number of states) discarded by the beam in the last forward pass
+    double beamDiscardedLogProb;
+    int64_t beamDiscardedCells;
 };
 
 stRPHmm *stRPHmm_construct(stProfileSeq *profileSeq, stRPHmmParameters *params);
@@ -332,7 +365,10 @@ struct _stRPColumn {
     int64_t depth;
     stProfileSeq **seqHeaders;
     uint8_t **seqs;
-    stRPCell *head;
+    stRPCell *cells; // Contiguous array of the states of the column
+    int64_t cellNo; // Number of states in cells
+    int64_t cellCapacity; // Allocated length of cells
+    uint64_t *bitCountVectors; // Bit count vectors of the column's sequences, NULL until calculated
     stRPMergeColumn *nColumn, *pColumn;
     double totalLogProb;
 };
@@ -350,6 +386,14 @@ stSet *stRPColumn_getSequencesInCommon(stRPColumn *column1, stRPColumn *column2)
 
 stSet *stRPColumn_getColumnSequencesAsSet(stRPColumn *column);
 
+void stRPColumn_reserveCells(stRPColumn *column, int64_t cellNo);
+
+stRPCell *stRPColumn_addCell(stRPColumn *column, uint64_t partition);
+
+void stRPColumn_setCells(stRPColumn *column, stList *cells);
+
+uint64_t *stRPColumn_getBitCountVectors(stRPColumn *column, stReference *ref);
+
 /*
  * _stRPCell
  * State of read partitioning hmm
@@ -357,13 +401,8 @@ stSet *stRPColumn_getColumnSequencesAsSet(stRPColumn *column);
 struct _stRPCell {
     uint64_t partition;
     double forwardLogProb, backwardLogProb;
-    stRPCell *nCell;
 };
 
-stRPCell *stRPCell_construct(int64_t partition);
-
-void stRPCell_destruct(stRPCell *cell);
-
 void stRPCell_print(stRPCell *cell, FILE *fileHandle);
 
 double stRPCell_posteriorProb(stRPCell *cell, stRPColumn *column);
@@ -375,8 +414,12 @@ double stRPCell_posteriorProb(stRPCell *cell, stRPColumn *column);
 struct _stRPMergeColumn {
     uint64_t maskFrom;
     uint64_t maskTo;
-    stHash *mergeCellsFrom;
-    stHash *mergeCellsTo;
+    stRPMergeCell *mergeCells; // Contiguous array of the merge states
+    int64_t mergeCellNo; // Number of merge states in mergeCells
+    int64_t mergeCellCapacity; // Allocated length of mergeCells
+    int64_t *mergeCellsFrom; // Open addressing table from "from" partition to index in mergeCells, -1 if empty
+    int64_t *mergeCellsTo; // Open addressing table from "to" partition to index in mergeCells, -1 if empty
+    int64_t mergeCellIndexSize; // Length of the open addressing tables, a power of two
     stRPColumn *nColumn, *pColumn;
 };
 
@@ -392,6 +435,8 @@ stRPMergeCell *stRPMergeColumn_getPreviousMergeCell(stRPCell *cell, stRPMergeCol
 
 int64_t stRPMergeColumn_numberOfPartitions(stRPMergeColumn *mColumn);
 
+void stRPMergeColumn_retainMergeCells(stRPMergeColumn *mColumn, stSet *mergeCellsToRetain);
+
 /*
  * _stRPMergeCell
  * Merge cell of read partitioning hmm
@@ -405,8 +450,6 @@ struct _stRPMergeCell {
 stRPMergeCell *stRPMergeCell_construct(uint64_t fromPartition,
         uint64_t toPartition, stRPMergeColumn *mColumn);
 
-void stRPMergeCell_destruct(stRPMergeCell *mCell);
-
 void stRPMergeCell_print(stRPMergeCell *mCell, FILE *fileHandle);
 
 double stRPMergeCell_posteriorProb(stRPMergeCell *mCell, stRPMergeColumn *mColumn);
@@ -564,6 +607,7 @@ struct _polishParams {
 	uint64_t maxRealignmentPolishIterations; // Maximum number of poa_polish iterations
 	uint64_t minRealignmentPolishIterations; // Minimum number of poa_polish iterations
 	uint64_t minReadsToCallConsensus; // Min reads to choose between consensus sequences for a region
+	uint64_t forwardScoreCacheMaxMemory; // Maximum bytes of (allele, read substring) forward scores cached per chunk, 0 disables caching
 	uint64_t filterReadsWhileHaveAtLeastThisCoverage; // Only filter read substrings if we have at least this coverage
 	// at a locus
 	double minAvgBaseQuality; // Minimum average base quality to include a substring for consensus finding
@@ -630,8 +674,12 @@ struct _poaBaseObservation {
  * Poa functions.
  */
 
+PoaInsert *poaInsert_construct(RleString *insert, double weight, bool strand);
+
 double poaInsert_getWeight(PoaInsert *toInsert);
 
+PoaDelete *poaDelete_construct(int64_t length, double weight, bool strand);
+
 double poaDelete_getWeight(PoaDelete *toDelete);
 
 /*
@@ -708,8 +756,8 @@ void poa_printSummaryStats(Poa *poa, FILE *fH);
  */
 RleString *poa_getConsensus(Poa *poa, int64_t **poaToConsensusMap, PolishParams *polishParams);
 
-RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params,
-				  int64_t **poaToConsensusMap);
+RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params, ForwardScoreCache *forwardScoreCache,
+				  ChunkProfile *chunkProfile, int64_t **poaToConsensusMap);
 
 
 /*
@@ -720,7 +768,8 @@ RleString *poa_polish(Poa *poa, stList *bamChunkReads, PolishParams *params,
  */
 Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 						   PolishParams *polishParams, bool hmmMNotRealign,
-						   int64_t minIterations, int64_t maxIterations);
+						   int64_t minIterations, int64_t maxIterations, ForwardScoreCache *forwardScoreCache,
+						   ChunkProfile *chunkProfile);
 
 /*
  * Convenience function that iteratively polishes sequence using poa_getConsensus and then poa_polish for
@@ -729,6 +778,22 @@ Poa *poa_realignIterative(Poa *poa, stList *bamChunkReads,
 Poa *poa_realignAll(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
 						  PolishParams *polishParams);
 
+/*
+ * As poa_realignAll, but using the given forward score cache (which may be NULL) for the poa_polish rounds, so that
+ * the cached scores can be reused by the caller, and recording the time of each stage in chunkProfile (which may
+ * be NULL).
+ */
+Poa *poa_realignAll2(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
+						  PolishParams *polishParams, ForwardScoreCache *forwardScoreCache, ChunkProfile *chunkProfile);
+
+/*
+ * Returns a rough estimate, in bytes, of the peak memory needed to run poa_realignAll and estimate repeat counts
+ * for the given reads, anchor alignments and reference, including the chunk's forward score cache at its cap. Used to
+ * budget memory across concurrently polished chunks.
+ */
+int64_t poa_estimatePeakMemory(stList *bamChunkReads, stList *anchorAlignments, RleString *reference,
+		PolishParams *polishParams);
+
 /*
  * Greedily evaluate the top scoring indels.
  */
@@ -880,6 +945,23 @@ double *repeatSubMatrix_setLogProb(RepeatSubMatrix *repeatSubMatrix, Symbol base
 double repeatSubMatrix_getLogProbForGivenRepeatCount(RepeatSubMatrix *repeatSubMatrix, Symbol base,
         stList *observations, stList *bamChunkReads, int64_t underlyingRepeatCount);
 
+/*
+ * Builds the weighted histograms of observed repeat counts, split by strand, for a set of observations, each an array
+ * of length 2 * maximumRepeatLength indexed [strand_idx * maximumRepeatLength + observedRepeatCount]. If readsBelongingToHap1
+ * is non-NULL the observations are split between histogramHap1 and histogramHap2 by haplotype, otherwise all go in
+ * histogramHap1. The histograms must be zeroed by the caller.
+ */
+void repeatSubMatrix_getRepeatCountHistograms(RepeatSubMatrix *repeatSubMatrix, stList *observations, stList *bamChunkReads,
+		stSet *readsBelongingToHap1, double *histogramHap1, double *histogramHap2,
+		int64_t *observationNoHap1, int64_t *observationNoHap2);
+
+/*
+ * As repeatSubMatrix_getLogProbForGivenRepeatCount, but using a histogram of the observations, considering only observed
+ * repeat counts in the range [minRepeatLength, maxRepeatLength].
+ */
+double repeatSubMatrix_getLogProbForGivenRepeatCountHistogram(RepeatSubMatrix *repeatSubMatrix, Symbol base,
+		double *histogram, int64_t minRepeatLength, int64_t maxRepeatLength, int64_t underlyingRepeatCount);
+
 /*
  * Gets the maximum likelihood underlying repeat count for a given set of observed read repeat counts.
  * Puts the ml log probility in *logProbabilty.
@@ -959,6 +1041,18 @@ BamChunkRead *bamChunkRead_construct2(char *readName, char *nucleotides, uint8_t
 BamChunkRead *bamChunkRead_constructCopy(BamChunkRead *copy);
 void bamChunkRead_destruct(BamChunkRead *bamChunkRead);
 
+/*
+ * Reads the reference fasta into a map from contig name to sequence, dropping anything after the first whitespace in
+ * each name.
+ */
+stHash *parseReferenceSequences(char *referenceFastaFile);
+
+/*
+ * Gets the (run length encoded, if the params say so) reference sequence under the chunk, including its boundaries.
+ * Returns NULL if the chunk's contig is not in the map.
+ */
+RleString *bamChunk_getReferenceSubstring(BamChunk *bamChunk, stHash *referenceSequences, Params *params);
+
 /*
  * Generates the expanded non-rle version of bam chunk read nucleotide sequence.
  */
@@ -971,20 +1065,165 @@ typedef struct _bamChunkReadSubstring {
 	double qualValue;
 } BamChunkReadSubstring;
 
+BamChunkReadSubstring *bamChunkRead_getSubstring(BamChunkRead *bamChunkRead, int64_t start, int64_t length, PolishParams *params);
+
+void bamChunkReadSubstring_destruct(BamChunkReadSubstring *rs);
+
 /*
  * Gets the RLE substring for the bam chunk read substring.
  */
 RleString *bamChunkReadSubstring_getRleString(BamChunkReadSubstring *readSubstring);
 
+/*
+ * Gets the expanded, non-RLE string for the bam chunk read substring, without copying the RLE substring.
+ */
+char *bamChunkReadSubstring_expand(BamChunkReadSubstring *readSubstring);
+
+/*
+ * Hash and equality functions for using read substrings as keys, comparing the RLE characters and repeat counts
+ * of the substrings in place in their parent reads.
+ */
+uint64_t bamChunkReadSubstring_hashKey(const void *k);
+
+int bamChunkReadSubstring_equalKey(const void *key1, const void *key2);
+
 /*
  * Remove overlap between two overlapping strings. Returns max weight of split point.
  */
 int64_t removeOverlap(char *prefixString, char *suffixString, int64_t approxOverlap, PolishParams *polishParams,
 				      int64_t *prefixStringCropEnd, int64_t *suffixStringCropStart);
+
+/*
+ * Merge the polished strings of the chunks of a contig. If chunkProfiles is non-NULL the time taken to stitch each
+ * chunk to its predecessor is added to the merge stage of chunkProfiles[chunkIdx].
+ */
 char *mergeContigChunksThreaded(char **chunks, int64_t startIdx, int64_t endIdxExclusive, int64_t numThreads,
-								int64_t overlap, Params *params, char *missingChunkSpacer, char *referenceSequenceName);
+								int64_t overlap, Params *params, char *missingChunkSpacer, char *referenceSequenceName,
+								ChunkProfile **chunkProfiles);
 char *mergeContigChunks(char **chunks, int64_t startIdx, int64_t endIdxExclusive,
-								int64_t overlap, Params *params, char *missingChunkSpacer);
+								int64_t overlap, Params *params, char *missingChunkSpacer, ChunkProfile **chunkProfiles);
+
+/*
+ * Hot-path work counters, which count the work done by the pair-HMM, the POA and the phasing HMM so slow chunks
+ * can be attributed to long reads, wide bands or combinatorial bubbles. The counters are thread local and only
+ * compiled in when _HOT_PATH_COUNTERS is defined (the HOT_PATH_COUNTERS cmake option), otherwise HOT_PATH_COUNT
+ * expands to nothing.
+ */
+
+typedef enum {
+	HOT_PATH_COUNTER_DP_CELLS=0, // Cells computed by the forward, backward and total probability recursions
+	HOT_PATH_COUNTER_POSTERIOR_PAIRS=1, // Aligned pairs emitted with a posterior probability above p->threshold
+	HOT_PATH_COUNTER_FORWARD_PROBABILITY_CALLS=2, // Calls to computeForwardProbability
+	HOT_PATH_COUNTER_FORWARD_PROBABILITY_CELLS=3, // Cells computed by computeForwardProbability, part of DP_CELLS
+	HOT_PATH_COUNTER_BUBBLES=4, // Bubbles in constructed bubble graphs
+	HOT_PATH_COUNTER_BUBBLE_ALLELES=5, // Alleles summed over the bubbles
+	HOT_PATH_COUNTER_HMM_COLUMNS=6, // Columns of read partitioning hmms after stRPHmm_prune
+	HOT_PATH_COUNTER_HMM_CELLS=7, // Cells of read partitioning hmms after stRPHmm_prune
+	HOT_PATH_COUNTER_POA_INSERTS=8, // Inserts added to the poa by poa_augment
+	HOT_PATH_COUNTER_POA_DELETES=9, // Deletes added to the poa by poa_augment
+	HOT_PATH_COUNTER_NUMBER=10
+} HotPathCounter;
+
+#ifdef _HOT_PATH_COUNTERS
+extern __thread int64_t hotPathCounters[HOT_PATH_COUNTER_NUMBER];
+#define HOT_PATH_COUNT(counter, n) (hotPathCounters[(counter)] += (n))
+#else
+#define HOT_PATH_COUNT(counter, n) ((void) 0)
+#endif
+
+/*
+ * Returns true if the counters were compiled in.
+ */
+bool hotPathCounters_enabled();
+
+/*
+ * Adds the counts of the calling thread to counters.
+ */
+void hotPathCounters_add(int64_t *counters);
+
+/*
+ * Subtracts the counts of the calling thread from counters, so that a following hotPathCounters_add on the same
+ * thread leaves counters holding the work done in between.
+ */
+void hotPathCounters_subtract(int64_t *counters);
+
+/*
+ * Logs the counters, with the alleles per bubble and cells per hmm column derived from them, as a run summary.
+ */
+void hotPathCounters_logSummary(int64_t *counters);
+
+/*
+ * Per-chunk profile of the time spent in each stage of polishing a chunk, written as one json object per line
+ * for capacity planning and for finding pathological regions. All functions accept a NULL profile, so
+ * callers can time stages unconditionally.
+ */
+
+typedef enum {
+	CHUNK_STAGE_BAM_FETCH=0, // convertToReadsAndAlignments
+	CHUNK_STAGE_DOWNSAMPLE=1,
+	CHUNK_STAGE_INITIAL_REALIGN=2, // The first poa_realign
+	CHUNK_STAGE_CONSENSUS=3, // All poa_getConsensus rounds, including their realignment
+	CHUNK_STAGE_POLISH=4, // All poa_polish rounds, including their realignment
+	CHUNK_STAGE_BUBBLE_GRAPH=5, // Building bubble graphs, part of CHUNK_STAGE_POLISH
+	CHUNK_STAGE_REPEAT_COUNTS=6, // Repeat count estimation, partly within CHUNK_STAGE_CONSENSUS and CHUNK_STAGE_POLISH
+	CHUNK_STAGE_FEATURES=7, // HELEN feature generation
+	CHUNK_STAGE_MERGE=8, // Stitching the chunk to the previous chunk of the contig
+	CHUNK_STAGE_NUMBER=9
+} ChunkStage;
+
+typedef struct _chunkProfileIteration {
+	bool consensus; // poa_getConsensus round if true, else poa_polish round
+	double consensusSeconds; // Time to find the new consensus string
+	double realignSeconds; // Time to realign the reads to it, including repeat count estimation
+} ChunkProfileIteration;
+
+struct _chunkProfile {
+	int64_t chunkIdx;
+	char *refSeqName;
+	int64_t chunkBoundaryStart;
+	int64_t chunkBoundaryEnd;
+	double stageSeconds[CHUNK_STAGE_NUMBER];
+	double totalSeconds; // Wall time to polish the chunk, excluding CHUNK_STAGE_MERGE
+	stList *iterations; // ChunkProfileIteration for each consensus and polish round, in order
+	int64_t readCount;
+	int64_t rleNucleotides; // Total RLE length of the reads
+	int64_t nodeCount; // Nodes in the final poa
+	int64_t bubbleCount; // Bubbles summed over the poa_polish rounds
+	int64_t peakRssKb; // Peak resident set size of the process when the chunk finished
+	int64_t counters[HOT_PATH_COUNTER_NUMBER]; // Hot-path work done polishing the chunk, if compiled in
+};
+
+ChunkProfile *chunkProfile_construct(int64_t chunkIdx, char *refSeqName, int64_t chunkBoundaryStart,
+		int64_t chunkBoundaryEnd);
+
+void chunkProfile_destruct(ChunkProfile *profile);
+
+/*
+ * Seconds from an arbitrary fixed point on a monotonic clock.
+ */
+double chunkProfile_getTime();
+
+void chunkProfile_addStageTime(ChunkProfile *profile, ChunkStage stage, double seconds);
+
+void chunkProfile_addIteration(ChunkProfile *profile, bool consensus, double consensusSeconds, double realignSeconds);
+
+/*
+ * Bracket the polishing of the chunk, attributing the hot-path work counted on the calling thread in between to the
+ * profile. Both must be called on the same thread.
+ */
+void chunkProfile_startCounters(ChunkProfile *profile);
+
+void chunkProfile_stopCounters(ChunkProfile *profile);
+
+/*
+ * Sets the read, node and peak memory statistics from the reads and poa of the chunk.
+ */
+void chunkProfile_setChunkStats(ChunkProfile *profile, stList *bamChunkReads, Poa *poa);
+
+/*
+ * Writes the profile as a single line json object.
+ */
+void chunkProfile_writeJson(ChunkProfile *profile, FILE *fh);
 
 /*
  * View functions
@@ -1102,6 +1341,49 @@ RleString *bubbleGraph_getConsensusString(BubbleGraph *bg, uint64_t *consensusPa
  */
 BubbleGraph *bubbleGraph_constructFromPoa(Poa *poa, stList *bamChunkReads, PolishParams *params);
 
+/*
+ * As bubbleGraph_constructFromPoa, but looks up and stores the read substring / allele forward scores in the given
+ * cache, which may be NULL.
+ */
+BubbleGraph *bubbleGraph_constructFromPoa2(Poa *poa, stList *bamChunkReads, PolishParams *params,
+		ForwardScoreCache *forwardScoreCache);
+
+/*
+ * Gets up to maximumStringNumber distinct candidate consensus substrings for the interval of the poa from
+ * "from" (inclusive) to "to" (exclusive), formed from the combinations of candidate bases, repeat counts and indels
+ * whose weights exceed candidateWeights. Substrings are returned in descending order of the summed log fraction of
+ * poa weight supporting each choice.
+ */
+stList *getKBestCandidateConsensusSubstrings(Poa *poa, int64_t from, int64_t to,
+											 double *candidateWeights, int64_t maximumStringNumber);
+
+/*
+ * A cache of the forward probabilities of read substrings given alleles, keyed by the expanded allele string,
+ * the expanded read substring and the read strand. Used to avoid rescoring the same bubbles across polishing
+ * rounds of a chunk. Least recently used scores are evicted once the memory used exceeds maxMemory bytes.
+ * Is safe to access concurrently.
+ */
+ForwardScoreCache *forwardScoreCache_construct(uint64_t maxMemory);
+
+void forwardScoreCache_destruct(ForwardScoreCache *cache);
+
+/*
+ * Looks up the score for the given allele, read substring and strand. Returns non-zero and sets score if present.
+ */
+bool forwardScoreCache_get(ForwardScoreCache *cache, char *allele, char *readSubstring, bool forwardStrand, float *score);
+
+/*
+ * Adds the score for the given allele, read substring and strand, evicting least recently used scores as needed.
+ */
+void forwardScoreCache_add(ForwardScoreCache *cache, char *allele, char *readSubstring, bool forwardStrand, float score);
+
+/*
+ * Number of lookups that did and did not find a cached score.
+ */
+uint64_t forwardScoreCache_getHits(ForwardScoreCache *cache);
+
+uint64_t forwardScoreCache_getMisses(ForwardScoreCache *cache);
+
 void bubbleGraph_destruct(BubbleGraph *bg);
 
 /*
@@ -1179,6 +1461,22 @@ typedef enum {
 	HFEAT_CHANNEL_RLE_WEIGHT=3,
 } HelenFeatureType;
 
+typedef enum {
+	HFEAT_IMAGE_NORMALIZED_UINT8=0, // weight fractions of the position's total weight, quantized to uint8 (HELEN's models)
+	HFEAT_IMAGE_FLOAT16=1, // weight fractions of the position's total weight, as half precision floats
+	HFEAT_IMAGE_SCALED_UINT8=2, // weight fractions quantized to uint8 against the largest in the window, with its scale
+} HelenFeatureImageEncoding;
+
+typedef enum {
+	HFEAT_WINDOW_OVERLAPPING=0, // full windows over the whole chunk, the last shifted back to overlap the one before
+	HFEAT_WINDOW_CORE=1, // consecutive windows over the chunk core only, the last zero padded with a row mask
+} HelenFeatureWindowMode;
+
+typedef enum {
+	HFEAT_OUTPUT_HDF5=0, // one group per window in a single .h5 file
+	HFEAT_OUTPUT_NPY=1, // fixed size windows appended to a few .npy files, with a TSV index of the windows
+} HelenFeatureOutputFormat;
+
 #define POAFEATURE_SPLIT_MAX_RUN_LENGTH_DEFAULT 10
 #define POAFEATURE_CHANNEL_MAX_RUN_LENGTH_DEFAULT 10
 
@@ -31,6 +31,12 @@ SymbolString symbolString_construct(const char *sequence, int64_t start, int64_t
 
 SymbolString symbolString_getSubString(SymbolString s, uint64_t start, uint64_t length);
 
+/*
+ * As symbolString_getSubString, but the returned string shares its symbols with s, so
+ * must not be destructed and is only valid while s is.
+ */
+SymbolString symbolString_getView(SymbolString s, uint64_t start, uint64_t length);
+
 void symbolString_destruct(SymbolString s);
 
 /*
@@ -129,6 +135,17 @@ StateMachine *stateMachine3_construct(StateMachineType type, Emissions *e); //th
 
 StateMachine *stateMachine3_constructNucleotide(StateMachineType type); // Construct with default nucleotide emission model
 
+#define STATE_MACHINE3_TRANSITION_NUMBER 9
+
+/*
+ * Get/set the log transition probabilities of a three state state-machine, as an array of
+ * STATE_MACHINE3_TRANSITION_NUMBER values (match continue, match from gap x/y, gap open x/y,
+ * gap extend x/y, gap switch to x/y).
+ */
+void stateMachine3_getTransitions(StateMachine *sM, double *transitions);
+
+void stateMachine3_setTransitions(StateMachine *sM, double *transitions);
+
 void stateMachine_destruct(StateMachine *stateMachine);
 
 /*
@@ -41,56 +41,9 @@ void usage() {
     fprintf(stderr, "                               Format: chr:start_pos-end_pos (chr3:2000-3000).\n");
     fprintf(stderr, "    -i --outputRepeatCounts        : File to write out the repeat counts [default = NULL]\n");
     fprintf(stderr, "    -j --outputPoaTsv        : File to write out the poa as TSV file [default = NULL]\n");
-}
-
-stHash *parseReferenceSequences(char *referenceFastaFile) {
-	/*
-	 * Get hash of reference sequence names in fasta to their sequences, doing some munging on the sequence names.
-	 */
-	st_logInfo("> Parsing reference sequences from file: %s\n", referenceFastaFile);
-	FILE *fh = fopen(referenceFastaFile, "r");
-	stHash *referenceSequences = fastaReadToMap(fh);  //valgrind says blocks from this allocation are "still reachable"
-	fclose(fh);
-	// log names and transform (if necessary)
-	stList *refSeqNames = stHash_getKeys(referenceSequences);
-	int64_t origRefSeqLen = stList_length(refSeqNames);
-	st_logDebug("\tReference contigs: \n");
-	for (int64_t i = 0; i < origRefSeqLen; ++i) {
-		char *fullRefSeqName = (char *) stList_get(refSeqNames, i);
-		st_logDebug("\t\t%s\n", fullRefSeqName);
-		char refSeqName[128] = "";
-		if (sscanf(fullRefSeqName, "%s", refSeqName) == 1 && !stString_eq(fullRefSeqName, refSeqName)) {
-			// this transformation is necessary for cases where the reference has metadata after the contig name:
-			// >contig001 length=1000 date=1999-12-31
-			char *newKey = stString_copy(refSeqName);
-			char *refSeq = stHash_search(referenceSequences, fullRefSeqName);
-			stHash_insert(referenceSequences, newKey, refSeq);
-			stHash_removeAndFreeKey(referenceSequences, fullRefSeqName);
-			st_logDebug("\t\t\t-> %s\n", newKey);
-		}
-	}
-	stList_destruct(refSeqNames);
-
-	return referenceSequences;
-}
-
-RleString *bamChunk_getReferenceSubstring(BamChunk *bamChunk, stHash *referenceSequences, Params *params) {
-	/*
-	 * Get corresponding substring of the reference for a given bamChunk.
-	 */
-	char *fullReferenceString = stHash_search(referenceSequences, bamChunk->refSeqName);
-	if (fullReferenceString == NULL) {
-		st_logCritical("> ERROR: Reference sequence missing from reference map: %s \n", bamChunk->refSeqName);
-		return NULL;
-	}
-	int64_t refLen = strlen(fullReferenceString);
-	char *referenceString = stString_getSubString(fullReferenceString, bamChunk->chunkBoundaryStart,
-		(refLen < bamChunk->chunkBoundaryEnd ? refLen : bamChunk->chunkBoundaryEnd) - bamChunk->chunkBoundaryStart);
-
-	RleString *rleRef = params->polishParams->useRunLengthEncoding ? rleString_construct(referenceString) : rleString_construct_no_rle(referenceString);
-	free(referenceString);
-
-	return rleRef;
+    fprintf(stderr, "    -t --threads           : Set number of concurrent threads [default = 1]\n");
+    fprintf(stderr, "    -w --reorderWindow     : Maximum number of chunks polished ahead of the next chunk to be written,\n");
+    fprintf(stderr, "                               bounding the memory held by finished chunks [default = 2 * threads]\n");
 }
 
 typedef struct _polishedReferenceSequence {
@@ -230,6 +183,256 @@ uint64_t *getPaddedHaplotypeString(uint64_t *hap, stGenomeFragment *gf, BubbleGr
 	return paddedHap;
 }
 
+typedef struct _polishedChunk {
+	/*
+	 * The polished POA(s) of a chunk, held until the chunk can be written out in order.
+	 */
+	BamChunk *bamChunk;
+	RleString *reference;
+	stList *reads;
+	Poa *poa_hap1; // The haploid POA if not diploid
+	Poa *poa_hap2; // NULL if not diploid
+} PolishedChunk;
+
+void polishedChunk_destruct(PolishedChunk *pChunk) {
+	poa_destruct(pChunk->poa_hap1);
+	if(pChunk->poa_hap2 != NULL) {
+		poa_destruct(pChunk->poa_hap2);
+	}
+	stList_destruct(pChunk->reads);
+	rleString_destruct(pChunk->reference);
+	free(pChunk);
+}
+
+PolishedChunk *polishChunk(BamChunk *bamChunk, stHash *referenceSequences, char *bamInFile, bool diploid, Params *params) {
+	/*
+	 * Polishes (and if diploid, phases) a single chunk. Does not modify any shared state, so
+	 * chunks can be polished concurrently.
+	 */
+	RleString *reference = bamChunk_getReferenceSubstring(bamChunk, referenceSequences, params);
+
+	st_logInfo("> Going to process a chunk for reference sequence: %s, starting at: %i and ending at: %i\n",
+			   bamChunk->refSeqName, (int)bamChunk->chunkBoundaryStart,
+			   (int)bamChunk->chunkBoundaryEnd);
+
+	// Convert bam lines into corresponding reads and alignments
+	st_logInfo("> Parsing input reads from file: %s\n", bamInFile);
+	stList *reads = stList_construct3(0, (void (*)(void *))bamChunkRead_destruct);
+	stList *alignments = stList_construct3(0, (void (*)(void *))stList_destruct);
+	convertToReadsAndAlignments(bamChunk, reference, reads, alignments);
+
+	// Now run the polishing method
+
+	// Forward scores are cached across the polishing rounds and the phasing bubble graph of the chunk
+	ForwardScoreCache *forwardScoreCache = params->polishParams->forwardScoreCacheMaxMemory > 0 ?
+			forwardScoreCache_construct(params->polishParams->forwardScoreCacheMaxMemory) : NULL;
+
+	// Generate the haploid partial order alignment (POA)
+	Poa *poa = poa_realignAll2(reads, alignments, reference, params->polishParams, forwardScoreCache, NULL);
+
+	PolishedChunk *pChunk = st_calloc(1, sizeof(PolishedChunk));
+	pChunk->bamChunk = bamChunk;
+	pChunk->reference = reference;
+	pChunk->reads = reads;
+
+	// If diploid
+	if(diploid) {
+		// Get the bubble graph representation, using a copy of the polish params so that concurrently
+		// polished chunks do not see the toggled read allele setting
+		PolishParams phasingPolishParams = *params->polishParams;
+		phasingPolishParams.useReadAlleles = params->polishParams->useReadAllelesInPhasing;
+		BubbleGraph *bg = bubbleGraph_constructFromPoa2(poa, reads, &phasingPolishParams, forwardScoreCache);
+
+		// Phasing toggles fields of the phase params, so likewise give the chunk its own copy
+		stRPHmmParameters chunkPhaseParams = *params->phaseParams;
+		Params chunkParams = { params->polishParams, &chunkPhaseParams };
+
+		// Now make a POA for each of the haplotypes
+		stHash *readsToPSeqs;
+		stGenomeFragment *gf = bubbleGraph_phaseBubbleGraph(bg, bamChunk->refSeqName, reads, &chunkParams, &readsToPSeqs);
+
+		stSet *readsBelongingToHap1, *readsBelongingToHap2;
+		stGenomeFragment_phaseBamChunkReads(gf, readsToPSeqs, reads, &readsBelongingToHap1, &readsBelongingToHap2);
+		st_logInfo("After phasing, of %i reads got %i reads partitioned into hap1 and %i reads partitioned into hap2 (%i unphased)\n",
+		(int)stList_length(reads), (int)stSet_size(readsBelongingToHap1), (int)stSet_size(readsBelongingToHap2), 
+		(int)(stList_length(reads) - stSet_size(readsBelongingToHap1)- stSet_size(readsBelongingToHap2)));
+
+		// Debug report of hets
+		uint64_t totalHets = 0;
+		for(uint64_t i=0; i<gf->length; i++) {
+			Bubble *b = &bg->bubbles[i+gf->refStart];
+			if(gf->haplotypeString1[i] != gf->haplotypeString2[i]) {
+				st_logDebug("Got predicted het at bubble %i %s %s\n", (int)i+gf->refStart, b->alleles[gf->haplotypeString1[i]]->rleString,
+						b->alleles[gf->haplotypeString2[i]]->rleString);
+				totalHets++;
+			}
+			else if(!rleString_eq(b->alleles[gf->haplotypeString1[i]], b->refAllele)) {
+				st_logDebug("Got predicted hom alt at bubble %i %i\n", (int)i+gf->refStart, (int)gf->haplotypeString1[i]);
+			}
+		}
+		st_logInfo("In phasing chunk, got: %i hets from: %i total sites (fraction: %f)\n", (int)totalHets, (int)gf->length, (float)totalHets/gf->length);
+
+		st_logInfo("Building POA for each haplotype\n");
+		uint64_t *hap1 = getPaddedHaplotypeString(gf->haplotypeString1, gf, bg, params);
+		uint64_t *hap2 = getPaddedHaplotypeString(gf->haplotypeString2, gf, bg, params);
+
+		Poa *poa_hap1 = bubbleGraph_getNewPoa(bg, hap1, poa, reads, params);
+		Poa *poa_hap2 = bubbleGraph_getNewPoa(bg, hap2, poa, reads, params);
+
+		/*st_logInfo("Using read phasing to reestimate bases in phased manner\n");
+		poa_estimatePhasedBasesUsingBayesianModel(poa_hap1, reads,
+				readsBelongingToHap1, readsBelongingToHap2, params->polishParams);
+
+		poa_estimatePhasedBasesUsingBayesianModel(poa_hap2, reads,
+							readsBelongingToHap2, readsBelongingToHap1, params->polishParams);*/
+
+		if(params->polishParams->useRunLengthEncoding) {
+			st_logInfo("Using read phasing to reestimate repeat counts in phased manner\n");
+			poa_estimatePhasedRepeatCountsUsingBayesianModel(poa_hap1, reads,
+					params->polishParams->repeatSubMatrix, readsBelongingToHap1, readsBelongingToHap2, params->polishParams);
+
+			poa_estimatePhasedRepeatCountsUsingBayesianModel(poa_hap2, reads,
+					params->polishParams->repeatSubMatrix, readsBelongingToHap2, readsBelongingToHap1, params->polishParams);
+		}
+
+		pChunk->poa_hap1 = poa_hap1;
+		pChunk->poa_hap2 = poa_hap2;
+
+		// Cleanup
+		free(hap1);
+		free(hap2);
+		bubbleGraph_destruct(bg);
+		stGenomeFragment_destruct(gf);
+		stSet_destruct(readsBelongingToHap1);
+		stSet_destruct(readsBelongingToHap2);
+		stHash_destruct(readsToPSeqs);
+		poa_destruct(poa);
+	}
+	else {
+		pChunk->poa_hap1 = poa;
+	}
+
+	// Cleanup
+	if(forwardScoreCache != NULL) {
+		st_logInfo("Forward score cache for chunk got %" PRIu64 " hits and %" PRIu64 " misses\n",
+				forwardScoreCache_getHits(forwardScoreCache), forwardScoreCache_getMisses(forwardScoreCache));
+		forwardScoreCache_destruct(forwardScoreCache);
+	}
+	stList_destruct(alignments);
+
+	return pChunk;
+}
+
+/*
+ * Ordered completion of concurrently polished chunks
+ */
+
+#define CHUNK_REORDER_POLL_MICROSECONDS 10000
+
+typedef struct _chunkReorderBuffer {
+	/*
+	 * Holds chunks that finished polishing out of order until all preceding chunks have been written.
+	 * At most windowSize chunks are claimed ahead of the next chunk to be written, which bounds the number
+	 * of polished chunks held in memory.
+	 */
+	PolishedChunk **slots; // Polished chunk i is held in slot i % windowSize until written
+	int64_t windowSize;
+	int64_t chunkCount;
+	int64_t nextChunkToClaim;
+	int64_t nextChunkToWrite;
+} ChunkReorderBuffer;
+
+ChunkReorderBuffer *chunkReorderBuffer_construct(int64_t chunkCount, int64_t windowSize) {
+	assert(windowSize > 0);
+	ChunkReorderBuffer *buffer = st_calloc(1, sizeof(ChunkReorderBuffer));
+	buffer->slots = st_calloc(windowSize, sizeof(PolishedChunk *));
+	buffer->windowSize = windowSize;
+	buffer->chunkCount = chunkCount;
+	return buffer;
+}
+
+void chunkReorderBuffer_destruct(ChunkReorderBuffer *buffer) {
+	assert(buffer->nextChunkToWrite == buffer->chunkCount);
+	free(buffer->slots);
+	free(buffer);
+}
+
+int64_t chunkReorderBuffer_claim(ChunkReorderBuffer *buffer) {
+	/*
+	 * Returns the index of the next chunk to polish, or -1 if all chunks have been claimed.
+	 * Blocks while the window is full. The chunk at the head of the window is always claimed before any
+	 * later chunk waits, so this cannot deadlock.
+	 */
+	while(1) {
+		int64_t chunkIdx = -1;
+		bool finished = 0;
+#if defined(_OPENMP)
+#pragma omp critical(chunkReorderBuffer)
+#endif
+		{
+			if(buffer->nextChunkToClaim >= buffer->chunkCount) {
+				finished = 1;
+			}
+			else if(buffer->nextChunkToClaim < buffer->nextChunkToWrite + buffer->windowSize) {
+				chunkIdx = buffer->nextChunkToClaim++;
+			}
+		}
+		if(finished || chunkIdx != -1) {
+			return chunkIdx;
+		}
+		usleep(CHUNK_REORDER_POLL_MICROSECONDS);
+	}
+}
+
+void chunkReorderBuffer_add(ChunkReorderBuffer *buffer, int64_t chunkIdx, PolishedChunk *pChunk,
+		PolishedReferenceSequence *rSeq1, PolishedReferenceSequence *rSeq2, Params *params) {
+	/*
+	 * Adds a polished chunk to the buffer, then writes out (and frees) any chunks that are now next in order.
+	 */
+#if defined(_OPENMP)
+#pragma omp critical(chunkReorderBuffer)
+#endif
+	{
+		assert(buffer->slots[chunkIdx % buffer->windowSize] == NULL);
+		buffer->slots[chunkIdx % buffer->windowSize] = pChunk;
+	}
+
+	// Only one thread writes at a time, and chunks leave the buffer strictly in order
+#if defined(_OPENMP)
+#pragma omp critical(chunkReorderWriter)
+#endif
+	{
+		while(1) {
+			PolishedChunk *nextChunk;
+#if defined(_OPENMP)
+#pragma omp critical(chunkReorderBuffer)
+#endif
+			{
+				nextChunk = buffer->nextChunkToWrite < buffer->chunkCount ?
+						buffer->slots[buffer->nextChunkToWrite % buffer->windowSize] : NULL;
+			}
+			if(nextChunk == NULL) {
+				break;
+			}
+
+			polishedReferenceSequence_processChunkSequence(rSeq1, nextChunk->bamChunk, nextChunk->poa_hap1, nextChunk->reads, params);
+			if(rSeq2 != NULL) {
+				polishedReferenceSequence_processChunkSequence(rSeq2, nextChunk->bamChunk, nextChunk->poa_hap2, nextChunk->reads, params);
+			}
+			polishedChunk_destruct(nextChunk);
+
+			// Freeing the slot widens the window for the claiming threads
+#if defined(_OPENMP)
+#pragma omp critical(chunkReorderBuffer)
+#endif
+			{
+				buffer->slots[buffer->nextChunkToWrite % buffer->windowSize] = NULL;
+				buffer->nextChunkToWrite++;
+			}
+		}
+	}
+}
+
 int main(int argc, char *argv[]) {
     // Parameters / arguments
     char *logLevelString = stString_copy("info");
@@ -242,6 +445,8 @@ int main(int argc, char *argv[]) {
     int64_t verboseBitstring = -1;
     char *outputRepeatCountFile = NULL;
     char *outputPoaTsvFile = NULL;
+    int numThreads = 1;
+    int64_t reorderWindow = 0;
 
     // TODO: When done testing, optionally set random seed using st_randomSeed();
 
@@ -265,10 +470,12 @@ int main(int argc, char *argv[]) {
                 { "verbose", required_argument, 0, 'v'},
 				{ "outputRepeatCounts", required_argument, 0, 'i'},
 				{ "outputPoaTsv", required_argument, 0, 'j'},
+				{ "threads", required_argument, 0, 't'},
+				{ "reorderWindow", required_argument, 0, 'w'},
                 { 0, 0, 0, 0 } };
 
         int option_index = 0;
-        int key = getopt_long(argc-2, &argv[2], "a:o:v:r:hdi:j:", long_options, &option_index);
+        int key = getopt_long(argc-2, &argv[2], "a:o:v:r:hdi:j:t:w:", long_options, &option_index);
 
         if (key == -1) {
             break;
@@ -301,6 +508,18 @@ int main(int argc, char *argv[]) {
         case 'j':
         	outputPoaTsvFile = stString_copy(optarg);
         	break;
+        case 't':
+            numThreads = atoi(optarg);
+            if (numThreads <= 0) {
+                st_errAbort("Invalid thread count: %d", numThreads);
+            }
+            break;
+        case 'w':
+            reorderWindow = atol(optarg);
+            if (reorderWindow <= 0) {
+                st_errAbort("Invalid reorder window: %s", optarg);
+            }
+            break;
         default:
             usage();
             return 0;
@@ -310,6 +529,12 @@ int main(int argc, char *argv[]) {
     // Initialization from arguments
     st_setLogLevelFromString(logLevelString);
     free(logLevelString);
+#if defined(_OPENMP)
+    omp_set_num_threads(numThreads);
+    st_logInfo("> Running OpenMP with %d threads.\n", omp_get_max_threads());
+#else
+    numThreads = 1;
+#endif
 
     // Parse parameters
     st_logInfo("> Using the diploid model: %s\n", diploid ? "True" : "False");
@@ -344,107 +569,38 @@ int main(int argc, char *argv[]) {
     st_logInfo("> Set up bam chunker with chunk size: %i and overlap %i (for region=%s)\n",
     		   (int)bamChunker->chunkSize, (int)bamChunker->chunkBoundary, regionStr == NULL ? "all" : regionStr);
 
-    // For each chunk of the BAM
-	for (int64_t chunkIdx = 0; chunkIdx < bamChunker->chunkCount; chunkIdx++) {
-		BamChunk *bamChunk = bamChunker_getChunk(bamChunker, chunkIdx);
-    		RleString *reference = bamChunk_getReferenceSubstring(bamChunk, referenceSequences, params);
-
-        st_logInfo("> Going to process a chunk for reference sequence: %s, starting at: %i and ending at: %i\n",
-        		   bamChunk->refSeqName, (int)bamChunk->chunkBoundaryStart,
-				   (int)bamChunk->chunkBoundaryEnd);
-
-		// Convert bam lines into corresponding reads and alignments
-		st_logInfo("> Parsing input reads from file: %s\n", bamInFile);
-		stList *reads = stList_construct3(0, (void (*)(void *))bamChunkRead_destruct);
-        stList *alignments = stList_construct3(0, (void (*)(void *))stList_destruct);
-        convertToReadsAndAlignments(bamChunk, reference, reads, alignments);
-
-		// Now run the polishing method
-
-		// Generate the haploid partial order alignment (POA)
-		Poa *poa = poa_realignAll(reads, alignments, reference, params->polishParams);
-
-		// If diploid
-		if(diploid) {
-			// Get the bubble graph representation
-			bool useReadAlleles = params->polishParams->useReadAlleles;
-			params->polishParams->useReadAlleles = params->polishParams->useReadAllelesInPhasing;
-			BubbleGraph *bg = bubbleGraph_constructFromPoa(poa, reads, params->polishParams);
-			params->polishParams->useReadAlleles = useReadAlleles;
-
-			// Now make a POA for each of the haplotypes
-			stHash *readsToPSeqs;
-			stGenomeFragment *gf = bubbleGraph_phaseBubbleGraph(bg, bamChunk->refSeqName, reads, params, &readsToPSeqs);
-
-			stSet *readsBelongingToHap1, *readsBelongingToHap2;
-			stGenomeFragment_phaseBamChunkReads(gf, readsToPSeqs, reads, &readsBelongingToHap1, &readsBelongingToHap2);
-			st_logInfo("After phasing, of %i reads got %i reads partitioned into hap1 and %i reads partitioned into hap2 (%i unphased)\n",
-			(int)stList_length(reads), (int)stSet_size(readsBelongingToHap1), (int)stSet_size(readsBelongingToHap2), 
-			(int)(stList_length(reads) - stSet_size(readsBelongingToHap1)- stSet_size(readsBelongingToHap2)));
-
-			// Debug report of hets
-			uint64_t totalHets = 0;
-			for(uint64_t i=0; i<gf->length; i++) {
-				Bubble *b = &bg->bubbles[i+gf->refStart];
-				if(gf->haplotypeString1[i] != gf->haplotypeString2[i]) {
-					st_logDebug("Got predicted het at bubble %i %s %s\n", (int)i+gf->refStart, b->alleles[gf->haplotypeString1[i]]->rleString,
-							b->alleles[gf->haplotypeString2[i]]->rleString);
-					totalHets++;
-				}
-				else if(!rleString_eq(b->alleles[gf->haplotypeString1[i]], b->refAllele)) {
-					st_logDebug("Got predicted hom alt at bubble %i %i\n", (int)i+gf->refStart, (int)gf->haplotypeString1[i]);
-				}
-			}
-			st_logInfo("In phasing chunk, got: %i hets from: %i total sites (fraction: %f)\n", (int)totalHets, (int)gf->length, (float)totalHets/gf->length);
-
-			st_logInfo("Building POA for each haplotype\n");
-			uint64_t *hap1 = getPaddedHaplotypeString(gf->haplotypeString1, gf, bg, params);
-			uint64_t *hap2 = getPaddedHaplotypeString(gf->haplotypeString2, gf, bg, params);
-
-			Poa *poa_hap1 = bubbleGraph_getNewPoa(bg, hap1, poa, reads, params);
-			Poa *poa_hap2 = bubbleGraph_getNewPoa(bg, hap2, poa, reads, params);
-
-			/*st_logInfo("Using read phasing to reestimate bases in phased manner\n");
-			poa_estimatePhasedBasesUsingBayesianModel(poa_hap1, reads,
-					readsBelongingToHap1, readsBelongingToHap2, params->polishParams);
-
-			poa_estimatePhasedBasesUsingBayesianModel(poa_hap2, reads,
-								readsBelongingToHap2, readsBelongingToHap1, params->polishParams);*/
-
-			if(params->polishParams->useRunLengthEncoding) {
-				st_logInfo("Using read phasing to reestimate repeat counts in phased manner\n");
-				poa_estimatePhasedRepeatCountsUsingBayesianModel(poa_hap1, reads,
-						params->polishParams->repeatSubMatrix, readsBelongingToHap1, readsBelongingToHap2, params->polishParams);
-
-				poa_estimatePhasedRepeatCountsUsingBayesianModel(poa_hap2, reads,
-						params->polishParams->repeatSubMatrix, readsBelongingToHap2, readsBelongingToHap1, params->polishParams);
-			}
-
-			// Output
-			polishedReferenceSequence_processChunkSequence(rSeq1, bamChunk, poa_hap1, reads, params);
-			polishedReferenceSequence_processChunkSequence(rSeq2, bamChunk, poa_hap2, reads, params);
-
-			// Cleanup
-			free(hap1);
-			free(hap2);
-			bubbleGraph_destruct(bg);
-			stGenomeFragment_destruct(gf);
-			poa_destruct(poa_hap1);
-			poa_destruct(poa_hap2);
-			stSet_destruct(readsBelongingToHap1);
-			stSet_destruct(readsBelongingToHap2);
-			stHash_destruct(readsToPSeqs);
-		}
-		else {
-			polishedReferenceSequence_processChunkSequence(rSeq1, bamChunk, poa, reads, params);
-		}
-
-		// Cleanup
-		poa_destruct(poa);
-		stList_destruct(reads);
-        stList_destruct(alignments);
-        rleString_destruct(reference);
+    // Polish the chunks concurrently, writing each out in order once it and all the chunks before it are done
+    if(reorderWindow <= 0) {
+    	reorderWindow = 2 * numThreads;
+    }
+    st_logInfo("> Polishing %i chunks with a reorder window of %i chunks\n", (int)bamChunker->chunkCount, (int)reorderWindow);
+    ChunkReorderBuffer *reorderBuffer = chunkReorderBuffer_construct(bamChunker->chunkCount, reorderWindow);
+    int64_t runCounters[HOT_PATH_COUNTER_NUMBER] = {0};
+#if defined(_OPENMP)
+#pragma omp parallel
+#endif
+    {
+    	// Hot-path work done by this thread, if the counters are compiled in
+    	int64_t threadCounters[HOT_PATH_COUNTER_NUMBER] = {0};
+    	hotPathCounters_subtract(threadCounters);
+    	int64_t chunkIdx;
+    	while((chunkIdx = chunkReorderBuffer_claim(reorderBuffer)) != -1) {
+    		BamChunk *bamChunk = bamChunker_getChunk(bamChunker, chunkIdx);
+    		PolishedChunk *pChunk = polishChunk(bamChunk, referenceSequences, bamInFile, diploid, params);
+    		chunkReorderBuffer_add(reorderBuffer, chunkIdx, pChunk, rSeq1, rSeq2, params);
+    	}
+    	hotPathCounters_add(threadCounters);
+#if defined(_OPENMP)
+#pragma omp critical(hotPathCounters)
+#endif
+    	{
+    		for(int64_t i=0; i<HOT_PATH_COUNTER_NUMBER; i++) {
+    			runCounters[i] += threadCounters[i];
+    		}
+    	}
     }
+    chunkReorderBuffer_destruct(reorderBuffer);
+    hotPathCounters_logSummary(runCounters);
 
     polishedReferenceSequence_destruct(rSeq1);
     if(diploid) {
@@ -0,0 +1,729 @@
+/*
+ * Copyright (C) 2018 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <memory.h>
+#include <unistd.h>
+#include <time.h>
+#include "marginVersion.h"
+
+#include "margin.h"
+#include "htsIntegration.h"
+
+/*
+ * Throughput benchmarks for the hot paths of polishing and phasing. Each benchmark is run for a number of
+ * timed repeats over fixed inputs, and summarised as one json object per line, so the output of two builds
+ * can be compared directly.
+ */
+
+#define BENCH_PAIRWISE_ALIGNMENT "pairwiseAlignment"
+#define BENCH_FORWARD_PROBABILITY "forwardProbability"
+#define BENCH_POA_REALIGN "poaRealign"
+#define BENCH_BUBBLE_GRAPH "bubbleGraph"
+#define BENCH_FORWARD_BACKWARD "forwardBackward"
+#define BENCH_REMOVE_OVERLAP "removeOverlap"
+#define BENCH_POLISH_CHUNK "polishChunk"
+
+static char *allBenchmarks[] = { BENCH_PAIRWISE_ALIGNMENT, BENCH_FORWARD_PROBABILITY, BENCH_POA_REALIGN,
+                                 BENCH_BUBBLE_GRAPH, BENCH_FORWARD_BACKWARD, BENCH_REMOVE_OVERLAP, BENCH_POLISH_CHUNK };
+static int64_t allBenchmarkNumber = 7;
+
+void usage() {
+    fprintf(stderr, "usage: marginBench [options]\n");
+    fprintf(stderr, "Version: %s \n\n", MARGIN_POLISH_VERSION_H);
+    fprintf(stderr, "Benchmarks the throughput of the pair-HMM, POA, bubble graph, phasing HMM, overlap removal\n");
+    fprintf(stderr, "and whole chunk polishing. Synthetic inputs are generated from a seeded random number\n");
+    fprintf(stderr, "generator; the BAM based benchmarks are skipped if the BAM or reference can not be read.\n");
+    fprintf(stderr, "Each benchmark is written as one json object per line, with the mean, standard deviation and\n");
+    fprintf(stderr, "95%% confidence interval of the time and of the cells, reads and bases per second.\n");
+
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "    -h --help                : Print this help screen\n");
+    fprintf(stderr, "    -a --logLevel            : Set the log level [default = critical]\n");
+    # ifdef _OPENMP
+    fprintf(stderr, "    -t --threads             : Set number of concurrent threads [default = 1]\n");
+    #endif
+    fprintf(stderr, "    -p --params              : Parameters file [default = ../params/allParams.np.json]\n");
+    fprintf(stderr, "    -b --bam                 : Indexed BAM for the BAM based benchmarks\n");
+    fprintf(stderr, "                                 [default = ../tests/data/realData/NA12878.np.chr3.5kb.bam]\n");
+    fprintf(stderr, "    -f --reference           : Reference fasta for the BAM\n");
+    fprintf(stderr, "                                 [default = ../tests/data/realData/hg19.chr3.9mb.fa]\n");
+    fprintf(stderr, "    -r --region              : Region of the BAM to benchmark [default = chr3:2150000-2155000]\n");
+    fprintf(stderr, "    -B --benchmarks          : Comma separated benchmarks to run [default = all], of:\n");
+    fprintf(stderr, "                                 %s, %s, %s, %s,\n", allBenchmarks[0], allBenchmarks[1],
+            allBenchmarks[2], allBenchmarks[3]);
+    fprintf(stderr, "                                 %s, %s, %s\n", allBenchmarks[4], allBenchmarks[5],
+            allBenchmarks[6]);
+    fprintf(stderr, "    -n --repeats             : Number of timed repeats of each benchmark [default = 10]\n");
+    fprintf(stderr, "    -w --warmup              : Number of untimed repeats before the timed ones [default = 1]\n");
+    fprintf(stderr, "    -l --sequenceLength      : Length of the synthetic sequences [default = 1000]\n");
+    fprintf(stderr, "    -k --pairs               : Synthetic sequence pairs aligned per repeat [default = 10]\n");
+    fprintf(stderr, "    -s --seed                : Seed for the synthetic sequences [default = 1]\n");
+    fprintf(stderr, "    -L --label               : Label added to each output line, e.g. the build [default = '']\n");
+    fprintf(stderr, "    -o --output              : File to write the results to [default = stdout]\n");
+    fprintf(stderr, "\n");
+}
+
+/*
+ * Benchmark results
+ */
+
+typedef struct _benchResult {
+    char *name;
+    int64_t repeats;
+    double *seconds; // Wall time of each timed repeat
+    // Work done by each repeat, or -1 if not measured. The inputs are fixed, so this is the same for all repeats.
+    int64_t cells;
+    int64_t reads;
+    int64_t bases;
+} BenchResult;
+
+BenchResult *benchResult_construct(char *name, int64_t repeats) {
+    BenchResult *result = st_calloc(1, sizeof(BenchResult));
+    result->name = stString_copy(name);
+    result->repeats = repeats;
+    result->seconds = st_calloc(repeats, sizeof(double));
+    result->cells = -1;
+    result->reads = -1;
+    result->bases = -1;
+    return result;
+}
+
+void benchResult_destruct(BenchResult *result) {
+    free(result->name);
+    free(result->seconds);
+    free(result);
+}
+
+static double studentT95(int64_t degreesOfFreedom) {
+    /*
+     * Two sided 95% critical value of the t distribution, for confidence intervals over few repeats.
+     */
+    static double t[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                          2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                          2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    assert(degreesOfFreedom > 0);
+    return degreesOfFreedom <= 30 ? t[degreesOfFreedom - 1] : 1.960;
+}
+
+static void writeSummaryJson(FILE *fh, char *key, double *samples, int64_t n) {
+    /*
+     * Writes the mean, standard deviation, range and 95% confidence interval of the mean of the samples.
+     */
+    double mean = 0.0, min = samples[0], max = samples[0];
+    for (int64_t i = 0; i < n; i++) {
+        mean += samples[i];
+        min = samples[i] < min ? samples[i] : min;
+        max = samples[i] > max ? samples[i] : max;
+    }
+    mean /= n;
+    double sd = 0.0;
+    for (int64_t i = 0; i < n; i++) {
+        sd += (samples[i] - mean) * (samples[i] - mean);
+    }
+    sd = n > 1 ? sqrt(sd / (n - 1)) : 0.0;
+    double halfWidth = n > 1 ? studentT95(n - 1) * sd / sqrt(n) : 0.0;
+    fprintf(fh, ", \"%s\": {\"mean\": %.6g, \"sd\": %.6g, \"min\": %.6g, \"max\": %.6g, \"ci95Low\": %.6g, "
+                "\"ci95High\": %.6g}", key, mean, sd, min, max, mean - halfWidth, mean + halfWidth);
+}
+
+static void writeRateJson(FILE *fh, char *key, int64_t work, double *seconds, int64_t n) {
+    // Rates are summarised per repeat, rather than derived from the mean time, so the interval is of the rate
+    if (work < 0) {
+        return;
+    }
+    double *rates = st_calloc(n, sizeof(double));
+    for (int64_t i = 0; i < n; i++) {
+        rates[i] = seconds[i] > 0.0 ? work / seconds[i] : 0.0;
+    }
+    writeSummaryJson(fh, key, rates, n);
+    free(rates);
+}
+
+void benchResult_writeJson(BenchResult *result, char *label, int numThreads, FILE *fh) {
+    /*
+     * Writes the result as a single line json object.
+     */
+    fprintf(fh, "{\"benchmark\": \"%s\", \"label\": \"%s\", \"version\": \"%s\", \"threads\": %d, "
+                "\"hotPathCounters\": %s, \"repeats\": %" PRIi64 ", \"work\": {\"cells\": %" PRIi64
+                ", \"reads\": %" PRIi64 ", \"bases\": %" PRIi64 "}",
+            result->name, label, MARGIN_POLISH_VERSION_H, numThreads, hotPathCounters_enabled() ? "true" : "false",
+            result->repeats, result->cells, result->reads, result->bases);
+    writeSummaryJson(fh, "seconds", result->seconds, result->repeats);
+    writeRateJson(fh, "cellsPerSecond", result->cells, result->seconds, result->repeats);
+    writeRateJson(fh, "readsPerSecond", result->reads, result->seconds, result->repeats);
+    writeRateJson(fh, "basesPerSecond", result->bases, result->seconds, result->repeats);
+    fprintf(fh, "}\n");
+}
+
+/*
+ * Benchmark inputs
+ */
+
+typedef struct _benchConfig {
+    Params *params;
+    int64_t repeats;
+    int64_t warmup;
+    int64_t sequenceLength;
+    int64_t pairs;
+    int numThreads;
+    stHash *referenceSequences; // NULL if the BAM based benchmarks are skipped
+    BamChunker *bamChunker;
+} BenchConfig;
+
+typedef struct _benchChunk {
+    RleString *reference;
+    stList *reads; // BamChunkRead
+    stList *alignments; // Anchor alignments of the reads
+    int64_t bases; // Total non-RLE length of the reads
+} BenchChunk;
+
+BenchChunk *benchChunk_construct(BamChunk *bamChunk, BenchConfig *config) {
+    BenchChunk *chunk = st_calloc(1, sizeof(BenchChunk));
+    chunk->reference = bamChunk_getReferenceSubstring(bamChunk, config->referenceSequences, config->params);
+    if (chunk->reference == NULL) {
+        st_errAbort("Reference sequence missing from reference map: %s\n", bamChunk->refSeqName);
+    }
+    chunk->reads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
+    chunk->alignments = stList_construct3(0, (void (*)(void *)) stList_destruct);
+    convertToReadsAndAlignments(bamChunk, chunk->reference, chunk->reads, chunk->alignments);
+    for (int64_t i = 0; i < stList_length(chunk->reads); i++) {
+        chunk->bases += ((BamChunkRead *) stList_get(chunk->reads, i))->rleRead->nonRleLength;
+    }
+    return chunk;
+}
+
+void benchChunk_destruct(BenchChunk *chunk) {
+    rleString_destruct(chunk->reference);
+    stList_destruct(chunk->reads);
+    stList_destruct(chunk->alignments);
+    free(chunk);
+}
+
+static stList *getSyntheticPairs(BenchConfig *config) {
+    /*
+     * Returns a list of 2 * config->pairs RLE strings, each a random sequence followed by a read evolved from it.
+     */
+    stList *pairs = stList_construct3(0, (void (*)(void *)) rleString_destruct);
+    for (int64_t i = 0; i < config->pairs; i++) {
+        char *reference = getRandomACGTSequence(config->sequenceLength);
+        char *read = evolveSequence(reference);
+        bool rle = config->params->polishParams->useRunLengthEncoding;
+        stList_append(pairs, rle ? rleString_construct(reference) : rleString_construct_no_rle(reference));
+        stList_append(pairs, rle ? rleString_construct(read) : rleString_construct_no_rle(read));
+        free(reference);
+        free(read);
+    }
+    return pairs;
+}
+
+static SymbolString getSymbolString(RleString *s, PolishParams *polishParams) {
+    // As poa_realign does for reads aligned without anchors
+    uint64_t maximumRepeatLength = 2; // MRL is exclusive
+    if (polishParams->useRunLengthEncoding) {
+        maximumRepeatLength = polishParams->repeatSubMatrix != NULL ?
+                polishParams->repeatSubMatrix->maximumRepeatLength : MAXIMUM_REPEAT_LENGTH;
+    }
+    return rleString_constructSymbolString(s, 0, s->length, polishParams->alphabet,
+            polishParams->useRepeatCountsInAlignment, maximumRepeatLength - 1);
+}
+
+static bool countCells(BenchConfig *config) {
+    // With more than one thread the inner parallel loops count on threads other than the benchmarking one
+    return hotPathCounters_enabled() && config->numThreads == 1;
+}
+
+/*
+ * Benchmarks. Each times config->repeats repeats after config->warmup untimed ones, keeping setup out of the
+ * timed region, and sets the work done by one repeat.
+ */
+
+static void bench_pairwise(BenchConfig *config, BenchResult *result, bool posteriors) {
+    /*
+     * Aligns synthetic sequence pairs without anchors, so each alignment fills the whole matrix. With posteriors
+     * the forward, backward and posterior passes of getAlignedPairsWithIndelsUsingAnchors are run, else just the
+     * forward pass of computeForwardProbability. Cells are those of the matrix, whatever the number of passes.
+     */
+    PolishParams *polishParams = config->params->polishParams;
+    stList *pairs = getSyntheticPairs(config);
+    result->cells = 0;
+    result->reads = config->pairs;
+    result->bases = 0;
+    for (int64_t i = 0; i < stList_length(pairs); i += 2) {
+        RleString *sX = stList_get(pairs, i), *sY = stList_get(pairs, i + 1);
+        result->cells += (sX->length + 1) * (sY->length + 1);
+        result->bases += sY->nonRleLength;
+    }
+
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        double seconds = 0.0;
+        for (int64_t i = 0; i < stList_length(pairs); i += 2) {
+            SymbolString sX = getSymbolString(stList_get(pairs, i), polishParams);
+            SymbolString sY = getSymbolString(stList_get(pairs, i + 1), polishParams);
+            stList *anchorPairs = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+            stList *matches = NULL, *inserts = NULL, *deletes = NULL;
+
+            double startTime = chunkProfile_getTime();
+            if (posteriors) {
+                getAlignedPairsWithIndelsUsingAnchors(polishParams->stateMachineForForwardStrandRead, sX, sY,
+                        anchorPairs, polishParams->p, &matches, &deletes, &inserts, 0, 0);
+            } else {
+                computeForwardProbability(sX, sY, anchorPairs, polishParams->p,
+                        polishParams->stateMachineForForwardStrandRead, 0, 0);
+            }
+            seconds += chunkProfile_getTime() - startTime;
+
+            if (posteriors) {
+                stList_destruct(matches);
+                stList_destruct(inserts);
+                stList_destruct(deletes);
+            }
+            stList_destruct(anchorPairs);
+            symbolString_destruct(sX);
+            symbolString_destruct(sY);
+        }
+        if (repeat >= 0) {
+            result->seconds[repeat] = seconds;
+        }
+    }
+
+    stList_destruct(pairs);
+}
+
+static void bench_removeOverlap(BenchConfig *config, BenchResult *result) {
+    /*
+     * Removes the overlap between synthetic prefix and suffix strings sharing an evolved overlap of
+     * config->sequenceLength bases, as when merging adjacent chunks.
+     */
+    PolishParams *polishParams = config->params->polishParams;
+    stList *prefixes = stList_construct3(0, free);
+    stList *suffixes = stList_construct3(0, free);
+    for (int64_t i = 0; i < config->pairs; i++) {
+        char *overlap = getRandomACGTSequence(config->sequenceLength);
+        char *prefixFlank = getRandomACGTSequence(config->sequenceLength);
+        char *suffixFlank = getRandomACGTSequence(config->sequenceLength);
+        char *evolvedOverlap = evolveSequence(overlap);
+        stList_append(prefixes, stString_print("%s%s", prefixFlank, overlap));
+        stList_append(suffixes, stString_print("%s%s", evolvedOverlap, suffixFlank));
+        free(overlap);
+        free(prefixFlank);
+        free(suffixFlank);
+        free(evolvedOverlap);
+    }
+    result->reads = config->pairs;
+    result->bases = 2 * config->pairs * config->sequenceLength;
+
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        double startTime = chunkProfile_getTime();
+        for (int64_t i = 0; i < config->pairs; i++) {
+            int64_t prefixStringCropEnd, suffixStringCropStart;
+            removeOverlap(stList_get(prefixes, i), stList_get(suffixes, i), config->sequenceLength, polishParams,
+                          &prefixStringCropEnd, &suffixStringCropStart);
+        }
+        if (repeat >= 0) {
+            result->seconds[repeat] = chunkProfile_getTime() - startTime;
+        }
+    }
+
+    stList_destruct(prefixes);
+    stList_destruct(suffixes);
+}
+
+static void bench_poaRealign(BenchConfig *config, BenchResult *result) {
+    /*
+     * Builds the poa of the reads of the first chunk of the region from their anchor alignments.
+     */
+    BenchChunk *chunk = benchChunk_construct(bamChunker_getChunk(config->bamChunker, 0), config);
+    result->reads = stList_length(chunk->reads);
+    result->bases = chunk->bases;
+
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        int64_t counters[HOT_PATH_COUNTER_NUMBER] = { 0 };
+        hotPathCounters_subtract(counters);
+        double startTime = chunkProfile_getTime();
+        Poa *poa = poa_realign(chunk->reads, chunk->alignments, chunk->reference, config->params->polishParams);
+        double seconds = chunkProfile_getTime() - startTime;
+        hotPathCounters_add(counters);
+        poa_destruct(poa);
+        if (repeat >= 0) {
+            result->seconds[repeat] = seconds;
+            result->cells = countCells(config) ? counters[HOT_PATH_COUNTER_DP_CELLS] : -1;
+        }
+    }
+
+    benchChunk_destruct(chunk);
+}
+
+static Poa *getPhasingPoa(BenchChunk *chunk, PolishParams *phasingPolishParams, BenchConfig *config) {
+    /*
+     * Polishes the chunk and sets the polish params used to build its bubble graph for phasing, as margin does.
+     */
+    *phasingPolishParams = *config->params->polishParams;
+    phasingPolishParams->useReadAlleles = config->params->polishParams->useReadAllelesInPhasing;
+    return poa_realignAll(chunk->reads, chunk->alignments, chunk->reference, config->params->polishParams);
+}
+
+static void bench_bubbleGraph(BenchConfig *config, BenchResult *result) {
+    /*
+     * Builds the bubble graph of the polished poa of the first chunk of the region.
+     */
+    BenchChunk *chunk = benchChunk_construct(bamChunker_getChunk(config->bamChunker, 0), config);
+    PolishParams phasingPolishParams;
+    Poa *poa = getPhasingPoa(chunk, &phasingPolishParams, config);
+    result->reads = stList_length(chunk->reads);
+    result->bases = chunk->bases;
+
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        int64_t counters[HOT_PATH_COUNTER_NUMBER] = { 0 };
+        hotPathCounters_subtract(counters);
+        double startTime = chunkProfile_getTime();
+        BubbleGraph *bg = bubbleGraph_constructFromPoa(poa, chunk->reads, &phasingPolishParams);
+        double seconds = chunkProfile_getTime() - startTime;
+        hotPathCounters_add(counters);
+        bubbleGraph_destruct(bg);
+        if (repeat >= 0) {
+            result->seconds[repeat] = seconds;
+            result->cells = countCells(config) ? counters[HOT_PATH_COUNTER_DP_CELLS] : -1;
+        }
+    }
+
+    poa_destruct(poa);
+    benchChunk_destruct(chunk);
+}
+
+static void bench_forwardBackward(BenchConfig *config, BenchResult *result) {
+    /*
+     * Runs the forward-backward algorithm over the read partitioning hmms built from the bubble graph of the first
+     * chunk of the region. Cells are those of the hmm columns.
+     */
+    BenchChunk *chunk = benchChunk_construct(bamChunker_getChunk(config->bamChunker, 0), config);
+    PolishParams phasingPolishParams;
+    Poa *poa = getPhasingPoa(chunk, &phasingPolishParams, config);
+    BubbleGraph *bg = bubbleGraph_constructFromPoa(poa, chunk->reads, &phasingPolishParams);
+    stRPHmmParameters phaseParams = *config->params->phaseParams;
+    Params params = { &phasingPolishParams, &phaseParams };
+    phaseParams.includeAncestorSubProb = 0;
+
+    stReference *ref = bubbleGraph_getReference(bg, "benchmark", &params);
+    stHash *readsToPSeqs = bubbleGraph_getProfileSeqs(bg, ref);
+    stList *profileSeqs = stHash_getValues(readsToPSeqs);
+    stList *filteredProfileSeqs = stList_construct();
+    stList *discardedProfileSeqs = stList_construct();
+    filterReadsByCoverageDepth(profileSeqs, &phaseParams, filteredProfileSeqs, discardedProfileSeqs);
+    stList *hmms = getRPHmms(filteredProfileSeqs, &phaseParams);
+
+    result->cells = 0;
+    result->reads = stList_length(filteredProfileSeqs);
+    for (int64_t i = 0; i < stList_length(hmms); i++) {
+        stRPHmm *hmm = stList_get(hmms, i);
+        stRPColumn *column = hmm->firstColumn;
+        while (1) {
+            result->cells += column->cellNo;
+            if (column->nColumn == NULL) {
+                break;
+            }
+            column = column->nColumn->nColumn;
+        }
+    }
+
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        double startTime = chunkProfile_getTime();
+        for (int64_t i = 0; i < stList_length(hmms); i++) {
+            stRPHmm_forwardBackward(stList_get(hmms, i));
+        }
+        if (repeat >= 0) {
+            result->seconds[repeat] = chunkProfile_getTime() - startTime;
+        }
+    }
+
+    // Cleanup
+    stList_destruct(hmms);
+    stList_destruct(filteredProfileSeqs);
+    stList_destruct(discardedProfileSeqs);
+    stList_setDestructor(profileSeqs, (void (*)(void *)) stProfileSeq_destruct);
+    stList_destruct(profileSeqs);
+    stHash_destruct(readsToPSeqs);
+    stReference_destruct(ref);
+    bubbleGraph_destruct(bg);
+    poa_destruct(poa);
+    benchChunk_destruct(chunk);
+}
+
+static void bench_polishChunk(BenchConfig *config, BenchResult *result) {
+    /*
+     * Polishes every chunk of the region as marginPolish does, from fetching the reads to the expanded consensus.
+     */
+    PolishParams *polishParams = config->params->polishParams;
+    for (int64_t repeat = -config->warmup; repeat < config->repeats; repeat++) {
+        int64_t counters[HOT_PATH_COUNTER_NUMBER] = { 0 };
+        int64_t reads = 0, bases = 0;
+        double seconds = 0.0;
+        for (int64_t chunkIdx = 0; chunkIdx < config->bamChunker->chunkCount; chunkIdx++) {
+            hotPathCounters_subtract(counters);
+            double startTime = chunkProfile_getTime();
+
+            BenchChunk *chunk = benchChunk_construct(bamChunker_getChunk(config->bamChunker, chunkIdx), config);
+            ForwardScoreCache *forwardScoreCache = polishParams->forwardScoreCacheMaxMemory > 0 ?
+                    forwardScoreCache_construct(polishParams->forwardScoreCacheMaxMemory) : NULL;
+            Poa *poa = poa_realignAll2(chunk->reads, chunk->alignments, chunk->reference, polishParams,
+                                       forwardScoreCache, NULL);
+            if (forwardScoreCache != NULL) {
+                forwardScoreCache_destruct(forwardScoreCache);
+            }
+            poa_estimateRepeatCountsUsingBayesianModel(poa, chunk->reads, polishParams->repeatSubMatrix);
+            char *polishedConsensusString = rleString_expand(poa->refString);
+
+            seconds += chunkProfile_getTime() - startTime;
+            hotPathCounters_add(counters);
+            reads += stList_length(chunk->reads);
+            bases += chunk->bases;
+            free(polishedConsensusString);
+            poa_destruct(poa);
+            benchChunk_destruct(chunk);
+        }
+        if (repeat >= 0) {
+            result->seconds[repeat] = seconds;
+            result->cells = countCells(config) ? counters[HOT_PATH_COUNTER_DP_CELLS] : -1;
+            result->reads = reads;
+            result->bases = bases;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Parameters / arguments
+    char *logLevelString = stString_copy("critical");
+    char *paramsFile = stString_copy("../params/allParams.np.json");
+    char *bamInFile = stString_copy("../tests/data/realData/NA12878.np.chr3.5kb.bam");
+    char *referenceFastaFile = stString_copy("../tests/data/realData/hg19.chr3.9mb.fa");
+    char *regionStr = stString_copy("chr3:2150000-2155000");
+    char *benchmarksString = NULL;
+    char *outputFile = NULL;
+    char *label = stString_copy("");
+    int64_t repeats = 10;
+    int64_t warmup = 1;
+    int64_t sequenceLength = 1000;
+    int64_t pairs = 10;
+    int64_t seed = 1;
+    int numThreads = 1;
+
+    // Parse the options
+    while (1) {
+        static struct option long_options[] = {
+                { "logLevel", required_argument, 0, 'a' },
+                { "help", no_argument, 0, 'h' },
+                { "threads", required_argument, 0, 't'},
+                { "params", required_argument, 0, 'p'},
+                { "bam", required_argument, 0, 'b'},
+                { "reference", required_argument, 0, 'f'},
+                { "region", required_argument, 0, 'r'},
+                { "benchmarks", required_argument, 0, 'B'},
+                { "repeats", required_argument, 0, 'n'},
+                { "warmup", required_argument, 0, 'w'},
+                { "sequenceLength", required_argument, 0, 'l'},
+                { "pairs", required_argument, 0, 'k'},
+                { "seed", required_argument, 0, 's'},
+                { "label", required_argument, 0, 'L'},
+                { "output", required_argument, 0, 'o'},
+                { 0, 0, 0, 0 } };
+
+        int option_index = 0;
+        int key = getopt_long(argc, argv, "a:ht:p:b:f:r:B:n:w:l:k:s:L:o:", long_options, &option_index);
+
+        if (key == -1) {
+            break;
+        }
+
+        switch (key) {
+        case 'a':
+            free(logLevelString);
+            logLevelString = stString_copy(optarg);
+            break;
+        case 'h':
+            usage();
+            return 0;
+        case 't':
+            numThreads = atoi(optarg);
+            if (numThreads <= 0) {
+                st_errAbort("Invalid thread count: %d", numThreads);
+            }
+            break;
+        case 'p':
+            free(paramsFile);
+            paramsFile = stString_copy(optarg);
+            break;
+        case 'b':
+            free(bamInFile);
+            bamInFile = stString_copy(optarg);
+            break;
+        case 'f':
+            free(referenceFastaFile);
+            referenceFastaFile = stString_copy(optarg);
+            break;
+        case 'r':
+            free(regionStr);
+            regionStr = stString_copy(optarg);
+            break;
+        case 'B':
+            benchmarksString = stString_copy(optarg);
+            break;
+        case 'n':
+            repeats = atoi(optarg);
+            if (repeats <= 0) {
+                st_errAbort("Invalid repeat count: %s", optarg);
+            }
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            if (warmup < 0) {
+                st_errAbort("Invalid warmup count: %s", optarg);
+            }
+            break;
+        case 'l':
+            sequenceLength = atoi(optarg);
+            if (sequenceLength <= 0) {
+                st_errAbort("Invalid sequence length: %s", optarg);
+            }
+            break;
+        case 'k':
+            pairs = atoi(optarg);
+            if (pairs <= 0) {
+                st_errAbort("Invalid pair count: %s", optarg);
+            }
+            break;
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case 'L':
+            free(label);
+            label = stString_copy(optarg);
+            break;
+        case 'o':
+            outputFile = stString_copy(optarg);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    // Initialization from arguments
+    st_setLogLevelFromString(logLevelString);
+    free(logLevelString);
+    # ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+    # else
+    numThreads = 1;
+    # endif
+    st_randomSeed(seed);
+
+    if (access(paramsFile, R_OK) != 0) {
+        st_errAbort("Could not read from file: %s\n", paramsFile);
+    }
+    Params *params = params_readParams(paramsFile);
+
+    stList *benchmarks = stList_construct3(0, free);
+    if (benchmarksString == NULL) {
+        for (int64_t i = 0; i < allBenchmarkNumber; i++) {
+            stList_append(benchmarks, stString_copy(allBenchmarks[i]));
+        }
+    } else {
+        stList *names = stString_splitByString(benchmarksString, ",");
+        for (int64_t i = 0; i < stList_length(names); i++) {
+            char *name = stList_get(names, i);
+            bool known = FALSE;
+            for (int64_t j = 0; j < allBenchmarkNumber; j++) {
+                known = known || stString_eq(name, allBenchmarks[j]);
+            }
+            if (!known) {
+                st_errAbort("Unrecognised benchmark: %s\n", name);
+            }
+            stList_append(benchmarks, stString_copy(name));
+        }
+        stList_destruct(names);
+        free(benchmarksString);
+    }
+
+    FILE *outputFh = stdout;
+    if (outputFile != NULL) {
+        outputFh = fopen(outputFile, "w");
+        if (outputFh == NULL) {
+            st_errAbort("Could not open %s for writing!\n", outputFile);
+        }
+    }
+
+    BenchConfig config = { params, repeats, warmup, sequenceLength, pairs, numThreads, NULL, NULL };
+
+    // The BAM based benchmarks need the BAM, its index and the reference
+    char *bamIndex = stString_print("%s.bai", bamInFile);
+    if (access(bamInFile, R_OK) != 0 || access(bamIndex, R_OK) != 0 || access(referenceFastaFile, R_OK) != 0) {
+        st_logCritical("> Could not read %s, its index or %s, skipping the BAM based benchmarks\n",
+                       bamInFile, referenceFastaFile);
+    } else {
+        config.referenceSequences = parseReferenceSequences(referenceFastaFile);
+        config.bamChunker = bamChunker_construct2(bamInFile, regionStr, params->polishParams);
+        if (config.bamChunker->chunkCount == 0) {
+            st_logCritical("> Found no chunks in region %s of %s, skipping the BAM based benchmarks\n",
+                           regionStr, bamInFile);
+            bamChunker_destruct(config.bamChunker);
+            stHash_destruct(config.referenceSequences);
+            config.bamChunker = NULL;
+            config.referenceSequences = NULL;
+        }
+    }
+    free(bamIndex);
+
+    for (int64_t i = 0; i < stList_length(benchmarks); i++) {
+        char *name = stList_get(benchmarks, i);
+        bool bamBased = !stString_eq(name, BENCH_PAIRWISE_ALIGNMENT) && !stString_eq(name, BENCH_FORWARD_PROBABILITY)
+                        && !stString_eq(name, BENCH_REMOVE_OVERLAP);
+        if (bamBased && config.bamChunker == NULL) {
+            continue;
+        }
+        st_logCritical("> Running benchmark %s\n", name);
+        BenchResult *result = benchResult_construct(name, repeats);
+        if (stString_eq(name, BENCH_PAIRWISE_ALIGNMENT)) {
+            bench_pairwise(&config, result, TRUE);
+        } else if (stString_eq(name, BENCH_FORWARD_PROBABILITY)) {
+            bench_pairwise(&config, result, FALSE);
+        } else if (stString_eq(name, BENCH_POA_REALIGN)) {
+            bench_poaRealign(&config, result);
+        } else if (stString_eq(name, BENCH_BUBBLE_GRAPH)) {
+            bench_bubbleGraph(&config, result);
+        } else if (stString_eq(name, BENCH_FORWARD_BACKWARD)) {
+            bench_forwardBackward(&config, result);
+        } else if (stString_eq(name, BENCH_REMOVE_OVERLAP)) {
+            bench_removeOverlap(&config, result);
+        } else {
+            assert(stString_eq(name, BENCH_POLISH_CHUNK));
+            bench_polishChunk(&config, result);
+        }
+        benchResult_writeJson(result, label, numThreads, outputFh);
+        fflush(outputFh);
+        benchResult_destruct(result);
+    }
+
+    // Cleanup
+    if (outputFile != NULL) {
+        fclose(outputFh);
+        free(outputFile);
+    }
+    if (config.bamChunker != NULL) {
+        bamChunker_destruct(config.bamChunker);
+        stHash_destruct(config.referenceSequences);
+    }
+    stList_destruct(benchmarks);
+    params_destruct(params);
+    free(paramsFile);
+    free(bamInFile);
+    free(referenceFastaFile);
+    free(regionStr);
+    free(label);
+
+    return 0;
+}
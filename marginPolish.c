@@ -19,65 +19,65 @@
 #include "helenFeatures.h"
 
 
-//TODO move these to a better spot
-stHash *parseReferenceSequences(char *referenceFastaFile) {
+/*
+ * Memory budget shared by concurrently polished chunks
+ */
+
+#define CHUNK_MEMORY_BUDGET_POLL_MICROSECONDS 100000
+
+static int64_t chunkMemoryBudget = -1; // Total bytes available to concurrently polished chunks, or -1 if unlimited
+static int64_t chunkMemoryInUse = 0; // Bytes currently reserved by chunks being polished
+
+int64_t chunkMemoryBudget_acquire(int64_t estimatedBytes, char *logIdentifier) {
     /*
-     * Get hash of reference sequence names in fasta to their sequences, doing some munging on the sequence names.
+     * Blocks until the estimated memory for a chunk fits within the budget, then reserves it.
+     * Returns the number of bytes reserved, which must be released with chunkMemoryBudget_release.
+     * A chunk is always admitted when nothing else is running, so chunks larger than the budget do not deadlock.
      */
-    st_logInfo("> Parsing reference sequences from file: %s\n", referenceFastaFile);
-    FILE *fh = fopen(referenceFastaFile, "r");
-    stHash *referenceSequences = fastaReadToMap(fh);  //valgrind says blocks from this allocation are "still reachable"
-    fclose(fh);
-    // log names and transform (if necessary)
-    stList *refSeqNames = stHash_getKeys(referenceSequences);
-    int64_t origRefSeqLen = stList_length(refSeqNames);
-    st_logDebug("\tReference contigs: \n");
-    for (int64_t i = 0; i < origRefSeqLen; ++i) {
-        char *fullRefSeqName = (char *) stList_get(refSeqNames, i);
-        st_logDebug("\t\t%s\n", fullRefSeqName);
-        char refSeqName[128] = "";
-        if (sscanf(fullRefSeqName, "%s", refSeqName) == 1 && !stString_eq(fullRefSeqName, refSeqName)) {
-            // this transformation is necessary for cases where the reference has metadata after the contig name:
-            // >contig001 length=1000 date=1999-12-31
-            char *newKey = stString_copy(refSeqName);
-            char *refSeq = stHash_search(referenceSequences, fullRefSeqName);
-            stHash_insert(referenceSequences, newKey, refSeq);
-            stHash_removeAndFreeKey(referenceSequences, fullRefSeqName);
-            st_logDebug("\t\t\t-> %s\n", newKey);
+    if (chunkMemoryBudget < 0) {
+        return 0;
+    }
+    int64_t reservedBytes = estimatedBytes < chunkMemoryBudget ? estimatedBytes : chunkMemoryBudget;
+    bool loggedWait = FALSE;
+    while (1) {
+        bool admitted = FALSE;
+        # ifdef _OPENMP
+        #pragma omp critical(chunkMemoryBudget)
+        # endif
+        {
+            if (chunkMemoryInUse == 0 || chunkMemoryInUse + reservedBytes <= chunkMemoryBudget) {
+                chunkMemoryInUse += reservedBytes;
+                admitted = TRUE;
+            }
+        }
+        if (admitted) {
+            return reservedBytes;
+        }
+        if (!loggedWait) {
+            st_logInfo(">%s Waiting for %"PRId64"M of memory budget to become free\n", logIdentifier,
+                    reservedBytes >> 20);
+            loggedWait = TRUE;
         }
+        usleep(CHUNK_MEMORY_BUDGET_POLL_MICROSECONDS);
     }
-    stList_destruct(refSeqNames);
-
-    return referenceSequences;
 }
 
-RleString *bamChunk_getReferenceSubstring(BamChunk *bamChunk, stHash *referenceSequences, Params *params) {
-    /*
-     * Get corresponding substring of the reference for a given bamChunk.
-     */
-    char *fullReferenceString = stHash_search(referenceSequences, bamChunk->refSeqName);
-    if (fullReferenceString == NULL) {
-        st_logCritical("> ERROR: Reference sequence missing from reference map: %s \n", bamChunk->refSeqName);
-        return NULL;
+void chunkMemoryBudget_release(int64_t reservedBytes) {
+    # ifdef _OPENMP
+    #pragma omp critical(chunkMemoryBudget)
+    # endif
+    {
+        chunkMemoryInUse -= reservedBytes;
     }
-    int64_t refLen = strlen(fullReferenceString);
-    char *referenceString = stString_getSubString(fullReferenceString, bamChunk->chunkBoundaryStart,
-                                                  (refLen < bamChunk->chunkBoundaryEnd ? refLen : bamChunk->chunkBoundaryEnd) - bamChunk->chunkBoundaryStart);
-
-    RleString *rleRef = params->polishParams->useRunLengthEncoding ?
-            rleString_construct(referenceString) : rleString_construct_no_rle(referenceString);
-    free(referenceString);
-
-    return rleRef;
 }
 
-
 /*
  * Main functions
  */
 
 void usage() {
     fprintf(stderr, "usage: marginPolish <BAM_FILE> <ASSEMBLY_FASTA> <PARAMS> [options]\n");
+    fprintf(stderr, "       marginPolish --compileParams <PARAMS> <COMPILED_PARAMS>\n");
     fprintf(stderr, "Version: %s \n\n", MARGIN_POLISH_VERSION_H);
     fprintf(stderr, "Polishes the ASSEMBLY_FASTA using alignments in BAM_FILE.\n");
 
@@ -85,6 +85,8 @@ void usage() {
     fprintf(stderr, "    BAM_FILE is the alignment of reads to the assembly (or reference).\n");
     fprintf(stderr, "    ASSEMBLY_FASTA is the reference sequence BAM file in fasta format.\n");
     fprintf(stderr, "    PARAMS is the file with marginPolish parameters.\n");
+    fprintf(stderr, "\nWith --compileParams, PARAMS is parsed and written to COMPILED_PARAMS as a binary file\n");
+    fprintf(stderr, "that can be given as PARAMS to later runs, which then load it without parsing json.\n");
 
     fprintf(stderr, "\nDefault options:\n");
     fprintf(stderr, "    -h --help                : Print this help screen\n");
@@ -96,6 +98,11 @@ void usage() {
     fprintf(stderr, "    -r --region              : If set, will only compute for given chromosomal region.\n");
     fprintf(stderr, "                                 Format: chr:start_pos-end_pos (chr3:2000-3000).\n");
     fprintf(stderr, "    -p --depth               : Will override the downsampling depth set in PARAMS.\n");
+    # ifdef _OPENMP
+    fprintf(stderr, "    -m --maxMemory           : Approximate memory budget in GB shared by concurrently polished chunks.\n");
+    fprintf(stderr, "                                 Chunks estimated to exceed the remaining budget wait until it is\n");
+    fprintf(stderr, "                                 freed [default = no limit]\n");
+    #endif
 
     # ifdef _HDF5
     fprintf(stderr, "\nHELEN feature generation options:\n");
@@ -110,12 +117,29 @@ void usage() {
     fprintf(stderr, "    -u --trueReferenceBam    : true reference aligned to ASSEMBLY_FASTA, for HELEN\n");
     fprintf(stderr, "                               features.  Setting this parameter will include labels\n");
     fprintf(stderr, "                               in output.\n");
+    fprintf(stderr, "    -z --featureCompression  : deflate level (1-9) for chunked, compressed feature datasets,\n");
+    fprintf(stderr, "                                 0 for contiguous uncompressed datasets [default = 0]\n");
+    fprintf(stderr, "    -e --featureEncoding     : encoding of feature image weights.  Valid encodings:\n");
+    fprintf(stderr, "                                 normalizedUint8: [default] uint8 fractions of position weight\n");
+    fprintf(stderr, "                                 float16:         half precision fractions of position weight\n");
+    fprintf(stderr, "                                 scaledUint8:     uint8 scaled per window, scale stored as\n");
+    fprintf(stderr, "                                                  <dataset>_scale\n");
+    fprintf(stderr, "    -w --featureWindows      : how chunk features are cut into windows.  Valid modes:\n");
+    fprintf(stderr, "                                 overlapping: [default] whole chunk, last window overlaps\n");
+    fprintf(stderr, "                                 core:        each position once, trimmed to the chunk core,\n");
+    fprintf(stderr, "                                              last window zero padded with a feature_mask\n");
+    fprintf(stderr, "    -g --featureFormat       : how feature windows are stored.  Valid formats:\n");
+    fprintf(stderr, "                                 hdf5: [default] one group per window in OUTPUT_BASE.h5\n");
+    fprintf(stderr, "                                 npy:  windows appended to OUTPUT_BASE.images.npy (and\n");
+    fprintf(stderr, "                                       .positions.npy etc.), indexed by OUTPUT_BASE.index.tsv\n");
     # endif
 
     fprintf(stderr, "\nMiscellaneous supplementary output options:\n");
     fprintf(stderr, "    -i --outputRepeatCounts  : Output base to write out the repeat counts [default = NULL]\n");
     fprintf(stderr, "    -j --outputPoaTsv        : Output base to write out the poa as TSV file [default = NULL]\n");
     fprintf(stderr, "    -d --outputPoaDot        : Output base to write out the poa as DOT file [default = NULL]\n");
+    fprintf(stderr, "    -P --outputChunkProfile  : File to write the time spent in each polishing stage to, one json\n");
+    fprintf(stderr, "                                 object per chunk per line [default = NULL]\n");
     fprintf(stderr, "\n");
 }
 
@@ -160,7 +184,9 @@ int main(int argc, char *argv[]) {
     char *outputRepeatCountBase = NULL;
     char *outputPoaTsvBase = NULL;
     char *outputPoaDotBase = NULL;
+    char *outputChunkProfileFile = NULL;
     int64_t maxDepth = -1;
+    double maxMemoryInGB = -1;
 
     // for feature generation
     HelenFeatureType helenFeatureType = HFEAT_NONE;
@@ -168,7 +194,12 @@ int main(int argc, char *argv[]) {
     BamChunker *trueReferenceChunker = NULL;
     bool fullFeatureOutput = FALSE;
     int64_t splitWeightMaxRunLength = 0;
-    void **helenHDF5Files = NULL;
+    void *helenFeatureWriter = NULL;
+    void *helenTruthLabeler = NULL;
+    int64_t helenFeatureCompression = 0;
+    HelenFeatureImageEncoding helenFeatureImageEncoding = HFEAT_IMAGE_NORMALIZED_UINT8;
+    HelenFeatureWindowMode helenFeatureWindowMode = HFEAT_WINDOW_OVERLAPPING;
+    HelenFeatureOutputFormat helenFeatureOutputFormat = HFEAT_OUTPUT_HDF5;
 
     if(argc < 4) {
         free(outputBase);
@@ -177,6 +208,22 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    // Compile the parameters, without polishing
+    if (stString_eq(argv[1], "--compileParams")) {
+        if (argc != 4) {
+            usage();
+            return 1;
+        }
+        st_setLogLevelFromString(logLevelString);
+        free(logLevelString);
+        free(outputBase);
+        Params *params = params_readParams(argv[2]);
+        params_writeCompiled(params, argv[3]);
+        st_logCritical("> Wrote compiled parameters from %s to %s\n", argv[2], argv[3]);
+        params_destruct(params);
+        return 0;
+    }
+
     bamInFile = stString_copy(argv[1]);
     referenceFastaFile = stString_copy(argv[2]);
     paramsFile = stString_copy(argv[3]);
@@ -192,17 +239,29 @@ int main(int argc, char *argv[]) {
                 { "outputBase", required_argument, 0, 'o'},
                 { "region", required_argument, 0, 'r'},
                 { "depth", required_argument, 0, 'p'},
+                # ifdef _OPENMP
+                { "maxMemory", required_argument, 0, 'm'},
+                #endif
                 { "produceFeatures", no_argument, 0, 'f'},
                 { "featureType", required_argument, 0, 'F'},
                 { "trueReferenceBam", required_argument, 0, 'u'},
                 { "splitRleWeightMaxRL", required_argument, 0, 'L'},
+                { "featureCompression", required_argument, 0, 'z'},
+                { "featureEncoding", required_argument, 0, 'e'},
+                { "featureWindows", required_argument, 0, 'w'},
+                { "featureFormat", required_argument, 0, 'g'},
 				{ "outputRepeatCounts", required_argument, 0, 'i'},
 				{ "outputPoaTsv", required_argument, 0, 'j'},
 				{ "outputPoaDot", required_argument, 0, 'd'},
+				{ "outputChunkProfile", required_argument, 0, 'P'},
                 { 0, 0, 0, 0 } };
 
         int option_index = 0;
-        int key = getopt_long(argc-2, &argv[2], "a:o:v:r:p:fF:u:hL:i:j:d:t:", long_options, &option_index);
+        # ifdef _OPENMP
+        int key = getopt_long(argc-2, &argv[2], "a:o:v:r:p:m:fF:u:hL:i:j:d:P:t:z:e:w:g:", long_options, &option_index);
+        # else
+        int key = getopt_long(argc-2, &argv[2], "a:o:v:r:p:fF:u:hL:i:j:d:P:t:z:e:w:g:", long_options, &option_index);
+        #endif
 
         if (key == -1) {
             break;
@@ -228,6 +287,15 @@ int main(int argc, char *argv[]) {
             if (maxDepth < 0) {
                 st_errAbort("Invalid maxDepth: %s", optarg);
             }
+            break;
+        # ifdef _OPENMP
+        case 'm':
+            maxMemoryInGB = atof(optarg);
+            if (maxMemoryInGB <= 0) {
+                st_errAbort("Invalid maxMemory: %s", optarg);
+            }
+            break;
+        #endif
         case 'i':
             outputRepeatCountBase = getFileBase(optarg, "repeatCount");
             break;
@@ -237,6 +305,9 @@ int main(int argc, char *argv[]) {
         case 'd':
             outputPoaDotBase = getFileBase(optarg, "poa");
             break;
+        case 'P':
+            outputChunkProfileFile = stString_copy(optarg);
+            break;
         case 'F':
             if (stString_eqcase(optarg, "simpleWeight")) {
                 helenFeatureType = HFEAT_SIMPLE_WEIGHT;
@@ -264,6 +335,47 @@ int main(int argc, char *argv[]) {
                 st_errAbort("Invalid splitRleWeightMaxRL: %d", splitWeightMaxRunLength);
             }
             break;
+        case 'z':
+            helenFeatureCompression = atoi(optarg);
+            if (helenFeatureCompression < 0 || helenFeatureCompression > 9) {
+                st_errAbort("Invalid featureCompression: %s", optarg);
+            }
+            break;
+        case 'e':
+            if (stString_eqcase(optarg, "normalizedUint8")) {
+                helenFeatureImageEncoding = HFEAT_IMAGE_NORMALIZED_UINT8;
+            } else if (stString_eqcase(optarg, "float16")) {
+                helenFeatureImageEncoding = HFEAT_IMAGE_FLOAT16;
+            } else if (stString_eqcase(optarg, "scaledUint8")) {
+                helenFeatureImageEncoding = HFEAT_IMAGE_SCALED_UINT8;
+            } else {
+                fprintf(stderr, "Unrecognized featureEncoding for HELEN: %s\n\n", optarg);
+                usage();
+                return 1;
+            }
+            break;
+        case 'w':
+            if (stString_eqcase(optarg, "overlapping")) {
+                helenFeatureWindowMode = HFEAT_WINDOW_OVERLAPPING;
+            } else if (stString_eqcase(optarg, "core")) {
+                helenFeatureWindowMode = HFEAT_WINDOW_CORE;
+            } else {
+                fprintf(stderr, "Unrecognized featureWindows for HELEN: %s\n\n", optarg);
+                usage();
+                return 1;
+            }
+            break;
+        case 'g':
+            if (stString_eqcase(optarg, "hdf5")) {
+                helenFeatureOutputFormat = HFEAT_OUTPUT_HDF5;
+            } else if (stString_eqcase(optarg, "npy")) {
+                helenFeatureOutputFormat = HFEAT_OUTPUT_NPY;
+            } else {
+                fprintf(stderr, "Unrecognized featureFormat for HELEN: %s\n\n", optarg);
+                usage();
+                return 1;
+            }
+            break;
         case 't':
             numThreads = atoi(optarg);
             if (numThreads <= 0) {
@@ -318,6 +430,10 @@ int main(int argc, char *argv[]) {
     }
     omp_set_num_threads(numThreads);
     st_logCritical("Running OpenMP with %d threads.\n", omp_get_max_threads());
+    if (maxMemoryInGB > 0) {
+        chunkMemoryBudget = (int64_t) (maxMemoryInGB * (1 << 30));
+        st_logCritical("Limiting estimated memory of concurrently polished chunks to %.2fG.\n", maxMemoryInGB);
+    }
     # endif
     if (helenFeatureType != HFEAT_NONE && splitWeightMaxRunLength == 0) {
         switch (helenFeatureType) {
@@ -392,6 +508,13 @@ int main(int argc, char *argv[]) {
         st_errAbort("Could not open %s for writing!\n", polishedReferenceOutFile);
     }
     free(polishedReferenceOutFile);
+    FILE *chunkProfileFh = NULL;
+    if (outputChunkProfileFile != NULL) {
+        chunkProfileFh = fopen(outputChunkProfileFile, "w");
+        if (chunkProfileFh == NULL) {
+            st_errAbort("Could not open %s for writing!\n", outputChunkProfileFile);
+        }
+    }
 
     // get chunker for bam.  if regionStr is NULL, it will be ignored
     BamChunker *bamChunker = bamChunker_construct2(bamInFile, regionStr, params->polishParams);
@@ -404,15 +527,17 @@ int main(int argc, char *argv[]) {
 
 
     // for feature generation
-    BamChunker *trueReferenceBamChunker = NULL;
+    #ifdef _HDF5
     if (trueReferenceBam != NULL) {
-        trueReferenceBamChunker = bamChunker_copyConstruct(bamChunker);
-        free(trueReferenceBamChunker->bamFile);
-        trueReferenceBamChunker->bamFile = stString_copy(trueReferenceBam);
+        helenTruthLabeler = helenTruthLabeler_construct(trueReferenceBam, params->polishParams);
     }
-    #ifdef _HDF5
     if (helenFeatureType != HFEAT_NONE) {
-        helenHDF5Files = (void**) openHelenFeatureHDF5FilesByThreadCount(outputBase, numThreads);
+        char *helenFeatureOutput = helenFeatureOutputFormat == HFEAT_OUTPUT_NPY ? stString_copy(outputBase) :
+                stString_print("%s.h5", outputBase);
+        helenFeatureWriter = helenFeatureWriter_construct(helenFeatureOutput, helenFeatureOutputFormat,
+                helenFeatureCompression, helenFeatureImageEncoding, helenFeatureWindowMode,
+                HELEN_FEATURE_WRITER_QUEUE_SIZE_PER_THREAD * numThreads);
+        free(helenFeatureOutput);
     }
     #endif
 
@@ -420,6 +545,11 @@ int main(int argc, char *argv[]) {
     // Each chunk produces a char* as output which is saved here
     char **chunkResults = st_calloc(bamChunker->chunkCount, sizeof(char*));
 
+    // Profiles are kept until the chunks are merged, so the stitch times can be included. They also carry the
+    // hot-path counters of each chunk to the run summary when those are compiled in
+    ChunkProfile **chunkProfiles = outputChunkProfileFile == NULL && !hotPathCounters_enabled() ? NULL :
+            st_calloc(bamChunker->chunkCount, sizeof(ChunkProfile *));
+
     // (may) need to shuffle chunks
     stList *chunkOrder = stList_construct3(0, (void (*)(void*))stIntTuple_destruct);
     for (int64_t i = 0; i < bamChunker->chunkCount; i++) {
@@ -440,9 +570,17 @@ int main(int argc, char *argv[]) {
         int64_t chunkIdx = stIntTuple_get(stList_get(chunkOrder, i), 0);
         // Time all chunks
         time_t chunkStartTime = time(NULL);
+        double chunkProfileStartTime = chunkProfile_getTime();
 
         // Get chunk
         BamChunk *bamChunk = bamChunker_getChunk(bamChunker, chunkIdx);
+        ChunkProfile *chunkProfile = NULL;
+        if (chunkProfiles != NULL) {
+            chunkProfile = chunkProfile_construct(chunkIdx, bamChunk->refSeqName, bamChunk->chunkBoundaryStart,
+                    bamChunk->chunkBoundaryEnd);
+            chunkProfiles[chunkIdx] = chunkProfile;
+            chunkProfile_startCounters(chunkProfile);
+        }
 
         // logging
         char *logIdentifier;
@@ -498,10 +636,13 @@ int main(int argc, char *argv[]) {
         st_logInfo(">%s Parsing input reads from file: %s\n", logIdentifier, bamInFile);
         stList *reads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
         stList *alignments = stList_construct3(0, (void (*)(void *)) stList_destruct);
+        double stageStartTime = chunkProfile_getTime();
         convertToReadsAndAlignments(bamChunk, rleReference, reads, alignments);
+        chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_BAM_FETCH, chunkProfile_getTime() - stageStartTime);
 
         // do downsampling if appropriate
         if (params->polishParams->maxDepth > 0) {
+            stageStartTime = chunkProfile_getTime();
             // get downsampling structures
             stList *filteredReads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
             stList *discardedReads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
@@ -534,7 +675,7 @@ int main(int argc, char *argv[]) {
                 stList_destruct(discardedReads);
                 stList_destruct(discardedAlignments);
             }
-
+            chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_DOWNSAMPLE, chunkProfile_getTime() - stageStartTime);
         }
 
         Poa *poa = NULL; // The poa alignment
@@ -550,12 +691,23 @@ int main(int argc, char *argv[]) {
                        logIdentifier, stList_length(reads), totalNucleotides >> 10);
         }
 
+        // Wait until there is enough memory budget to polish the chunk
+        int64_t reservedMemory = chunkMemoryBudget_acquire(
+                poa_estimatePeakMemory(reads, alignments, rleReference, params->polishParams), logIdentifier);
+
         // Generate partial order alignment (POA) (destroys rleAlignments in the process)
-        poa = poa_realignAll(reads, alignments, rleReference, params->polishParams);
+        ForwardScoreCache *forwardScoreCache = params->polishParams->forwardScoreCacheMaxMemory > 0 ?
+                forwardScoreCache_construct(params->polishParams->forwardScoreCacheMaxMemory) : NULL;
+        poa = poa_realignAll2(reads, alignments, rleReference, params->polishParams, forwardScoreCache, chunkProfile);
+        if (forwardScoreCache != NULL) {
+            forwardScoreCache_destruct(forwardScoreCache);
+        }
 
 
         // get polished reference string and expand RLE (regardless of whether RLE was applied)
+        stageStartTime = chunkProfile_getTime();
         poa_estimateRepeatCountsUsingBayesianModel(poa, reads, params->polishParams->repeatSubMatrix);
+        chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_REPEAT_COUNTS, chunkProfile_getTime() - stageStartTime);
         RleString *polishedRleConsensus = poa->refString;
         polishedConsensusString = rleString_expand(polishedRleConsensus);
 
@@ -606,10 +758,11 @@ int main(int argc, char *argv[]) {
 
         #ifdef _HDF5
         if (helenFeatureType != HFEAT_NONE) {
-            handleHelenFeatures(helenFeatureType, trueReferenceBamChunker, splitWeightMaxRunLength,
-                    helenHDF5Files, fullFeatureOutput, trueReferenceBam, params, logIdentifier, chunkIdx,
-                    bamChunk, poa, reads, polishedConsensusString, polishedRleConsensus);
-
+            stageStartTime = chunkProfile_getTime();
+            handleHelenFeatures(helenFeatureType, helenTruthLabeler, splitWeightMaxRunLength,
+                    helenFeatureWriter, fullFeatureOutput, params, logIdentifier, chunkIdx,
+                    bamChunk, poa, reads, polishedConsensusString, polishedRleConsensus, rleReference);
+            chunkProfile_addStageTime(chunkProfile, CHUNK_STAGE_FEATURES, chunkProfile_getTime() - stageStartTime);
         }
         #endif
 
@@ -620,11 +773,18 @@ int main(int argc, char *argv[]) {
                        (int) (time(NULL) - chunkStartTime));
         }
 
+        if (chunkProfile != NULL) {
+            chunkProfile_stopCounters(chunkProfile);
+            chunkProfile_setChunkStats(chunkProfile, reads, poa);
+            chunkProfile->totalSeconds = chunkProfile_getTime() - chunkProfileStartTime;
+        }
+
         // Cleanup
         rleString_destruct(rleReference);
         poa_destruct(poa);
         stList_destruct(reads);
         stList_destruct(alignments);
+        chunkMemoryBudget_release(reservedMemory);
         free(logIdentifier);
     }
 
@@ -655,7 +815,7 @@ int main(int argc, char *argv[]) {
 
             // generate and save sequence
             char *contigSequence = mergeContigChunksThreaded(chunkResults, contigStartIdx, chunkIdx, numThreads, 
-                    bamChunker->chunkBoundary * 2, params, missingChunkSpacer, referenceSequenceName);
+                    bamChunker->chunkBoundary * 2, params, missingChunkSpacer, referenceSequenceName, chunkProfiles);
             fastaWrite(contigSequence, referenceSequenceName, polishedReferenceOutFh);
 
             // log progress
@@ -691,19 +851,41 @@ int main(int argc, char *argv[]) {
         free(chunkResults[chunkIdx]);
     }
 
+    // write chunk profiles, in chunk order, and summarise the hot-path counters over the run
+    if (chunkProfiles != NULL) {
+        int64_t runCounters[HOT_PATH_COUNTER_NUMBER] = {0};
+        if (chunkProfileFh != NULL) {
+            st_logCritical("> Writing chunk profiles to %s\n", outputChunkProfileFile);
+        }
+        for (int64_t chunkIdx = 0; chunkIdx < bamChunker->chunkCount; chunkIdx++) {
+            for (int64_t i = 0; i < HOT_PATH_COUNTER_NUMBER; i++) {
+                runCounters[i] += chunkProfiles[chunkIdx]->counters[i];
+            }
+            if (chunkProfileFh != NULL) {
+                chunkProfile_writeJson(chunkProfiles[chunkIdx], chunkProfileFh);
+            }
+            chunkProfile_destruct(chunkProfiles[chunkIdx]);
+        }
+        hotPathCounters_logSummary(runCounters);
+        if (chunkProfileFh != NULL) {
+            fclose(chunkProfileFh);
+            free(outputChunkProfileFile);
+        }
+        free(chunkProfiles);
+    }
+
     // Cleanup
     bamChunker_destruct(bamChunker);
     stHash_destruct(referenceSequences);
     params_destruct(params);
     if (trueReferenceBam != NULL) free(trueReferenceBam);
-    if (trueReferenceBamChunker != NULL) bamChunker_destruct(trueReferenceBamChunker);
     if (regionStr != NULL) free(regionStr);
     #ifdef _HDF5
-    if (helenHDF5Files != NULL) {
-        for (int64_t i = 0; i < numThreads; i++) {
-            HelenFeatureHDF5FileInfo_destruct((HelenFeatureHDF5FileInfo *) helenHDF5Files[i]);
-        }
-        free(helenHDF5Files);
+    if (helenFeatureWriter != NULL) {
+        helenFeatureWriter_destruct(helenFeatureWriter);
+    }
+    if (helenTruthLabeler != NULL) {
+        helenTruthLabeler_destruct(helenTruthLabeler);
     }
     #endif
     free(chunkResults);
@@ -922,7 +922,7 @@ void test_mergeContigChunks(CuTest *testCase) {
     chunks[1] = stString_copy("AACCCCCCCCGG");
     chunks[2] = stString_copy("CCGGGGGGGGTT");
     chunks[3] = stString_copy("GGTTTTTTTT");
-    char* contig = mergeContigChunks(chunks, 0, 4, 4, params, "NNNNNN");
+    char* contig = mergeContigChunks(chunks, 0, 4, 4, params, "NNNNNN", NULL);
     CuAssertTrue(testCase, strcmp(contig, "AAAAAAAACCCCCCCCGGGGGGGGTTTTTTTT") == 0);
 }
 
@@ -948,24 +948,83 @@ void test_mergeContigChunksThreaded(CuTest *testCase) {
     chunks[15] = stString_copy("GGTTTTTTTT");
     char *truth = "AAAAAAAACCCCCCCCGGGGGGGGTTTTTTTTAAAAAAAACCCCCCCCGGGGGGGGTTTTTTTTAAAAAAAACCCCCCCCGGGGGGGGTTTTTTTTAAAAAAAACCCCCCCCGGGGGGGGTTTTTTTT";
     char* contig;
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 1, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 1, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 2, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 2, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 3, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 3, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 4, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 4, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 5, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 5, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 6, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 6, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0);
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 7, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 7, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0 );
-    contig = mergeContigChunksThreaded(chunks, 0, 16, 8, 4, params, "NNNNNN", "testContig");
+    contig = mergeContigChunksThreaded(chunks, 0, 16, 8, 4, params, "NNNNNN", "testContig", NULL);
     CuAssertTrue(testCase, strcmp(contig, truth) == 0 );
 }
 
+void test_chunkProfile(CuTest *testCase) {
+    Params *params = params_readParams(INPUT_PARAMS);
+    char *chunks[4];
+    chunks[0] = stString_copy("AAAAAAAACC");
+    chunks[1] = stString_copy("AACCCCCCCCGG");
+    chunks[2] = stString_copy("CCGGGGGGGGTT");
+    chunks[3] = stString_copy("GGTTTTTTTT");
+    ChunkProfile *chunkProfiles[4];
+    for (int64_t i = 0; i < 4; i++) {
+        chunkProfiles[i] = chunkProfile_construct(i, "testContig", 10 * i, 10 * i + 12);
+    }
+
+    // every chunk after the first is stitched to its predecessor, whichever thread merges it
+    char *contig = mergeContigChunksThreaded(chunks, 0, 4, 2, 4, params, "NNNNNN", "testContig", chunkProfiles);
+    CuAssertStrEquals(testCase, "AAAAAAAACCCCCCCCGGGGGGGGTTTTTTTT", contig);
+    CuAssertDblEquals(testCase, 0.0, chunkProfiles[0]->stageSeconds[CHUNK_STAGE_MERGE], 0);
+    for (int64_t i = 1; i < 4; i++) {
+        CuAssertTrue(testCase, chunkProfiles[i]->stageSeconds[CHUNK_STAGE_MERGE] > 0);
+    }
+
+    ChunkProfile *profile = chunkProfiles[1];
+    chunkProfile_addStageTime(profile, CHUNK_STAGE_BAM_FETCH, 1.5);
+    chunkProfile_addStageTime(profile, CHUNK_STAGE_BAM_FETCH, 0.25);
+    chunkProfile_addStageTime(NULL, CHUNK_STAGE_BAM_FETCH, 1.0);
+    chunkProfile_addIteration(profile, TRUE, 2.0, 3.0);
+    chunkProfile_addIteration(profile, FALSE, 4.0, 0.0);
+    stList *reads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
+    stList_append(reads, bamChunkRead_construct2("read", "AAACGT", NULL, TRUE, TRUE));
+    chunkProfile_setChunkStats(profile, reads, NULL);
+    CuAssertIntEquals(testCase, 1, profile->readCount);
+    CuAssertIntEquals(testCase, 4, profile->rleNucleotides);
+    CuAssertTrue(testCase, profile->peakRssKb > 0);
+
+    // one line of json
+    char *profileFile = "test.chunkProfile.jsonl";
+    FILE *fh = fopen(profileFile, "w");
+    chunkProfile_writeJson(profile, fh);
+    fclose(fh);
+    char line[4096];
+    fh = fopen(profileFile, "r");
+    CuAssertTrue(testCase, fgets(line, sizeof(line), fh) != NULL);
+    CuAssertTrue(testCase, fgets(line + strlen(line), sizeof(line) - strlen(line), fh) == NULL);
+    fclose(fh);
+    remove(profileFile);
+    CuAssertTrue(testCase, strstr(line, "{\"chunk\": 1, \"contig\": \"testContig\", \"start\": 10, \"end\": 22, ") == line);
+    CuAssertTrue(testCase, strstr(line, "\"bamFetch\": 1.750000") != NULL);
+    CuAssertTrue(testCase, strstr(line, "\"iterations\": [{\"algorithm\": \"consensus\", \"consensusSeconds\": 2.000000, "
+            "\"realignSeconds\": 3.000000}, {\"algorithm\": \"polish\"") != NULL);
+    CuAssertTrue(testCase, strstr(line, "]}\n") != NULL);
+
+    for (int64_t i = 0; i < 4; i++) {
+        chunkProfile_destruct(chunkProfiles[i]);
+        free(chunks[i]);
+    }
+    free(contig);
+    stList_destruct(reads);
+    params_destruct(params);
+}
+
 
 
 
@@ -987,6 +1046,7 @@ CuSuite* chunkingTestSuite(void) {
     SUITE_ADD_TEST(suite, test_readAlignmentsWithSoftclippingChunkEnd);
     SUITE_ADD_TEST(suite, test_mergeContigChunks);
     SUITE_ADD_TEST(suite, test_mergeContigChunksThreaded);
+    SUITE_ADD_TEST(suite, test_chunkProfile);
 
     return suite;
 }
@@ -43,7 +43,7 @@ void test_defaultFeatureGeneration(CuTest *testCase) {
     struct stat st;
     char *outputName = "test.default";
     char *expectedOutputFa = stString_print("%s.fa", outputName);
-    char *expectedOutputFeature = stString_print("%s.T00.h5", outputName);
+    char *expectedOutputFeature = stString_print("%s.h5", outputName);
 
     CuAssertTrue(testCase, access(expectedOutputFa, R_OK ) == 0 || remove(expectedOutputFa) != 0);
     CuAssertTrue(testCase, access(expectedOutputFeature, R_OK ) == 0 || remove(expectedOutputFeature) != 0);
@@ -67,7 +67,7 @@ void test_simpleWeightFeatureGeneration(CuTest *testCase) {
     char *featureType = "simpleWeight";
     char *outputName = "test.simpleWeightFeature";
     char *expectedOutputFa = stString_print("%s.fa", outputName);
-    char *expectedOutputFeature = stString_print("%s.T00.h5", outputName);
+    char *expectedOutputFeature = stString_print("%s.h5", outputName);
 
     CuAssertTrue(testCase, access(expectedOutputFa, R_OK ) == 0 || remove(expectedOutputFa) != 0);
     CuAssertTrue(testCase, access(expectedOutputFeature, R_OK ) == 0 || remove(expectedOutputFeature) != 0);
@@ -92,7 +92,7 @@ void test_splitRleWeightFeatureGeneration(CuTest *testCase) {
     char *featureType = "splitRleWeight";
     char *outputName = "test.splitRleWeightFeature";
     char *expectedOutputFa = stString_print("%s.fa", outputName);
-    char *expectedOutputFeature = stString_print("%s.T00.h5", outputName);
+    char *expectedOutputFeature = stString_print("%s.h5", outputName);
 
     CuAssertTrue(testCase, access(expectedOutputFa, R_OK ) == 0 || remove(expectedOutputFa) != 0);
     CuAssertTrue(testCase, access(expectedOutputFeature, R_OK ) == 0 || remove(expectedOutputFeature) != 0);
@@ -234,12 +234,636 @@ void test_channelRleWeightIndex(CuTest *testCase) {
     PoaFeature_ChannelRleWeight_destruct(feature);
 }
 
+void test_bandedTruthAlignment(CuTest *testCase) {
+    // consensus is the truth with a deletion, a substitution and an insertion
+    char *truth = FEATURE_TEST_TRUTH_SEQ;
+    char *consensus = "ACGATAACCGGTTAAACCCGGGTTTCAAACCCCGTGGTTGATTACAGCAT";
+    int64_t truthLength = strlen(truth);
+
+    // the truth aligns to the reference without edits
+    int64_t *referenceToTruth = st_calloc(truthLength, sizeof(int64_t));
+    for (int64_t i = 0; i < truthLength; i++) {
+        referenceToTruth[i] = i;
+    }
+
+    stList *unbanded = alignConsensusAndTruth(consensus, truth);
+    stList *banded = alignConsensusAndTruthBanded(consensus, truth, referenceToTruth, truthLength, 8);
+    CuAssertTrue(testCase, banded != NULL);
+    CuAssertIntEquals(testCase, stList_length(unbanded), stList_length(banded));
+    for (int64_t i = 0; i < stList_length(banded); i++) {
+        stIntTuple *bandedPair = stList_get(banded, i);
+        stIntTuple *unbandedPair = stList_get(unbanded, i);
+        CuAssertIntEquals(testCase, stIntTuple_get(unbandedPair, 0), stIntTuple_get(bandedPair, 0));
+        CuAssertIntEquals(testCase, stIntTuple_get(unbandedPair, 1), stIntTuple_get(bandedPair, 1));
+    }
+
+    // a band too narrow for the drift is reported rather than followed
+    for (int64_t i = 0; i < truthLength; i++) {
+        referenceToTruth[i] = i < truthLength / 2 ? i : i + 10;
+    }
+    CuAssertTrue(testCase, alignConsensusAndTruthBanded(consensus, truth, referenceToTruth, truthLength, 2) == NULL);
+
+    stList_destruct(unbanded);
+    stList_destruct(banded);
+    free(referenceToTruth);
+}
+
+static char *getTruthThroughReads(BamChunker *truthChunker, char *refSeqName, int64_t start, int64_t end) {
+    // the truth as it was found before the labeler, by converting the truth alignment to a read of the chunk
+    BamChunk *bamChunk = bamChunk_construct2(refSeqName, start, start, end, end, truthChunker);
+    stList *reads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
+    stList *alignments = stList_construct3(0, (void (*)(void *)) stList_destruct);
+    char *truth = NULL;
+    if (convertToReadsAndAlignments(bamChunk, NULL, reads, alignments) == 1) {
+        truth = rleString_expand(((BamChunkRead *) stList_get(reads, 0))->rleRead);
+    }
+    stList_destruct(reads);
+    stList_destruct(alignments);
+    bamChunk_destruct(bamChunk);
+    return truth;
+}
+
+static char *getTruthThroughLabeler(HelenTruthLabeler *labeler, char *refSeqName, int64_t start, int64_t end,
+        int64_t **referenceToTruth) {
+    BamChunk *bamChunk = bamChunk_construct2(refSeqName, start, start, end, end, NULL);
+    char *truth = helenTruthLabeler_getTruth(labeler, bamChunk, referenceToTruth);
+    bamChunk_destruct(bamChunk);
+    return truth;
+}
+
+void test_truthLabeler(CuTest *testCase) {
+    // the truth alignment is 3M1I11M1I24M2D10M from the first position of the 50bp contig
+    Params *params = params_readParams(FEATURE_TEST_PARAMS);
+    HelenTruthLabeler *labeler = helenTruthLabeler_construct(FEATURE_TEST_TRUTH_BAM, params->polishParams);
+    BamChunker *truthChunker = bamChunker_construct(FEATURE_TEST_TRUTH_BAM, params->polishParams);
+    char *contig = "feature_contig";
+
+    // the whole contig, the inserts inside it, a window starting at an insert and one ending in the deletion
+    // with the position in the truth sequence each starts at
+    int64_t windows[4][3] = {{0, 50, 0}, {5, 45, 6}, {3, 20, 3}, {30, 39, 32}};
+    int64_t *referenceToTruth = NULL;
+    for (int64_t w = 0; w < 4; w++) {
+        char *truth = getTruthThroughLabeler(labeler, contig, windows[w][0], windows[w][1], &referenceToTruth);
+        char *expectedTruth = getTruthThroughReads(truthChunker, contig, windows[w][0], windows[w][1]);
+        CuAssertTrue(testCase, truth != NULL);
+        CuAssertTrue(testCase, expectedTruth != NULL);
+        CuAssertStrEquals(testCase, expectedTruth, truth);
+        CuAssertTrue(testCase, referenceToTruth != NULL);
+
+        // each reference position maps to its truth base, or the one after the deletion
+        for (int64_t r = windows[w][0]; r < windows[w][1]; r++) {
+            int64_t truthPos = r < 3 ? r : r < 14 ? r + 1 : r < 38 ? r + 2 : r < 40 ? 40 : r;
+            CuAssertIntEquals(testCase, truthPos - windows[w][2], referenceToTruth[r - windows[w][0]]);
+        }
+        free(truth);
+        free(expectedTruth);
+        free(referenceToTruth);
+    }
+
+    // the insert at the start of a window is kept, the deleted positions at the end map past the truth
+    char *truth = getTruthThroughLabeler(labeler, contig, 3, 20, &referenceToTruth);
+    CuAssertIntEquals(testCase, 19, strlen(truth));
+    CuAssertIntEquals(testCase, 'A', truth[0]);
+    free(truth);
+    free(referenceToTruth);
+    truth = getTruthThroughLabeler(labeler, contig, 30, 39, &referenceToTruth);
+    CuAssertIntEquals(testCase, 8, strlen(truth));
+    CuAssertIntEquals(testCase, 8, referenceToTruth[8]);
+    free(truth);
+    free(referenceToTruth);
+
+    // a window no truth alignment overlaps has no truth
+    CuAssertTrue(testCase, getTruthThroughLabeler(labeler, contig, 50, 60, &referenceToTruth) == NULL);
+    CuAssertTrue(testCase, referenceToTruth == NULL);
+    CuAssertIntEquals(testCase, 1, labeler->contigLoads);
+
+    // contigs missing from the truth evict the first contig, which is then loaded again
+    CuAssertTrue(testCase, getTruthThroughLabeler(labeler, "missing_contig_1", 0, 50, &referenceToTruth) == NULL);
+    CuAssertTrue(testCase, getTruthThroughLabeler(labeler, "missing_contig_2", 0, 50, &referenceToTruth) == NULL);
+    CuAssertIntEquals(testCase, 3, labeler->contigLoads);
+    CuAssertIntEquals(testCase, HELEN_TRUTH_CACHED_CONTIGS, stList_length(labeler->contigs));
+    truth = getTruthThroughLabeler(labeler, contig, 0, 50, &referenceToTruth);
+    CuAssertIntEquals(testCase, 4, labeler->contigLoads);
+    CuAssertStrEquals(testCase, FEATURE_TEST_TRUTH_SEQ, truth);
+    free(truth);
+    free(referenceToTruth);
+
+    bamChunker_destruct(truthChunker);
+    helenTruthLabeler_destruct(labeler);
+    params_destruct(params);
+}
+
+void test_npyFeatureOutput(CuTest *testCase) {
+    struct stat st;
+    char *outputBase = "test.npyFeatureOutput";
+    BamChunk *bamChunk = bamChunk_construct2("contig", 0, 0, 2000, 2000, NULL);
+
+    // 1500 rows take two windows, the second one padded
+    HelenFeatureNpyFileInfo *fileInfo = HelenFeatureNpyFileInfo_construct(outputBase, HFEAT_IMAGE_NORMALIZED_UINT8,
+            HFEAT_WINDOW_OVERLAPPING);
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_SIMPLE_WEIGHT, HFEAT_IMAGE_NORMALIZED_UINT8,
+            "chunk", bamChunk, TRUE, 1500, 2, POAFEATURE_SIMPLE_WEIGHT_TOTAL_SIZE, 0);
+    for (int64_t i = 0; i < tensor->featureCount; i++) {
+        tensor->positionData[i][0] = (uint32_t) i;
+        tensor->imageData[i][0] = (uint8_t) (i % 256);
+        tensor->labelCharacterData[i][0] = (uint8_t) (i % 5);
+    }
+    helenFeatureTensor_writeNpy(tensor, fileInfo);
+    helenFeatureTensor_destruct(tensor);
+    CuAssertIntEquals(testCase, 2, fileInfo->windowCount);
+    HelenFeatureNpyFileInfo_destruct(fileInfo);
+
+    // fixed size records after the header
+    char *imageFile = stString_print("%s.images.npy", outputBase);
+    stat(imageFile, &st);
+    CuAssertIntEquals(testCase, HELEN_NPY_HEADER_SIZE + 2 * 1000 * POAFEATURE_SIMPLE_WEIGHT_TOTAL_SIZE, st.st_size);
+    char header[HELEN_NPY_HEADER_SIZE + 1];
+    FILE *fh = fopen(imageFile, "rb");
+    CuAssertTrue(testCase, fread(header, 1, HELEN_NPY_HEADER_SIZE, fh) == HELEN_NPY_HEADER_SIZE);
+    fclose(fh);
+    header[HELEN_NPY_HEADER_SIZE] = '\0';
+    CuAssertTrue(testCase, memcmp(header, "\x93NUMPY", 6) == 0);
+    CuAssertTrue(testCase, strstr(header + 10, "'shape': (2, 1000, 10)") != NULL);
+    CuAssertTrue(testCase, header[HELEN_NPY_HEADER_SIZE - 1] == '\n');
+
+    char *positionFile = stString_print("%s.positions.npy", outputBase);
+    stat(positionFile, &st);
+    CuAssertIntEquals(testCase, HELEN_NPY_HEADER_SIZE + 2 * 1000 * 2 * sizeof(uint32_t), st.st_size);
+    char *labelFile = stString_print("%s.labels.npy", outputBase);
+    stat(labelFile, &st);
+    CuAssertIntEquals(testCase, HELEN_NPY_HEADER_SIZE + 2 * 1000 * 2, st.st_size);
+
+    // the second window is the last 1000 features, overlapping the first
+    uint32_t position;
+    fh = fopen(positionFile, "rb");
+    fseek(fh, HELEN_NPY_HEADER_SIZE + 1000 * 2 * sizeof(uint32_t), SEEK_SET);
+    CuAssertTrue(testCase, fread(&position, sizeof(uint32_t), 1, fh) == 1);
+    fclose(fh);
+    CuAssertIntEquals(testCase, 500, position);
+
+    // one index row per window, after the header
+    char *indexFile = stString_print("%s.index.tsv", outputBase);
+    char line[1024];
+    int64_t indexRows = 0;
+    fh = fopen(indexFile, "r");
+    CuAssertTrue(testCase, fh != NULL);
+    while (fgets(line, sizeof(line), fh) != NULL) {
+        if (line[0] == '#') {
+            continue;
+        }
+        if (indexRows == 0) {
+            CuAssertTrue(testCase, strcmp(line, "0\tchunk\t0\tcontig\t0\t2000\t0\t2000\t1000\tNA\tNA\n") == 0);
+        }
+        indexRows++;
+    }
+    fclose(fh);
+    CuAssertIntEquals(testCase, 2, indexRows);
+
+    // the simple weight type writes no run length file
+    char *normalizationFile = stString_print("%s.normalization.npy", outputBase);
+    char *runLengthFile = stString_print("%s.runLengths.npy", outputBase);
+    CuAssertTrue(testCase, stat(runLengthFile, &st) != 0);
+    remove(imageFile);
+    remove(positionFile);
+    remove(normalizationFile);
+    remove(labelFile);
+    remove(runLengthFile);
+    remove(indexFile);
+
+    free(imageFile);
+    free(positionFile);
+    free(normalizationFile);
+    free(labelFile);
+    free(runLengthFile);
+    free(indexFile);
+    bamChunk_destruct(bamChunk);
+}
+
+static herr_t readHelenFeatureDataset(hid_t file, char *groupName, char *datasetName, hid_t memoryType, void *data) {
+    char *path = stString_print("images/%s/%s", groupName, datasetName);
+    hid_t dataset = H5Dopen(file, path, H5P_DEFAULT);
+    herr_t status = dataset < 0 ? -1 : H5Dread(dataset, memoryType, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+    if (dataset >= 0) {
+        status |= H5Dclose(dataset);
+    }
+    free(path);
+    return status;
+}
+
+void test_coreWindowConsensusPosition(CuTest *testCase) {
+    // an insert in the consensus right before the core boundary is left out of the core
+    char *reference = getRandomACGTSequence(1000);
+    int64_t boundary = 500;
+    char insert[5];
+    for (int64_t i = 0; i < 4; i++) {
+        // bases that can not slide the insert along the reference, so where it aligns is unambiguous
+        do {
+            insert[i] = "ACGT"[st_randomInt(0, 4)];
+        } while ((i == 0 && insert[i] == reference[boundary]) || (i == 3 && insert[i] == reference[boundary - 1]));
+    }
+    insert[4] = '\0';
+    char *consensus = addInsert(reference, insert, boundary);
+    RleString *rleReference = rleString_construct_no_rle(reference);
+    RleString *rleConsensus = rleString_construct_no_rle(consensus);
+
+    CuAssertIntEquals(testCase, 0, getConsensusPositionOfReferencePosition(rleConsensus, rleReference, 0));
+    CuAssertIntEquals(testCase, 100, getConsensusPositionOfReferencePosition(rleConsensus, rleReference, 100));
+    CuAssertIntEquals(testCase, boundary + 4, getConsensusPositionOfReferencePosition(rleConsensus, rleReference,
+            boundary));
+    CuAssertIntEquals(testCase, 804, getConsensusPositionOfReferencePosition(rleConsensus, rleReference, 800));
+    CuAssertIntEquals(testCase, rleConsensus->length, getConsensusPositionOfReferencePosition(rleConsensus,
+            rleReference, rleReference->length));
+    rleString_destruct(rleConsensus);
+    free(consensus);
+
+    // an insert longer than the anchor window, so the windows share no bases and the expected position is used
+    for (int64_t i = 0; i < 1000; i++) {
+        reference[i] = "AC"[st_randomInt(0, 2)];
+    }
+    char *unrelated = getRandomACGTSequence(6 * HELEN_CORE_ANCHOR_WINDOW);
+    for (int64_t i = 0; i < 6 * HELEN_CORE_ANCHOR_WINDOW; i++) {
+        unrelated[i] = unrelated[i] == 'A' || unrelated[i] == 'G' ? 'G' : 'T';
+    }
+    consensus = addInsert(reference, unrelated, 400);
+    rleString_destruct(rleReference);
+    rleReference = rleString_construct_no_rle(reference);
+    rleConsensus = rleString_construct_no_rle(consensus);
+    int64_t expectedPos = (int64_t) (1.0 * 420 * rleConsensus->length / rleReference->length);
+    CuAssertIntEquals(testCase, expectedPos, getConsensusPositionOfReferencePosition(rleConsensus, rleReference, 420));
+
+    rleString_destruct(rleConsensus);
+    rleString_destruct(rleReference);
+    free(consensus);
+    free(unrelated);
+    free(reference);
+}
+
+void test_coreWindowFeatureOutput(CuTest *testCase) {
+    char *outputFile = "test.coreWindows.h5";
+    BamChunk *bamChunk = bamChunk_construct2("contig", 0, 100, 1300, 1400, NULL);
+
+    // every position has an insert row after it, so both core boundaries fall next to an insert
+    int64_t imageColumnCount = ((SYMBOL_NUMBER - 1) * (POAFEATURE_SPLIT_MAX_RUN_LENGTH_DEFAULT + 1) + 1) * 2;
+    HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_SPLIT_RLE_WEIGHT, HFEAT_IMAGE_NORMALIZED_UINT8,
+            "chunk", bamChunk, TRUE, 2800, 3, imageColumnCount, 0);
+    for (int64_t i = 0; i < tensor->featureCount; i++) {
+        tensor->positionData[i][0] = (uint32_t) (i / 2);
+        tensor->positionData[i][1] = (uint32_t) (i % 2);
+        for (int64_t j = 0; j < imageColumnCount; j++) {
+            tensor->imageData[i][j] = (uint8_t) (1 + (i + j) % 200);
+        }
+        tensor->normalizationData[i][0] = 1;
+        tensor->labelCharacterData[i][0] = 1;
+        tensor->labelRunLengthData[i][0] = 1;
+    }
+
+    // the core drops the insert before its first position, and keeps the one after its last
+    helenFeatureTensor_keepReferencePositions(tensor, 100, 1299);
+    CuAssertIntEquals(testCase, 2400, tensor->featureCount);
+    CuAssertIntEquals(testCase, 100, tensor->positionData[0][0]);
+    CuAssertIntEquals(testCase, 0, tensor->positionData[0][1]);
+    CuAssertIntEquals(testCase, 1299, tensor->positionData[2399][0]);
+    CuAssertIntEquals(testCase, 1, tensor->positionData[2399][1]);
+    CuAssertIntEquals(testCase, 1 + (200 + 5) % 200, tensor->imageData[0][5]);
+
+    // consecutive windows, the last of 400 features zero padded to 1000
+    HelenFeatureHDF5FileInfo *fileInfo = HelenFeatureHDF5FileInfo_construct(outputFile, 0,
+            HFEAT_IMAGE_NORMALIZED_UINT8, HFEAT_WINDOW_CORE);
+    helenFeatureTensor_writeHDF5(tensor, fileInfo);
+    helenFeatureTensor_destruct(tensor);
+    HelenFeatureHDF5FileInfo_destruct(fileInfo);
+
+    hid_t file = H5Fopen(outputFile, H5F_ACC_RDONLY, H5P_DEFAULT);
+    CuAssertTrue(testCase, file >= 0);
+    uint32_t *positions = st_calloc(1000 * 3, sizeof(uint32_t));
+    uint8_t *image = st_calloc(1000 * imageColumnCount, sizeof(uint8_t));
+    uint8_t *featureMask = st_calloc(1000, sizeof(uint8_t));
+    int64_t coreStart, coreEnd;
+    for (int64_t w = 0; w < 3; w++) {
+        char *groupName = stString_print("chunk.%"PRId64, w);
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "position", H5T_NATIVE_UINT32, positions) >= 0);
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "image", H5T_NATIVE_UINT8, image) >= 0);
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "feature_mask", H5T_NATIVE_UINT8,
+                featureMask) >= 0);
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "contig_core_start", H5T_NATIVE_INT64,
+                &coreStart) >= 0);
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "contig_core_end", H5T_NATIVE_INT64,
+                &coreEnd) >= 0);
+        CuAssertIntEquals(testCase, 100, coreStart);
+        CuAssertIntEquals(testCase, 1300, coreEnd);
+
+        // windows do not overlap
+        CuAssertIntEquals(testCase, 100 + w * 500, positions[0]);
+
+        int64_t featureRows = w < 2 ? 1000 : 400;
+        for (int64_t r = 0; r < 1000; r++) {
+            CuAssertIntEquals(testCase, r < featureRows ? 1 : 0, featureMask[r]);
+            if (r >= featureRows) {
+                CuAssertIntEquals(testCase, 0, positions[r * 3]);
+                CuAssertIntEquals(testCase, 0, image[r * imageColumnCount]);
+            }
+        }
+        free(groupName);
+    }
+    char *groupName = stString_print("chunk.3");
+    H5E_BEGIN_TRY {
+        CuAssertTrue(testCase, readHelenFeatureDataset(file, groupName, "position", H5T_NATIVE_UINT32, positions) < 0);
+    } H5E_END_TRY;
+    H5Fclose(file);
+
+    free(groupName);
+    free(positions);
+    free(image);
+    free(featureMask);
+    bamChunk_destruct(bamChunk);
+    remove(outputFile);
+}
+
+static float getEncodingTestWeight(int64_t i) {
+    // weight fractions spread over [0, 1), with some exact zeros
+    return i % 7 == 0 ? 0.0f : (float) ((i * 37) % 1000) / 1000.0f;
+}
+
+void test_featureEncodingOutput(CuTest *testCase) {
+    char *outputFile = "test.featureEncodings.h5";
+    BamChunk *bamChunk = bamChunk_construct2("contig", 0, 0, 300, 300, NULL);
+    int64_t featureCount = 300;
+    int64_t imageColumnCount = 10;
+    int64_t runLengthColumnCount = 4;
+    int64_t imageWeightCount = featureCount * imageColumnCount;
+    int64_t runLengthWeightCount = featureCount * runLengthColumnCount * (SYMBOL_NUMBER - 1);
+    HelenFeatureImageEncoding encodings[3] = {HFEAT_IMAGE_NORMALIZED_UINT8, HFEAT_IMAGE_FLOAT16,
+            HFEAT_IMAGE_SCALED_UINT8};
+    int64_t compressionLevels[2] = {0, 6};
+    float *image = st_calloc(imageWeightCount, sizeof(float));
+    float *runLengths = st_calloc(runLengthWeightCount, sizeof(float));
+    uint8_t *quantized = st_calloc(runLengthWeightCount, sizeof(uint8_t));
+
+    for (int64_t e = 0; e < 3; e++) {
+        for (int64_t c = 0; c < 2; c++) {
+            HelenFeatureTensor *tensor = helenFeatureTensor_construct(HFEAT_CHANNEL_RLE_WEIGHT, encodings[e],
+                    "chunk", bamChunk, FALSE, featureCount, 3, imageColumnCount, runLengthColumnCount);
+            for (int64_t i = 0; i < featureCount; i++) {
+                tensor->positionData[i][0] = (uint32_t) i;
+                tensor->normalizationData[i][0] = (uint8_t) (i % 256);
+                for (int64_t j = 0; j < imageColumnCount; j++) {
+                    float weight = getEncodingTestWeight(i * imageColumnCount + j);
+                    if (tensor->imageData != NULL) {
+                        tensor->imageData[i][j] = (uint8_t) (weight * UINT8_MAX);
+                    } else {
+                        tensor->imageWeights[i][j] = weight;
+                    }
+                }
+                for (int64_t j = 0; j < runLengthColumnCount * (SYMBOL_NUMBER - 1); j++) {
+                    // half the image weights, so the two scales differ
+                    float weight = getEncodingTestWeight(i * runLengthColumnCount * (SYMBOL_NUMBER - 1) + j) / 2;
+                    if (tensor->runLengthData != NULL) {
+                        tensor->runLengthData[i][0][j] = (uint8_t) (weight * UINT8_MAX);
+                    } else {
+                        tensor->runLengthWeights[i][0][j] = weight;
+                    }
+                }
+            }
+            HelenFeatureHDF5FileInfo *fileInfo = HelenFeatureHDF5FileInfo_construct(outputFile,
+                    compressionLevels[c], encodings[e], HFEAT_WINDOW_OVERLAPPING);
+            helenFeatureTensor_writeHDF5(tensor, fileInfo);
+            helenFeatureTensor_destruct(tensor);
+            HelenFeatureHDF5FileInfo_destruct(fileInfo);
+
+            hid_t file = H5Fopen(outputFile, H5F_ACC_RDONLY, H5P_DEFAULT);
+            CuAssertTrue(testCase, file >= 0);
+
+            // compressed datasets are chunked and deflated, others are contiguous
+            hid_t dataset = H5Dopen(file, "images/chunk.0/nucleotide", H5P_DEFAULT);
+            CuAssertTrue(testCase, dataset >= 0);
+            hid_t properties = H5Dget_create_plist(dataset);
+            CuAssertIntEquals(testCase, compressionLevels[c] > 0 ? H5D_CHUNKED : H5D_CONTIGUOUS,
+                    H5Pget_layout(properties));
+            CuAssertIntEquals(testCase, compressionLevels[c] > 0 ? 2 : 0, H5Pget_nfilters(properties));
+            H5Pclose(properties);
+
+            // float16 is stored as a two byte IEEE half, the others as bytes
+            hid_t fileType = H5Dget_type(dataset);
+            CuAssertIntEquals(testCase, encodings[e] == HFEAT_IMAGE_FLOAT16 ? H5T_FLOAT : H5T_INTEGER,
+                    H5Tget_class(fileType));
+            CuAssertIntEquals(testCase, encodings[e] == HFEAT_IMAGE_FLOAT16 ? 2 : 1, (int) H5Tget_size(fileType));
+            if (encodings[e] == HFEAT_IMAGE_FLOAT16) {
+                size_t signPos, exponentPos, exponentSize, mantissaPos, mantissaSize;
+                H5Tget_fields(fileType, &signPos, &exponentPos, &exponentSize, &mantissaPos, &mantissaSize);
+                CuAssertIntEquals(testCase, 15, (int) signPos);
+                CuAssertIntEquals(testCase, 10, (int) exponentPos);
+                CuAssertIntEquals(testCase, 5, (int) exponentSize);
+                CuAssertIntEquals(testCase, 10, (int) mantissaSize);
+                CuAssertIntEquals(testCase, 15, (int) H5Tget_ebias(fileType));
+            }
+            H5Tclose(fileType);
+            H5Dclose(dataset);
+
+            // weights come back within the encoding's precision
+            float imageScale = 1.0f / UINT8_MAX, runLengthScale = 1.0f / UINT8_MAX;
+            if (encodings[e] == HFEAT_IMAGE_FLOAT16) {
+                CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "nucleotide", H5T_NATIVE_FLOAT,
+                        image) >= 0);
+                CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "runLengths", H5T_NATIVE_FLOAT,
+                        runLengths) >= 0);
+            } else {
+                if (encodings[e] == HFEAT_IMAGE_SCALED_UINT8) {
+                    CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "nucleotide_scale",
+                            H5T_NATIVE_FLOAT, &imageScale) >= 0);
+                    CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "runLengths_scale",
+                            H5T_NATIVE_FLOAT, &runLengthScale) >= 0);
+                    CuAssertDblEquals(testCase, 0.999 / UINT8_MAX, imageScale, 1e-6);
+                    CuAssertDblEquals(testCase, 0.999 / 2 / UINT8_MAX, runLengthScale, 1e-6);
+                }
+                CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "nucleotide", H5T_NATIVE_UINT8,
+                        quantized) >= 0);
+                for (int64_t i = 0; i < imageWeightCount; i++) {
+                    image[i] = quantized[i] * imageScale;
+                }
+                CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "runLengths", H5T_NATIVE_UINT8,
+                        quantized) >= 0);
+                for (int64_t i = 0; i < runLengthWeightCount; i++) {
+                    runLengths[i] = quantized[i] * runLengthScale;
+                }
+            }
+            // normalized uint8 truncates, the scaled encoding rounds, and a half has an 11 bit significand
+            double imageTolerance = encodings[e] == HFEAT_IMAGE_FLOAT16 ? 1.0 / 2048 :
+                    encodings[e] == HFEAT_IMAGE_SCALED_UINT8 ? imageScale / 2 + 1e-6 : imageScale + 1e-6;
+            double runLengthTolerance = encodings[e] == HFEAT_IMAGE_FLOAT16 ? 1.0 / 4096 :
+                    encodings[e] == HFEAT_IMAGE_SCALED_UINT8 ? runLengthScale / 2 + 1e-6 : runLengthScale + 1e-6;
+            for (int64_t i = 0; i < imageWeightCount; i++) {
+                CuAssertDblEquals(testCase, getEncodingTestWeight(i), image[i], imageTolerance);
+            }
+            for (int64_t i = 0; i < runLengthWeightCount; i++) {
+                CuAssertDblEquals(testCase, getEncodingTestWeight(i) / 2, runLengths[i], runLengthTolerance);
+            }
+
+            // the other datasets do not depend on the encoding
+            uint32_t *positions = st_calloc(featureCount * 3, sizeof(uint32_t));
+            CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "position", H5T_NATIVE_UINT32,
+                    positions) >= 0);
+            CuAssertIntEquals(testCase, 299, positions[299 * 3]);
+            CuAssertTrue(testCase, readHelenFeatureDataset(file, "chunk.0", "normalization", H5T_NATIVE_UINT8,
+                    quantized) >= 0);
+            CuAssertIntEquals(testCase, 299 % 256, quantized[299]);
+            free(positions);
+
+            H5Fclose(file);
+            remove(outputFile);
+        }
+    }
+
+    free(image);
+    free(runLengths);
+    free(quantized);
+    bamChunk_destruct(bamChunk);
+}
+
+static char *mutateFeatureTestSequence(const char *sequence, double errorRate) {
+    // substitutions, insertions and deletions of ACGT bases only, as Ns are counted differently by the two paths
+    int64_t length = strlen(sequence);
+    char *mutated = st_calloc(2 * length + 1, sizeof(char));
+    int64_t j = 0;
+    for (int64_t i = 0; i < length; i++) {
+        double r = st_random();
+        if (r < errorRate / 3) {
+            continue;
+        }
+        mutated[j++] = r < 2 * errorRate / 3 ? "ACGT"[st_randomInt(0, 4)] : sequence[i];
+        if (st_random() < errorRate / 3) {
+            mutated[j++] = "ACGT"[st_randomInt(0, 4)];
+        }
+    }
+    mutated[j] = '\0';
+    return mutated;
+}
+
+static void assertFeatureTensorsEqual(CuTest *testCase, HelenFeatureTensor *linked, HelenFeatureTensor *dense) {
+    CuAssertTrue(testCase, linked != NULL && dense != NULL);
+    CuAssertIntEquals(testCase, linked->featureCount, dense->featureCount);
+    CuAssertIntEquals(testCase, linked->imageColumnCount, dense->imageColumnCount);
+    CuAssertIntEquals(testCase, linked->runLengthColumnCount, dense->runLengthColumnCount);
+    int64_t rows = linked->featureCount;
+    int64_t runLengthSize = rows * linked->runLengthColumnCount * (SYMBOL_NUMBER - 1);
+    CuAssertTrue(testCase, memcmp(linked->positionData[0], dense->positionData[0],
+            rows * linked->positionColumnCount * sizeof(uint32_t)) == 0);
+    CuAssertTrue(testCase, memcmp(linked->normalizationData[0], dense->normalizationData[0], rows) == 0);
+    if (linked->imageData != NULL) {
+        CuAssertTrue(testCase, memcmp(linked->imageData[0], dense->imageData[0],
+                rows * linked->imageColumnCount) == 0);
+        if (runLengthSize > 0) {
+            CuAssertTrue(testCase, memcmp(linked->runLengthData[0][0], dense->runLengthData[0][0],
+                    runLengthSize) == 0);
+        }
+    } else {
+        CuAssertTrue(testCase, memcmp(linked->imageWeights[0], dense->imageWeights[0],
+                rows * linked->imageColumnCount * sizeof(float)) == 0);
+        if (runLengthSize > 0) {
+            CuAssertTrue(testCase, memcmp(linked->runLengthWeights[0][0], dense->runLengthWeights[0][0],
+                    runLengthSize * sizeof(float)) == 0);
+        }
+    }
+    if (linked->outputLabels) {
+        CuAssertTrue(testCase, memcmp(linked->labelCharacterData[0], dense->labelCharacterData[0], rows) == 0);
+        CuAssertTrue(testCase, memcmp(linked->labelRunLengthData[0], dense->labelRunLengthData[0], rows) == 0);
+    }
+}
+
+void test_denseRleWeightFeatures(CuTest *testCase) {
+    /*
+     * The dense run length tensor against the linked features it replaced, which are kept as its reference.
+     */
+    Params *params = params_readParams(FEATURE_TEST_PARAMS);
+    PolishParams *polishParams = params->polishParams;
+
+    // a truth with homopolymers longer than the max run length, so positions have several run length rows
+    char *truth = getRandomACGTSequence(2000);
+    for (int64_t i = 0; i + 30 < 2000; i += st_randomInt(50, 150)) {
+        int64_t runLength = st_randomInt(5, 25);
+        for (int64_t j = 1; j < runLength; j++) {
+            truth[i + j] = truth[i];
+        }
+    }
+    char *reference = mutateFeatureTestSequence(truth, 0.02);
+    RleString *rleReference = rleString_construct(reference);
+    stList *reads = stList_construct3(0, (void (*)(void *)) bamChunkRead_destruct);
+    for (int64_t i = 0; i < 10; i++) {
+        char *readName = stString_print("read_%"PRId64, i);
+        char *read = mutateFeatureTestSequence(truth, 0.05);
+        stList_append(reads, bamChunkRead_construct2(readName, read, NULL, i % 2 == 0, TRUE));
+        free(readName);
+        free(read);
+    }
+    Poa *poa = poa_realign(reads, NULL, rleReference, polishParams);
+
+    // truth alignment in run length space, as handleHelenFeatures builds it
+    RleString *rleTruth = rleString_construct(truth);
+    stList *rawAlignment = alignConsensusAndTruth(reference, truth);
+    uint64_t *referenceMap = rleString_getNonRleToRleCoordinateMap(rleReference);
+    uint64_t *truthMap = rleString_getNonRleToRleCoordinateMap(rleTruth);
+    stList *trueRefAlignment = runLengthEncodeAlignment(rawAlignment, referenceMap, truthMap);
+
+    BamChunk *bamChunk = bamChunk_construct2("contig", 0, 0, strlen(reference), strlen(reference), NULL);
+    HelenFeatureType types[] = { HFEAT_SPLIT_RLE_WEIGHT, HFEAT_CHANNEL_RLE_WEIGHT };
+    HelenFeatureImageEncoding encodings[] = { HFEAT_IMAGE_NORMALIZED_UINT8, HFEAT_IMAGE_FLOAT16 };
+    for (int64_t t = 0; t < 2; t++) {
+        int64_t maxRunLength = types[t] == HFEAT_SPLIT_RLE_WEIGHT ? POAFEATURE_SPLIT_MAX_RUN_LENGTH_DEFAULT :
+                POAFEATURE_CHANNEL_MAX_RUN_LENGTH_DEFAULT;
+        for (int64_t e = 0; e < 2; e++) {
+            for (int64_t labels = 0; labels < 2; labels++) {
+                stList *features = types[t] == HFEAT_SPLIT_RLE_WEIGHT ?
+                        poa_getSplitRleWeightFeatures(poa, reads, maxRunLength) :
+                        poa_getChannelRleWeightFeatures(poa, reads, maxRunLength);
+                int64_t firstMatchedFeature = 0;
+                int64_t lastMatchedFeature = stList_length(features) - 1;
+                if (labels) {
+                    poa_annotateHelenFeaturesWithTruth(features, types[t], trueRefAlignment, rleTruth,
+                            &firstMatchedFeature, &lastMatchedFeature);
+                }
+                HelenFeatureTensor *linked = types[t] == HFEAT_SPLIT_RLE_WEIGHT ?
+                        getSplitRleWeightHelenFeatureTensor(poa->alphabet, encodings[e], "chunk", bamChunk, labels,
+                                features, firstMatchedFeature, lastMatchedFeature, maxRunLength) :
+                        getChannelRleWeightHelenFeatureTensor(poa->alphabet, encodings[e], "chunk", bamChunk, labels,
+                                features, firstMatchedFeature, lastMatchedFeature, maxRunLength);
+                HelenFeatureTensor *dense = poa_getRleWeightFeatureTensor(types[t], encodings[e], poa, reads,
+                        maxRunLength, "chunk", bamChunk, labels ? trueRefAlignment : NULL, labels ? rleTruth : NULL);
+
+                assertFeatureTensorsEqual(testCase, linked, dense);
+
+                helenFeatureTensor_destruct(linked);
+                helenFeatureTensor_destruct(dense);
+                stList_destruct(features);
+            }
+        }
+    }
+
+    bamChunk_destruct(bamChunk);
+    stList_destruct(trueRefAlignment);
+    stList_destruct(rawAlignment);
+    free(referenceMap);
+    free(truthMap);
+    rleString_destruct(rleTruth);
+    poa_destruct(poa);
+    stList_destruct(reads);
+    rleString_destruct(rleReference);
+    free(reference);
+    free(truth);
+    params_destruct(params);
+}
+
 CuSuite* featureTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
 
     SUITE_ADD_TEST(suite, test_simpleWeightIndex);
     SUITE_ADD_TEST(suite, test_splitRleWeightIndex);
     SUITE_ADD_TEST(suite, test_channelRleWeightIndex);
+    SUITE_ADD_TEST(suite, test_bandedTruthAlignment);
+    SUITE_ADD_TEST(suite, test_truthLabeler);
+    SUITE_ADD_TEST(suite, test_npyFeatureOutput);
+    SUITE_ADD_TEST(suite, test_denseRleWeightFeatures);
+    SUITE_ADD_TEST(suite, test_coreWindowConsensusPosition);
+    SUITE_ADD_TEST(suite, test_coreWindowFeatureOutput);
+    SUITE_ADD_TEST(suite, test_featureEncodingOutput);
     SUITE_ADD_TEST(suite, test_defaultFeatureGeneration);
     SUITE_ADD_TEST(suite, test_simpleWeightFeatureGeneration);
     SUITE_ADD_TEST(suite, test_splitRleWeightFeatureGeneration);
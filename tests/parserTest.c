@@ -280,11 +280,73 @@ void test_jsmnParsing(CuTest *testCase) {
     stRPHmmParameters_destruct(params);
 }
 
+static void checkCompiledStateMachine(CuTest *testCase, StateMachine *sM, StateMachine *compiledSM) {
+    CuAssertIntEquals(testCase, sM->type, compiledSM->type);
+    double transitions[STATE_MACHINE3_TRANSITION_NUMBER], compiledTransitions[STATE_MACHINE3_TRANSITION_NUMBER];
+    stateMachine3_getTransitions(sM, transitions);
+    stateMachine3_getTransitions(compiledSM, compiledTransitions);
+    for (int64_t i = 0; i < STATE_MACHINE3_TRANSITION_NUMBER; i++) {
+        CuAssertDblEquals(testCase, transitions[i], compiledTransitions[i], 0);
+    }
+    for (Symbol x = 0; x < 4; x++) {
+        for (Symbol y = 0; y < 4; y++) {
+            CuAssertDblEquals(testCase, sM->emissions->emission(sM->emissions, x, y),
+                              compiledSM->emissions->emission(compiledSM->emissions, x, y), 0);
+        }
+        CuAssertDblEquals(testCase, sM->emissions->gapEmissionX(sM->emissions, x),
+                          compiledSM->emissions->gapEmissionX(compiledSM->emissions, x), 0);
+        CuAssertDblEquals(testCase, sM->emissions->gapEmissionY(sM->emissions, x),
+                          compiledSM->emissions->gapEmissionY(compiledSM->emissions, x), 0);
+    }
+}
+
+void test_compiledParams(CuTest *testCase) {
+    char *paramsFile = "../params/allParams.np.json";
+    char *compiledParamsFile = "test.compiledParams.bin";
+
+    Params *params = params_readParams(paramsFile);
+    params_writeCompiled(params, compiledParamsFile);
+    Params *compiledParams = params_readParams(compiledParamsFile);
+    PolishParams *pp = params->polishParams, *compiledPp = compiledParams->polishParams;
+
+    // State machines
+    checkCompiledStateMachine(testCase, pp->stateMachineForForwardStrandRead, compiledPp->stateMachineForForwardStrandRead);
+    checkCompiledStateMachine(testCase, pp->stateMachineForReverseStrandRead, compiledPp->stateMachineForReverseStrandRead);
+    checkCompiledStateMachine(testCase, pp->stateMachineForGenomeComparison, compiledPp->stateMachineForGenomeComparison);
+
+    // Repeat counts
+    CuAssertTrue(testCase, pp->repeatSubMatrix != NULL && compiledPp->repeatSubMatrix != NULL);
+    for (int64_t i = 0; i < pp->repeatSubMatrix->maxEntry; i++) {
+        CuAssertDblEquals(testCase, pp->repeatSubMatrix->logProbabilities[i],
+                          compiledPp->repeatSubMatrix->logProbabilities[i], 0);
+    }
+
+    // Scalars
+    CuAssertDblEquals(testCase, pp->p->threshold, compiledPp->p->threshold, 0);
+    CuAssertIntEquals(testCase, pp->p->diagonalExpansion, compiledPp->p->diagonalExpansion);
+    CuAssertIntEquals(testCase, pp->useRunLengthEncoding, compiledPp->useRunLengthEncoding);
+    CuAssertIntEquals(testCase, pp->chunkSize, compiledPp->chunkSize);
+    CuAssertIntEquals(testCase, pp->maxDepth, compiledPp->maxDepth);
+    CuAssertDblEquals(testCase, pp->candidateVariantWeight, compiledPp->candidateVariantWeight, 0);
+    CuAssertIntEquals(testCase, pp->minPosteriorProbForAlignmentAnchorsLength, compiledPp->minPosteriorProbForAlignmentAnchorsLength);
+    for (int64_t i = 0; i < pp->minPosteriorProbForAlignmentAnchorsLength; i++) {
+        CuAssertDblEquals(testCase, pp->minPosteriorProbForAlignmentAnchors[i],
+                          compiledPp->minPosteriorProbForAlignmentAnchors[i], 0);
+    }
+    CuAssertIntEquals(testCase, params->phaseParams->maxPartitionsInAColumn, compiledParams->phaseParams->maxPartitionsInAColumn);
+    CuAssertIntEquals(testCase, params->phaseParams->maxCoverageDepth, compiledParams->phaseParams->maxCoverageDepth);
+
+    params_destruct(params);
+    params_destruct(compiledParams);
+    remove(compiledParamsFile);
+}
+
 CuSuite *parserTestSuite(void) {
     st_setLogLevelFromString("debug");
     CuSuite* suite = CuSuiteNew();
 
     SUITE_ADD_TEST(suite, test_jsmnParsing);
+    SUITE_ADD_TEST(suite, test_compiledParams);
 
     return suite;
 }
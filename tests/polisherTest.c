@@ -998,6 +998,374 @@ void test_polishParams(CuTest *testCase) {
 	params_destruct(params);
 }
 
+void test_repeatSubMatrix_repeatCountHistogram(CuTest *testCase) {
+	Params *params = params_readParams(polishParamsFile);
+	RepeatSubMatrix *repeatSubMatrix = params->polishParams->repeatSubMatrix;
+
+	for (int64_t test = 0; test < 100; test++) {
+		// Make random reads and observations of their first base
+		stList *bamChunkReads = stList_construct3(0, (void (*)(void *))bamChunkRead_destruct);
+		stList *observations = stList_construct3(0, free);
+		int64_t readNo = st_randomInt(1, 60);
+		for (int64_t i = 0; i < readNo; i++) {
+			char *nucleotides = expandChar('A', st_randomInt(1, 2 * repeatSubMatrix->maximumRepeatLength));
+			stList_append(bamChunkReads, bamChunkRead_construct2("read", nucleotides, NULL, st_random() > 0.5, 1));
+			free(nucleotides);
+
+			PoaBaseObservation *observation = st_calloc(1, sizeof(PoaBaseObservation));
+			observation->readNo = i;
+			observation->offset = 0;
+			observation->weight = st_random() * PAIR_ALIGNMENT_PROB_1;
+			stList_append(observations, observation);
+		}
+
+		// Compare the histogram likelihood to the direct sum over observations
+		double histogram[2 * repeatSubMatrix->maximumRepeatLength];
+		memset(histogram, 0, sizeof(histogram));
+		int64_t observationNo, unused;
+		repeatSubMatrix_getRepeatCountHistograms(repeatSubMatrix, observations, bamChunkReads, NULL, histogram, NULL,
+				&observationNo, &unused);
+		CuAssertIntEquals(testCase, readNo, observationNo);
+
+		for (int64_t repeatCount = 1; repeatCount < repeatSubMatrix->maximumRepeatLength; repeatCount++) {
+			double logProb = 0.0;
+			for (int64_t i = 0; i < readNo; i++) {
+				PoaBaseObservation *observation = stList_get(observations, i);
+				BamChunkRead *read = stList_get(bamChunkReads, i);
+				int64_t observedRepeatCount = read->rleRead->repeatCounts[0];
+				observedRepeatCount = observedRepeatCount >= repeatSubMatrix->maximumRepeatLength ?
+						repeatSubMatrix->maximumRepeatLength-1 : observedRepeatCount;
+				logProb += repeatSubMatrix_getLogProb(repeatSubMatrix, 0, read->forwardStrand,
+						observedRepeatCount, repeatCount) * observation->weight;
+			}
+			logProb /= PAIR_ALIGNMENT_PROB_1;
+
+			CuAssertDblEquals(testCase, logProb, repeatSubMatrix_getLogProbForGivenRepeatCountHistogram(repeatSubMatrix,
+					0, histogram, 1, repeatSubMatrix->maximumRepeatLength-1, repeatCount), 0.0001);
+			CuAssertDblEquals(testCase, logProb, repeatSubMatrix_getLogProbForGivenRepeatCount(repeatSubMatrix,
+					0, observations, bamChunkReads, repeatCount), 0.0001);
+		}
+
+		stList_destruct(observations);
+		stList_destruct(bamChunkReads);
+	}
+
+	params_destruct(params);
+}
+
+typedef struct _scoredCandidateSubstring {
+	char *string;
+	double score; // Best score of any combination of candidate variants spelling the string
+} ScoredCandidateSubstring;
+
+static void scoredCandidateSubstring_destruct(ScoredCandidateSubstring *s) {
+	free(s->string);
+	free(s);
+}
+
+static int scoredCandidateSubstring_cmp(const void *a, const void *b) {
+	double s1 = ((ScoredCandidateSubstring *)a)->score, s2 = ((ScoredCandidateSubstring *)b)->score;
+	return s1 > s2 ? -1 : s1 < s2 ? 1 : 0;
+}
+
+static ScoredCandidateSubstring *getScoredCandidateSubstring(stList *substrings, char *string) {
+	for(int64_t i=0; i<stList_length(substrings); i++) {
+		ScoredCandidateSubstring *s = stList_get(substrings, i);
+		if(stString_eq(s->string, string)) {
+			return s;
+		}
+	}
+	return NULL;
+}
+
+static double getCandidateLogWeightFraction(double weight, double totalWeight) {
+	return log((weight + PAIR_ALIGNMENT_PROB_1) / (totalWeight + PAIR_ALIGNMENT_PROB_1));
+}
+
+static void enumerateCandidateSubstrings(Poa *poa, int64_t position, int64_t to, double candidateWeight,
+		char *prefix, double score, stList *substrings) {
+	/*
+	 * Exhaustively walks every combination of candidate base, repeat count and indel from the position to the end of
+	 * the interval, keeping the best score of each distinct substring spelled.
+	 */
+	if(position == to) {
+		ScoredCandidateSubstring *s = getScoredCandidateSubstring(substrings, prefix);
+		if(s == NULL) {
+			s = st_malloc(sizeof(ScoredCandidateSubstring));
+			s->string = stString_copy(prefix);
+			s->score = score;
+			stList_append(substrings, s);
+		}
+		else if(score > s->score) {
+			s->score = score;
+		}
+		return;
+	}
+
+	PoaNode *node = stList_get(poa->nodes, position);
+	double totalWeight = 0.0, totalRepeatCountWeight = 0.0;
+	for(int64_t b=0; b<poa->alphabet->alphabetSize; b++) {
+		totalWeight += node->baseWeights[b];
+	}
+	for(int64_t r=0; r<poa->maxRepeatCount; r++) {
+		totalRepeatCountWeight += node->repeatCountWeights[r];
+	}
+	double noIndelWeight = totalWeight;
+	for(int64_t k=0; k<stList_length(node->inserts); k++) {
+		double w = poaInsert_getWeight(stList_get(node->inserts, k));
+		noIndelWeight -= w > candidateWeight ? w : 0.0;
+	}
+	for(int64_t k=0; k<stList_length(node->deletes); k++) {
+		double w = poaDelete_getWeight(stList_get(node->deletes, k));
+		noIndelWeight -= w > candidateWeight ? w : 0.0;
+	}
+
+	for(int64_t b=0; b<poa->alphabet->alphabetSize; b++) {
+		char base = poa->alphabet->convertSymbolToChar(b);
+		if(node->baseWeights[b] <= candidateWeight && toupper(node->base) != base) {
+			continue;
+		}
+		for(int64_t r=1; r<poa->maxRepeatCount; r++) {
+			if(node->repeatCountWeights[r] <= 2.0 * candidateWeight && node->repeatCount != r) {
+				continue;
+			}
+			double baseScore = score + getCandidateLogWeightFraction(node->baseWeights[b], totalWeight) +
+					getCandidateLogWeightFraction(node->repeatCountWeights[r], totalRepeatCountWeight);
+			char *bases = expandChar(base, r);
+
+			char *extended = stString_print("%s%s", prefix, bases);
+			enumerateCandidateSubstrings(poa, position+1, to, candidateWeight, extended,
+					baseScore + getCandidateLogWeightFraction(noIndelWeight > 0.0 ? noIndelWeight : 0.0, totalWeight),
+					substrings);
+			free(extended);
+
+			for(int64_t k=0; k<stList_length(node->inserts); k++) {
+				PoaInsert *insert = stList_get(node->inserts, k);
+				if(poaInsert_getWeight(insert) > candidateWeight) {
+					char *expandedInsert = rleString_expand(insert->insert);
+					extended = stString_print("%s%s%s", prefix, bases, expandedInsert);
+					enumerateCandidateSubstrings(poa, position+1, to, candidateWeight, extended,
+							baseScore + getCandidateLogWeightFraction(poaInsert_getWeight(insert), totalWeight),
+							substrings);
+					free(extended);
+					free(expandedInsert);
+				}
+			}
+
+			for(int64_t k=0; k<stList_length(node->deletes); k++) {
+				PoaDelete *delete = stList_get(node->deletes, k);
+				if(poaDelete_getWeight(delete) > candidateWeight) {
+					extended = stString_print("%s%s", prefix, bases);
+					int64_t next = position+1+delete->length;
+					enumerateCandidateSubstrings(poa, next < to ? next : to, to, candidateWeight, extended,
+							baseScore + getCandidateLogWeightFraction(poaDelete_getWeight(delete), totalWeight),
+							substrings);
+					free(extended);
+				}
+			}
+
+			free(bases);
+		}
+	}
+}
+
+void test_getKBestCandidateConsensusSubstringsExhaustive(CuTest *testCase) {
+	/*
+	 * Compares the k-best search with an exhaustive enumeration of every combination of candidate variants, over small
+	 * bubbles with random weights.
+	 */
+	Params *params = params_readParams(polishParamsFile);
+	Alphabet *alphabet = params->polishParams->alphabet;
+	double candidateWeight = 0.5 * PAIR_ALIGNMENT_PROB_1;
+	for (int64_t test = 0; test < 100; test++) {
+		int64_t length = st_randomInt(1, 5);
+		char *reference = st_calloc(length+1, sizeof(char));
+		for(int64_t i=0; i<length; i++) {
+			reference[i] = "ACGT"[st_randomInt(0, 4)];
+		}
+		RleString *referenceRle = rleString_construct_no_rle(reference);
+		Poa *poa = poa_getReferenceGraph(referenceRle, alphabet, 4);
+
+		// Random weights, of which about a third are above the candidate weight
+		for(int64_t i=0; i<stList_length(poa->nodes); i++) {
+			PoaNode *node = stList_get(poa->nodes, i);
+			for(int64_t b=0; b<alphabet->alphabetSize; b++) {
+				node->baseWeights[b] = st_random() * 0.75 * PAIR_ALIGNMENT_PROB_1;
+			}
+			for(int64_t r=1; r<poa->maxRepeatCount; r++) {
+				node->repeatCountWeights[r] = st_random() * 1.5 * PAIR_ALIGNMENT_PROB_1;
+			}
+			for(int64_t k=st_randomInt(0, 3); k>0; k--) {
+				char insert[3] = { "ACGT"[st_randomInt(0, 4)], "ACGT"[st_randomInt(0, 4)], '\0' };
+				insert[st_randomInt(1, 3)] = '\0';
+				stList_append(node->inserts, poaInsert_construct(rleString_construct_no_rle(insert),
+						st_random() * 0.75 * PAIR_ALIGNMENT_PROB_1, st_random() > 0.5));
+			}
+			for(int64_t k=st_randomInt(0, 3); k>0; k--) {
+				stList_append(node->deletes, poaDelete_construct(st_randomInt(1, 3),
+						st_random() * 0.75 * PAIR_ALIGNMENT_PROB_1, st_random() > 0.5));
+			}
+		}
+		double *candidateWeights = st_calloc(stList_length(poa->nodes), sizeof(double));
+		for(int64_t i=0; i<stList_length(poa->nodes); i++) {
+			candidateWeights[i] = candidateWeight;
+		}
+
+		int64_t from = st_randomInt(0, stList_length(poa->nodes));
+		int64_t to = st_randomInt(from+1, stList_length(poa->nodes)+1);
+		stList *expected = stList_construct3(0, (void (*)(void *))scoredCandidateSubstring_destruct);
+		enumerateCandidateSubstrings(poa, from, to, candidateWeight, "", 0.0, expected);
+		stList_sort(expected, scoredCandidateSubstring_cmp);
+
+		// The k-best substrings are the k best scoring distinct substrings, in score order
+		int64_t k = st_randomInt(1, 20);
+		stList *substrings = getKBestCandidateConsensusSubstrings(poa, from, to, candidateWeights, k);
+		CuAssertIntEquals(testCase, stList_length(expected) < k ? stList_length(expected) : k,
+				stList_length(substrings));
+		for(int64_t i=0; i<stList_length(substrings); i++) {
+			ScoredCandidateSubstring *s = getScoredCandidateSubstring(expected, stList_get(substrings, i));
+			CuAssertTrue(testCase, s != NULL);
+			CuAssertDblEquals(testCase, ((ScoredCandidateSubstring *)stList_get(expected, i))->score, s->score, 1e-9);
+		}
+
+		// Cleanup
+		stList_destruct(substrings);
+		stList_destruct(expected);
+		free(candidateWeights);
+		poa_destruct(poa);
+		rleString_destruct(referenceRle);
+		free(reference);
+	}
+	params_destruct(params);
+}
+
+void test_getKBestCandidateConsensusSubstrings(CuTest *testCase) {
+	for (int64_t test = 0; test < 20; test++) {
+		Params *params = params_readParams(polishParamsFile);
+		PolishParams *polishParams = params->polishParams;
+
+		// Make a poa from reads evolved from a true reference
+		char *trueReference = getRandomSequence(st_randomInt(10, 100));
+		char *reference = evolveSequence(trueReference);
+		RleString *referenceRle = polishParams->useRunLengthEncoding ?
+				rleString_construct(reference) : rleString_construct_no_rle(reference);
+		int64_t readNumber = st_randomInt(1, 20);
+		stList *reads = stList_construct3(0, (void(*)(void*)) bamChunkRead_destruct);
+		for(int64_t i=0; i<readNumber; i++) {
+			stList_append(reads, bamChunkRead_construct2(stString_print("read_%d", i), evolveSequence(trueReference), NULL,
+					TRUE, polishParams->useRunLengthEncoding));
+		}
+		Poa *poa = poa_realign(reads, NULL, referenceRle, polishParams);
+
+		// Use a low candidate weight to get many candidate variants
+		double *candidateWeights = st_calloc(stList_length(poa->nodes), sizeof(double));
+		for(int64_t i=0; i<stList_length(poa->nodes); i++) {
+			candidateWeights[i] = 0.1 * PAIR_ALIGNMENT_PROB_1;
+		}
+
+		int64_t from = st_randomInt(1, stList_length(poa->nodes));
+		int64_t to = st_randomInt(from+1, stList_length(poa->nodes)+1);
+		stList *fewest = getKBestCandidateConsensusSubstrings(poa, from, to, candidateWeights, 3);
+		stList *most = getKBestCandidateConsensusSubstrings(poa, from, to, candidateWeights, 50);
+
+		// Substrings are distinct, bounded in number and the best substrings are found first
+		CuAssertTrue(testCase, stList_length(fewest) > 0);
+		CuAssertTrue(testCase, stList_length(fewest) <= 3);
+		CuAssertTrue(testCase, stList_length(most) <= 50);
+		CuAssertTrue(testCase, stList_length(most) >= stList_length(fewest));
+		for(int64_t i=0; i<stList_length(fewest); i++) {
+			CuAssertStrEquals(testCase, stList_get(most, i), stList_get(fewest, i));
+		}
+		for(int64_t i=0; i<stList_length(most); i++) {
+			for(int64_t j=i+1; j<stList_length(most); j++) {
+				CuAssertTrue(testCase, !stString_eq(stList_get(most, i), stList_get(most, j)));
+			}
+		}
+
+		// Cleanup
+		stList_destruct(fewest);
+		stList_destruct(most);
+		free(candidateWeights);
+		poa_destruct(poa);
+		stList_destruct(reads);
+		rleString_destruct(referenceRle);
+		free(trueReference);
+		free(reference);
+		params_destruct(params);
+	}
+}
+
+void test_bamChunkReadSubstring_views(CuTest *testCase) {
+	Params *params = params_readParams(polishParamsFile);
+
+	BamChunkRead *read1 = bamChunkRead_construct2(stString_print("read1"), stString_print("GGATTACCA"), NULL, 1, 1);
+	BamChunkRead *read2 = bamChunkRead_construct2(stString_print("read2"), stString_print("CATTACCAT"), NULL, 0, 1);
+	BamChunkReadSubstring *rs1 = bamChunkRead_getSubstring(read1, 1, 5, params->polishParams); // "ATTACCA"
+	BamChunkReadSubstring *rs2 = bamChunkRead_getSubstring(read2, 1, 5, params->polishParams); // "ATTACCA"
+	BamChunkReadSubstring *rs3 = bamChunkRead_getSubstring(read2, 1, 6, params->polishParams); // "ATTACCAT"
+
+	// Substrings are compared in place in their parent reads
+	CuAssertTrue(testCase, bamChunkReadSubstring_equalKey(rs1, rs2));
+	CuAssertIntEquals(testCase, bamChunkReadSubstring_hashKey(rs1), bamChunkReadSubstring_hashKey(rs2));
+	CuAssertTrue(testCase, !bamChunkReadSubstring_equalKey(rs1, rs3));
+
+	// Expansion matches that of the copied substring
+	RleString *r = bamChunkReadSubstring_getRleString(rs3);
+	char *expanded = rleString_expand(r);
+	char *expandedView = bamChunkReadSubstring_expand(rs3);
+	CuAssertStrEquals(testCase, "ATTACCAT", expandedView);
+	CuAssertStrEquals(testCase, expanded, expandedView);
+
+	// Symbol string views match copied substrings
+	SymbolString s = rleString_constructSymbolString(read2->rleRead, 0, read2->rleRead->length,
+			params->polishParams->alphabet, 1, 51);
+	SymbolString sCopy = rleString_constructSymbolString(r, 0, r->length, params->polishParams->alphabet, 1, 51);
+	SymbolString sView = symbolString_getView(s, rs3->start, rs3->length);
+	CuAssertIntEquals(testCase, sCopy.length, sView.length);
+	for(int64_t i=0; i<sView.length; i++) {
+		CuAssertIntEquals(testCase, sCopy.sequence[i], sView.sequence[i]);
+	}
+
+	symbolString_destruct(s);
+	symbolString_destruct(sCopy);
+	free(expanded);
+	free(expandedView);
+	rleString_destruct(r);
+	bamChunkReadSubstring_destruct(rs1);
+	bamChunkReadSubstring_destruct(rs2);
+	bamChunkReadSubstring_destruct(rs3);
+	bamChunkRead_destruct(read1);
+	bamChunkRead_destruct(read2);
+	params_destruct(params);
+}
+
+void test_forwardScoreCache(CuTest *testCase) {
+	// Room for two of the small entries below, but not three
+	ForwardScoreCache *cache = forwardScoreCache_construct(250);
+	float score;
+
+	forwardScoreCache_add(cache, "A", "C", 1, -1.0);
+	forwardScoreCache_add(cache, "G", "T", 1, -2.0);
+
+	// Strand is part of the key
+	CuAssertTrue(testCase, !forwardScoreCache_get(cache, "A", "C", 0, &score));
+	CuAssertTrue(testCase, forwardScoreCache_get(cache, "A", "C", 1, &score));
+	CuAssertDblEquals(testCase, -1.0, score, 0.0);
+
+	// Adding a third entry evicts the least recently used
+	forwardScoreCache_add(cache, "T", "T", 1, -3.0);
+	CuAssertTrue(testCase, !forwardScoreCache_get(cache, "G", "T", 1, &score));
+	CuAssertTrue(testCase, forwardScoreCache_get(cache, "A", "C", 1, &score));
+	CuAssertDblEquals(testCase, -1.0, score, 0.0);
+	CuAssertTrue(testCase, forwardScoreCache_get(cache, "T", "T", 1, &score));
+	CuAssertDblEquals(testCase, -3.0, score, 0.0);
+
+	CuAssertIntEquals(testCase, 3, forwardScoreCache_getHits(cache));
+	CuAssertIntEquals(testCase, 2, forwardScoreCache_getMisses(cache));
+
+	forwardScoreCache_destruct(cache);
+}
+
 void test_removeOverlapExample(CuTest *testCase) {
 	Params *params = params_readParams(polishParamsFile);
 	PolishParams *polishParams = params->polishParams;
@@ -1024,6 +1392,80 @@ void test_removeOverlapExample(CuTest *testCase) {
 	free(suffixString);
 }
 
+void test_removeOverlap_KmerAnchoredExamples(CuTest *testCase) {
+	Params *params = params_readParams(polishParamsFile);
+	PolishParams *polishParams = params->polishParams;
+
+	for (int64_t test = 0; test < 100; test++) {
+		// Make overlapping prefix and suffix strings from a common sequence
+		int64_t length = st_randomInt(500, 2000);
+		char *sequence = getRandomACGTSequence(length);
+		int64_t overlap = st_randomInt(50, 200);
+		int64_t prefixLength = st_randomInt(overlap, length);
+		char *prefixString = stString_getSubString(sequence, 0, prefixLength);
+		char *suffixString = stString_copy(&(sequence[prefixLength - overlap]));
+
+		// Run overlap remover
+		int64_t prefixStringCropEnd, suffixStringCropStart;
+		int64_t overlapWeight = removeOverlap(prefixString, suffixString, overlap, polishParams,
+					  &prefixStringCropEnd, &suffixStringCropStart);
+
+		// Check the stitched strings recreate the original sequence
+		CuAssertIntEquals(testCase, PAIR_ALIGNMENT_PROB_1, overlapWeight);
+		CuAssertIntEquals(testCase, prefixLength - overlap, prefixStringCropEnd - suffixStringCropStart);
+		char *stitchedString = stString_print("%.*s%s", (int)prefixStringCropEnd, prefixString,
+				&(suffixString[suffixStringCropStart]));
+		CuAssertStrEquals(testCase, sequence, stitchedString);
+
+		free(sequence);
+		free(prefixString);
+		free(suffixString);
+		free(stitchedString);
+	}
+
+	params_destruct(params);
+}
+
+void test_removeOverlap_ShortKmerNotAnchored(CuTest *testCase) {
+	Params *params = params_readParams(polishParamsFile);
+	PolishParams *polishParams = params->polishParams;
+
+	for (int64_t test = 0; test < 100; test++) {
+		// Make overlapping prefix and suffix strings from a common sequence
+		int64_t length = st_randomInt(500, 2000);
+		char *sequence = getRandomACGTSequence(length);
+		int64_t overlap = st_randomInt(150, 250);
+		int64_t prefixLength = st_randomInt(overlap, length);
+		char *prefixString = stString_getSubString(sequence, 0, prefixLength);
+		char *suffixString = stString_copy(&(sequence[prefixLength - overlap]));
+
+		// Substitute every tenth base of the overlap, so the strings share no k-mer on the true diagonal
+		for (int64_t k = 5; k < overlap; k += 10) {
+			suffixString[k] = suffixString[k] == 'A' ? 'C' : 'A';
+		}
+
+		// Copy a lone 20-mer of the prefix string into the suffix string, long enough to seed but too short
+		// to be trusted, either close to the true diagonal or far from it
+		int64_t shift = test % 2 == 0 ? 25 : 100;
+		int64_t x = st_randomInt(0, overlap - shift - 20);
+		memcpy(&(suffixString[x + shift]), &(prefixString[prefixLength - overlap + x]), 20);
+
+		// Run overlap remover
+		int64_t prefixStringCropEnd, suffixStringCropStart;
+		removeOverlap(prefixString, suffixString, overlap, polishParams,
+					  &prefixStringCropEnd, &suffixStringCropStart);
+
+		// Check the split point is on the true diagonal, not the shared k-mer's
+		CuAssertIntEquals(testCase, prefixLength - overlap, prefixStringCropEnd - suffixStringCropStart);
+
+		free(sequence);
+		free(prefixString);
+		free(suffixString);
+	}
+
+	params_destruct(params);
+}
+
 void test_removeOverlap_RandomExamples(CuTest *testCase) {
 	Params *params = params_readParams(polishParamsFile);
 	PolishParams *polishParams = params->polishParams;
@@ -1197,8 +1639,15 @@ CuSuite* polisherTestSuite(void) {
     SUITE_ADD_TEST(suite, test_addInsert);
     SUITE_ADD_TEST(suite, test_removeDelete);
     SUITE_ADD_TEST(suite, test_polishParams);
+    SUITE_ADD_TEST(suite, test_repeatSubMatrix_repeatCountHistogram);
+    SUITE_ADD_TEST(suite, test_getKBestCandidateConsensusSubstrings);
+    SUITE_ADD_TEST(suite, test_getKBestCandidateConsensusSubstringsExhaustive);
+    SUITE_ADD_TEST(suite, test_bamChunkReadSubstring_views);
+    SUITE_ADD_TEST(suite, test_forwardScoreCache);
     SUITE_ADD_TEST(suite, test_removeOverlapExample);
     SUITE_ADD_TEST(suite, test_removeOverlap_RandomExamples);
+    SUITE_ADD_TEST(suite, test_removeOverlap_KmerAnchoredExamples);
+    SUITE_ADD_TEST(suite, test_removeOverlap_ShortKmerNotAnchored);
     SUITE_ADD_TEST(suite, test_binomialPValue);
 //	SUITE_ADD_TEST(suite, test_poa_realignIterative); //todo this fails when there is an "N" in a read
     SUITE_ADD_TEST(suite, test_poa_realign_ecoli_examples_rle);
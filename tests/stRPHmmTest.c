@@ -363,12 +363,11 @@ static void test_systemTest(CuTest *testCase, int64_t minReferenceSeqNumber, int
                 }
 
                 // Check cells in column
-                stRPCell *cell = column->head;
-                while(cell != NULL) {
+                CuAssertTrue(testCase, column->cellNo > 0);
+                CuAssertTrue(testCase, column->cellNo <= column->cellCapacity);
+                for(int64_t j=0; j<column->cellNo; j++) {
                     // Check that partition is properly specified
-                    CuAssertIntEquals(testCase, cell->partition >> column->depth, 0);
-
-                    cell = cell->nCell;
+                    CuAssertIntEquals(testCase, column->cells[j].partition >> column->depth, 0);
                 }
 
                 if(column->nColumn == NULL) {
@@ -411,27 +410,19 @@ static void test_systemTest(CuTest *testCase, int64_t minReferenceSeqNumber, int
                     }
                 }
 
-                // Check merge cells are same in both the from and to sets
-                stList *mCellsFrom = stHash_getValues(mColumn->mergeCellsFrom);
-                stList *mCellsTo = stHash_getValues(mColumn->mergeCellsTo);
-                stSet *mCellsFromSet = stList_getSet(mCellsFrom);
-                stSet *mCellsToSet = stList_getSet(mCellsTo);
-                CuAssertTrue(testCase, stSet_equals(mCellsFromSet, mCellsToSet));
-                // Clean up
-                stSet_destruct(mCellsFromSet);
-                stSet_destruct(mCellsToSet);
-                stList_destruct(mCellsFrom);
-                stList_destruct(mCellsTo);
-
                 // Check merge cells
-                stRPMergeCell *mCell;
-                stHashIterator *it = stHash_getIterator(mColumn->mergeCellsFrom);
-                while((mCell = stHash_getNext(it)) != NULL) {
+                for(int64_t j=0; j<mColumn->mergeCellNo; j++) {
+                    stRPMergeCell *mCell = &mColumn->mergeCells[j];
                     // Check partitions
                     CuAssertTrue(testCase, (mCell->fromPartition & mColumn->maskFrom) == mCell->fromPartition);
                     CuAssertTrue(testCase, (mCell->toPartition & mColumn->maskTo) == mCell->toPartition);
+
+                    // Check merge cell is indexed by both its from and to partitions
+                    stRPCell fromCell = { mCell->fromPartition, 0.0, 0.0 };
+                    stRPCell toCell = { mCell->toPartition, 0.0, 0.0 };
+                    CuAssertPtrEquals(testCase, mCell, stRPMergeColumn_getNextMergeCell(&fromCell, mColumn));
+                    CuAssertPtrEquals(testCase, mCell, stRPMergeColumn_getPreviousMergeCell(&toCell, mColumn));
                 }
-                stHash_destructIterator(it);
 
             }
 
@@ -464,14 +455,12 @@ static void test_systemTest(CuTest *testCase, int64_t minReferenceSeqNumber, int
                         column->totalLogProb, 0.1);
 
                 // Check posterior probabilities
-                stRPCell *cell = column->head;
                 double totalProb = 0.0;
-                while(cell != NULL) {
-                    double posteriorProb = stRPCell_posteriorProb(cell, column);
+                for(int64_t j=0; j<column->cellNo; j++) {
+                    double posteriorProb = stRPCell_posteriorProb(&column->cells[j], column);
                     CuAssertTrue(testCase, posteriorProb >= 0.0);
                     CuAssertTrue(testCase, posteriorProb <= 1.0);
                     totalProb += posteriorProb;
-                    cell = cell->nCell;
                 }
 
 				if(!maxNotSumTransitions) {
@@ -485,16 +474,13 @@ static void test_systemTest(CuTest *testCase, int64_t minReferenceSeqNumber, int
                 stRPMergeColumn *mColumn = column->nColumn;
 
                 // Check posterior probabilities of merge cells
-                stRPMergeCell *mCell;
-                stHashIterator *it = stHash_getIterator(mColumn->mergeCellsFrom);
                 totalProb = 0.0;
-                while((mCell = stHash_getNext(it)) != NULL) {
-                    double posteriorProb = stRPMergeCell_posteriorProb(mCell, mColumn);
+                for(int64_t j=0; j<mColumn->mergeCellNo; j++) {
+                    double posteriorProb = stRPMergeCell_posteriorProb(&mColumn->mergeCells[j], mColumn);
                     CuAssertTrue(testCase, posteriorProb >= 0.0);
                     CuAssertTrue(testCase, posteriorProb <= 1.0);
                     totalProb += posteriorProb;
                 }
-                stHash_destructIterator(it);
                 if(!maxNotSumTransitions) {
                 	CuAssertDblEquals(testCase, 1.0, totalProb, 0.1);
                 }
@@ -517,16 +503,7 @@ static void test_systemTest(CuTest *testCase, int64_t minReferenceSeqNumber, int
                 stRPCell *cell = stList_get(traceBackPath, j);
 
                 // Must belong to the given column
-                stRPCell *cell2 = column->head;
-                bool inColumn = 0;
-                while((cell2 != NULL)) {
-                    if(cell == cell2) {
-                        inColumn = 1;
-                        break;
-                    }
-                    cell2 = cell2->nCell;
-                }
-                CuAssertTrue(testCase, inColumn);
+                CuAssertTrue(testCase, cell >= column->cells && cell < column->cells + column->cellNo);
 
                 // Must be compatible with previous cell (i.e. point to the same merge cell)
                 if(j > 0) {
@@ -847,6 +824,82 @@ void test_systemMultipleReferences(CuTest *testCase) {
             minReadCoverageToSupportPhasingBetweenHeterozygousSites, printHmm);
 }
 
+void test_forwardBeam(CuTest *testCase) {
+    /*
+     * Checks that with a beam width set the forward pass never retains more than the beam width
+     * number of cells per column, that forward and backward still agree over the retained cells,
+     * and that the traceback remains a valid path through the retained cells.
+     */
+    for(int64_t test=0; test<RANDOM_TEST_NO; test++) {
+        stRPHmmParameters *params = getHmmParams(50, 0.05, 0, 0);
+        params->beamWidth = 8;
+
+        stList *referenceSeqs = stList_construct3(0, (void (*)(void *))stReference_destruct);
+        stList *hapSeqs1 = stList_construct3(0, free);
+        stList *hapSeqs2 = stList_construct3(0, free);
+        stList *profileSeqs1 = stList_construct3(0, (void (*)(void *))stProfileSeq_destruct);
+        stList *profileSeqs2 = stList_construct3(0, (void (*)(void *))stProfileSeq_destruct);
+
+        simulateReads(referenceSeqs, hapSeqs1, hapSeqs2, profileSeqs1, profileSeqs2,
+                      1, 1, 500, 1000, 10, 30, 50, 300, 0.05, params);
+
+        stList *profileSeqs = stList_construct();
+        stList_appendAll(profileSeqs, profileSeqs1);
+        stList_appendAll(profileSeqs, profileSeqs2);
+        stList_shuffle(profileSeqs);
+
+        stList *filteredProfileSeqs = stList_construct();
+        stList *discardedProfileSeqs = stList_construct();
+        filterReadsByCoverageDepth(profileSeqs, params, filteredProfileSeqs, discardedProfileSeqs);
+        stList *hmms = getRPHmms(filteredProfileSeqs, params);
+
+        for(int64_t i=0; i<stList_length(hmms); i++) {
+            stRPHmm *hmm = stList_get(hmms, i);
+            stRPHmm_forwardBackward(hmm);
+
+            CuAssertDblEquals(testCase, hmm->forwardLogProb, hmm->backwardLogProb, 0.1);
+            CuAssertTrue(testCase, hmm->beamDiscardedCells >= 0);
+            if(hmm->beamDiscardedCells == 0) {
+                CuAssertTrue(testCase, hmm->beamDiscardedLogProb == ST_MATH_LOG_ZERO);
+            }
+
+            stRPColumn *column = hmm->firstColumn;
+            while(1) {
+                CuAssertTrue(testCase, column->cellNo > 0);
+                CuAssertTrue(testCase, column->cellNo <= params->beamWidth);
+                if(column->nColumn == NULL) {
+                    break;
+                }
+                column = column->nColumn->nColumn;
+            }
+
+            stList *traceBackPath = stRPHmm_forwardTraceBack(hmm);
+            CuAssertIntEquals(testCase, hmm->columnNumber, stList_length(traceBackPath));
+            column = hmm->firstColumn;
+            for(int64_t j=0; j<stList_length(traceBackPath); j++) {
+                stRPCell *cell = stList_get(traceBackPath, j);
+                CuAssertTrue(testCase, cell >= column->cells && cell < column->cells + column->cellNo);
+                if(j+1 < stList_length(traceBackPath)) {
+                    column = column->nColumn->nColumn;
+                }
+            }
+            stList_destruct(traceBackPath);
+        }
+
+        // Cleanup
+        stList_destruct(hmms);
+        stList_destruct(discardedProfileSeqs);
+        stList_destruct(filteredProfileSeqs);
+        stList_destruct(profileSeqs);
+        stList_destruct(referenceSeqs);
+        stList_destruct(hapSeqs1);
+        stList_destruct(hapSeqs2);
+        stList_destruct(profileSeqs1);
+        stList_destruct(profileSeqs2);
+        stRPHmmParameters_destruct(params);
+    }
+}
+
 void test_popCount64(CuTest *testCase) {
     CuAssertIntEquals(testCase, popcount64(0), 0);
     CuAssertIntEquals(testCase, popcount64(1), 1);
@@ -923,6 +976,53 @@ void test_bitCountVectors(CuTest *testCase) {
     }
 }
 
+void test_getLogProbsOfAllele(CuTest *testCase) {
+    /*
+     * Checks the batched allele probability kernel agrees with the per-partition calculation.
+     */
+    for(int64_t test=0; test<100; test++) {
+        uint64_t depth = st_randomInt(0, 64);
+        stReference *ref = getRandomReference("ref", (uint64_t) st_randomInt(1, 10));
+
+        uint8_t **seqs = st_malloc(sizeof(uint8_t *) * depth);
+        for(int64_t i=0; i<depth; i++) {
+            seqs[i] = st_calloc(ref->totalAlleles, sizeof(uint8_t));
+            for(int64_t j=0; j<ref->totalAlleles; j++) {
+                seqs[i][j] = (uint8_t) st_randomInt(0, 255);
+            }
+        }
+        uint64_t *countBitVectors = calculateCountBitVectors(seqs, ref, 0, ref->length, depth);
+
+        // Odd numbers of partitions exercise the remainder handling of the vectorized kernels
+        int64_t partitionNo = st_randomInt(1, 3 * EMISSION_PARTITION_BLOCK_SIZE);
+        uint64_t partitions[partitionNo];
+        for(int64_t k=0; k<partitionNo; k++) {
+            partitions[k] = getRandomPartition(depth);
+        }
+
+        for(int64_t i=0; i<ref->length; i++) {
+            for(int64_t j=0; j<ref->sites[i].alleleNumber; j++) {
+                uint64_t negLogProbs[2 * partitionNo];
+                getLogProbsOfAllele(countBitVectors, partitions, partitionNo, ref->sites[i].alleleOffset, j,
+                        negLogProbs, 2);
+                for(int64_t k=0; k<partitionNo; k++) {
+                    CuAssertIntEquals(testCase,
+                                      (int) getLogProbOfAllele(countBitVectors, depth, partitions[k], ref->sites[i].alleleOffset, j),
+                                      (int) negLogProbs[2 * k]);
+                }
+            }
+        }
+
+        // Cleanup
+        for(int64_t i=0; i<depth; i++) {
+            free(seqs[i]);
+        }
+        free(seqs);
+        free(countBitVectors);
+        stReference_destruct(ref);
+    }
+}
+
 void buildComponent(stRPHmm *hmm1, stSortedSet *component, stSet *seen) {
     stSet_insert(seen, hmm1);
     stSortedSetIterator *it = stSortedSet_getIterator(component);
@@ -1206,11 +1306,13 @@ CuSuite *stRPHmmTestSuite(void) {
     SUITE_ADD_TEST(suite, test_systemSingleReferenceFixedLengthReads);
     SUITE_ADD_TEST(suite, test_systemSingleReference);
     SUITE_ADD_TEST(suite, test_systemMultipleReferences);
+    SUITE_ADD_TEST(suite, test_forwardBeam);
 
     // Constituent function tests
     SUITE_ADD_TEST(suite, test_flipAReadsPartition);
     SUITE_ADD_TEST(suite, test_popCount64);
     SUITE_ADD_TEST(suite, test_bitCountVectors);
+    SUITE_ADD_TEST(suite, test_getLogProbsOfAllele);
     SUITE_ADD_TEST(suite, test_getOverlappingComponents);
 
     return suite;